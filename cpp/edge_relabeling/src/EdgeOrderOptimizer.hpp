@@ -0,0 +1,309 @@
+// ============================================================================
+// EdgeOrderOptimizer.hpp
+// ============================================================================
+//
+// What this file does:
+//   Refines the edge order produced by convertEdgePermutation so that the
+//   spanning-tree ZDD built over it (Phase 4) has a narrow frontier.
+//   Candidate orders are scored with a frontier-width profile and improved
+//   by a deterministic local search (swaps and block moves). Optionally, a
+//   truncated count-only frontier DP predicts the ZDD node count of the
+//   best candidates and picks the smallest.
+//
+// このファイルの役割:
+//   convertEdgePermutation が出力した辺順序を、その上に構築される全域木 ZDD
+//   （Phase 4）のフロンティアが狭くなるよう改良する。候補の順序は
+//   フロンティア幅のプロファイルで評価し、決定的な局所探索（交換と
+//   ブロック移動）で改善する。オプションで、打ち切り付きの要素数のみの
+//   フロンティア DP により上位候補の ZDD ノード数を予測し、最小のものを選ぶ。
+//
+// Responsibility:
+//   - Frontier model matches the frontier-based ZDD construction: a vertex
+//     is active from its first incident edge to its last one
+//   - Same input always yields the same order (fixed seed, fixed budget)
+//   - Does NOT change the edge set, only its order
+//
+// 責任範囲:
+//   - フロンティアのモデルはフロンティア法による ZDD 構築と一致:
+//     頂点は最初の接続辺から最後の接続辺まで活性
+//   - 同じ入力からは常に同じ順序を返す（固定シード・固定の反復回数）
+//   - 辺集合は変えず、順序のみを変更
+//
+// ============================================================================
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// OrderScore
+// ============================================================================
+//
+// Frontier profile of an edge order. width is the largest number of active
+// vertices while processing an edge; weight sums 2^(active vertices) over
+// all edges, a proxy for the number of ZDD nodes. Orders are compared by
+// width first, then weight.
+//
+// 辺順序のフロンティアプロファイル。width は辺を処理する間の活性頂点数の
+// 最大値、weight は全辺にわたる 2^(活性頂点数) の和（ZDD ノード数の代理指標）。
+// 順序は width、次に weight で比較する。
+//
+// ============================================================================
+struct OrderScore {
+    int width;
+    double weight;
+
+    bool operator<(const OrderScore& o) const {
+        if (width != o.width) return width < o.width;
+        return weight < o.weight;
+    }
+};
+
+class EdgeOrderOptimizer {
+public:
+    typedef std::pair<int, int> Edge;
+
+private:
+    int num_vertices;
+    std::vector<int> degree;
+
+    // probeNodes: fresh labels are FRESH_LABEL + slot, above any canonical
+    // label 1..width / probeNodes: 新しいラベルは FRESH_LABEL + 位置で、
+    // 正規ラベル 1..幅 より常に大きい
+    static const int FRESH_LABEL = 0x8000;
+
+    // Scratch buffers reused by score() / score() で再利用する作業領域
+    mutable std::vector<int> remaining;
+    mutable std::vector<char> seen;
+
+public:
+    EdgeOrderOptimizer(int num_vertices, const std::vector<Edge>& edges)
+        : num_vertices(num_vertices), degree(num_vertices, 0),
+          remaining(num_vertices), seen(num_vertices) {
+        for (const Edge& e : edges) {
+            ++degree[e.first];
+            ++degree[e.second];
+        }
+    }
+
+    // ========================================================================
+    // score
+    // ========================================================================
+    OrderScore score(const std::vector<Edge>& order) const {
+        std::copy(degree.begin(), degree.end(), remaining.begin());
+        std::fill(seen.begin(), seen.end(), 0);
+        OrderScore s = {0, 0.0};
+        int active = 0;
+        for (const Edge& e : order) {
+            if (!seen[e.first]) { seen[e.first] = 1; ++active; }
+            if (!seen[e.second]) { seen[e.second] = 1; ++active; }
+            s.width = std::max(s.width, active);
+            s.weight += double(1ULL << std::min(active, 63));
+            if (--remaining[e.first] == 0) --active;
+            if (--remaining[e.second] == 0) --active;
+        }
+        return s;
+    }
+
+    // ========================================================================
+    // probeNodes
+    // ========================================================================
+    //
+    // Count-only frontier DP for spanning trees: the number of distinct
+    // connectivity states of the frontier summed over all edges, i.e. the
+    // node count of the unreduced ZDD. Returns -1 as soon as one level holds
+    // more than max_states states (truncated probe).
+    //
+    // 全域木に対する要素数のみのフロンティア DP: フロンティアの連結状態の
+    // 異なるものの数を全辺にわたり合計したもの（既約化前の ZDD のノード数）。
+    // いずれかのレベルの状態数が max_states を超えた時点で -1 を返す
+    // （打ち切り付きの予測）。
+    //
+    // ========================================================================
+    int64_t probeNodes(const std::vector<Edge>& order, size_t max_states) const {
+        std::vector<int> left(degree);
+        std::vector<int> frontier;         // Active vertices / 活性頂点
+        std::vector<int> slot(num_vertices, -1);
+        int unseen = num_vertices;
+
+        // State: component label per frontier slot, canonical (first
+        // occurrence order, 1..width); 16-bit labels so wide frontiers
+        // cannot wrap / 状態: フロンティアの各位置の成分ラベル（初出順で
+        // 正規化、1..幅）。広いフロンティアでも折り返さないよう 16 ビット
+        if (num_vertices >= FRESH_LABEL) return -1;
+        std::unordered_set<std::u16string> level, next;
+        level.insert(std::u16string());
+        int64_t nodes = 0;
+
+        for (const Edge& e : order) {
+            const int u = e.first, v = e.second;
+            for (int x : {u, v}) {
+                if (slot[x] >= 0) continue;
+                slot[x] = frontier.size();
+                frontier.push_back(x);
+                --unseen;
+            }
+            nodes += level.size();
+
+            // Vertices leaving after this edge / この辺の後に離脱する頂点
+            --left[u];
+            --left[v];
+            std::vector<char> leaving(frontier.size(), 0);
+            for (int x : {u, v}) {
+                if (left[x] == 0) leaving[slot[x]] = 1;
+            }
+
+            next.clear();
+            std::u16string state;
+            for (const std::u16string& base : level) {
+                for (int take = 0; take < 2; ++take) {
+                    // New vertices get fresh labels above the canonical
+                    // range / 新しい頂点には正規ラベルより上の新しいラベル
+                    state = base;
+                    while (state.size() < frontier.size()) state.push_back(char16_t(FRESH_LABEL + state.size()));
+                    char16_t lu = state[slot[u]], lv = state[slot[v]];
+                    if (take) {
+                        if (lu == lv) continue;  // Cycle / 閉路
+                        for (char16_t& c : state) if (c == lv) c = lu;
+                    }
+                    if (!leave(state, leaving, unseen)) continue;
+                    next.insert(state);
+                }
+            }
+
+            // Compact the frontier / フロンティアを詰める
+            std::vector<int> kept;
+            for (size_t i = 0; i < frontier.size(); ++i) {
+                if (leaving[i]) slot[frontier[i]] = -1;
+                else {
+                    slot[frontier[i]] = kept.size();
+                    kept.push_back(frontier[i]);
+                }
+            }
+            frontier.swap(kept);
+
+            level.swap(next);
+            if (level.size() > max_states) return -1;
+        }
+        return nodes;
+    }
+
+    // ========================================================================
+    // optimize
+    // ========================================================================
+    //
+    // Local search from `order`: each step either swaps two nearby edges or
+    // moves a block of up to 8 edges by up to 16 positions, and is kept if
+    // the score does not get worse (sideways moves cross plateaus). When
+    // max_states > 0, the best orders met along the way (at most 8, plus the
+    // start) are probed with probeNodes and the one with the fewest
+    // predicted nodes wins; otherwise the best-scoring order wins.
+    //
+    // order から局所探索: 各ステップで近くの 2 辺の交換、または 8 辺以下の
+    // ブロックの 16 位置以内の移動を行い、スコアが悪化しなければ採用
+    // （横ばいの移動で平坦部を越える）。max_states > 0 のときは途中で得た
+    // 最良の順序（最大 8 個と開始時の順序）を probeNodes で評価し、予測
+    // ノード数が最小のものを選ぶ。それ以外は最良スコアの順序を選ぶ。
+    //
+    // ========================================================================
+    std::vector<Edge> optimize(const std::vector<Edge>& order, int iterations,
+                               size_t max_states = 0, uint32_t seed = 1) const {
+        const int m = order.size();
+        std::vector<Edge> current = order, best = order;
+        OrderScore current_score = score(current), best_score = current_score;
+        std::vector<std::vector<Edge>> elite;
+        std::mt19937 rng(seed);
+        std::vector<Edge> trial;
+
+        for (int it = 0; it < iterations && m > 1; ++it) {
+            trial = current;
+            if (rng() & 1) {
+                int i = rng() % m;
+                int j = std::min(m - 1, std::max(0, i + int(rng() % 9) - 4));
+                if (i == j) continue;
+                std::swap(trial[i], trial[j]);
+            } else {
+                int len = 1 + rng() % std::min(8, m);
+                int from = rng() % (m - len + 1);
+                int to = std::min(m - len, std::max(0, from + int(rng() % 33) - 16));
+                if (from == to) continue;
+                std::vector<Edge> block(trial.begin() + from, trial.begin() + from + len);
+                trial.erase(trial.begin() + from, trial.begin() + from + len);
+                trial.insert(trial.begin() + to, block.begin(), block.end());
+            }
+
+            OrderScore s = score(trial);
+            if (current_score < s) continue;
+            current.swap(trial);
+            current_score = s;
+            if (current_score < best_score) {
+                best = current;
+                best_score = current_score;
+                if (max_states > 0) {
+                    if (elite.size() == 8) elite.erase(elite.begin());
+                    elite.push_back(best);
+                }
+            }
+        }
+
+        if (max_states == 0) return best;
+
+        // Probe the start and the elite, newest first / 開始時の順序と上位候補を評価
+        elite.insert(elite.begin(), order);
+        std::vector<Edge> winner = best;
+        int64_t winner_nodes = -1;
+        for (auto it = elite.rbegin(); it != elite.rend(); ++it) {
+            int64_t nodes = probeNodes(*it, max_states);
+            if (nodes >= 0 && (winner_nodes < 0 || nodes < winner_nodes)) {
+                winner = *it;
+                winner_nodes = nodes;
+            }
+        }
+        return winner;
+    }
+
+private:
+    // Drop leaving vertices from a state; false if a component is closed
+    // while the tree cannot be finished / 離脱する頂点を状態から除く。
+    // 木を完成できないのに成分が閉じる場合は false
+    static bool leave(std::u16string& state, const std::vector<char>& leaving, int unseen) {
+        std::u16string kept;
+        bool closed = false;
+        for (size_t i = 0; i < state.size(); ++i) {
+            if (leaving[i]) continue;
+            kept.push_back(state[i]);
+        }
+        for (size_t i = 0; i < state.size(); ++i) {
+            if (!leaving[i] || kept.find(state[i]) != std::u16string::npos) continue;
+            // Component of a leaving vertex has no active member left
+            // 離脱する頂点の成分に活性な頂点が残らない
+            bool again = false;
+            for (size_t j = 0; j < i; ++j) again |= leaving[j] && state[j] == state[i];
+            if (!again) {
+                if (closed) return false;
+                closed = true;
+            }
+        }
+        if (closed && (!kept.empty() || unseen > 0)) return false;
+
+        // Canonical labels; kept is at most the frontier width, so a linear
+        // lookup is enough / 正規化したラベル。kept はフロンティア幅以下
+        // なので線形探索で足りる
+        std::u16string from;
+        for (char16_t& c : kept) {
+            size_t k = from.find(c);
+            if (k == std::u16string::npos) {
+                k = from.size();
+                from.push_back(c);
+            }
+            c = char16_t(1 + k);
+        }
+        state.swap(kept);
+        return true;
+    }
+};
@@ -5,24 +5,26 @@
 // What this file does:
 //   Wrapper for lib/decompose to perform pathwidth-based edge reordering.
 //   Reads .grh file from stdin, optimizes edge order, outputs to stdout.
+//   With --manifest, relabels many .grh files concurrently in one process.
 //
 // このファイルの役割:
 //   lib/decompose のラッパーでパス幅に基づく辺順序の最適化を実行。
 //   stdin から .grh ファイルを読み込み、辺順序を最適化し、stdout に出力。
+//   --manifest 指定時は、1 プロセスで多数の .grh ファイルを並行して処理。
 //
 // Responsibility in the project:
-//   - Invokes lib/decompose (external black-box program)
+//   - Runs the lib/decompose path decomposition (compiled in)
 //   - Converts vertex ordering to edge ordering via convertEdgePermutation
+//   - Refines the edge ordering for the frontier width (EdgeOrderOptimizer)
 //   - Outputs .grh file in the same format as input (p edge header + e lines)
 //   - Converts internal 0-indexed vertices back to 1-indexed for output
-//   - Does NOT modify the decompose algorithm itself
 //
 // プロジェクト内での責務:
-//   - lib/decompose（外部ブラックボックスプログラム）を呼び出し
+//   - lib/decompose のパス分解を実行（組み込み）
 //   - convertEdgePermutation により頂点順序を辺順序に変換
+//   - 辺順序をフロンティア幅について改良（EdgeOrderOptimizer）
 //   - 入力と同じ形式（p edge ヘッダー + e 行）で .grh ファイルを出力
 //   - 内部の 0-indexed 頂点を出力用に 1-indexed に変換
-//   - decompose アルゴリズム自体は変更しない
 //
 // Phase 1 における位置づけ:
 //   Core binary for Phase 1 edge relabeling.
@@ -32,76 +34,323 @@
 //
 // ============================================================================
 
+#include <atomic>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 #include "../../../lib/decompose/graph.cpp"
 #include "../../../lib/decompose/decompose.cpp"
 #include "../../../lib/decompose/convertEdgePermutation.cpp"
+#include "EdgeOrderOptimizer.hpp"
 
 using namespace std;
 
+struct Options {
+    int num_threads = 1;
+    double time_limit = 30.0;
+    int gap = 0;
+    int order_iterations = 0;
+    long long probe_states = 0;
+};
+
 // ============================================================================
-// main function
+// relabel
 // ============================================================================
 //
-// Input:
-//   .grh file from stdin (p edge header + e lines, 1-indexed vertices)
-//
-// 入力:
-//   stdin からの .grh ファイル（p edge ヘッダー + e 行、1-indexed 頂点）
-//
-// Output:
-//   Optimized .grh file to stdout (same format, reordered edges)
-//
-// 出力:
-//   stdout への最適化された .grh ファイル（同じ形式、辺の順序が変更）
-//
-// Processing:
-//   1. Read graph from stdin (readGraph converts 1-indexed to 0-indexed internally)
-//   2. Run decompose with time limit 30s and beam width 60
-//   3. Convert vertex ordering to edge ordering
-//   4. Validate edge count consistency
-//   5. Output header and edges (convert back to 1-indexed)
+// Decompose one graph read from `in` and write the reordered .grh to `out`.
+// Summary and error lines go to `log`. Holds no shared state, so several
+// calls may run concurrently. Returns 0 on success.
 //
-// 処理:
-//   1. stdin からグラフを読み込み（readGraph が内部で 1-indexed を 0-indexed に変換）
-//   2. 時間制限 30 秒、ビーム幅 60 で decompose を実行
-//   3. 頂点順序を辺順序に変換
-//   4. 辺数の一貫性を検証
-//   5. ヘッダーと辺を出力（1-indexed に変換し直す）
+// `in` から読んだ 1 つのグラフを分解し、並べ替えた .grh を `out` に出力。
+// 要約とエラーの行は `log` へ。共有状態を持たないため、複数の呼び出しを
+// 並行に実行できる。成功時は 0 を返す。
 //
 // ============================================================================
-int main() {
-    // 標準入力からグラフを読み込む
-    // Read graph from stdin
-    Graph G = readGraph();
+int relabel(FILE* in, ostream& out, ostream& log, const Options& opt) {
+    // グラフを読み込む
+    // Read graph
+    Graph G = readGraph(in);
     
-    // パス分解を実行（時間制限: 30秒、ビーム幅: 60）
-    // Run path decomposition (time limit: 30s, beam width: 60)
-    auto res = decompose(G, 30.0, 60);
+    // パス分解を実行（ビーム幅: 60、最適性の証明または時間制限で終了）
+    // Run path decomposition (beam width: 60, ends on proven optimum or time limit)
+    DecomposeResult res = decomposeWithBounds(G, opt.time_limit, 60, opt.num_threads, opt.gap);
+    
+    log << "decompose: width=" << res.width
+        << " lower_bound=" << res.lowerBound
+        << " gap=" << res.width - res.lowerBound
+        << " optimal=" << (res.optimal ? "yes" : "no")
+        << " time_to_best=" << res.timeToBest
+        << " elapsed=" << res.elapsed << endl;
     
     // 頂点順序から辺順序を計算
     // Convert vertex ordering to edge ordering
-    vector<pair<int, int>> edgePermutation = convertEdgePermutation(G, res);
+    vector<pair<int, int>> edgePermutation = convertEdgePermutation(G, res.order);
+    
+    // 辺順序をフロンティア幅について改良
+    // Refine the edge ordering for the frontier width
+    EdgeOrderOptimizer optimizer(G.numVertices(), edgePermutation);
+    OrderScore initial = optimizer.score(edgePermutation);
+    vector<pair<int, int>> initialPermutation = edgePermutation;
+    edgePermutation = optimizer.optimize(edgePermutation, opt.order_iterations, opt.probe_states);
+    OrderScore refined = optimizer.score(edgePermutation);
+    
+    log << "edge_order: frontier_width=" << refined.width
+        << " initial_frontier_width=" << initial.width
+        << " weight=" << (long long)refined.weight
+        << " initial_weight=" << (long long)initial.weight;
+    if (opt.probe_states > 0) {
+        log << " predicted_nodes=" << optimizer.probeNodes(edgePermutation, opt.probe_states)
+            << " initial_predicted_nodes=" << optimizer.probeNodes(initialPermutation, opt.probe_states);
+    }
+    log << endl;
     
     // 辺数の検証
     // Validate edge count
     if (edgePermutation.size() != G.numEdges()) {
-        cerr << "Error: edgePermutation size (" << edgePermutation.size() 
-             << ") != G.numEdges() (" << G.numEdges() << ")" << endl;
+        log << "Error: edgePermutation size (" << edgePermutation.size() 
+            << ") != G.numEdges() (" << G.numEdges() << ")" << endl;
         return 1;
     }
     
     // ヘッダーを出力（p edge <頂点数> <辺数>）
     // Output header (p edge <num_vertices> <num_edges>)
-    cout << "p edge " << G.numVertices() << ' ' << edgePermutation.size() << endl;
+    out << "p edge " << G.numVertices() << ' ' << edgePermutation.size() << '\n';
     
     // 最適化された辺順序を出力（e u v 形式、1-indexed）
     // Output optimized edge ordering (e u v format, 1-indexed)
     for (size_t i = 0; i < edgePermutation.size(); ++i) {
         int u = edgePermutation[i].first;
         int v = edgePermutation[i].second;
-        cout << "e " << u+1 << ' ' << v+1 << endl;
+        out << "e " << u+1 << ' ' << v+1 << '\n';
     }
+    out.flush();
     
     return 0;
 }
+
+// ============================================================================
+// run_manifest
+// ============================================================================
+//
+// Relabel every "<input.grh> <output.grh>" line of the manifest (blank lines
+// and lines starting with # are skipped) on `jobs` worker threads. Each
+// graph's log is printed as one block, headed by
+//   job: input=IN output=OUT status=ok|error
+// in completion order. Returns 0 only if every job succeeded.
+//
+// マニフェストの各 "<input.grh> <output.grh>" 行（空行と # で始まる行は
+// 無視）を jobs 個のワーカスレッドで処理する。各グラフのログは上記の
+// job: 行を先頭とする 1 ブロックとして完了順に出力。全ジョブが成功した
+// 場合のみ 0 を返す。
+//
+// ============================================================================
+int run_manifest(istream& manifest, int jobs, const Options& opt) {
+    vector<pair<string, string>> tasks;
+    string line;
+    while (getline(manifest, line)) {
+        istringstream fields(line);
+        string input, output, extra;
+        if (!(fields >> input) || input[0] == '#') continue;
+        if (!(fields >> output) || (fields >> extra)) {
+            cerr << "Error: Manifest line must be \"<input.grh> <output.grh>\": " << line << endl;
+            return 1;
+        }
+        tasks.emplace_back(input, output);
+    }
+    
+    if (jobs <= 0) jobs = max(1u, thread::hardware_concurrency());
+    jobs = min<int>(jobs, max<size_t>(1, tasks.size()));
+    
+    atomic<size_t> next(0);
+    atomic<int> failed(0);
+    mutex log_lock;
+    auto worker = [&]() {
+        for (size_t k; (k = next++) < tasks.size(); ) {
+            const string& input = tasks[k].first;
+            const string& output = tasks[k].second;
+            ostringstream log;
+            int status = 1;
+            FILE* in = fopen(input.c_str(), "r");
+            if (!in) {
+                log << "Error: Cannot open " << input << endl;
+            } else {
+                ofstream out(output);
+                if (!out) {
+                    log << "Error: Cannot create " << output << endl;
+                } else {
+                    status = relabel(in, out, log, opt);
+                    if (status == 0 && !out) {
+                        log << "Error: Failed to write " << output << endl;
+                        status = 1;
+                    }
+                }
+                fclose(in);
+            }
+            if (status != 0) ++failed;
+            
+            lock_guard<mutex> guard(log_lock);
+            cerr << "job: input=" << input << " output=" << output
+                 << " status=" << (status == 0 ? "ok" : "error") << '\n'
+                 << log.str() << flush;
+        }
+    };
+    
+    vector<thread> threads;
+    for (int t = 1; t < jobs; ++t) threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads) t.join();
+    
+    return failed.load() == 0 ? 0 : 1;
+}
+
+// ============================================================================
+// main function
+// ============================================================================
+//
+// Input:
+//   .grh file from stdin (p edge header + e lines, 1-indexed vertices)
+//   --manifest F: relabel every "<input.grh> <output.grh>" line of F
+//                (- = stdin) instead of stdin → stdout
+//   --jobs N:    graphs relabeled concurrently with --manifest
+//                (default 1, 0 = all hardware threads)
+//   --threads N: branch-and-bound threads (default 1 = sequential and
+//                deterministic, 0 = all hardware threads)
+//   --time S:    time limit in seconds (default 30)
+//   --gap K:     stop as soon as the width is within K of the lower bound
+//                (default 0 = only stop early on a proven optimum)
+//   --order-iterations N: local search steps on the edge order
+//                (default 0 = keep the convertEdgePermutation order)
+//   --probe-states K: predict ZDD node counts with a count-only DP,
+//                abandoning a candidate above K states per level
+//                (default 0 = off, rank by frontier width only)
+//
+// 入力:
+//   stdin からの .grh ファイル（p edge ヘッダー + e 行、1-indexed 頂点）
+//   --manifest F: F（- = stdin）の各 "<input.grh> <output.grh>" 行を処理
+//                （stdin → stdout の代わりに）
+//   --jobs N:    --manifest で並行に処理するグラフ数
+//                （デフォルト 1、0 = 全ハードウェアスレッド）
+//   --threads N: 分枝限定法のスレッド数（デフォルト 1 = 逐次・決定的、
+//                0 = 全ハードウェアスレッド）
+//   --time S:    時間制限（秒、デフォルト 30）
+//   --gap K:     幅が下界から K 以内になった時点で停止
+//                （デフォルト 0 = 最適性が証明されたときのみ早期停止）
+//   --order-iterations N: 辺順序の局所探索のステップ数
+//                （デフォルト 0 = convertEdgePermutation の順序のまま）
+//   --probe-states K: 要素数のみの DP で ZDD ノード数を予測し、
+//                1 レベルあたり K 状態を超えた候補は打ち切る
+//                （デフォルト 0 = 無効、フロンティア幅のみで順位付け）
+//
+// Output:
+//   Optimized .grh file to stdout (same format, reordered edges)
+//   One summary line to stderr:
+//     decompose: width=W lower_bound=L gap=G optimal=yes|no
+//                time_to_best=T elapsed=E
+//   and one for the edge order (predicted_nodes only with --probe-states,
+//   -1 when the probe was truncated):
+//     edge_order: frontier_width=F initial_frontier_width=F0 weight=X
+//                 initial_weight=X0 [predicted_nodes=N initial_predicted_nodes=N0]
+//
+// 出力:
+//   stdout への最適化された .grh ファイル（同じ形式、辺の順序が変更）
+//   stderr への探索と辺順序の要約各 1 行（上記の形式）
+//   With --manifest: one output file per line, and per graph a "job:" line
+//   followed by its summary lines (see run_manifest)
+//   --manifest 指定時: 行ごとに 1 つの出力ファイル、グラフごとに "job:" 行と
+//   その要約行（run_manifest を参照）
+//
+// Processing:
+//   1. Read graph from stdin (readGraph converts 1-indexed to 0-indexed internally)
+//   2. Run decompose with beam width 60 until the order is proven optimal
+//      (width == lower bound) or the time limit is reached
+//   3. Convert vertex ordering to edge ordering
+//   4. Refine the edge ordering by local search on the frontier profile
+//   5. Validate edge count consistency
+//   6. Output header and edges (convert back to 1-indexed)
+//
+// 処理:
+//   1. stdin からグラフを読み込み（readGraph が内部で 1-indexed を 0-indexed に変換）
+//   2. ビーム幅 60 で、順序の最適性が証明される（幅 == 下界）か
+//      時間制限に達するまで decompose を実行
+//   3. 頂点順序を辺順序に変換
+//   4. フロンティアプロファイルに基づく局所探索で辺順序を改良
+//   5. 辺数の一貫性を検証
+//   6. ヘッダーと辺を出力（1-indexed に変換し直す）
+//
+// ============================================================================
+int main(int argc, char **argv) {
+    // 引数解析
+    // Argument parsing
+    Options opt;
+    string manifest_path;
+    int jobs = 1;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            opt.num_threads = stoi(argv[++i]);
+            if (opt.num_threads < 0) {
+                cerr << "Error: --threads must be non-negative" << endl;
+                return 1;
+            }
+        } else if (arg == "--time" && i + 1 < argc) {
+            opt.time_limit = stod(argv[++i]);
+            if (opt.time_limit <= 0) {
+                cerr << "Error: --time must be positive" << endl;
+                return 1;
+            }
+        } else if (arg == "--gap" && i + 1 < argc) {
+            opt.gap = stoi(argv[++i]);
+            if (opt.gap < 0) {
+                cerr << "Error: --gap must be non-negative" << endl;
+                return 1;
+            }
+        } else if (arg == "--order-iterations" && i + 1 < argc) {
+            opt.order_iterations = stoi(argv[++i]);
+            if (opt.order_iterations < 0) {
+                cerr << "Error: --order-iterations must be non-negative" << endl;
+                return 1;
+            }
+        } else if (arg == "--probe-states" && i + 1 < argc) {
+            opt.probe_states = stoll(argv[++i]);
+            if (opt.probe_states < 0) {
+                cerr << "Error: --probe-states must be non-negative" << endl;
+                return 1;
+            }
+        } else if (arg == "--manifest" && i + 1 < argc) {
+            manifest_path = argv[++i];
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            jobs = stoi(argv[++i]);
+            if (jobs < 0) {
+                cerr << "Error: --jobs must be non-negative" << endl;
+                return 1;
+            }
+        } else {
+            cerr << "Error: Unexpected argument: " << arg << endl;
+            cerr << "Usage: " << argv[0] << " [--threads N] [--time S] [--gap K]"
+                 << " [--order-iterations N] [--probe-states K] < input.grh > output.grh" << endl;
+            cerr << "       " << argv[0] << " [options] --manifest FILE [--jobs N]" << endl;
+            return 1;
+        }
+    }
+
+    // マニフェストの全グラフを処理
+    // Relabel every graph of the manifest
+    if (!manifest_path.empty()) {
+        if (manifest_path == "-") return run_manifest(cin, jobs, opt);
+        ifstream manifest(manifest_path);
+        if (!manifest) {
+            cerr << "Error: Cannot open manifest " << manifest_path << endl;
+            return 1;
+        }
+        return run_manifest(manifest, jobs, opt);
+    }
+
+    // 標準入力から 1 つのグラフを処理
+    // Relabel one graph from stdin
+    return relabel(stdin, cout, cerr, opt);
+}
@@ -14,27 +14,70 @@
 //   - Provide bitwise operations for ZDD filtering
 //   - Support arbitrary bit widths in 64-bit increments
 //   - Maintain performance through inlining and compile-time optimization
+//   - Dispatch wide bitmasks to SIMD kernels (see BitKernels.hpp)
 //
 // 責任範囲:
 //   - ZDD フィルタリングのためのビット演算を提供
 //   - 64 ビット刻みで任意のビット幅をサポート
 //   - インライン化とコンパイル時最適化でパフォーマンスを維持
+//   - 幅の広いビットマスクは SIMD カーネルに委譲（BitKernels.hpp 参照）
 //
 // Design:
 //   - Template parameter N specifies number of 64-bit blocks
 //   - All operations are inlined for performance
 //   - Compatible with TdZdd's DdSpec requirements
+//   - N >= KERNEL_MIN_BLOCKS uses the runtime-selected SIMD kernels;
+//     smaller widths stay as inline loops (call overhead would dominate)
+//   - Single-bit access goes through BitPos (block index + mask), which
+//     filters precompute per level instead of building bit(pos) each time
 //
 // 設計:
 //   - テンプレートパラメータ N は 64 ビットブロックの数を指定
 //   - 全ての演算はパフォーマンスのためにインライン化
 //   - TdZdd の DdSpec 要件と互換
+//   - N >= KERNEL_MIN_BLOCKS では実行時に選択された SIMD カーネルを使用。
+//     それより小さい幅は呼び出しオーバーヘッドが支配的なためインラインループのまま
+//   - 単一ビットへのアクセスは BitPos（ブロック番号 + マスク）を通じて行い、
+//     フィルタは bit(pos) を毎回構築する代わりにレベルごとに事前計算する
 //
 // ============================================================================
 
 #pragma once
 #include <cstdint>
 #include <cstring>
+#include "BitKernels.hpp"
+
+namespace BigUIntHelper {
+    // ========================================================================
+    // BitPos: Precomputed position of a single bit
+    // BitPos: 単一ビットの事前計算済み位置
+    // ========================================================================
+    //
+    // block: Index of the 64-bit block containing the bit
+    // mask:  Mask of the bit within that block
+    //
+    // block: ビットを含む 64 ビットブロックの番号
+    // mask:  そのブロック内でのビットのマスク
+    //
+    // ========================================================================
+    struct BitPos {
+        int block;
+        uint64_t mask;
+
+        BitPos() : block(0), mask(0) {}
+        explicit BitPos(int pos)
+            : block(pos / 64), mask(1ULL << (pos % 64)) {}
+    };
+
+    // Minimum block count for which BigUInt dispatches to BitKernels. The
+    // kernel call is indirect and cannot be inlined; with -O3 the inline
+    // loops are 4-6x faster at 4-7 blocks and still ahead at 32, and the
+    // kernels win from 64 blocks.
+    // BigUInt が BitKernels に委譲する最小ブロック数。カーネル呼び出しは間接
+    // 呼び出しでインライン化できない。-O3 ではインラインループが 4-7 ブロックで
+    // 4-6 倍速く 32 でもまだ速い。カーネルは 64 ブロックから勝る。
+    constexpr size_t KERNEL_MIN_BLOCKS = 64;
+}
 
 // ============================================================================
 // BigUInt Template Class
@@ -54,6 +97,7 @@
 //   - Equality (==, !=)
 //   - Zero check (!)
 //   - Bit setting (static bit(int pos))
+//   - Single-bit test/set/clear (testBit, setBit, clearBit with BitPos)
 //
 // サポートする演算:
 //   - ビット論理和 (|=)
@@ -62,6 +106,7 @@
 //   - 等価比較 (==, !=)
 //   - ゼロチェック (!)
 //   - ビット設定 (static bit(int pos))
+//   - 単一ビットのテスト/設定/クリア（BitPos を用いる testBit, setBit, clearBit）
 //
 // ============================================================================
 template<size_t N>
@@ -111,8 +156,12 @@ public:
     //
     // ========================================================================
     inline BigUInt& operator|=(const BigUInt& rhs) {
-        for (size_t i = 0; i < N; ++i) {
-            blocks[i] |= rhs.blocks[i];
+        if constexpr (N >= BigUIntHelper::KERNEL_MIN_BLOCKS) {
+            BitKernels::active().or_assign(blocks, rhs.blocks, N);
+        } else {
+            for (size_t i = 0; i < N; ++i) {
+                blocks[i] |= rhs.blocks[i];
+            }
         }
         return *this;
     }
@@ -130,8 +179,12 @@ public:
     //
     // ========================================================================
     inline BigUInt& operator&=(const BigUInt& rhs) {
-        for (size_t i = 0; i < N; ++i) {
-            blocks[i] &= rhs.blocks[i];
+        if constexpr (N >= BigUIntHelper::KERNEL_MIN_BLOCKS) {
+            BitKernels::active().and_assign(blocks, rhs.blocks, N);
+        } else {
+            for (size_t i = 0; i < N; ++i) {
+                blocks[i] &= rhs.blocks[i];
+            }
         }
         return *this;
     }
@@ -156,8 +209,12 @@ public:
     // ========================================================================
     inline BigUInt operator~() const {
         BigUInt result;
-        for (size_t i = 0; i < N; ++i) {
-            result.blocks[i] = ~blocks[i];
+        if constexpr (N >= BigUIntHelper::KERNEL_MIN_BLOCKS) {
+            BitKernels::active().not_copy(result.blocks, blocks, N);
+        } else {
+            for (size_t i = 0; i < N; ++i) {
+                result.blocks[i] = ~blocks[i];
+            }
         }
         return result;
     }
@@ -181,10 +238,14 @@ public:
     //
     // ========================================================================
     inline bool operator==(const BigUInt& rhs) const {
-        for (size_t i = 0; i < N; ++i) {
-            if (blocks[i] != rhs.blocks[i]) return false;
+        if constexpr (N >= BigUIntHelper::KERNEL_MIN_BLOCKS) {
+            return BitKernels::active().equal(blocks, rhs.blocks, N);
+        } else {
+            for (size_t i = 0; i < N; ++i) {
+                if (blocks[i] != rhs.blocks[i]) return false;
+            }
+            return true;
         }
-        return true;
     }
 
     // ========================================================================
@@ -224,10 +285,14 @@ public:
     //
     // ========================================================================
     inline bool operator!() const {
-        for (size_t i = 0; i < N; ++i) {
-            if (blocks[i] != 0) return false;
+        if constexpr (N >= BigUIntHelper::KERNEL_MIN_BLOCKS) {
+            return BitKernels::active().is_zero(blocks, N);
+        } else {
+            for (size_t i = 0; i < N; ++i) {
+                if (blocks[i] != 0) return false;
+            }
+            return true;
         }
-        return true;
     }
 
     // ========================================================================
@@ -246,12 +311,66 @@ public:
     // ========================================================================
     inline BigUInt operator&(const BigUInt& rhs) const {
         BigUInt result;
-        for (size_t i = 0; i < N; ++i) {
-            result.blocks[i] = blocks[i] & rhs.blocks[i];
+        if constexpr (N >= BigUIntHelper::KERNEL_MIN_BLOCKS) {
+            BitKernels::active().and_copy(result.blocks, blocks, rhs.blocks, N);
+        } else {
+            for (size_t i = 0; i < N; ++i) {
+                result.blocks[i] = blocks[i] & rhs.blocks[i];
+            }
         }
         return result;
     }
 
+    // ========================================================================
+    // Block Access
+    // ブロックアクセス
+    // ========================================================================
+    //
+    // What this does:
+    //   Read-only access to the 64-bit blocks (block 0 holds bits 0-63).
+    //   Used for hashing and chunked permutation lookup in verification.
+    //
+    // この処理の内容:
+    //   64 ビットブロックへの読み取り専用アクセス（ブロック 0 がビット 0-63）。
+    //   検証でのハッシュ計算とチャンク単位の置換テーブル参照に使用。
+    //
+    // ========================================================================
+    inline uint64_t word(size_t i) const {
+        return blocks[i];
+    }
+
+    // ========================================================================
+    // Single-Bit Access via BitPos
+    // BitPos による単一ビットアクセス
+    // ========================================================================
+    //
+    // What this does:
+    //   Test, set or clear one bit using a precomputed BitPos.
+    //   Touches only one block, unlike operations with bit(pos) which
+    //   build and combine a whole N-block temporary.
+    //   Positions outside the N*64-bit range behave like bit(pos)
+    //   (all zero): test returns false, set/clear do nothing.
+    //
+    // この処理の内容:
+    //   事前計算した BitPos を用いて 1 ビットをテスト・設定・クリア。
+    //   N ブロック全体の一時オブジェクトを構築・結合する bit(pos) による
+    //   演算と異なり、1 ブロックのみにアクセスする。
+    //   N*64 ビットの範囲外の位置は bit(pos)（全ゼロ）と同様に振る舞う:
+    //   test は false を返し、set/clear は何もしない。
+    //
+    // ========================================================================
+    inline bool testBit(const BigUIntHelper::BitPos& p) const {
+        return p.block < static_cast<int>(N) && (blocks[p.block] & p.mask) != 0;
+    }
+
+    inline void setBit(const BigUIntHelper::BitPos& p) {
+        if (p.block < static_cast<int>(N)) blocks[p.block] |= p.mask;
+    }
+
+    inline void clearBit(const BigUIntHelper::BitPos& p) {
+        if (p.block < static_cast<int>(N)) blocks[p.block] &= ~p.mask;
+    }
+
     // ========================================================================
     // Static Bit Setting Method
     // 静的ビット設定メソッド
@@ -318,8 +437,10 @@ namespace BigUIntHelper {
     // BitMaskTraits: ビット演算の統一インターフェース
     // ========================================================================
     //
-    // Provides a uniform way to create bit masks for both uint64_t and BigUInt<N>.
-    // uint64_t と BigUInt<N> の両方に対してビットマスクを作成する統一的な方法を提供。
+    // Provides a uniform way to create bit masks for both uint64_t and BigUInt<N>,
+    // and to test/set/clear a single bit through a precomputed BitPos.
+    // uint64_t と BigUInt<N> の両方に対してビットマスクを作成し、事前計算した
+    // BitPos で単一ビットをテスト・設定・クリアする統一的な方法を提供。
     //
     // ========================================================================
     
@@ -330,6 +451,18 @@ namespace BigUIntHelper {
         static inline BitMask bit(int pos) {
             return BitMask::bit(pos);
         }
+        static inline bool isZero(const BitMask& m) {
+            return !m;
+        }
+        static inline bool test(const BitMask& m, const BitPos& p) {
+            return m.testBit(p);
+        }
+        static inline void set(BitMask& m, const BitPos& p) {
+            m.setBit(p);
+        }
+        static inline void clear(BitMask& m, const BitPos& p) {
+            m.clearBit(p);
+        }
     };
     
     // Specialization for uint64_t
@@ -339,5 +472,17 @@ namespace BigUIntHelper {
         static inline uint64_t bit(int pos) {
             return 1ULL << pos;
         }
+        static inline bool isZero(uint64_t m) {
+            return m == 0;
+        }
+        static inline bool test(uint64_t m, const BitPos& p) {
+            return (m & p.mask) != 0;
+        }
+        static inline void set(uint64_t& m, const BitPos& p) {
+            m |= p.mask;
+        }
+        static inline void clear(uint64_t& m, const BitPos& p) {
+            m &= ~p.mask;
+        }
     };
 }
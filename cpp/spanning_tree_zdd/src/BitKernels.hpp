@@ -0,0 +1,451 @@
+// ============================================================================
+// BitKernels.hpp
+// ============================================================================
+//
+// What this file does:
+//   Word-array bitwise kernels (OR, AND, NOT, equality, zero test) with
+//   scalar, SSE2, AVX2 and AVX-512 implementations. The best kernel set
+//   supported by the running CPU is selected once at startup.
+//
+// このファイルの役割:
+//   ワード配列に対するビット演算カーネル（OR, AND, NOT, 等価比較, ゼロ判定）を
+//   scalar, SSE2, AVX2, AVX-512 の各実装で提供。実行中の CPU がサポートする
+//   最良のカーネルセットを起動時に 1 度だけ選択する。
+//
+// Responsibility:
+//   - Provide the arithmetic backend for wide bitmasks (filter states,
+//     BigUInt<N> from KERNEL_MIN_BLOCKS words)
+//   - Detect CPU features at runtime (no -mavx2 / -mavx512f build flags needed)
+//   - Allow an explicit kernel choice for benchmarking (--simd option)
+//
+// 責任範囲:
+//   - 幅の広いビットマスク（フィルタの状態、KERNEL_MIN_BLOCKS ワード以上の
+//     BigUInt<N>）の演算バックエンドを提供
+//   - 実行時に CPU 機能を検出（-mavx2 / -mavx512f のビルドフラグ不要）
+//   - ベンチマーク用にカーネルを明示指定可能（--simd オプション）
+//
+// Design:
+//   - Each ISA variant is compiled with __attribute__((target(...))), so the
+//     binary stays runnable on any x86-64 CPU
+//   - All kernels take a runtime word count n, so the same table serves
+//     every bitmask width
+//   - On non-x86 targets only the scalar kernels are built
+//
+// 設計:
+//   - 各 ISA 版は __attribute__((target(...))) でコンパイルするため、
+//     バイナリは任意の x86-64 CPU で実行可能
+//   - 全カーネルは実行時のワード数 n を受け取り、同じテーブルで全ビット幅に対応
+//   - x86 以外のターゲットでは scalar カーネルのみをビルド
+//
+// ============================================================================
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BITKERNELS_X86 1
+#include <immintrin.h>
+#else
+#define BITKERNELS_X86 0
+#endif
+
+namespace BitKernels {
+
+// ============================================================================
+// KernelTable
+// ============================================================================
+//
+// Function table for one instruction set.
+// 1 つの命令セットに対する関数テーブル。
+//
+// ============================================================================
+struct KernelTable {
+    const char* name;
+    void (*or_assign)(uint64_t* dst, const uint64_t* src, size_t n);            // dst |= src
+    void (*and_assign)(uint64_t* dst, const uint64_t* src, size_t n);           // dst &= src
+    void (*not_copy)(uint64_t* dst, const uint64_t* src, size_t n);             // dst = ~src
+    void (*and_copy)(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n);  // dst = a & b
+    bool (*equal)(const uint64_t* a, const uint64_t* b, size_t n);              // a == b
+    bool (*is_zero)(const uint64_t* a, size_t n);                               // a == 0
+};
+
+namespace detail {
+
+// ============================================================================
+// Scalar kernels
+// scalar カーネル
+// ============================================================================
+inline void scalar_or(uint64_t* d, const uint64_t* s, size_t n) {
+    for (size_t i = 0; i < n; ++i) d[i] |= s[i];
+}
+inline void scalar_and(uint64_t* d, const uint64_t* s, size_t n) {
+    for (size_t i = 0; i < n; ++i) d[i] &= s[i];
+}
+inline void scalar_not(uint64_t* d, const uint64_t* s, size_t n) {
+    for (size_t i = 0; i < n; ++i) d[i] = ~s[i];
+}
+inline void scalar_and3(uint64_t* d, const uint64_t* a, const uint64_t* b, size_t n) {
+    for (size_t i = 0; i < n; ++i) d[i] = a[i] & b[i];
+}
+inline bool scalar_equal(const uint64_t* a, const uint64_t* b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+inline bool scalar_is_zero(const uint64_t* a, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i] != 0) return false;
+    }
+    return true;
+}
+
+#if BITKERNELS_X86
+
+// ============================================================================
+// SSE2 kernels (2 words per step)
+// SSE2 カーネル（1 ステップ 2 ワード）
+// ============================================================================
+__attribute__((target("sse2")))
+inline void sse2_or(uint64_t* d, const uint64_t* s, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(d + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), _mm_or_si128(x, y));
+    }
+    for (; i < n; ++i) d[i] |= s[i];
+}
+
+__attribute__((target("sse2")))
+inline void sse2_and(uint64_t* d, const uint64_t* s, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(d + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), _mm_and_si128(x, y));
+    }
+    for (; i < n; ++i) d[i] &= s[i];
+}
+
+__attribute__((target("sse2")))
+inline void sse2_not(uint64_t* d, const uint64_t* s, size_t n) {
+    const __m128i ones = _mm_set1_epi32(-1);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), _mm_xor_si128(y, ones));
+    }
+    for (; i < n; ++i) d[i] = ~s[i];
+}
+
+__attribute__((target("sse2")))
+inline void sse2_and3(uint64_t* d, const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), _mm_and_si128(x, y));
+    }
+    for (; i < n; ++i) d[i] = a[i] & b[i];
+}
+
+__attribute__((target("sse2")))
+inline bool sse2_equal(const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(x, y)) != 0xFFFF) return false;
+    }
+    for (; i < n; ++i) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+__attribute__((target("sse2")))
+inline bool sse2_is_zero(const uint64_t* a, size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(x, zero)) != 0xFFFF) return false;
+    }
+    for (; i < n; ++i) {
+        if (a[i] != 0) return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// AVX2 kernels (4 words per step)
+// AVX2 カーネル（1 ステップ 4 ワード）
+// ============================================================================
+__attribute__((target("avx2")))
+inline void avx2_or(uint64_t* d, const uint64_t* s, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), _mm256_or_si256(x, y));
+    }
+    for (; i < n; ++i) d[i] |= s[i];
+}
+
+__attribute__((target("avx2")))
+inline void avx2_and(uint64_t* d, const uint64_t* s, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), _mm256_and_si256(x, y));
+    }
+    for (; i < n; ++i) d[i] &= s[i];
+}
+
+__attribute__((target("avx2")))
+inline void avx2_not(uint64_t* d, const uint64_t* s, size_t n) {
+    const __m256i ones = _mm256_set1_epi32(-1);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), _mm256_xor_si256(y, ones));
+    }
+    for (; i < n; ++i) d[i] = ~s[i];
+}
+
+__attribute__((target("avx2")))
+inline void avx2_and3(uint64_t* d, const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), _mm256_and_si256(x, y));
+    }
+    for (; i < n; ++i) d[i] = a[i] & b[i];
+}
+
+__attribute__((target("avx2")))
+inline bool avx2_equal(const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i diff = _mm256_xor_si256(x, y);
+        if (!_mm256_testz_si256(diff, diff)) return false;
+    }
+    for (; i < n; ++i) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+__attribute__((target("avx2")))
+inline bool avx2_is_zero(const uint64_t* a, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        if (!_mm256_testz_si256(x, x)) return false;
+    }
+    for (; i < n; ++i) {
+        if (a[i] != 0) return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// AVX-512 kernels (8 words per step, masked tail)
+// AVX-512 カーネル（1 ステップ 8 ワード、端数はマスク処理）
+// ============================================================================
+//
+// The last partial step is a single masked load/store, so no width
+// falls back to a scalar tail.
+// 最後の端数ステップはマスク付きロード/ストア 1 回で処理するため、
+// どの幅でもスカラーの端数処理は発生しない。
+//
+// ============================================================================
+__attribute__((target("avx512f")))
+inline __mmask8 avx512_tail_mask(size_t remaining) {
+    return remaining >= 8 ? static_cast<__mmask8>(0xFF)
+                          : static_cast<__mmask8>((1u << remaining) - 1);
+}
+
+__attribute__((target("avx512f")))
+inline void avx512_or(uint64_t* d, const uint64_t* s, size_t n) {
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 m = avx512_tail_mask(n - i);
+        __m512i x = _mm512_maskz_loadu_epi64(m, d + i);
+        __m512i y = _mm512_maskz_loadu_epi64(m, s + i);
+        _mm512_mask_storeu_epi64(d + i, m, _mm512_or_si512(x, y));
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void avx512_and(uint64_t* d, const uint64_t* s, size_t n) {
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 m = avx512_tail_mask(n - i);
+        __m512i x = _mm512_maskz_loadu_epi64(m, d + i);
+        __m512i y = _mm512_maskz_loadu_epi64(m, s + i);
+        _mm512_mask_storeu_epi64(d + i, m, _mm512_and_si512(x, y));
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void avx512_not(uint64_t* d, const uint64_t* s, size_t n) {
+    const __m512i ones = _mm512_set1_epi64(-1);
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 m = avx512_tail_mask(n - i);
+        __m512i y = _mm512_maskz_loadu_epi64(m, s + i);
+        _mm512_mask_storeu_epi64(d + i, m, _mm512_xor_si512(y, ones));
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void avx512_and3(uint64_t* d, const uint64_t* a, const uint64_t* b, size_t n) {
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 m = avx512_tail_mask(n - i);
+        __m512i x = _mm512_maskz_loadu_epi64(m, a + i);
+        __m512i y = _mm512_maskz_loadu_epi64(m, b + i);
+        _mm512_mask_storeu_epi64(d + i, m, _mm512_and_si512(x, y));
+    }
+}
+
+__attribute__((target("avx512f")))
+inline bool avx512_equal(const uint64_t* a, const uint64_t* b, size_t n) {
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 m = avx512_tail_mask(n - i);
+        __m512i x = _mm512_maskz_loadu_epi64(m, a + i);
+        __m512i y = _mm512_maskz_loadu_epi64(m, b + i);
+        if (_mm512_cmpneq_epi64_mask(x, y) != 0) return false;
+    }
+    return true;
+}
+
+__attribute__((target("avx512f")))
+inline bool avx512_is_zero(const uint64_t* a, size_t n) {
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 m = avx512_tail_mask(n - i);
+        __m512i x = _mm512_maskz_loadu_epi64(m, a + i);
+        if (_mm512_test_epi64_mask(x, x) != 0) return false;
+    }
+    return true;
+}
+
+#endif  // BITKERNELS_X86
+
+}  // namespace detail
+
+// ============================================================================
+// Kernel tables
+// カーネルテーブル
+// ============================================================================
+inline const KernelTable& scalarTable() {
+    static const KernelTable t = {
+        "scalar",
+        detail::scalar_or, detail::scalar_and, detail::scalar_not,
+        detail::scalar_and3, detail::scalar_equal, detail::scalar_is_zero
+    };
+    return t;
+}
+
+#if BITKERNELS_X86
+inline const KernelTable& sse2Table() {
+    static const KernelTable t = {
+        "sse2",
+        detail::sse2_or, detail::sse2_and, detail::sse2_not,
+        detail::sse2_and3, detail::sse2_equal, detail::sse2_is_zero
+    };
+    return t;
+}
+
+inline const KernelTable& avx2Table() {
+    static const KernelTable t = {
+        "avx2",
+        detail::avx2_or, detail::avx2_and, detail::avx2_not,
+        detail::avx2_and3, detail::avx2_equal, detail::avx2_is_zero
+    };
+    return t;
+}
+
+inline const KernelTable& avx512Table() {
+    static const KernelTable t = {
+        "avx512",
+        detail::avx512_or, detail::avx512_and, detail::avx512_not,
+        detail::avx512_and3, detail::avx512_equal, detail::avx512_is_zero
+    };
+    return t;
+}
+#endif
+
+// ============================================================================
+// findTable
+// ============================================================================
+//
+// Look up a kernel table by name ("scalar", "sse2", "avx2", "avx512").
+// Returns nullptr if the name is unknown or the CPU lacks the instructions.
+//
+// 名前（"scalar", "sse2", "avx2", "avx512"）でカーネルテーブルを検索。
+// 名前が不明、または CPU が命令をサポートしない場合は nullptr を返す。
+//
+// ============================================================================
+inline const KernelTable* findTable(const std::string& name) {
+    if (name == "scalar") return &scalarTable();
+#if BITKERNELS_X86
+    __builtin_cpu_init();
+    if (name == "sse2" && __builtin_cpu_supports("sse2")) return &sse2Table();
+    if (name == "avx2" && __builtin_cpu_supports("avx2")) return &avx2Table();
+    if (name == "avx512" && __builtin_cpu_supports("avx512f")) return &avx512Table();
+#endif
+    return nullptr;
+}
+
+// ============================================================================
+// detectBest
+// ============================================================================
+//
+// Pick the widest kernel set supported by the running CPU.
+// 実行中の CPU がサポートする最も幅の広いカーネルセットを選択。
+//
+// ============================================================================
+inline const KernelTable& detectBest() {
+    for (const char* name : {"avx512", "avx2", "sse2"}) {
+        if (const KernelTable* t = findTable(name)) return *t;
+    }
+    return scalarTable();
+}
+
+// Active kernel table, chosen during static initialization.
+// 静的初期化時に選択されるアクティブなカーネルテーブル。
+inline const KernelTable* g_active = &detectBest();
+
+inline const KernelTable& active() {
+    return *g_active;
+}
+
+// ============================================================================
+// select
+// ============================================================================
+//
+// Override the automatically detected kernel set (e.g. --simd scalar).
+// Returns false if the requested set is unavailable; the active set is
+// left unchanged in that case.
+//
+// 自動検出されたカーネルセットを上書き（例: --simd scalar）。
+// 要求されたセットが利用できない場合は false を返し、アクティブなセットは変更しない。
+//
+// ============================================================================
+inline bool select(const std::string& name) {
+    if (name == "auto") {
+        g_active = &detectBest();
+        return true;
+    }
+    const KernelTable* t = findTable(name);
+    if (t == nullptr) return false;
+    g_active = t;
+    return true;
+}
+
+}  // namespace BitKernels
@@ -0,0 +1,219 @@
+// ============================================================================
+// BitState.hpp
+// ============================================================================
+//
+// What this file does:
+//   Helpers for runtime-width bitmask states stored as uint64_t arrays.
+//   Used by filters built on tdzdd::PodArrayDdSpec, where the number of
+//   words is fixed per filter instance (setArraySize) instead of per type.
+//
+// このファイルの役割:
+//   uint64_t 配列として格納される実行時幅のビットマスク状態のヘルパー。
+//   tdzdd::PodArrayDdSpec 上に構築されたフィルタで使用し、ワード数は
+//   型ごとではなくフィルタインスタンスごと（setArraySize）に固定される。
+//
+// Responsibility:
+//   - Compute the word count for a given number of bits
+//   - Test/set/clear single bits via precomputed BitPos
+//   - Zero check and zero fill
+//   - Hash and equality hooks for TdZdd's node table
+//
+// 責任範囲:
+//   - 指定ビット数に必要なワード数を計算
+//   - 事前計算した BitPos による単一ビットのテスト/設定/クリア
+//   - ゼロ判定とゼロ埋め
+//   - TdZdd のノード表のためのハッシュ・等価判定フック
+//
+// Design:
+//   - Replaces the uint64_t / BigUInt<2..7> dispatch ladder: one filter
+//     class handles any width, so there is no upper limit on edge count
+//   - States are sized exactly to what a filter needs (no padding to
+//     the next BigUInt<N>)
+//   - Multi-word states carry a summary word (bit i = data block i is
+//     nonzero), so zero checks are O(1) and hashing/equality only touch
+//     nonzero blocks; the all-zero state short-circuits immediately
+//
+// 設計:
+//   - uint64_t / BigUInt<2..7> の分岐を置き換え: 1 つのフィルタクラスで
+//     任意の幅を扱うため、辺数の上限がない
+//   - 状態はフィルタが必要とするサイズに正確に合わせる
+//     （次の BigUInt<N> へのパディングなし）
+//   - 複数ワードの状態は要約ワード（ビット i = データブロック i が非ゼロ）を
+//     持つため、ゼロ判定は O(1)、ハッシュ・等価判定は非ゼロブロックのみを参照し、
+//     全ゼロ状態は即座に判定を終える
+//
+// ============================================================================
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "BigUInt.hpp"
+#include "BitKernels.hpp"
+
+namespace BitState {
+
+using BigUIntHelper::BitPos;
+
+// ============================================================================
+// wordsFor
+// ============================================================================
+//
+// Number of 64-bit words needed for `bits` bits (at least 1, so that
+// every state has a valid non-empty array).
+//
+// `bits` ビットに必要な 64 ビットワード数（全状態が空でない配列を持つよう最低 1）。
+//
+// ============================================================================
+inline int wordsFor(int bits) {
+    return bits <= 64 ? 1 : (bits + 63) / 64;
+}
+
+// ============================================================================
+// mix64
+// ============================================================================
+//
+// 64-bit finalizer (MurmurHash3 fmix64). Every input bit affects every
+// output bit, unlike the multiply-accumulate word hash in TdZdd.
+//
+// 64 ビットの最終化関数（MurmurHash3 fmix64）。TdZdd の乗算累積ワードハッシュと
+// 異なり、全入力ビットが全出力ビットに影響する。
+//
+// ============================================================================
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// ============================================================================
+// Layout
+// ============================================================================
+//
+// What this does:
+//   Describes a bitmask state of a given number of bits and provides all
+//   operations on it. The state array (stateWords() words) is:
+//     1 data word:  [data]
+//     n > 1 words:  [summary][data_0] ... [data_{n-1}]
+//   Summary bit i (i < 63) is set iff data_i != 0; bit 63 is set iff any
+//   of data_63 ... data_{n-1} is nonzero.
+//
+// この処理の内容:
+//   指定ビット数のビットマスク状態を記述し、その全演算を提供する。
+//   状態配列（stateWords() ワード）は:
+//     データ 1 ワード:  [data]
+//     n > 1 ワード:     [summary][data_0] ... [data_{n-1}]
+//   要約ビット i（i < 63）は data_i != 0 のときのみ立つ。ビット 63 は
+//   data_63 ... data_{n-1} のいずれかが非ゼロのとき立つ。
+//
+// Invariant:
+//   s[0] == 0 iff all bits are zero (for both layouts).
+//
+// 不変条件:
+//   s[0] == 0 ⇔ 全ビットがゼロ（両レイアウトとも）。
+//
+// ============================================================================
+class Layout {
+private:
+    int data_words;  // Number of data words / データワード数
+    int offset;      // 1 if a summary word precedes the data, else 0 / 要約ワードがあれば 1
+
+    static inline uint64_t summaryBit(int block) {
+        return 1ULL << (block < 63 ? block : 63);
+    }
+
+    // Clear the summary bit of `block` after that block became zero
+    // ブロックがゼロになった後、その要約ビットをクリア
+    inline void dropSummary(uint64_t* s, int block) const {
+        if (block < 63) {
+            s[0] &= ~summaryBit(block);
+        } else if (BitKernels::active().is_zero(s + offset + 63, data_words - 63)) {
+            s[0] &= ~summaryBit(63);
+        }
+    }
+
+public:
+    explicit Layout(int bits)
+        : data_words(wordsFor(bits)), offset(data_words > 1 ? 1 : 0) {}
+
+    // Number of uint64_t words per state (for setArraySize)
+    // 状態あたりの uint64_t ワード数（setArraySize 用）
+    inline int stateWords() const {
+        return offset + data_words;
+    }
+
+    inline bool test(const uint64_t* s, const BitPos& p) const {
+        return (s[offset + p.block] & p.mask) != 0;
+    }
+
+    inline void set(uint64_t* s, const BitPos& p) const {
+        s[offset + p.block] |= p.mask;
+        if (offset) s[0] |= summaryBit(p.block);
+    }
+
+    inline void clear(uint64_t* s, const BitPos& p) const {
+        uint64_t& w = s[offset + p.block];
+        if ((w & p.mask) == 0) return;
+        w &= ~p.mask;
+        if (offset && w == 0) dropSummary(s, p.block);
+    }
+
+    inline bool isZero(const uint64_t* s) const {
+        return s[0] == 0;
+    }
+
+    inline void clearAll(uint64_t* s) const {
+        std::memset(s, 0, sizeof(uint64_t) * stateWords());
+    }
+
+    // ========================================================================
+    // hash / equal
+    // ========================================================================
+    //
+    // What this does:
+    //   Hash and equality over the nonzero blocks only. The all-zero state
+    //   (e.g. a cut MOPE) hashes to 0 and compares by its first word.
+    //
+    // この処理の内容:
+    //   非ゼロブロックのみを対象としたハッシュと等価判定。全ゼロ状態
+    //   （例: 切断済みの MOPE）はハッシュ値 0 となり、先頭ワードのみで比較される。
+    //
+    // ========================================================================
+    inline size_t hash(const uint64_t* s) const {
+        uint64_t summary = s[0];
+        if (summary == 0) return 0;  // All-zero sentinel / 全ゼロの番兵
+        uint64_t h = mix64(summary);
+        if (!offset) return h;
+        for (uint64_t m = summary; m != 0; m &= m - 1) {
+            int b = __builtin_ctzll(m);
+            if (b < 63) {
+                h = mix64(h ^ s[offset + b]);
+            } else {
+                for (int i = 63; i < data_words; ++i) {
+                    h = mix64(h ^ s[offset + i]);
+                }
+            }
+        }
+        return h;
+    }
+
+    inline bool equal(const uint64_t* s, const uint64_t* t) const {
+        uint64_t summary = s[0];
+        if (summary != t[0]) return false;
+        if (summary == 0 || !offset) return true;
+        for (uint64_t m = summary; m != 0; m &= m - 1) {
+            int b = __builtin_ctzll(m);
+            if (b < 63) {
+                if (s[offset + b] != t[offset + b]) return false;
+            } else if (!BitKernels::active().equal(s + offset + 63, t + offset + 63,
+                                                   data_words - 63)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+}  // namespace BitState
@@ -0,0 +1,159 @@
+// ============================================================================
+// BufferPool.hpp
+// ============================================================================
+//
+// What this file does:
+//   Defines BufferPool, a run-scoped pool of uint64_t word buffers that the
+//   repeated diagram passes (Phase 6 counts, out-of-core build / reduce /
+//   count) borrow and return, so that thousands of passes recycle the same
+//   few large blocks instead of allocating and freeing them each time.
+//
+// このファイルの役割:
+//   繰り返し実行される ZDD のパス（Phase 6 の数え上げ、メモリ外の構築・
+//   既約化・数え上げ）が借りて返す、実行単位の uint64_t ワードバッファの
+//   プール BufferPool を定義。数千回のパスが大きなブロックを毎回確保・解放
+//   する代わりに、同じ少数のブロックを使い回す。
+//
+// Responsibility:
+//   - Hand out the smallest free buffer that is large enough (best fit);
+//     allocate only when none is
+//   - Keep at most MAX_FREE_BUFFERS free buffers, dropping the smallest
+//   - Count bytes taken from the allocator and bytes reused, for result.json
+//   - Ask for huge pages on new large buffers (--huge-pages), before their
+//     first write
+//
+// 責任範囲:
+//   - 十分な大きさの空きバッファのうち最小のものを渡す（最良適合）。
+//     ない場合のみ確保する
+//   - 空きバッファは最大 MAX_FREE_BUFFERS 個まで保持し、最小のものから捨てる
+//   - アロケータから得たバイト数と再利用したバイト数を result.json 用に数える
+//   - 新しい大きなバッファには最初の書き込みより前にヒュージページを要求する
+//     （--huge-pages）
+//
+// Design:
+//   A Lease owns one buffer and returns it to the pool when destroyed. A
+//   buffer's capacity is recorded when it is handed out; if it comes back
+//   larger, it was reallocated while in use, and the new capacity counts as
+//   allocated. The pool belongs to one job and is not thread-safe.
+//
+// 設計:
+//   Lease は 1 つのバッファを所有し、破棄時にプールへ返す。渡した時点の
+//   容量を記録し、大きくなって戻った場合は使用中に再確保されたものとして
+//   新しい容量を確保量に数える。プールは 1 ジョブに属し、スレッドセーフ
+//   ではない。
+//
+// ============================================================================
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+#include "MemoryPlacement.hpp"
+
+class BufferPool {
+    std::multimap<size_t, std::vector<uint64_t>> free_buffers;  // capacity → buffer
+    uint64_t free_bytes = 0;
+
+public:
+    static const size_t MAX_FREE_BUFFERS = 64;
+
+    uint64_t allocated_bytes = 0;  // Capacity taken from the allocator / アロケータから得た容量
+    uint64_t reused_bytes = 0;     // Capacity handed out again / 再び渡した容量
+    uint64_t leases = 0;           // Buffers handed out / 渡したバッファ数
+    uint64_t reuses = 0;           // ... of which recycled / そのうち再利用
+    uint64_t peak_free_bytes = 0;  // Largest capacity held unused / 未使用で保持した容量の最大
+
+    BufferPool() {}
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // ========================================================================
+    // Lease
+    // ========================================================================
+    //
+    // An empty buffer (size 0) with capacity for at least `words` words.
+    // 容量が words ワード以上の空のバッファ（サイズ 0）。
+    //
+    // ========================================================================
+    class Lease {
+        BufferPool* pool = nullptr;
+        std::vector<uint64_t> buffer;
+        size_t issued = 0;  // Capacity when handed out / 渡した時点の容量
+
+    public:
+        Lease() {}
+
+        Lease(BufferPool& pool, size_t words) : pool(&pool) {
+            pool.take(words, buffer, issued);
+        }
+
+        ~Lease() {
+            release();
+        }
+
+        Lease(Lease&& other) noexcept
+            : pool(other.pool), buffer(std::move(other.buffer)), issued(other.issued) {
+            other.pool = nullptr;
+        }
+
+        Lease& operator=(Lease&& other) noexcept {
+            if (this != &other) {
+                release();
+                pool = other.pool;
+                buffer = std::move(other.buffer);
+                issued = other.issued;
+                other.pool = nullptr;
+            }
+            return *this;
+        }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        std::vector<uint64_t>& operator*() { return buffer; }
+        const std::vector<uint64_t>& operator*() const { return buffer; }
+        std::vector<uint64_t>* operator->() { return &buffer; }
+        const std::vector<uint64_t>* operator->() const { return &buffer; }
+
+        // Return the buffer now / バッファを今すぐ返す
+        void release() {
+            if (pool) pool->give(buffer, issued);
+            pool = nullptr;
+            buffer = std::vector<uint64_t>();
+        }
+    };
+
+private:
+    void take(size_t words, std::vector<uint64_t>& buffer, size_t& issued) {
+        ++leases;
+        auto it = free_buffers.lower_bound(words);
+        if (it != free_buffers.end()) {
+            buffer = std::move(it->second);
+            free_buffers.erase(it);
+            buffer.clear();
+            issued = buffer.capacity();
+            free_bytes -= issued * sizeof(uint64_t);
+            reused_bytes += issued * sizeof(uint64_t);
+            ++reuses;
+        } else {
+            buffer.reserve(words);
+            MemoryPlacement::adviseHugePages(buffer.data(), buffer.capacity() * sizeof(uint64_t));
+            issued = 0;
+        }
+    }
+
+    void give(std::vector<uint64_t>& buffer, size_t issued) {
+        size_t capacity = buffer.capacity();
+        if (capacity != issued) allocated_bytes += capacity * sizeof(uint64_t);
+        if (capacity == 0) return;
+        free_bytes += capacity * sizeof(uint64_t);
+        free_buffers.emplace(capacity, std::move(buffer));
+        if (free_buffers.size() > MAX_FREE_BUFFERS) {
+            free_bytes -= free_buffers.begin()->first * sizeof(uint64_t);
+            free_buffers.erase(free_buffers.begin());
+        }
+        if (free_bytes > peak_free_bytes) peak_free_bytes = free_bytes;
+    }
+};
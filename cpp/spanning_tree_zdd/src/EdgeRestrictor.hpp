@@ -0,0 +1,63 @@
+// ============================================================================
+// EdgeRestrictor.hpp
+// ============================================================================
+//
+// What this file does:
+//   Defines EdgeRestrictor, a DdSpec that fixes the first `depth` edges to
+//   the bits of a partition index.
+//
+// このファイルの役割:
+//   最初の depth 辺をパーティション番号のビットに固定する DdSpec である
+//   EdgeRestrictor を定義。
+//
+// Responsibility:
+//   - Split a ZDD into 2^depth disjoint sub-diagrams via zddIntersection
+//   - Shared by the partitioned pipeline (main.cpp) and verification
+//
+// 責任範囲:
+//   - zddIntersection により ZDD を 2^depth 個の排他的な部分 ZDD に分割
+//   - 分割パイプライン（main.cpp）と検証プログラムで共有
+//
+// ============================================================================
+
+#pragma once
+#include <tdzdd/DdSpec.hpp>
+
+// ============================================================================
+// EdgeRestrictor
+// ============================================================================
+//
+// What this does:
+//   ZDD filter that restricts the top `depth` edges to a specific bit pattern.
+//   Used to partition the ZDD into 2^depth disjoint subsets for memory-efficient
+//   subsetting with SymmetryFilter, and for parallel iteration in verify.
+//
+// この処理の内容:
+//   上位 depth 辺を特定のビットパターンに制約する ZDD フィルタ。
+//   SymmetryFilter との subsetting のメモリ効率化、および verify での
+//   並列走査のため、ZDD を 2^depth 個の排他的部分集合に分割するのに使用。
+//
+// ============================================================================
+class EdgeRestrictor : public tdzdd::DdSpec<EdgeRestrictor, int, 2> {
+    int num_edges;
+    int depth;
+    int partition;
+
+public:
+    EdgeRestrictor(int num_edges, int depth, int partition)
+        : num_edges(num_edges), depth(depth), partition(partition) {}
+
+    int getRoot(int& state) const {
+        state = 0;
+        return num_edges;
+    }
+
+    int getChild(int& state, int level, int value) const {
+        int edge_idx = num_edges - level;
+        if (edge_idx < depth) {
+            int required = (partition >> edge_idx) & 1;
+            if (value != required) return 0;
+        }
+        return (level <= 1) ? -1 : level - 1;
+    }
+};
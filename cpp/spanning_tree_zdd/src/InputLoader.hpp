@@ -0,0 +1,516 @@
+// ============================================================================
+// InputLoader.hpp
+// ============================================================================
+//
+// What this file does:
+//   Shared loaders for the Phase 4–6 input files: polyhedron.grh, the MOPE
+//   file unfoldings_edge_sets.jsonl and automorphisms.json. Files are
+//   memory-mapped and parsed in place by a hand-written integer scanner
+//   into flat arrays; no per-line strings, streams or std::set are built.
+//   The binary forms written by graph_export.binary_format
+//   (unfoldings_edge_sets.bin, automorphisms.bin) are recognized by their
+//   magic; a binary MOPE file is used directly from the mapping.
+//
+// このファイルの役割:
+//   Phase 4–6 の入力ファイル（polyhedron.grh、MOPE ファイル
+//   unfoldings_edge_sets.jsonl、automorphisms.json）の共通ローダー。
+//   ファイルをメモリマップし、手書きの整数スキャナでその場でフラット配列へ
+//   パースする。行ごとの文字列・ストリーム・std::set は作らない。
+//   graph_export.binary_format が書くバイナリ形式
+//   （unfoldings_edge_sets.bin、automorphisms.bin）はマジックで判別し、
+//   バイナリの MOPE ファイルはマップをそのまま使う。
+//
+// Binary formats (little-endian; see python/graph_export/binary_format.py):
+//   MOPE:         "STZM", u32 version = 1, u32 num_edges, u32 reserved,
+//                 u64 num_sets, u64 num_entries,
+//                 u64 offset[num_sets + 1], i32 edges[num_entries]
+//   Automorphism: "STZA", u32 version = 1, u32 num_edges, u32 group_order,
+//                 u32 num_perms, u32 num_generators, u32 flags, u32 reserved,
+//                 u16 perms[num_perms][num_edges] (padded to 4),
+//                 u8 zero_flags[num_perms] if flags & 1 (padded to 4),
+//                 u32 generators[num_generators]
+//
+// バイナリ形式（リトルエンディアン。python/graph_export/binary_format.py 参照）:
+//   上記の通り。ヘッダはいずれも 32 バイトで、各配列は要素サイズに整列する。
+//
+// Responsibility:
+//   - Used by spanning_tree_zdd (main.cpp) and the verification tools
+//     (verify.cpp, overlap_check.cpp), so all of them accept exactly the
+//     same input
+//   - Loading is linear in the file size (millions of MOPE lines)
+//   - Errors are reported through a message string and a false return
+//
+// 責任範囲:
+//   - spanning_tree_zdd（main.cpp）と検証ツール（verify.cpp、
+//     overlap_check.cpp）の両方が使い、全て同じ入力を受け付ける
+//   - 読み込みはファイルサイズに線形（数百万行の MOPE）
+//   - エラーはメッセージ文字列と false の戻り値で報告
+//
+// ============================================================================
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <tdzdd/util/Graph.hpp>
+
+namespace InputLoader {
+
+// ============================================================================
+// MappedFile
+// ============================================================================
+//
+// Read-only view of a whole file. Regular files are mmap'ed with the given
+// madvise access advice (MADV_SEQUENTIAL for inputs parsed front to back,
+// MADV_RANDOM for segment files read by node index, MADV_NORMAL for none);
+// anything that cannot be mapped (pipes, empty files) is read into a buffer.
+//
+// ファイル全体の読み取り専用ビュー。通常ファイルは指定した madvise の
+// アクセス助言で mmap する（先頭から解析する入力は MADV_SEQUENTIAL、
+// ノード番号で読むセグメントファイルは MADV_RANDOM、助言なしは
+// MADV_NORMAL）。マップできないもの（パイプ、空ファイル）はバッファに読み込む。
+//
+// ============================================================================
+class MappedFile {
+    const char* first = nullptr;
+    size_t length = 0;
+    void* mapping = MAP_FAILED;
+    std::vector<char> buffer;
+    bool opened = false;
+
+public:
+    explicit MappedFile(const std::string& path, int advice = MADV_SEQUENTIAL) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        opened = true;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            mapping = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                if (advice != MADV_NORMAL) ::madvise(mapping, st.st_size, advice);
+                first = static_cast<const char*>(mapping);
+                length = st.st_size;
+            }
+        }
+        if (mapping == MAP_FAILED) {
+            char chunk[65536];
+            ssize_t n;
+            while ((n = ::read(fd, chunk, sizeof(chunk))) > 0) {
+                buffer.insert(buffer.end(), chunk, chunk + n);
+            }
+            first = buffer.data();
+            length = buffer.size();
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (mapping != MAP_FAILED) ::munmap(mapping, length);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool ok() const { return opened; }
+    const char* begin() const { return first; }
+    const char* end() const { return first + length; }
+    size_t size() const { return length; }
+
+    // Ask for the whole file up front (one read-ahead instead of faults)
+    // ファイル全体を先読みさせる（ページフォルトの代わりに一括読み込み）
+    void willNeed() const {
+        if (mapping != MAP_FAILED) ::madvise(mapping, length, MADV_WILLNEED);
+    }
+};
+
+// ============================================================================
+// Binary headers
+// バイナリヘッダ
+// ============================================================================
+
+static const char MOPE_MAGIC[4] = {'S', 'T', 'Z', 'M'};
+static const char AUTOMORPHISM_MAGIC[4] = {'S', 'T', 'Z', 'A'};
+static const uint32_t BINARY_VERSION = 1;
+static const size_t BINARY_HEADER_BYTES = 32;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static const bool NATIVE_LITTLE_ENDIAN = true;
+#else
+static const bool NATIVE_LITTLE_ENDIAN = false;
+#endif
+
+inline uint64_t getLE(const char* p, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) value |= uint64_t(uint8_t(p[i])) << (8 * i);
+    return value;
+}
+
+inline bool hasMagic(const MappedFile& file, const char magic[4]) {
+    return file.size() >= BINARY_HEADER_BYTES && std::memcmp(file.begin(), magic, 4) == 0;
+}
+
+// ============================================================================
+// Integer scanner
+// 整数スキャナ
+// ============================================================================
+
+// Parse the next non-negative integer in [p, last); advances p past it.
+// Skips anything that is not a digit. Returns false at the end.
+// [p, last) 内の次の非負整数をパースし p をその後ろへ進める。
+// 数字以外は読み飛ばす。終端に達したら false。
+inline bool scanInt(const char*& p, const char* last, int& value) {
+    while (p < last && (*p < '0' || *p > '9')) ++p;
+    if (p == last) return false;
+    int v = 0;
+    while (p < last && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+    value = v;
+    return true;
+}
+
+// Position of the first c in [p, last), or last / [p, last) 内の最初の c の位置
+inline const char* findChar(const char* p, const char* last, char c) {
+    const void* q = p < last ? std::memchr(p, c, last - p) : nullptr;
+    return q ? static_cast<const char*>(q) : last;
+}
+
+// ============================================================================
+// parseEdgeList
+// ============================================================================
+//
+// Edge IDs of the first [...] in [first, last) (one {"edges": [...]} JSON
+// line), sorted and without duplicates. Empty if there is no list.
+//
+// [first, last) の最初の [...] に含まれる辺 ID（{"edges": [...]} 形式の
+// JSON 1 行）を昇順・重複なしで返す。リストがなければ空。
+//
+// ============================================================================
+inline void parseEdgeList(const char* first, const char* last, std::vector<int>& edges) {
+    edges.clear();
+    const char* open = findChar(first, last, '[');
+    if (open == last) return;
+    const char* close = findChar(open, last, ']');
+    int v;
+    for (const char* p = open + 1; scanInt(p, close, v);) edges.push_back(v);
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+}
+
+// ============================================================================
+// EdgeSets
+// ============================================================================
+//
+// A family of edge sets in CSR form: set i is edges[offset[i], offset[i+1]),
+// sorted ascending. Sets loaded from a binary file on a little-endian host
+// point into the mapped file instead, which the struct keeps alive.
+//
+// CSR 形式の辺集合族: 集合 i は edges[offset[i], offset[i+1])（昇順）。
+// リトルエンディアン環境でバイナリファイルから読んだ集合はマップした
+// ファイルを直接指し、構造体がそのファイルを保持する。
+//
+// ============================================================================
+struct EdgeSets {
+    std::vector<size_t> offset = std::vector<size_t>(1, 0);
+    std::vector<int> edges;
+    std::vector<size_t> empty_lines;  // 1-based lines without edges / 辺のない行（1 始まり）
+    int num_edges = 0;                // From a binary header, 0 if unknown / バイナリのヘッダ値（不明なら 0）
+
+    std::shared_ptr<const MappedFile> mapped;
+    size_t mapped_sets = 0;
+    const uint64_t* mapped_offset = nullptr;
+    const int32_t* mapped_edges = nullptr;
+
+    size_t size() const { return mapped ? mapped_sets : offset.size() - 1; }
+    bool empty() const { return size() == 0; }
+    const int* begin(size_t i) const {
+        return mapped ? mapped_edges + mapped_offset[i] : edges.data() + offset[i];
+    }
+    const int* end(size_t i) const {
+        return mapped ? mapped_edges + mapped_offset[i + 1] : edges.data() + offset[i + 1];
+    }
+};
+
+static_assert(sizeof(int) == sizeof(int32_t), "binary MOPE files store int32 edges");
+
+// Binary MOPE file → sets / バイナリ MOPE ファイル → sets
+inline bool loadEdgeSetsBinary(const std::shared_ptr<const MappedFile>& file,
+                               const std::string& path, EdgeSets& sets, std::string& error) {
+    const char* p = file->begin();
+    uint64_t num_sets = getLE(p + 16, 8);
+    uint64_t num_entries = getLE(p + 24, 8);
+    uint64_t available = file->size() - BINARY_HEADER_BYTES;
+    if (getLE(p + 4, 4) != BINARY_VERSION) {
+        error = "Unsupported binary edge-set version in " + path;
+        return false;
+    }
+    if (num_sets >= available / 8 ||
+        num_entries > (available - 8 * (num_sets + 1)) / 4) {
+        error = "Truncated binary edge-set file " + path;
+        return false;
+    }
+    sets.num_edges = int(getLE(p + 8, 4));
+    const char* offsets = p + BINARY_HEADER_BYTES;
+    const char* entries = offsets + 8 * (num_sets + 1);
+
+    // Offsets must run from 0 to num_entries without going back
+    // オフセットは 0 から num_entries まで減らずに進む必要がある
+    uint64_t prev = 0;
+    for (uint64_t i = 0; i <= num_sets; ++i) {
+        uint64_t o = getLE(offsets + 8 * i, 8);
+        if ((i == 0 && o != 0) || o < prev || o > num_entries) {
+            error = "Corrupt offsets in binary edge-set file " + path;
+            return false;
+        }
+        prev = o;
+    }
+    if (prev != num_entries) {
+        error = "Corrupt offsets in binary edge-set file " + path;
+        return false;
+    }
+
+    // UnfoldingFilter expects each set strictly ascending within [0, num_edges)
+    // UnfoldingFilter は各集合が [0, num_edges) 内で狭義単調増加であることを前提とする
+    for (uint64_t i = 0; i < num_sets; ++i) {
+        uint64_t lo = getLE(offsets + 8 * i, 8);
+        uint64_t hi = getLE(offsets + 8 * (i + 1), 8);
+        int32_t last = -1;
+        for (uint64_t k = lo; k < hi; ++k) {
+            int32_t e = int32_t(getLE(entries + 4 * k, 4));
+            if (e <= last || e >= sets.num_edges) {
+                error = "Corrupt edges in binary edge-set file " + path;
+                return false;
+            }
+            last = e;
+        }
+    }
+
+    if (NATIVE_LITTLE_ENDIAN) {
+        file->willNeed();
+        sets.mapped = file;
+        sets.mapped_sets = num_sets;
+        sets.mapped_offset = reinterpret_cast<const uint64_t*>(offsets);
+        sets.mapped_edges = reinterpret_cast<const int32_t*>(entries);
+        return true;
+    }
+    sets.offset.resize(num_sets + 1);
+    for (uint64_t i = 0; i <= num_sets; ++i) sets.offset[i] = getLE(offsets + 8 * i, 8);
+    sets.edges.resize(num_entries);
+    for (uint64_t i = 0; i < num_entries; ++i) sets.edges[i] = int32_t(getLE(entries + 4 * i, 4));
+    return true;
+}
+
+// ============================================================================
+// loadEdgeSets
+// ============================================================================
+//
+// Read an edge-set JSONL file ({"edges": [...]} per line) or its binary
+// form. Blank lines are skipped; other lines without edges are recorded in
+// empty_lines.
+//
+// 辺集合の JSONL ファイル（1 行に {"edges": [...]}）またはそのバイナリ形式を
+// 読み込む。空行は読み飛ばし、辺のないその他の行は empty_lines に記録する。
+//
+// ============================================================================
+inline bool loadEdgeSets(const std::string& path, EdgeSets& sets, std::string& error) {
+    auto mapped = std::make_shared<const MappedFile>(path);
+    const MappedFile& file = *mapped;
+    if (!file.ok()) {
+        error = "Could not open " + path;
+        return false;
+    }
+    sets = EdgeSets();
+    if (hasMagic(file, MOPE_MAGIC)) return loadEdgeSetsBinary(mapped, path, sets, error);
+
+    std::vector<int> line_edges;
+    size_t line_num = 0;
+    for (const char* p = file.begin(); p < file.end();) {
+        const char* eol = findChar(p, file.end(), '\n');
+        ++line_num;
+        const char* q = p;
+        while (q < eol && (*q == ' ' || *q == '\t' || *q == '\r')) ++q;
+        if (q < eol) {
+            parseEdgeList(q, eol, line_edges);
+            if (line_edges.empty()) {
+                sets.empty_lines.push_back(line_num);
+            } else {
+                sets.edges.insert(sets.edges.end(), line_edges.begin(), line_edges.end());
+                sets.offset.push_back(sets.edges.size());
+            }
+        }
+        p = eol + 1;
+    }
+    return true;
+}
+
+// ============================================================================
+// Automorphisms
+// ============================================================================
+//
+// Contents of automorphisms.json: the group order, the edge permutations
+// and the optional Theorem 2 zero_flags. generators (indices into
+// edge_permutations) is only filled from the binary form.
+//
+// automorphisms.json の内容: 群の位数、辺置換、任意の Theorem 2 zero_flags。
+// generators（edge_permutations の番号）はバイナリ形式からのみ埋まる。
+//
+// ============================================================================
+struct Automorphisms {
+    int group_order = 0;
+    std::vector<std::vector<int>> edge_permutations;
+    std::vector<bool> zero_flags;
+    std::vector<int> generators;
+};
+
+// Binary automorphism file → aut / バイナリ自己同型ファイル → aut
+inline bool loadAutomorphismsBinary(const MappedFile& file, const std::string& path,
+                                    Automorphisms& aut, std::string& error) {
+    const char* p = file.begin();
+    if (getLE(p + 4, 4) != BINARY_VERSION) {
+        error = "Unsupported binary automorphism version in " + path;
+        return false;
+    }
+    uint64_t num_edges = getLE(p + 8, 4);
+    uint64_t num_perms = getLE(p + 16, 4);
+    uint64_t num_generators = getLE(p + 20, 4);
+    bool has_zero_flags = getLE(p + 24, 4) & 1;
+    aut.group_order = int(getLE(p + 12, 4));
+
+    uint64_t perm_bytes = (2 * num_perms * num_edges + 3) / 4 * 4;
+    uint64_t flag_bytes = has_zero_flags ? (num_perms + 3) / 4 * 4 : 0;
+    if (file.size() < BINARY_HEADER_BYTES + perm_bytes + flag_bytes + 4 * num_generators) {
+        error = "Truncated binary automorphism file " + path;
+        return false;
+    }
+    const char* q = p + BINARY_HEADER_BYTES;
+    aut.edge_permutations.assign(num_perms, std::vector<int>(num_edges));
+    for (auto& perm : aut.edge_permutations) {
+        for (auto& e : perm) {
+            e = int(getLE(q, 2));
+            q += 2;
+        }
+    }
+    q = p + BINARY_HEADER_BYTES + perm_bytes;
+    if (has_zero_flags) {
+        aut.zero_flags.assign(q, q + num_perms);
+        q += flag_bytes;
+    }
+    aut.generators.resize(num_generators);
+    for (auto& g : aut.generators) {
+        g = int(getLE(q, 4));
+        q += 4;
+    }
+    return true;
+}
+
+// End of the array opened at open (matching bracket) / open で始まる配列の終端
+inline const char* matchBracket(const char* open, const char* last) {
+    int depth = 0;
+    for (const char* p = open; p < last; ++p) {
+        if (*p == '[') ++depth;
+        else if (*p == ']' && --depth == 0) return p;
+    }
+    return last;
+}
+
+// Position just after "key": in [first, last), or last / "key": の直後の位置
+inline const char* findKey(const char* first, const char* last, const std::string& key) {
+    const std::string quoted = "\"" + key + "\"";
+    const char* p = std::search(first, last, quoted.begin(), quoted.end());
+    if (p == last) return last;
+    return findChar(p + quoted.size(), last, ':');
+}
+
+inline bool loadAutomorphisms(const std::string& path, Automorphisms& aut, std::string& error) {
+    MappedFile file(path);
+    if (!file.ok()) {
+        error = "Could not open " + path;
+        return false;
+    }
+    aut = Automorphisms();
+    if (hasMagic(file, AUTOMORPHISM_MAGIC)) return loadAutomorphismsBinary(file, path, aut, error);
+    const char* first = file.begin();
+    const char* last = file.end();
+
+    // group_order
+    const char* p = findKey(first, last, "group_order");
+    if (p == last || !scanInt(p, last, aut.group_order)) {
+        error = "group_order not found in " + path;
+        return false;
+    }
+
+    // edge_permutations: [[...], [...], ...]
+    p = findKey(first, last, "edge_permutations");
+    const char* open = findChar(p, last, '[');
+    if (p == last || open == last) {
+        error = "edge_permutations not found in " + path;
+        return false;
+    }
+    const char* close = matchBracket(open, last);
+    std::vector<int> perm;
+    for (p = findChar(open + 1, close, '['); p < close; p = findChar(p + 1, close, '[')) {
+        const char* end = findChar(p, close, ']');
+        perm.clear();
+        int v;
+        for (const char* q = p + 1; scanInt(q, end, v);) perm.push_back(v);
+        if (!perm.empty()) aut.edge_permutations.push_back(perm);
+        p = end;
+    }
+
+    // zero_flags (optional): [true, false, ...]
+    p = findKey(first, last, "zero_flags");
+    open = findChar(p, last, '[');
+    if (p != last && open != last) {
+        close = findChar(open, last, ']');
+        for (const char* q = open + 1; q < close; ++q) {
+            if (*q == 't') aut.zero_flags.push_back(true);
+            else if (*q == 'f') aut.zero_flags.push_back(false);
+            else continue;
+            while (q < close && *q != ',') ++q;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// loadGraph
+// ============================================================================
+//
+// Read polyhedron.grh ("u v" per line, line i = edge i) into G. Same
+// vertex names and edge order as tdzdd::Graph::readEdges.
+//
+// polyhedron.grh（1 行に "u v"、i 行目 = 辺 i）を G に読み込む。頂点名と
+// 辺の順序は tdzdd::Graph::readEdges と同じ。
+//
+// ============================================================================
+inline bool loadGraph(const std::string& path, tdzdd::Graph& G, std::string& error) {
+    MappedFile file(path);
+    if (!file.ok()) {
+        error = "Could not open " + path;
+        return false;
+    }
+    for (const char* p = file.begin(); p < file.end();) {
+        const char* eol = findChar(p, file.end(), '\n');
+        int u, v;
+        const char* q = p;
+        if (scanInt(q, eol, u)) {
+            if (!scanInt(q, eol, v)) {
+                error = "Malformed edge line in " + path;
+                return false;
+            }
+            G.addEdge(std::to_string(u), std::to_string(v));
+        }
+        p = eol + 1;
+    }
+    G.update();
+    return true;
+}
+
+} // namespace InputLoader
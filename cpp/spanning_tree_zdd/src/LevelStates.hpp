@@ -0,0 +1,248 @@
+// ============================================================================
+// LevelStates.hpp
+// ============================================================================
+//
+// What this file does:
+//   Defines LevelStates<SPEC>, the level-local table of distinct spec states
+//   used by the top-down passes that run a TdZdd spec without building a
+//   DdStructure, and countPaths(), the cardinality of a spec computed top-down
+//   with per-state path counts (no diagram is stored at all).
+//
+// このファイルの役割:
+//   DdStructure を構築せずに TdZdd の spec を実行するトップダウンのパスが使う、
+//   レベル局所の異なる spec 状態の表 LevelStates<SPEC> と、状態ごとの経路数を
+//   トップダウンに伝える spec の要素数計算 countPaths()（ZDD は一切格納しない）
+//   を定義。
+//
+// Responsibility:
+//   - Deduplicate states with the spec's hash_code / equal_to (open
+//     addressing) and own them until clear()
+//   - Draw every buffer from a BufferPool, so repeated passes recycle them
+//   - countPaths: |family| of any spec, e.g. zddIntersection(dd, filter),
+//     holding only the states of the levels not yet expanded
+//
+// 責任範囲:
+//   - spec の hash_code / equal_to で状態を重複除去し（オープンアドレス法）、
+//     clear() まで所有する
+//   - 全てのバッファを BufferPool から借り、繰り返しのパスで使い回す
+//   - countPaths: zddIntersection(dd, filter) などの任意の spec の族の要素数を、
+//     未展開のレベルの状態のみを保持して求める
+//
+// Design:
+//   Each entry is `stride` words of state followed by `payload` words for
+//   the caller (countPaths keeps its multi-word path count there). States
+//   are moved bitwise when the data buffer grows, as TdZdd itself does.
+//
+// 設計:
+//   各エントリは stride ワードの状態と、呼び出し側用の payload ワード
+//   （countPaths は多倍長の経路数を置く）から成る。データバッファの拡張時に
+//   状態はビット単位で移動する（TdZdd 自身と同じ）。
+//
+// ============================================================================
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BufferPool.hpp"
+
+namespace LevelStatesHelper {
+    // a += b over `words` little-endian words (carry out is dropped)
+    // words 個のリトルエンディアンのワード上で a += b（桁あふれは捨てる）
+    inline void add(uint64_t* a, const uint64_t* b, size_t words) {
+        uint64_t carry = 0;
+        for (size_t w = 0; w < words; ++w) {
+            unsigned __int128 s = (unsigned __int128)a[w] + b[w] + carry;
+            a[w] = (uint64_t)s;
+            carry = (uint64_t)(s >> 64);
+        }
+    }
+
+    // Decimal string of a `words`-word number / words ワードの数の 10 進文字列
+    inline std::string toDecimal(const uint64_t* number, size_t words) {
+        std::vector<uint64_t> n(number, number + words);
+        std::string digits;
+        while (std::any_of(n.begin(), n.end(), [](uint64_t w) { return w != 0; })) {
+            unsigned __int128 rem = 0;
+            for (int w = (int)words - 1; w >= 0; --w) {
+                unsigned __int128 cur = (rem << 64) | n[w];
+                n[w] = (uint64_t)(cur / 10);
+                rem = cur % 10;
+            }
+            digits.push_back(char('0' + (int)rem));
+        }
+        if (digits.empty()) return "0";
+        return std::string(digits.rbegin(), digits.rend());
+    }
+}
+
+// ============================================================================
+// LevelStates
+// ============================================================================
+template<typename SPEC>
+class LevelStates {
+    SPEC& spec;
+    BufferPool& pool;
+    int level;
+    size_t stride;                  // Words per state / 状態あたりのワード数
+    size_t payload_words;
+    size_t entry;                   // stride + payload_words (at least 1)
+    BufferPool::Lease data;
+    BufferPool::Lease table;        // index + 1, 0 = empty / index + 1、0 は空
+    int bits = 0;                   // table size = 2^bits
+    uint64_t count = 0;
+
+    // Home slot: Fibonacci hashing, so the high bits of hash_code (where
+    // the usual multiplicative spec hashes mix best) pick the slot
+    // 基準スロット: フィボナッチハッシュ。spec のよくある乗算ハッシュが最も
+    // よく混ざる hash_code の上位ビットでスロットを選ぶ
+    size_t home(const void* s) const {
+        return (uint64_t(spec.hash_code(s, level)) * 0x9E3779B97F4A7C15ULL) >> (64 - bits);
+    }
+
+    void grow() {
+        bits = std::max(6, bits + 1);
+        BufferPool::Lease old = std::move(table);
+        table = BufferPool::Lease(pool, size_t(1) << bits);
+        table->assign(size_t(1) << bits, 0);
+        if (old->empty()) return;
+        for (uint64_t slot : *old) {
+            if (slot != 0) place(slot - 1);
+        }
+    }
+
+    void place(uint64_t index) {
+        size_t mask = table->size() - 1;
+        size_t h = home(state(index));
+        while ((*table)[h] != 0) h = (h + 1) & mask;
+        (*table)[h] = index + 1;
+    }
+
+public:
+    LevelStates(SPEC& spec, BufferPool& pool, int level, size_t stride, size_t payload_words = 0)
+        : spec(spec), pool(pool), level(level), stride(stride), payload_words(payload_words),
+          entry(std::max<size_t>(1, stride + payload_words)) {}
+
+    uint64_t size() const {
+        return count;
+    }
+
+    void* state(uint64_t index) {
+        return &(*data)[index * entry];
+    }
+
+    uint64_t* payload(uint64_t index) {
+        return &(*data)[index * entry + stride];
+    }
+
+    // Index of the state equal to `s`, adding it (with a zero payload) if
+    // new. The state is moved in (a new one is kept bitwise, a duplicate is
+    // destroyed).
+    // s と等しい状態の番号。新しければ（ペイロード 0 で）追加する。状態は
+    // 移される（新しいものはビット単位で保持し、重複は破棄する）。
+    uint64_t insert(void* s) {
+        if ((count + 1) * 2 > table->size()) grow();
+        size_t mask = table->size() - 1;
+        size_t h = home(s);
+        while ((*table)[h] != 0) {
+            uint64_t index = (*table)[h] - 1;
+            if (spec.equal_to(state(index), s, level)) {
+                spec.destruct(s);
+                return index;
+            }
+            h = (h + 1) & mask;
+        }
+        if ((count + 1) * entry > data->capacity()) {
+            // Grow through the pool instead of a vector reallocation
+            // vector の再確保ではなくプールを通じて拡張する
+            BufferPool::Lease bigger(pool, std::max<size_t>(64 * entry, data->capacity() * 2));
+            bigger->assign(data->begin(), data->end());
+            data = std::move(bigger);
+        }
+        data->resize((count + 1) * entry, 0);
+        std::memcpy(state(count), s, stride * sizeof(uint64_t));
+        (*table)[h] = count + 1;
+        return count++;
+    }
+
+    // Destroy every state and return the buffers to the pool
+    // 全ての状態を破棄し、バッファをプールへ返す
+    void clear() {
+        for (uint64_t i = 0; i < count; ++i) spec.destruct(state(i));
+        data.release();
+        table.release();
+        bits = 0;
+        count = 0;
+    }
+
+    ~LevelStates() {
+        clear();
+    }
+};
+
+// ============================================================================
+// countPaths
+// ============================================================================
+//
+// What this does:
+//   Number of sets in the family of `spec`, i.e. the number of paths from
+//   the root to the 1-terminal. Levels are expanded top-down; each distinct
+//   state carries the number of paths reaching it (topLevel / 64 + 1 words,
+//   enough for the 2^topLevel bound), and a level's states are released as
+//   soon as it is expanded. Equals DdStructure<2>(spec).zddCardinality()
+//   without storing, copying or reducing a diagram.
+//
+// この処理の内容:
+//   spec の族の集合の数、すなわち根から 1-終端への経路数。レベルをトップ
+//   ダウンに展開し、異なる各状態はそこに至る経路数（topLevel / 64 + 1
+//   ワード。上限 2^topLevel に十分）を持つ。レベルを展開し終えるとその状態を
+//   すぐに解放する。ZDD の格納・コピー・既約化なしに
+//   DdStructure<2>(spec).zddCardinality() と等しい値を返す。
+//
+// ============================================================================
+template<typename SPEC>
+std::string countPaths(const SPEC& spec0, BufferPool& pool) {
+    SPEC spec(spec0);
+    size_t stride = (spec.datasize() + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    BufferPool::Lease tmp(pool, std::max<size_t>(1, stride));
+    tmp->resize(std::max<size_t>(1, stride));
+
+    int top = spec.get_root(tmp->data());
+    if (top <= 0) {
+        spec.destruct(tmp->data());
+        return top < 0 ? "1" : "0";
+    }
+
+    const size_t words = top / 64 + 1;
+    std::vector<uint64_t> total(words, 0);
+    std::vector<std::unique_ptr<LevelStates<SPEC>>> levels(top + 1);
+    for (int i = 1; i <= top; ++i) {
+        levels[i].reset(new LevelStates<SPEC>(spec, pool, i, stride, words));
+    }
+    levels[top]->payload(levels[top]->insert(tmp->data()))[0] = 1;
+
+    for (int i = top; i >= 1; --i) {
+        LevelStates<SPEC>& states = *levels[i];
+        for (uint64_t j = 0; j < states.size(); ++j) {
+            for (int b = 0; b < 2; ++b) {
+                spec.get_copy(tmp->data(), states.state(j));
+                int c = spec.get_child(tmp->data(), i, b);
+                if (c <= 0) {
+                    spec.destruct(tmp->data());
+                    if (c < 0) LevelStatesHelper::add(total.data(), states.payload(j), words);
+                } else {
+                    LevelStates<SPEC>& next = *levels[c];
+                    uint64_t k = next.insert(tmp->data());
+                    LevelStatesHelper::add(next.payload(k), states.payload(j), words);
+                }
+            }
+        }
+        levels[i].reset();
+        spec.destructLevel(i);
+    }
+
+    return LevelStatesHelper::toDecimal(total.data(), words);
+}
@@ -0,0 +1,183 @@
+// ============================================================================
+// MemoryBudget.hpp
+// ============================================================================
+//
+// What this file does:
+//   Memory model behind --max-memory: parses byte sizes, converts a byte
+//   budget to a ZDD node budget, and picks the smallest split depth whose
+//   largest partition is predicted to fit, from node counts measured on a
+//   few probe partitions.
+//
+// このファイルの役割:
+//   --max-memory のメモリモデル: バイト数の解析、バイト予算から ZDD ノード
+//   予算への換算、少数の試行パーティションで測ったノード数から、最大
+//   パーティションが収まると予測される最小の分割深さの選択。
+//
+// Responsibility:
+//   - Pure arithmetic; the probe builds themselves live in main.cpp
+//   - Report the process peak resident set (Linux /proc), so result.json
+//     can show how close a run came to its budget (once per process: a
+//     batch shares one peak)
+//
+// 責任範囲:
+//   - 純粋な計算のみ。試行構築そのものは main.cpp が行う
+//   - プロセスのピーク常駐メモリ（Linux の /proc）を報告し、実行が予算に
+//     どこまで近づいたかを result.json に示せるようにする（プロセスごとに
+//     1 回。バッチは 1 つのピークを共有する）
+//
+// Model:
+//   A partition holds its Phase 4 diagram plus, while Phase 5 / Phase 6
+//   run, the diagram under construction and (Burnside) the level states of
+//   the intersection being counted, so its working set is about
+//   nodes × BYTES_PER_NODE × workingCopies(). Fixing one more edge at most
+//   halves the largest partition; in practice the ratio is much smaller and
+//   uneven, so it is measured on probe partitions and extrapolated, and
+//   partitions that still outgrow the budget are split during the run.
+//
+// モデル:
+//   パーティションは Phase 4 の ZDD に加え、Phase 5 / Phase 6 の実行中は
+//   構築中の ZDD と（Burnside では）数え上げ中の共通部分のレベル状態を保持
+//   するため、作業領域は約 ノード数 × BYTES_PER_NODE × workingCopies()。
+//   固定する辺を 1 本増やすと最大パーティションは高々半分になる。実際の比は
+//   ずっと小さく不均一なため、試行パーティションで測って外挿し、それでも
+//   予算を超えたパーティションは実行中に分割する。
+//
+// ============================================================================
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace MemoryBudget {
+
+// Bytes per ZDD node including the per-level state tables of a build
+// (node array, spec states, unique tables); deliberately on the high side
+// ZDD 1 ノードあたりのバイト数（ノード配列・状態・一意表を含む）。多めに見積もる
+const uint64_t BYTES_PER_NODE = 64;
+
+// Partitions probed at each probe depth / 各試行深さで試すパーティション数
+const int PROBE_SAMPLES = 2;
+
+// Deepest probe depth; partitions there are cheap to build
+// 試行深さの上限。この深さのパーティションは安価に構築できる
+const int PROBE_DEPTH = 12;
+
+// ============================================================================
+// parseBytes
+// ============================================================================
+//
+// "4096", "512M", "1.5G", "2GiB" → bytes (K/M/G/T are powers of 1024).
+// Returns false on malformed or zero input.
+//
+// "4096", "512M", "1.5G", "2GiB" → バイト数（K/M/G/T は 1024 の累乗）。
+// 不正な入力や 0 では false を返す。
+//
+// ============================================================================
+inline bool parseBytes(const std::string& text, uint64_t& bytes) {
+    size_t pos = 0;
+    double value;
+    try {
+        value = std::stod(text, &pos);
+    } catch (...) {
+        return false;
+    }
+    std::string unit = text.substr(pos);
+    if (unit.size() >= 2 && unit.compare(unit.size() - 2, 2, "iB") == 0) {
+        unit.erase(unit.size() - 2);
+    } else if (!unit.empty() && (unit.back() == 'B' || unit.back() == 'b')) {
+        unit.pop_back();
+    }
+    double scale = 1;
+    if (unit == "K" || unit == "k") {
+        scale = 1024.0;
+    } else if (unit == "M" || unit == "m") {
+        scale = 1024.0 * 1024;
+    } else if (unit == "G" || unit == "g") {
+        scale = 1024.0 * 1024 * 1024;
+    } else if (unit == "T" || unit == "t") {
+        scale = 1024.0 * 1024 * 1024 * 1024;
+    } else if (!unit.empty()) {
+        return false;
+    }
+    double total = value * scale;
+    if (!(total >= 1) || total > 1.8e19) return false;
+    bytes = static_cast<uint64_t>(total);
+    return true;
+}
+
+// ============================================================================
+// workingCopies / nodeBudget
+// ============================================================================
+//
+// Diagrams a partition holds at once, and the node count a partition may
+// reach so that its working set stays within max_memory.
+//
+// パーティションが同時に保持する ZDD の数と、作業領域が max_memory に
+// 収まるためにパーティションが取りうるノード数。
+//
+// ============================================================================
+inline int workingCopies(bool apply_filter, bool apply_burnside, bool apply_representatives) {
+    if (apply_burnside) return 3;
+    if (apply_filter || apply_representatives) return 2;
+    return 1;
+}
+
+inline uint64_t nodeBudget(uint64_t max_memory, int copies) {
+    return std::max<uint64_t>(1, max_memory / (BYTES_PER_NODE * copies));
+}
+
+// ============================================================================
+// chooseSplitDepth
+// ============================================================================
+//
+// Smallest depth in [0, max_depth] whose largest partition, extrapolated
+// from probe_nodes (largest probed partition at probe_depth) with growth
+// ratio per removed edge, fits in node_budget. Writes the prediction for
+// the chosen depth to estimated_nodes.
+//
+// 最大パーティションのノード数を probe_nodes（probe_depth で試した最大
+// パーティション）から辺 1 本あたりの増加率 growth で外挿し、node_budget
+// に収まる [0, max_depth] の最小の深さ。選んだ深さの予測値を
+// estimated_nodes に書く。
+//
+// ============================================================================
+inline int chooseSplitDepth(uint64_t probe_nodes, int probe_depth, double growth,
+                            uint64_t node_budget, int max_depth,
+                            uint64_t& estimated_nodes) {
+    growth = std::min(2.0, std::max(1.0, growth));
+    for (int d = 0; d <= max_depth; ++d) {
+        double estimate = probe_nodes * std::pow(growth, probe_depth - d);
+        if (estimate <= node_budget || d == max_depth) {
+            estimated_nodes = static_cast<uint64_t>(std::min(estimate, 1.8e19));
+            return d;
+        }
+    }
+    estimated_nodes = probe_nodes;
+    return max_depth;
+}
+
+// ============================================================================
+// peakResidentBytes
+// ============================================================================
+//
+// Peak resident set of this process (VmHWM), or 0 where /proc is missing.
+// In a batch this includes every job run so far, not just the caller's.
+// このプロセスのピーク常駐メモリ（VmHWM）。/proc がなければ 0。
+// バッチでは呼び出し元のジョブだけでなく、それまでの全ジョブを含む。
+//
+// ============================================================================
+inline uint64_t peakResidentBytes() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stoull(line.substr(6)) * 1024;  // kB
+        }
+    }
+    return 0;
+}
+
+}  // namespace MemoryBudget
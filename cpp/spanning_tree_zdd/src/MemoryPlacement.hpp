@@ -0,0 +1,292 @@
+// ============================================================================
+// MemoryPlacement.hpp
+// ============================================================================
+//
+// What this file does:
+//   Process-wide placement of diagram memory on multi-socket machines:
+//   the NUMA policy (--numa interleave | first-touch), transparent huge page
+//   hints for the large arrays this tree allocates (--huge-pages) and the
+//   pinning of worker threads to CPUs (--pin-threads). Chosen once at
+//   startup, like the bitmask kernels.
+//
+// このファイルの役割:
+//   マルチソケットのマシンにおける ZDD メモリのプロセス全体の配置:
+//   NUMA ポリシー（--numa interleave | first-touch）、このツリーが確保する
+//   大きな配列への透過的ヒュージページのヒント（--huge-pages）、ワーカ
+//   スレッドの CPU への固定（--pin-threads）。ビットマスクカーネルと同様に
+//   起動時に 1 度だけ選択する。
+//
+// Responsibility:
+//   - interleave: set_mempolicy(MPOL_INTERLEAVE) over every online node, so
+//     every later allocation, TdZdd's node tables included, is spread
+//     page by page across the sockets
+//   - first-touch: keep the kernel's local policy and pin the workers, so
+//     each worker's diagram lands on the node of the CPU that builds it
+//   - Huge pages: madvise(MADV_HUGEPAGE) on buffers of at least 2 MiB.
+//     TdZdd allocates its node tables itself; glibc hints those when the
+//     process starts with GLIBC_TUNABLES=glibc.malloc.hugetlb=1, which
+//     mallocHugePages() detects
+//   - Worker w is pinned to one CPU, visiting the nodes round-robin
+//
+// 責任範囲:
+//   - interleave: 全オンラインノードに set_mempolicy(MPOL_INTERLEAVE) を
+//     設定し、以降の全ての確保（TdZdd のノード表を含む）をページ単位で
+//     ソケット間に分散する
+//   - first-touch: カーネルのローカルポリシーのままワーカを固定し、各
+//     ワーカの ZDD を構築した CPU のノードに置く
+//   - ヒュージページ: 2 MiB 以上のバッファに madvise(MADV_HUGEPAGE)。
+//     TdZdd はノード表を自身で確保する。プロセスが
+//     GLIBC_TUNABLES=glibc.malloc.hugetlb=1 で起動されていれば glibc が
+//     それらにヒントを与え、mallocHugePages() がそれを検出する
+//   - ワーカ w を 1 つの CPU に固定し、ノードを順番に巡る
+//
+// Design:
+//   The system calls are made directly (no libnuma dependency). The memory
+//   policy is per thread and inherited by new threads, so apply() runs on
+//   the main thread before any worker starts. Where /sys or the calls are
+//   missing (non-Linux, containers without NUMA), the options degrade to
+//   no-ops and the detected node count says so.
+//
+// 設計:
+//   システムコールを直接呼ぶ（libnuma に依存しない）。メモリポリシーは
+//   スレッドごとで新しいスレッドに継承されるため、apply() はワーカの起動前
+//   にメインスレッドで実行する。/sys やシステムコールがない環境（Linux 以外、
+//   NUMA のないコンテナ）では何もせず、検出したノード数でそれを示す。
+//
+// ============================================================================
+
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace MemoryPlacement {
+
+enum class Numa { Default, Interleave, FirstTouch };
+
+struct Settings {
+    Numa numa = Numa::Default;
+    bool huge_pages = false;
+    bool pin_threads = false;
+};
+
+// Smallest buffer worth a huge page hint / ヒュージページのヒントを与える最小のバッファ
+const size_t HUGE_PAGE_BYTES = size_t(2) << 20;
+
+namespace detail {
+
+inline Settings g_settings;
+inline std::vector<int> g_nodes = {0};   // Online NUMA nodes / オンラインの NUMA ノード
+inline std::vector<int> g_cpu_order;     // Pinning order / 固定の順序
+
+// "0-3,8,10-11" → {0, 1, 2, 3, 8, 10, 11}
+inline std::vector<int> parseList(const std::string& text) {
+    std::vector<int> values;
+    std::istringstream in(text);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int v = first; v <= last; ++v) values.push_back(v);
+        } catch (...) {
+        }
+    }
+    return values;
+}
+
+inline std::string readLine(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+}  // namespace detail
+
+inline const Settings& active() {
+    return detail::g_settings;
+}
+
+inline int nodeCount() {
+    return (int)detail::g_nodes.size();
+}
+
+// True if glibc malloc was started with huge page hints
+// (GLIBC_TUNABLES=glibc.malloc.hugetlb=1 or 2)
+// glibc の malloc がヒュージページのヒント付きで起動されていれば true
+inline bool mallocHugePages() {
+    const char* tunables = std::getenv("GLIBC_TUNABLES");
+    if (tunables == nullptr) return false;
+    std::string text = tunables;
+    return text.find("glibc.malloc.hugetlb=1") != std::string::npos
+        || text.find("glibc.malloc.hugetlb=2") != std::string::npos;
+}
+
+inline const char* name(Numa numa) {
+    switch (numa) {
+        case Numa::Interleave: return "interleave";
+        case Numa::FirstTouch: return "first-touch";
+        default: return "default";
+    }
+}
+
+inline bool parseNuma(const std::string& text, Numa& numa) {
+    for (Numa n : {Numa::Default, Numa::Interleave, Numa::FirstTouch}) {
+        if (text == name(n)) {
+            numa = n;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// apply
+// ============================================================================
+//
+// Install `settings` for the whole process. Call on the main thread before
+// any worker starts; pins the calling thread as worker 0. first-touch
+// implies pinning. Returns false (with a message) if the policy is refused.
+//
+// settings をプロセス全体に設定する。ワーカの起動前にメインスレッドで呼ぶ。
+// 呼び出したスレッドをワーカ 0 として固定する。first-touch は固定を伴う。
+// ポリシーが拒否された場合は（メッセージ付きで）false を返す。
+//
+// ============================================================================
+inline bool apply(Settings settings, std::string& error) {
+    if (settings.numa == Numa::FirstTouch) settings.pin_threads = true;
+    detail::g_settings = settings;
+
+#ifdef __linux__
+    std::vector<int> nodes = detail::parseList(
+        detail::readLine("/sys/devices/system/node/online"));
+    if (!nodes.empty()) detail::g_nodes = nodes;
+
+    if (settings.numa == Numa::Interleave && nodeCount() > 1) {
+        const long MPOL_INTERLEAVE_MODE = 3;
+        const int bits = 8 * sizeof(unsigned long);
+        std::vector<unsigned long> mask(detail::g_nodes.back() / bits + 1, 0);
+        for (int node : detail::g_nodes) mask[node / bits] |= 1UL << (node % bits);
+        if (syscall(SYS_set_mempolicy, MPOL_INTERLEAVE_MODE, mask.data(),
+                    (unsigned long)(mask.size() * bits + 1)) != 0) {
+            error = "set_mempolicy(MPOL_INTERLEAVE) failed";
+            return false;
+        }
+    }
+
+    // CPUs this process may use, grouped by node, then taken round-robin
+    // このプロセスが使える CPU をノードごとにまとめ、順番に取り出す
+    detail::g_cpu_order.clear();
+    if (settings.pin_threads) {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            error = "sched_getaffinity failed";
+            return false;
+        }
+        std::vector<std::vector<int>> per_node;
+        std::vector<bool> seen(CPU_SETSIZE, false);
+        for (int node : detail::g_nodes) {
+            std::vector<int> cpus;
+            for (int cpu : detail::parseList(detail::readLine(
+                     "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"))) {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed) && !seen[cpu]) {
+                    seen[cpu] = true;
+                    cpus.push_back(cpu);
+                }
+            }
+            if (!cpus.empty()) per_node.push_back(cpus);
+        }
+        std::vector<int> rest;  // CPUs /sys did not place / /sys で配置できなかった CPU
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed) && !seen[cpu]) rest.push_back(cpu);
+        }
+        if (!rest.empty()) per_node.push_back(rest);
+        for (size_t k = 0; !per_node.empty(); ++k) {
+            bool any = false;
+            for (auto& cpus : per_node) {
+                if (k < cpus.size()) {
+                    detail::g_cpu_order.push_back(cpus[k]);
+                    any = true;
+                }
+            }
+            if (!any) break;
+        }
+        if (!detail::g_cpu_order.empty()) {
+            cpu_set_t first;
+            CPU_ZERO(&first);
+            CPU_SET(detail::g_cpu_order[0], &first);
+            pthread_setaffinity_np(pthread_self(), sizeof(first), &first);
+        }
+    }
+#else
+    if (settings.numa != Numa::Default || settings.pin_threads) {
+        error = "--numa and --pin-threads need Linux";
+        return false;
+    }
+#endif
+    return true;
+}
+
+// ============================================================================
+// pinWorker
+// ============================================================================
+//
+// Pin the calling thread as worker `worker` (0 = the thread that called
+// apply). A no-op unless pinning is active.
+// 呼び出したスレッドをワーカ worker として固定する（0 = apply を呼んだ
+// スレッド）。固定が無効なら何もしない。
+//
+// ============================================================================
+inline void pinWorker(int worker) {
+#ifdef __linux__
+    if (detail::g_cpu_order.empty()) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(detail::g_cpu_order[worker % detail::g_cpu_order.size()], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)worker;
+#endif
+}
+
+// ============================================================================
+// adviseHugePages
+// ============================================================================
+//
+// Ask for transparent huge pages on the 2 MiB-aligned interior of
+// [data, data + bytes), if --huge-pages is on and the range is large
+// enough. Call before the buffer is first written.
+// --huge-pages が有効で範囲が十分大きければ、[data, data + bytes) の
+// 2 MiB 境界に揃った内側に透過的ヒュージページを要求する。バッファへの
+// 最初の書き込みより前に呼ぶ。
+//
+// ============================================================================
+inline void adviseHugePages(void* data, size_t bytes) {
+#ifdef __linux__
+    if (!detail::g_settings.huge_pages || bytes < HUGE_PAGE_BYTES) return;
+    uintptr_t first = (reinterpret_cast<uintptr_t>(data) + HUGE_PAGE_BYTES - 1)
+                      & ~(uintptr_t)(HUGE_PAGE_BYTES - 1);
+    uintptr_t last = (reinterpret_cast<uintptr_t>(data) + bytes)
+                     & ~(uintptr_t)(HUGE_PAGE_BYTES - 1);
+    if (last > first) ::madvise(reinterpret_cast<void*>(first), last - first, MADV_HUGEPAGE);
+#else
+    (void)data;
+    (void)bytes;
+#endif
+}
+
+}  // namespace MemoryPlacement
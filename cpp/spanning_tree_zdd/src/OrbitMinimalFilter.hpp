@@ -0,0 +1,264 @@
+// ============================================================================
+// OrbitMinimalFilter.hpp
+// ============================================================================
+//
+// What this file does:
+//   Defines OrbitMinimalFilter class for orbit-representative filtering.
+//   Given an edge permutation g, keeps spanning trees T such that
+//   T ≤ gT in lexicographic order (of sorted edge index lists).
+//   Subsetting with one filter per automorphism g ∈ Aut(Γ) keeps exactly
+//   the lexicographically smallest tree of every orbit.
+//
+// このファイルの役割:
+//   軌道代表元フィルタリングのための OrbitMinimalFilter クラスを定義。
+//   辺置換 g が与えられたとき、（ソート済み辺インデックス列の）辞書式順序で
+//   T ≤ gT を満たす全域木 T を残す。
+//   各自己同型 g ∈ Aut(Γ) ごとに 1 つのフィルタで subsetting すると、
+//   各軌道の辞書式最小の全域木のみが残る。
+//
+// Responsibility in the project:
+//   - Implements TdZdd DdSpec interface for ZDD subsetting
+//   - Its cardinality after all automorphisms is the nonisomorphic count,
+//     independent of Burnside's lemma
+//   - Iterating the result yields one representative per class (export)
+//
+// プロジェクト内での責務:
+//   - ZDD subsetting のための TdZdd DdSpec インターフェースを実装
+//   - 全自己同型適用後の要素数が非同型数（Burnside の補題とは独立）
+//   - 結果を走査すると各同型類の代表元が 1 つずつ得られる（エクスポート）
+//
+// Phase 6 における位置づけ:
+//   Independent check on the Burnside count, and the source of
+//   nonisomorphic unfoldings for drawing.
+//   Burnside 計数の独立検証、および描画用の非同型展開図の供給源。
+//
+// Design:
+//   All spanning trees have the same size, so T < gT iff the smallest edge
+//   of the symmetric difference T △ gT belongs to T. Position p compares
+//   x_p (p ∈ T) with x_{g⁻¹(p)} (p ∈ gT); its outcome is known once both
+//   p and g⁻¹(p) are processed. Edges are processed from index 0 upward.
+//
+//   State = [header][bitmask of remembered x_j]:
+//   - header: the smallest position decided so far with a difference
+//     ("tail", and whether T is smaller or larger there), or ACCEPTED
+//   - bitmask: x_j for processed edges still needed by an undecided
+//     position (BitState::Layout(num_edges), unneeded bits are cleared
+//     so that equivalent states merge)
+//
+//   When no undecided position precedes the tail, the comparison is over:
+//   T > gT prunes, T < gT accepts (all later edges are free).
+//
+// 設計:
+//   全域木は全て同じ辺数なので、T < gT ⇔ 対称差 T △ gT の最小辺が T に属する。
+//   位置 p では x_p（p ∈ T）と x_{g⁻¹(p)}（p ∈ gT）を比較し、p と g⁻¹(p) の
+//   両方を処理した時点で結果が確定する。辺はインデックス 0 から順に処理される。
+//
+//   状態 = [ヘッダ][記憶した x_j のビットマスク]:
+//   - ヘッダ: これまでに差が確定した最小の位置（"tail"、そこで T が小さいか
+//     大きいか）、または ACCEPTED
+//   - ビットマスク: 未確定の位置が必要とする処理済み辺の x_j
+//     （BitState::Layout(num_edges)、同値な状態が併合されるよう不要ビットはクリア）
+//
+//   tail より前に未確定の位置がなくなれば比較は終了:
+//   T > gT なら枝刈り、T < gT なら受理（以降の辺は自由）。
+//
+// ============================================================================
+
+#pragma once
+#include <algorithm>
+#include <climits>
+#include <vector>
+#include <tdzdd/DdSpec.hpp>
+#include "BitState.hpp"
+
+// ============================================================================
+// OrbitMinimalFilter Class
+// OrbitMinimalFilter クラス
+// ============================================================================
+//
+// State:
+//   uint64_t array: one header word followed by a BitState::Layout state.
+//
+// 状態:
+//   uint64_t 配列: ヘッダ 1 ワードと BitState::Layout の状態。
+//
+// ============================================================================
+class OrbitMinimalFilter
+    : public tdzdd::PodArrayDdSpec<OrbitMinimalFilter, uint64_t, 2> {
+private:
+    // Header encoding / ヘッダの符号化
+    //   bits 0-31: tail position + 1 (0 = no difference yet / 差なし)
+    //   bit 32:    T > gT at tail / tail で T > gT
+    static constexpr uint64_t TAIL_MASK = 0xFFFFFFFFULL;
+    static constexpr uint64_t TAIL_GREATER = 1ULL << 32;
+    static constexpr uint64_t ACCEPTED = 1ULL << 63;
+
+    int const e;                          // Total number of edges / 全辺数
+    BitState::Layout layout;              // Remembered x_j (one bit per edge) / 記憶した x_j
+    std::vector<int> perm;                // g
+    std::vector<int> inv;                 // g⁻¹
+    std::vector<int> min_pending;         // After edge i: smallest p ≤ i with g⁻¹(p) > i
+    std::vector<BitState::BitPos> edge_bit;  // edge index → bit / 辺インデックス → ビット
+
+    inline bool stillNeeded(int j, int i) const {
+        return perm[j] > i || inv[j] > i;
+    }
+
+public:
+    // ========================================================================
+    // Constructor
+    // コンストラクタ
+    // ========================================================================
+    //
+    // Parameters:
+    //   num_edges: Total number of edges in the graph
+    //   edge_perm: Edge permutation [g(0), g(1), ..., g(E-1)]
+    //
+    // パラメータ:
+    //   num_edges: グラフの全辺数
+    //   edge_perm: 辺置換 [g(0), g(1), ..., g(E-1)]
+    //
+    // ========================================================================
+    OrbitMinimalFilter(int num_edges, const std::vector<int>& edge_perm)
+        : e(num_edges),
+          layout(num_edges),
+          perm(edge_perm),
+          inv(num_edges),
+          min_pending(num_edges, INT_MAX),
+          edge_bit(num_edges) {
+        for (int i = 0; i < e; ++i) {
+            inv[perm[i]] = i;
+            edge_bit[i] = BitState::BitPos(i);
+        }
+
+        // Position p is undecided after edge i iff p ≤ i < g⁻¹(p)
+        // 位置 p が辺 i の処理後に未確定 ⇔ p ≤ i < g⁻¹(p)
+        for (int p = 0; p < e; ++p) {
+            for (int i = p; i < inv[p]; ++i) {
+                min_pending[i] = std::min(min_pending[i], p);
+            }
+        }
+
+        setArraySize(1 + layout.stateWords());
+    }
+
+    int getRoot(uint64_t* state) const {
+        state[0] = 0;
+        layout.clearAll(state + 1);
+        return e;
+    }
+
+    // ========================================================================
+    // hashCode / equalTo
+    // ========================================================================
+    //
+    // Header word plus BitState::Layout hooks on the bitmask part.
+    // ヘッダワードとビットマスク部分への BitState::Layout フック。
+    //
+    // ========================================================================
+    size_t hashCode(uint64_t const* a) const {
+        return BitState::mix64(a[0] ^ layout.hash(a + 1));
+    }
+
+    bool equalTo(uint64_t const* a, uint64_t const* b) const {
+        return a[0] == b[0] && layout.equal(a + 1, b + 1);
+    }
+
+    size_t hash_code(void const* p, int /*level*/) const {
+        return hashCode(static_cast<uint64_t const*>(p));
+    }
+
+    bool equal_to(void const* p, void const* q, int /*level*/) const {
+        return equalTo(static_cast<uint64_t const*>(p),
+                       static_cast<uint64_t const*>(q));
+    }
+
+    // ========================================================================
+    // getChild
+    // ========================================================================
+    //
+    // Process edge i = e - level with x_i = value:
+    //   1. Position g(i) < i is now decided: compare x_{g(i)} with x_i
+    //   2. Position i is decided if g⁻¹(i) < i: compare x_i with x_{g⁻¹(i)}
+    //   3. A difference before the current tail becomes the new tail
+    //   4. Drop remembered bits no longer needed
+    //   5. If no undecided position precedes the tail: prune or accept
+    //
+    // 辺 i = e - level を x_i = value で処理:
+    //   1. 位置 g(i) < i が確定: x_{g(i)} と x_i を比較
+    //   2. g⁻¹(i) < i なら位置 i が確定: x_i と x_{g⁻¹(i)} を比較
+    //   3. 現在の tail より前の差が新しい tail になる
+    //   4. 不要になった記憶ビットを破棄
+    //   5. tail より前に未確定の位置がなければ枝刈りまたは受理
+    //
+    // ========================================================================
+    int getChild(uint64_t* state, int level, int value) const {
+        int next = (level == 1) ? -1 : level - 1;
+        if (state[0] == ACCEPTED) return next;
+
+        uint64_t* bits = state + 1;
+        int i = e - level;
+        bool x = (value == 1);
+
+        int tail = (state[0] & TAIL_MASK) ? int(state[0] & TAIL_MASK) - 1 : INT_MAX;
+        bool greater = (state[0] & TAIL_GREATER) != 0;
+        bool new_tail = false;
+
+        // 1. Position p = g(i): T has x_p, gT has x_i
+        //    位置 p = g(i): T 側は x_p、gT 側は x_i
+        int p = perm[i];
+        if (p < i && p < tail) {
+            bool xp = layout.test(bits, edge_bit[p]);
+            if (xp != x) {
+                tail = p;
+                greater = x;
+                new_tail = true;
+            }
+        }
+
+        // 2. Position i: T has x_i, gT has x_{g⁻¹(i)}
+        //    位置 i: T 側は x_i、gT 側は x_{g⁻¹(i)}
+        int s = inv[i];
+        if (s < i && i < tail) {
+            bool xs = layout.test(bits, edge_bit[s]);
+            if (xs != x) {
+                tail = i;
+                greater = xs;
+                new_tail = true;
+            }
+        }
+
+        // 4. Keep only bits that an undecided position can still use
+        //    未確定の位置が使いうるビットのみを保持
+        if (tail == INT_MAX) {
+            if (x && stillNeeded(i, i)) layout.set(bits, edge_bit[i]);
+            if (p < i && !stillNeeded(p, i)) layout.clear(bits, edge_bit[p]);
+            if (s < i && !stillNeeded(s, i)) layout.clear(bits, edge_bit[s]);
+        } else if (new_tail) {
+            // Only positions before the tail matter from now on
+            // 以降は tail より前の位置のみが意味を持つ
+            for (int j = 0; j < i; ++j) {
+                if (layout.test(bits, edge_bit[j]) && (j >= tail || inv[j] <= i)) {
+                    layout.clear(bits, edge_bit[j]);
+                }
+            }
+        } else if (p < i) {
+            layout.clear(bits, edge_bit[p]);
+        }
+
+        // 5. Decided when no undecided position precedes the tail
+        //    tail より前に未確定の位置がなければ確定
+        if (tail != INT_MAX && min_pending[i] > tail) {
+            if (greater) return 0;  // T > gT: not the orbit minimum / 軌道最小でない
+            state[0] = ACCEPTED;    // T < gT / T < gT
+            layout.clearAll(bits);
+            return next;
+        }
+        if (level == 1) return -1;  // T = gT
+
+        state[0] = (tail == INT_MAX)
+                 ? 0
+                 : (uint64_t(tail + 1) | (greater ? TAIL_GREATER : 0));
+        return next;
+    }
+};
@@ -0,0 +1,507 @@
+// ============================================================================
+// OutOfCoreDd.hpp
+// ============================================================================
+//
+// What this file does:
+//   Out-of-core ZDDs for --out-of-core: a top-down builder that writes each
+//   completed level to a segment file and frees it, and the level-sequential
+//   passes that read those files back through memory maps (reduce, count,
+//   and subsetting by building the intersection with a stored diagram).
+//
+// このファイルの役割:
+//   --out-of-core 用のメモリ外 ZDD: 完成したレベルをセグメントファイルに
+//   書き出して解放するトップダウン構築と、そのファイルをメモリマップで
+//   読み戻すレベル順のパス（既約化、数え上げ、格納済み ZDD との共通部分の
+//   構築による subsetting）。
+//
+// Responsibility:
+//   - Only the states of levels not yet expanded stay in RAM; node arrays,
+//     reduction maps and counts live in files, so the page cache (not the
+//     heap) holds them and the kernel may evict them under pressure
+//   - Work with any TdZdd spec through its generic interface (datasize,
+//     get_root, get_child, get_copy, destruct, hash_code, equal_to)
+//   - Report bytes written and per-pass node throughput
+//
+// 責任範囲:
+//   - RAM に残るのは未展開のレベルの状態のみ。ノード配列・既約化の対応表・
+//     要素数はファイルに置くため、ヒープではなくページキャッシュが保持し、
+//     メモリ不足時にはカーネルが追い出せる
+//   - TdZdd の汎用インタフェース（datasize, get_root, get_child, get_copy,
+//     destruct, hash_code, equal_to）を通じて任意の spec を扱う
+//   - 書き込んだバイト数とパスごとのノード処理速度を報告
+//
+// Layout:
+//   A node reference is level << 44 | index, like tdzdd::NodeId; (0, 0) and
+//   (0, 1) are the 0- and 1-terminals. A diagram is one file per non-empty
+//   level, <dir>/<name>-<pid>-<serial>.<level>, holding {child0, child1}
+//   per node as two native-endian uint64_t. Files are scratch data of one
+//   run and are removed when their owner is destroyed.
+//
+// 配置:
+//   ノード参照は tdzdd::NodeId と同じ level << 44 | index。(0, 0) と (0, 1)
+//   は 0-終端と 1-終端。ZDD は空でないレベルごとに 1 ファイル
+//   <dir>/<name>-<pid>-<通番>.<level> で、ノードごとに {child0, child1} を
+//   ネイティブエンディアンの uint64_t 2 個で持つ。ファイルは 1 回の実行の
+//   一時データで、所有者の破棄時に削除する。
+//
+// ============================================================================
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <tdzdd/DdSpec.hpp>
+#include "BufferPool.hpp"
+#include "InputLoader.hpp"
+#include "LevelStates.hpp"
+
+namespace OutOfCore {
+
+const int INDEX_BITS = 44;
+const uint64_t ZERO = 0;
+const uint64_t ONE = 1;
+
+inline uint64_t makeRef(int level, uint64_t index) {
+    return (uint64_t(level) << INDEX_BITS) | index;
+}
+
+inline int levelOf(uint64_t f) {
+    return int(f >> INDEX_BITS);
+}
+
+inline uint64_t indexOf(uint64_t f) {
+    return f & ((uint64_t(1) << INDEX_BITS) - 1);
+}
+
+// TdZdd level code of a reference: level, 0 (0-terminal) or -1 (1-terminal)
+// 参照の TdZdd レベル値: レベル、0（0-終端）、-1（1-終端）
+inline int specLevel(uint64_t f) {
+    return f == ONE ? -1 : levelOf(f);
+}
+
+// ============================================================================
+// Workspace
+// ============================================================================
+//
+// Segment directory of a run, with the I/O and throughput counters of
+// every diagram created in it.
+//
+// 1 回の実行のセグメントディレクトリと、そこで作られた全 ZDD の I/O・
+// 処理速度の集計。
+//
+// ============================================================================
+class Workspace {
+    std::string dir;
+
+public:
+    BufferPool& pool;             // Buffers of every pass / 全パスのバッファ
+    uint64_t bytes_written = 0;   // Total written / 書き込み総量
+    uint64_t bytes_on_disk = 0;   // Currently held / 現在の保持量
+    uint64_t peak_bytes = 0;      // Largest bytes_on_disk / bytes_on_disk の最大
+    uint64_t built_nodes = 0;     // Nodes made by build() / build() が作ったノード
+    uint64_t reduced_nodes = 0;   // Nodes read by reduce() / reduce() が読んだノード
+    uint64_t counted_nodes = 0;   // Nodes read by count() / count() が読んだノード
+    double build_ms = 0.0;
+    double reduce_ms = 0.0;
+    double count_ms = 0.0;
+
+    explicit Workspace(BufferPool& pool) : pool(pool) {}
+
+    // Use (and create if missing) directory `path`
+    // ディレクトリ path を使う（なければ作成）
+    bool open(const std::string& path, std::string& error) {
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0 && ::mkdir(path.c_str(), 0777) != 0) {
+            error = "Could not create " + path;
+            return false;
+        }
+        if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+            error = path + " is not a directory";
+            return false;
+        }
+        dir = path;
+        return true;
+    }
+
+    const std::string& directory() const {
+        return dir;
+    }
+
+    // File prefix for a new array, unique across the jobs and processes
+    // sharing the directory
+    // 新しい配列用のファイル接頭辞。ディレクトリを共有するジョブ・プロセス間で一意
+    std::string prefix(const std::string& name) {
+        static std::atomic<uint64_t> serial(0);
+        return dir + "/" + name + "-" + std::to_string(::getpid()) + "-"
+            + std::to_string(serial++);
+    }
+
+    void added(uint64_t bytes) {
+        bytes_written += bytes;
+        bytes_on_disk += bytes;
+        peak_bytes = std::max(peak_bytes, bytes_on_disk);
+    }
+
+    void removed(uint64_t bytes) {
+        bytes_on_disk -= bytes;
+    }
+
+    static double perSecond(uint64_t nodes, double ms) {
+        return ms > 0 ? nodes * 1000.0 / ms : 0.0;
+    }
+};
+
+// ============================================================================
+// SegmentArray
+// ============================================================================
+//
+// Per-level arrays of fixed-size records (record_words uint64_t each). A
+// level is written once, in full, and is then read through a memory map.
+//
+// レベルごとの固定長レコード（各 record_words 個の uint64_t）の配列。
+// レベルは 1 回だけ丸ごと書き込み、以後はメモリマップで読む。
+//
+// ============================================================================
+class SegmentArray {
+    Workspace& ws;
+    std::string file_prefix;
+    size_t record_words;
+    std::vector<uint64_t> sizes;  // [level] → records
+    std::vector<std::unique_ptr<InputLoader::MappedFile>> files;
+
+public:
+    SegmentArray(Workspace& ws, const std::string& name, size_t record_words)
+        : ws(ws), file_prefix(ws.prefix(name)), record_words(record_words) {}
+
+    ~SegmentArray() {
+        remove();
+    }
+
+    SegmentArray(const SegmentArray&) = delete;
+    SegmentArray& operator=(const SegmentArray&) = delete;
+
+    std::string path(int level) const {
+        return file_prefix + "." + std::to_string(level);
+    }
+
+    // Write level `level` (records.size() / record_words records) and map it
+    // レベル level（records.size() / record_words 個）を書き込んでマップする
+    bool write(int level, const std::vector<uint64_t>& records, std::string& error) {
+        if ((int)sizes.size() <= level) {
+            sizes.resize(level + 1, 0);
+            files.resize(level + 1);
+        }
+        sizes[level] = records.size() / record_words;
+        if (records.empty()) return true;
+
+        size_t bytes = records.size() * sizeof(uint64_t);
+        {
+            std::ofstream out(path(level), std::ios::binary);
+            out.write(reinterpret_cast<const char*>(records.data()), bytes);
+            if (!out) {
+                std::remove(path(level).c_str());
+                error = "Could not write " + path(level);
+                return false;
+            }
+        }
+        ws.added(bytes);
+
+        // Reduce and count passes look records up by node index
+        // 既約化と数え上げのパスはノード番号でレコードを引く
+        files[level].reset(new InputLoader::MappedFile(path(level), MADV_RANDOM));
+        if (files[level]->size() != bytes) {
+            error = "Could not map " + path(level);
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t size(int level) const {
+        return level < (int)sizes.size() ? sizes[level] : 0;
+    }
+
+    uint64_t totalRecords() const {
+        uint64_t total = 0;
+        for (uint64_t n : sizes) total += n;
+        return total;
+    }
+
+    const uint64_t* at(int level, uint64_t index) const {
+        return reinterpret_cast<const uint64_t*>(files[level]->begin()) + index * record_words;
+    }
+
+    // Read-ahead of a level about to be scanned / 走査直前のレベルを先読み
+    void willNeed(int level) const {
+        if (level < (int)files.size() && files[level]) files[level]->willNeed();
+    }
+
+    void remove() {
+        for (size_t level = 0; level < files.size(); ++level) {
+            if (!files[level]) continue;
+            ws.removed(files[level]->size());
+            files[level].reset();
+            std::remove(path(level).c_str());
+        }
+        files.clear();
+        sizes.clear();
+    }
+};
+
+// ============================================================================
+// Diagram
+// ============================================================================
+//
+// A stored ZDD: root reference and per-level {child0, child1} arrays.
+// 格納された ZDD: 根の参照とレベルごとの {child0, child1} 配列。
+//
+// ============================================================================
+struct Diagram {
+    SegmentArray nodes;
+    uint64_t root = ZERO;
+
+    Diagram(Workspace& ws, const std::string& name) : nodes(ws, name, 2) {}
+
+    int topLevel() const {
+        return levelOf(root);
+    }
+
+    uint64_t size() const {
+        return nodes.totalRecords();
+    }
+
+    uint64_t child(uint64_t f, int b) const {
+        return nodes.at(levelOf(f), indexOf(f))[b];
+    }
+};
+
+// ============================================================================
+// DiagramSpec
+// ============================================================================
+//
+// A stored diagram as a TdZdd spec (state = node reference), so that
+// zddIntersection(DiagramSpec(dd), filter) is its subset by `filter`.
+//
+// 格納された ZDD を TdZdd の spec として扱う（状態 = ノード参照）。
+// zddIntersection(DiagramSpec(dd), filter) がその filter による部分集合。
+//
+// ============================================================================
+class DiagramSpec : public tdzdd::DdSpec<DiagramSpec, uint64_t, 2> {
+    const Diagram* dd;
+
+public:
+    explicit DiagramSpec(const Diagram& dd) : dd(&dd) {}
+
+    int getRoot(uint64_t& f) const {
+        f = dd->root;
+        return specLevel(f);
+    }
+
+    int getChild(uint64_t& f, int /*level*/, int value) const {
+        f = dd->child(f, value);
+        return specLevel(f);
+    }
+
+    size_t hashCode(uint64_t const& f) const {
+        return f * 314159257;
+    }
+
+    bool equalTo(uint64_t const& f, uint64_t const& g) const {
+        return f == g;
+    }
+};
+
+// ============================================================================
+// build
+// ============================================================================
+//
+// What this does:
+//   Top-down breadth-first construction of `spec` into `out` (not reduced).
+//   The states of each level are deduplicated with the spec's hash_code /
+//   equal_to in a level-local table. When a level has been expanded, its
+//   node array is written out and its states are destroyed, so RAM holds
+//   only the frontier of levels still to expand.
+//
+// この処理の内容:
+//   spec をトップダウン・幅優先で out に構築する（既約化しない）。各レベルの
+//   状態は spec の hash_code / equal_to によりレベル局所の表で重複除去する。
+//   レベルを展開し終えるとノード配列を書き出して状態を破棄するため、RAM に
+//   残るのは未展開のレベルのみ。
+//
+// ============================================================================
+template<typename SPEC>
+bool build(const SPEC& spec0, Diagram& out, Workspace& ws, std::string& error) {
+    auto start = std::chrono::high_resolution_clock::now();
+    SPEC spec(spec0);
+    size_t stride = (spec.datasize() + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    BufferPool::Lease tmp(ws.pool, std::max<size_t>(1, stride));
+    tmp->resize(std::max<size_t>(1, stride));
+
+    int top = spec.get_root(tmp->data());
+    if (top <= 0) {
+        spec.destruct(tmp->data());
+        out.root = (top == 0) ? ZERO : ONE;
+        return true;
+    }
+
+    std::vector<std::unique_ptr<LevelStates<SPEC>>> levels(top + 1);
+    for (int i = 1; i <= top; ++i) {
+        levels[i].reset(new LevelStates<SPEC>(spec, ws.pool, i, stride));
+    }
+    out.root = makeRef(top, levels[top]->insert(tmp->data()));
+
+    for (int i = top; i >= 1; --i) {
+        LevelStates<SPEC>& states = *levels[i];
+        BufferPool::Lease nodes(ws.pool, states.size() * 2);
+        nodes->assign(states.size() * 2, ZERO);
+        for (uint64_t j = 0; j < states.size(); ++j) {
+            for (int b = 0; b < 2; ++b) {
+                spec.get_copy(tmp->data(), states.state(j));
+                int c = spec.get_child(tmp->data(), i, b);
+                if (c <= 0) {
+                    spec.destruct(tmp->data());
+                    (*nodes)[j * 2 + b] = (c == 0) ? ZERO : ONE;
+                } else {
+                    (*nodes)[j * 2 + b] = makeRef(c, levels[c]->insert(tmp->data()));
+                }
+            }
+        }
+        ws.built_nodes += states.size();
+        levels[i].reset();
+        spec.destructLevel(i);
+        if (!out.nodes.write(i, *nodes, error)) return false;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    ws.build_ms += std::chrono::duration<double, std::milli>(end - start).count();
+    return true;
+}
+
+// ============================================================================
+// reduce
+// ============================================================================
+//
+// What this does:
+//   Bottom-up ZDD reduction of `in` into `out`: a node whose 1-child is the
+//   0-terminal is replaced by its 0-child, and equal nodes of a level are
+//   merged. The old → new reference map of each level is itself a segment
+//   array, since upper levels may point to any level below.
+//
+// この処理の内容:
+//   in をボトムアップに ZDD 既約化して out に書く: 1-子が 0-終端のノードは
+//   0-子に置き換え、同じレベルの等しいノードは併合する。上のレベルは下の
+//   任意のレベルを指しうるため、各レベルの旧 → 新参照の対応表もセグメント
+//   配列とする。
+//
+// ============================================================================
+struct PairHash {
+    size_t operator()(const std::pair<uint64_t, uint64_t>& p) const {
+        return p.first * 314159257 + p.second * 271828183;
+    }
+};
+
+inline bool reduce(const Diagram& in, Diagram& out, Workspace& ws, std::string& error) {
+    auto start = std::chrono::high_resolution_clock::now();
+    int top = in.topLevel();
+    SegmentArray map(ws, "map", 1);
+
+    auto mapped = [&](uint64_t f) {
+        return levelOf(f) == 0 ? f : map.at(levelOf(f), indexOf(f))[0];
+    };
+
+    std::unordered_map<std::pair<uint64_t, uint64_t>, uint64_t, PairHash> unique;
+    for (int i = 1; i <= top; ++i) {
+        uint64_t n = in.nodes.size(i);
+        in.nodes.willNeed(i);
+        BufferPool::Lease level_map(ws.pool, n);
+        BufferPool::Lease nodes(ws.pool, n * 2);
+        level_map->assign(n, ZERO);
+        unique.clear();
+        for (uint64_t j = 0; j < n; ++j) {
+            const uint64_t* node = in.nodes.at(i, j);
+            uint64_t c0 = mapped(node[0]);
+            uint64_t c1 = mapped(node[1]);
+            if (c1 == ZERO) {
+                (*level_map)[j] = c0;
+                continue;
+            }
+            auto it = unique.emplace(std::make_pair(c0, c1), nodes->size() / 2).first;
+            if (it->second == nodes->size() / 2) {
+                nodes->push_back(c0);
+                nodes->push_back(c1);
+            }
+            (*level_map)[j] = makeRef(i, it->second);
+        }
+        ws.reduced_nodes += n;
+        if (!map.write(i, *level_map, error)) return false;
+        if (!out.nodes.write(i, *nodes, error)) return false;
+    }
+    out.root = mapped(in.root);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    ws.reduce_ms += std::chrono::duration<double, std::milli>(end - start).count();
+    return true;
+}
+
+// ============================================================================
+// count
+// ============================================================================
+//
+// What this does:
+//   Cardinality of `dd` as a decimal string, computed bottom-up with
+//   fixed-width multi-word counts (topLevel() / 64 + 1 words, enough for
+//   the 2^topLevel() bound) kept in a segment array. Works on reduced and
+//   unreduced diagrams alike.
+//
+// この処理の内容:
+//   dd の要素数を 10 進文字列で返す。固定幅の多倍長の要素数
+//   （topLevel() / 64 + 1 ワード。上限 2^topLevel() に十分）をセグメント配列に
+//   置いてボトムアップに計算する。既約・非既約のどちらの ZDD にも使える。
+//
+// ============================================================================
+inline bool count(const Diagram& dd, Workspace& ws, std::string& result, std::string& error) {
+    auto start = std::chrono::high_resolution_clock::now();
+    int top = dd.topLevel();
+    const size_t words = top / 64 + 1;
+    SegmentArray counts(ws, "count", words);
+
+    std::vector<uint64_t> zero(words, 0), one(words, 0);
+    one[0] = 1;
+    auto countOf = [&](uint64_t f) -> const uint64_t* {
+        if (f == ZERO) return zero.data();
+        if (f == ONE) return one.data();
+        return counts.at(levelOf(f), indexOf(f));
+    };
+
+    for (int i = 1; i <= top; ++i) {
+        uint64_t n = dd.nodes.size(i);
+        dd.nodes.willNeed(i);
+        BufferPool::Lease level_counts(ws.pool, n * words);
+        level_counts->assign(n * words, 0);
+        for (uint64_t j = 0; j < n; ++j) {
+            const uint64_t* node = dd.nodes.at(i, j);
+            uint64_t* sum = &(*level_counts)[j * words];
+            LevelStatesHelper::add(sum, countOf(node[0]), words);
+            LevelStatesHelper::add(sum, countOf(node[1]), words);
+        }
+        ws.counted_nodes += n;
+        if (!counts.write(i, *level_counts, error)) return false;
+    }
+
+    result = LevelStatesHelper::toDecimal(countOf(dd.root), words);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    ws.count_ms += std::chrono::duration<double, std::milli>(end - start).count();
+    return true;
+}
+
+}  // namespace OutOfCore
@@ -0,0 +1,268 @@
+// ============================================================================
+// SizeEstimator.hpp
+// ============================================================================
+//
+// What this file does:
+//   Predicts the size of a diagram before it is built (--estimate). Runs the
+//   spec's transitions top-down one level at a time: exactly while a level
+//   has at most max_states distinct states, then on a uniform random sample
+//   of each level (stratified Knuth-style probing), and extrapolates the
+//   width of every level, the total node count and the number of sets.
+//
+// このファイルの役割:
+//   ZDD を構築する前にその大きさを予測する（--estimate）。spec の遷移を
+//   レベルごとにトップダウンに実行する。レベルの異なる状態が max_states 個
+//   以下の間は正確に、その後は各レベルの一様ランダム標本上で実行し（層別の
+//   Knuth 型の試行）、各レベルの幅、総ノード数、集合の数を外挿する。
+//
+// Responsibility:
+//   - Per-level widths of the unreduced diagram, i.e. the nodes a top-down
+//     build allocates (exact above the first sampled level)
+//   - Path counts carried per state and scaled by the inverse sampling
+//     fraction, an unbiased estimate of the family size (checks the model)
+//   - States a top-down pass such as countPaths holds at once (every level
+//     reached but not yet expanded), for its memory
+//   - Expansion throughput, so the caller can turn nodes into time
+//
+// 責任範囲:
+//   - 既約化前の ZDD のレベルごとの幅、すなわちトップダウンの構築が確保する
+//     ノード数（最初の標本レベルより上は正確）
+//   - 状態ごとに経路数を持ち、標本比率の逆数で拡大する。族の大きさの
+//     不偏推定（モデルの確認用）
+//   - countPaths などのトップダウンのパスが同時に保持する状態数（到達済みで
+//     未展開の全レベル）。そのメモリ量のため
+//   - 展開の処理速度。呼び出し側がノード数を時間に換算できるようにする
+//
+// Model:
+//   Expanding a fraction f of a level of width W reaches D(f) distinct
+//   children. Children are shared, so D grows more slowly than f. Each
+//   sampled level is expanded in two random halves, which gives D(f/2) and
+//   D(f). A power law D(f) = D(1) f^a with a = log2(D(f) / D(f/2)) then
+//   gives the next width D(1) = D(f) f^-a (0 ≤ a ≤ 1; a = 1 means no
+//   sharing). A child may skip levels (as in zddIntersection with a
+//   filter); each lower level adds the new states it received from this
+//   level, extrapolated the same way.
+//
+// モデル:
+//   幅 W のレベルの比率 f を展開すると D(f) 個の異なる子に至る。子は共有
+//   されるため D は f より緩やかに増える。標本レベルはランダムな 2 つの半分に
+//   分けて展開し、D(f/2) と D(f) を得る。べき乗則 D(f) = D(1) f^a
+//   （a = log2(D(f) / D(f/2))）から次の幅 D(1) = D(f) f^-a を求める
+//   （0 ≤ a ≤ 1。a = 1 は共有なし）。子はレベルを飛ばしてよい
+//   （フィルタとの zddIntersection など）。下の各レベルには、このレベルから
+//   受け取った新しい状態を同じ方法で外挿して加える。
+//
+// ============================================================================
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "BufferPool.hpp"
+#include "LevelStates.hpp"
+
+namespace SizeEstimator {
+
+// Phase 5 / Phase 6 passes estimated per run (the rest are extrapolated)
+// 実行ごとに推定する Phase 5 / Phase 6 のパス数（残りは外挿する）
+const int PASS_SAMPLES = 3;
+
+// ============================================================================
+// Level / Estimate
+// ============================================================================
+struct Level {
+    int level = 0;
+    double nodes = 0;        // Estimated width / 推定した幅
+    uint64_t observed = 0;   // Distinct states seen / 観測した異なる状態数
+    uint64_t expanded = 0;   // States expanded / 展開した状態数
+    double exponent = 1;     // Mean sharing exponent a toward lower levels / 下のレベルへの共有指数 a の平均
+    bool exact = true;
+};
+
+struct Estimate {
+    std::vector<Level> levels;   // Top level first / 最上位レベルから
+    double nodes = 0;            // Sum of the widths / 幅の総和
+    double peak_level_nodes = 0;
+    double peak_held_nodes = 0;  // Most states held by a top-down pass / トップダウンのパスが保持する最大状態数
+    size_t state_words = 0;      // Words per state / 状態あたりのワード数
+    double sets = 0;             // Estimated family size / 推定した族の大きさ
+    int exact_levels = 0;
+    uint64_t expanded_states = 0;
+    double time_ms = 0;
+
+    bool exact() const {
+        return exact_levels == (int)levels.size();
+    }
+
+    // Expansion time per state / 状態あたりの展開時間
+    double msPerState() const {
+        return expanded_states > 0 ? time_ms / expanded_states : 0;
+    }
+};
+
+// ============================================================================
+// estimate
+// ============================================================================
+//
+// Estimate the diagram of `spec`, expanding at most max_states states per
+// level; the samples are drawn from a generator seeded with `seed`.
+// spec の ZDD を推定する。レベルあたり高々 max_states 個の状態を展開し、
+// 標本は seed で初期化した生成器から引く。
+//
+// ============================================================================
+template<typename SPEC>
+Estimate estimate(const SPEC& spec0, BufferPool& pool, uint64_t max_states, uint64_t seed) {
+    auto start = std::chrono::high_resolution_clock::now();
+    Estimate result;
+    SPEC spec(spec0);
+    std::mt19937_64 rng(seed);
+    size_t stride = (spec.datasize() + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    BufferPool::Lease tmp(pool, std::max<size_t>(1, stride));
+    tmp->resize(std::max<size_t>(1, stride));
+    max_states = std::max<uint64_t>(2, max_states);
+
+    // Path counts are doubles kept in the one-word payload
+    // 経路数は 1 ワードのペイロードに置く double
+    auto weight = [](LevelStates<SPEC>& states, uint64_t j) {
+        double w;
+        std::memcpy(&w, states.payload(j), sizeof(double));
+        return w;
+    };
+    auto addWeight = [](LevelStates<SPEC>& states, uint64_t j, double w) {
+        double sum;
+        std::memcpy(&sum, states.payload(j), sizeof(double));
+        sum += w;
+        std::memcpy(states.payload(j), &sum, sizeof(double));
+    };
+
+    int top = spec.get_root(tmp->data());
+    if (top <= 0) {
+        spec.destruct(tmp->data());
+        result.sets = top < 0 ? 1 : 0;
+        return result;
+    }
+
+    // Per level: observed states, estimated width, and whether every
+    // parent level reaching it was expanded in full
+    // レベルごと: 観測した状態、推定幅、到達する全ての親レベルを完全に展開したか
+    std::vector<std::unique_ptr<LevelStates<SPEC>>> levels(top + 1);
+    for (int i = 1; i <= top; ++i) {
+        levels[i].reset(new LevelStates<SPEC>(spec, pool, i, stride, 1));
+    }
+    std::vector<double> width(top + 1, 0);
+    std::vector<bool> exact(top + 1, true);
+    std::vector<uint64_t> before(top + 1), half(top + 1);
+    std::vector<int> first(top + 1, 0);  // Level that first reached it / 最初に到達したレベル
+    first[top] = top + 1;
+    result.state_words = stride;
+    addWeight(*levels[top], levels[top]->insert(tmp->data()), 1.0);
+    width[top] = 1;
+
+    for (int i = top; i >= 1; --i) {
+        LevelStates<SPEC>& states = *levels[i];
+        uint64_t n = states.size();
+        if (n == 0) {
+            levels[i].reset();
+            spec.destructLevel(i);
+            continue;
+        }
+        width[i] = std::max(width[i], (double)n);
+        Level info;
+        info.level = i;
+        info.nodes = width[i];
+        info.observed = n;
+        info.exact = exact[i];
+
+        // Expand everything, or a uniform sample of max_states states
+        // 全てを展開するか、max_states 個の一様標本を展開する
+        std::vector<uint64_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        uint64_t m = n;
+        if (n > max_states) {
+            for (uint64_t k = 0; k < max_states; ++k) {
+                std::swap(order[k], order[k + rng() % (n - k)]);
+            }
+            m = max_states;
+        } else if (!exact[i]) {
+            std::shuffle(order.begin(), order.end(), rng);
+        }
+        info.expanded = m;
+        double f = m / width[i];          // Fraction of the level expanded / 展開したレベルの比率
+        double scale = (double)n / m;     // Inverse within-level sampling fraction / レベル内の標本比率の逆数
+
+        for (int c = 1; c < i; ++c) before[c] = half[c] = levels[c]->size();
+        for (uint64_t k = 0; k < m; ++k) {
+            if (k == m / 2) {
+                for (int c = 1; c < i; ++c) half[c] = levels[c]->size();
+            }
+            uint64_t j = order[k];
+            double w = weight(states, j) * scale;
+            for (int b = 0; b < 2; ++b) {
+                spec.get_copy(tmp->data(), states.state(j));
+                int c = spec.get_child(tmp->data(), i, b);
+                if (c <= 0) {
+                    spec.destruct(tmp->data());
+                    if (c < 0) result.sets += w;
+                } else {
+                    LevelStates<SPEC>& child = *levels[c];
+                    addWeight(child, child.insert(tmp->data()), w);
+                }
+            }
+        }
+        result.expanded_states += m;
+
+        // Widths of the levels below: the new states this level reached,
+        // extrapolated from the fraction f by the power law
+        // 下のレベルの幅: このレベルが到達した新しい状態を、べき乗則で比率 f から外挿
+        double exponent_sum = 0;
+        int exponent_levels = 0;
+        for (int c = 1; c < i; ++c) {
+            uint64_t reached = levels[c]->size() - before[c];
+            if (reached == 0) continue;
+            if (first[c] == 0) first[c] = i;
+            if (f >= 1) {
+                width[c] += reached;
+                continue;
+            }
+            exact[c] = false;
+            uint64_t reached_half = half[c] - before[c];
+            double a = reached_half > 0
+                ? std::min(1.0, std::max(0.0, std::log2((double)reached / reached_half)))
+                : 1.0;
+            width[c] += reached * std::pow(f, -a);
+            exponent_sum += a;
+            ++exponent_levels;
+        }
+        info.exponent = exponent_levels > 0 ? exponent_sum / exponent_levels : 1.0;
+
+        result.levels.push_back(info);
+        result.nodes += info.nodes;
+        result.peak_level_nodes = std::max(result.peak_level_nodes, info.nodes);
+        if (info.exact) ++result.exact_levels;
+
+        levels[i].reset();
+        spec.destructLevel(i);
+    }
+
+    // Expanding level i holds level i and every level below it already reached
+    // レベル i の展開中は、レベル i と到達済みのその下の全レベルを保持する
+    for (int i = top; i >= 1; --i) {
+        double held = 0;
+        for (int c = 1; c <= i; ++c) {
+            if (first[c] >= i) held += width[c];
+        }
+        result.peak_held_nodes = std::max(result.peak_held_nodes, held);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    result.time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    return result;
+}
+
+}  // namespace SizeEstimator
@@ -3,12 +3,12 @@
 // ============================================================================
 //
 // What this file does:
-//   Defines SymmetryFilter<BitMask> template class for g-invariance filtering.
+//   Defines SymmetryFilter class for g-invariance filtering.
 //   Given an edge permutation g, filters spanning trees T such that gT = T.
 //   Used in Phase 6 for Burnside's lemma computation.
 //
 // このファイルの役割:
-//   g-不変フィルタリングのための SymmetryFilter<BitMask> テンプレートクラスを定義。
+//   g-不変フィルタリングのための SymmetryFilter クラスを定義。
 //   辺置換 g が与えられたとき、gT = T を満たす全域木 T をフィルタリング。
 //   Phase 6 の Burnside の補題計算で使用。
 //
@@ -31,7 +31,8 @@
 //   各自己同型 g ∈ Aut(Γ) に対して、g の下で不変な全域木を数える。
 //
 // Design:
-//   State = single BitMask (one bit per non-trivial orbit).
+//   State = runtime-width bitmask (one bit per non-trivial orbit),
+//   stored as a BitState::Layout(num_orbits) uint64_t array.
 //   For each orbit, the "representative" is the edge with the smallest index.
 //   Since ZDD processes edges from index 0 upward, the representative is
 //   always processed first.
@@ -44,7 +45,8 @@
 //     value=1 → bit set to 1 → subsequent edges must also be 1
 //
 // 設計:
-//   状態 = 単一の BitMask（非自明軌道ごとに 1 ビット）。
+//   状態 = 実行時幅のビットマスク（非自明軌道ごとに 1 ビット）、
+//   BitState::Layout(num_orbits) の uint64_t 配列として格納。
 //   各軌道の「代表辺」は最小インデックスの辺。
 //   ZDD はインデックス 0 から順に辺を処理するため、代表辺が必ず先に処理される。
 //
@@ -58,29 +60,33 @@
 // ============================================================================
 
 #pragma once
+#include <algorithm>
 #include <vector>
 #include <tdzdd/DdSpec.hpp>
-#include "BigUInt.hpp"
+#include "BitState.hpp"
 
 // ============================================================================
-// SymmetryFilter Template Class
-// SymmetryFilter テンプレートクラス
+// SymmetryFilter Class
+// SymmetryFilter クラス
 // ============================================================================
 //
-// Template Parameters:
-//   BitMask: Type used for bitmask operations (uint64_t or BigUInt<N>)
+// State:
+//   uint64_t array whose width (in words) is fixed in the constructor
+//   once the number of non-trivial orbits is known.
 //
-// テンプレートパラメータ:
-//   BitMask: ビットマスク演算に使用する型（uint64_t または BigUInt<N>）
+// 状態:
+//   非自明軌道数が判明した時点でコンストラクタにて幅（ワード数）を
+//   固定する uint64_t 配列。
 //
 // ============================================================================
-template<typename BitMask>
 class SymmetryFilter
-    : public tdzdd::DdSpec<SymmetryFilter<BitMask>, BitMask, 2> {
+    : public tdzdd::PodArrayDdSpec<SymmetryFilter, uint64_t, 2> {
 private:
     int const e;                          // Total number of edges / 全辺数
+    BitState::Layout layout;              // State layout (one bit per orbit) / 状態レイアウト（軌道ごとに 1 ビット）
     std::vector<int> edge_to_orbit;       // edge index → orbit index (-1 if trivial)
     std::vector<bool> is_representative;  // is this edge the representative of its orbit?
+    std::vector<BitState::BitPos> orbit_bit;  // edge index → bit of its orbit / 辺インデックス → 軌道のビット
 
 public:
     // ========================================================================
@@ -100,17 +106,23 @@ public:
     //   1. Compute edge orbits from the permutation
     //   2. For non-trivial orbits (size > 1), assign orbit index and mark representative
     //   3. Representative = smallest edge index in each orbit
+    //   4. Precompute the orbit bit position of each edge for getChild()
+    //   5. Fix the state width to the number of non-trivial orbits
     //
     // 処理:
     //   1. 置換から辺軌道を計算
     //   2. 非自明軌道（サイズ > 1）に軌道インデックスを割り当て、代表辺をマーク
     //   3. 代表辺 = 各軌道の最小辺インデックス
+    //   4. getChild() 用に各辺の軌道ビット位置を事前計算
+    //   5. 状態の幅を非自明軌道数に固定
     //
     // ========================================================================
     SymmetryFilter(int num_edges, const std::vector<int>& edge_perm)
         : e(num_edges),
+          layout(0),
           edge_to_orbit(num_edges, -1),
-          is_representative(num_edges, false) {
+          is_representative(num_edges, false),
+          orbit_bit(num_edges) {
 
         // Compute orbits from edge permutation
         // 辺置換から軌道を計算
@@ -138,9 +150,13 @@ public:
                 for (int edge_idx : orbit) {
                     edge_to_orbit[edge_idx] = orbit_id;
                     is_representative[edge_idx] = (edge_idx == min_edge);
+                    orbit_bit[edge_idx] = BitState::BitPos(orbit_id);
                 }
             }
         }
+
+        layout = BitState::Layout(num_orbits);
+        setArraySize(layout.stateWords());
     }
 
     // ========================================================================
@@ -151,11 +167,43 @@ public:
     // ビットマスクを 0 に初期化（全軌道は未定 / デフォルトで EXCLUDE）。
     //
     // ========================================================================
-    int getRoot(BitMask& state) const {
-        state = BitMask();  // Zero initialization / ゼロ初期化
+    int getRoot(uint64_t* state) const {
+        layout.clearAll(state);  // Zero initialization / ゼロ初期化
         return e;
     }
 
+    // ========================================================================
+    // hashCode / equalTo
+    // ========================================================================
+    //
+    // What this does:
+    //   Node-table hooks used by TdZdd instead of its raw word hash.
+    //   Delegates to BitState::Layout (summary-guided, strong 64-bit mixer,
+    //   all-zero state short-circuited).
+    //
+    // この処理の内容:
+    //   TdZdd が生ワードハッシュの代わりに使用するノード表フック。
+    //   BitState::Layout（要約ワード参照、強い 64 ビットミキサー、
+    //   全ゼロ状態の即時判定）に委譲。
+    //
+    // ========================================================================
+    size_t hashCode(uint64_t const* a) const {
+        return layout.hash(a);
+    }
+
+    bool equalTo(uint64_t const* a, uint64_t const* b) const {
+        return layout.equal(a, b);
+    }
+
+    size_t hash_code(void const* p, int /*level*/) const {
+        return hashCode(static_cast<uint64_t const*>(p));
+    }
+
+    bool equal_to(void const* p, void const* q, int /*level*/) const {
+        return equalTo(static_cast<uint64_t const*>(p),
+                       static_cast<uint64_t const*>(q));
+    }
+
     // ========================================================================
     // getChild
     // ========================================================================
@@ -181,25 +229,25 @@ public:
     //     bit=1 かつ value=0: 枝刈り（軌道は INCLUDE であるべき）
     //
     // ========================================================================
-    int getChild(BitMask& state, int level, int value) const {
+    int getChild(uint64_t* state, int level, int value) const {
         int edge_index = e - level;
         int orbit = edge_to_orbit[edge_index];
 
         if (orbit >= 0) {
-            BitMask orbit_bit = BigUIntHelper::BitMaskTraits<BitMask>::bit(orbit);
+            const BitState::BitPos& pos = orbit_bit[edge_index];
 
             if (is_representative[edge_index]) {
                 // Representative edge: record decision
                 // 代表辺: 判定を記録
                 if (value == 1) {
-                    state |= orbit_bit;  // Set bit / ビットを設定
+                    layout.set(state, pos);  // Set bit / ビットを設定
                 }
                 // value=0: bit stays 0 (correct by initialization)
                 // value=0: ビットは 0 のまま（初期化で正しい）
             } else {
                 // Non-representative edge: enforce consistency
                 // 非代表辺: 一貫性を強制
-                bool orbit_included = (state & orbit_bit) != BitMask();
+                bool orbit_included = layout.test(state, pos);
 
                 if (orbit_included && value == 0) return 0;  // Expected INCLUDE, got EXCLUDE
                 if (!orbit_included && value == 1) return 0;  // Expected EXCLUDE, got INCLUDE
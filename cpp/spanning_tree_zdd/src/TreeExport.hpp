@@ -0,0 +1,290 @@
+// ============================================================================
+// TreeExport.hpp
+// ============================================================================
+//
+// What this file does:
+//   Defines the block format used to export every tree of a ZDD family:
+//   BlockEncoder packs trees into self-contained blocks, and Reader streams
+//   them back one tree at a time.
+//
+// このファイルの役割:
+//   ZDD の族の全ての木を出力するためのブロック形式を定義。
+//   BlockEncoder は木を自己完結したブロックに詰め、Reader はそれを
+//   1 本ずつストリームで読み戻す。
+//
+// Format (all integers little-endian):
+//   header: magic "STZE", uint32 version = 1, uint32 num_edges,
+//           uint32 encoding (0 = bitset, 1 = delta), uint64 num_trees,
+//           uint32 block_trees (maximum trees per block)
+//   block:  uint32 trees, uint32 payload_bytes, payload
+//
+//   bitset: ceil(num_edges / 64) uint64 words per tree (bit e = edge e)
+//   delta:  per tree, varint(k) varint(m) then m varints, where k is the
+//           number of leading edges shared with the previous tree of the
+//           block (0 for the first) and each varint is e - prev - 1 for the
+//           next edge e after prev (prev = -1 before the first edge)
+//
+//   Trees exported in index order share long prefixes (consecutive leaves
+//   of the DFS), so prefix sharing plus small deltas compress well without
+//   an external codec. Blocks never refer to each other, so they can be
+//   encoded in parallel and skipped without decoding.
+//
+// 形式（整数は全てリトルエンディアン）:
+//   ヘッダ: マジック "STZE"、uint32 バージョン = 1、uint32 辺数、
+//           uint32 符号化（0 = bitset、1 = delta）、uint64 木の本数、
+//           uint32 block_trees（1 ブロックあたりの最大本数）
+//   ブロック: uint32 本数、uint32 ペイロードのバイト数、ペイロード
+//
+//   bitset: 1 本につき ceil(辺数 / 64) 個の uint64 ワード（ビット e = 辺 e）
+//   delta:  1 本につき varint(k) varint(m) と m 個の varint。k はブロック内の
+//           直前の木と共有する先頭の辺の数（最初の木は 0）、各 varint は
+//           prev の次の辺 e に対する e - prev - 1（最初の辺の前は prev = -1）
+//
+//   番号順に出力した木は長い接頭辞を共有する（DFS の連続する葉）ため、
+//   接頭辞共有と小さな差分で外部の圧縮器なしに良く圧縮される。ブロックは
+//   互いに参照しないため、並列に符号化でき、復号せずに読み飛ばせる。
+//
+// ============================================================================
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace TreeExport {
+
+enum Encoding : uint32_t {
+    BITSET = 0,
+    DELTA = 1
+};
+
+static const char MAGIC[4] = {'S', 'T', 'Z', 'E'};
+static const uint32_t VERSION = 1;
+static const size_t HEADER_BYTES = 28;
+
+inline void putLE(std::string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(char((value >> (8 * i)) & 0xFF));
+}
+
+inline uint64_t getLE(const unsigned char* p, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) value |= uint64_t(p[i]) << (8 * i);
+    return value;
+}
+
+inline void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(char(value));
+}
+
+inline std::string header(int num_edges, Encoding encoding,
+                          uint64_t num_trees, uint32_t block_trees) {
+    std::string out(MAGIC, 4);
+    putLE(out, VERSION, 4);
+    putLE(out, num_edges, 4);
+    putLE(out, encoding, 4);
+    putLE(out, num_trees, 8);
+    putLE(out, block_trees, 4);
+    return out;
+}
+
+// ============================================================================
+// BlockEncoder
+// ============================================================================
+//
+// Collects trees (ascending edge lists) and emits one self-contained block.
+// 木（昇順辺リスト）を集め、自己完結した 1 ブロックを出力する。
+//
+// ============================================================================
+class BlockEncoder {
+    int num_edges;
+    Encoding encoding;
+    uint32_t trees;
+    std::string payload;
+    std::vector<int> prev;
+    std::vector<uint64_t> mask;
+
+public:
+    BlockEncoder(int num_edges, Encoding encoding)
+        : num_edges(num_edges), encoding(encoding), trees(0),
+          mask((num_edges + 63) / 64) {
+    }
+
+    uint32_t size() const {
+        return trees;
+    }
+
+    void add(const std::vector<int>& edges) {
+        if (encoding == BITSET) {
+            std::fill(mask.begin(), mask.end(), 0);
+            for (int e : edges) mask[e >> 6] |= 1ULL << (e & 63);
+            for (uint64_t w : mask) putLE(payload, w, 8);
+        } else {
+            size_t k = 0;
+            while (k < prev.size() && k < edges.size() && prev[k] == edges[k]) ++k;
+            putVarint(payload, k);
+            putVarint(payload, edges.size() - k);
+            int last = (k > 0) ? edges[k - 1] : -1;
+            for (size_t i = k; i < edges.size(); ++i) {
+                putVarint(payload, uint64_t(edges[i] - last - 1));
+                last = edges[i];
+            }
+            prev = edges;
+        }
+        ++trees;
+    }
+
+    // Append the block to `out` and start a new one
+    // ブロックを out に追記し、新しいブロックを開始
+    void flush(std::string& out) {
+        putLE(out, trees, 4);
+        putLE(out, payload.size(), 4);
+        out += payload;
+        payload.clear();
+        prev.clear();
+        trees = 0;
+    }
+};
+
+// ============================================================================
+// Reader
+// ============================================================================
+//
+// Streams trees back from an export file, one block in memory at a time.
+// Errors (bad magic, truncated block) make next() return false and set
+// error().
+//
+// 出力ファイルから木をストリームで読み戻す（メモリ上には 1 ブロックのみ）。
+// エラー（不正なマジック、途切れたブロック）では next() が false を返し
+// error() が設定される。
+//
+// ============================================================================
+class Reader {
+    std::istream& in;
+    int num_edges;
+    Encoding encoding;
+    uint64_t num_trees;
+    uint32_t block_trees;
+    std::string err;
+
+    std::vector<unsigned char> block;
+    size_t pos;
+    uint32_t remaining;  // Trees left in the block / ブロック内の残り本数
+    uint64_t trees_read; // Trees returned so far / これまでに返した本数
+    std::vector<int> prev;
+
+    bool fail(const std::string& message) {
+        if (err.empty()) err = message;
+        return false;
+    }
+
+    bool readVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= block.size()) return fail("truncated varint");
+            unsigned char b = block[pos++];
+            value |= uint64_t(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return fail("varint too long");
+    }
+
+    bool loadBlock() {
+        unsigned char head[8];
+        if (!in.read(reinterpret_cast<char*>(head), 8)) {
+            if (in.gcount() == 0) return false;  // End of file / ファイル終端
+            return fail("truncated block header");
+        }
+        remaining = getLE(head, 4);
+        block.resize(getLE(head + 4, 4));
+        if (!block.empty() &&
+            !in.read(reinterpret_cast<char*>(block.data()), block.size())) {
+            return fail("truncated block");
+        }
+        pos = 0;
+        prev.clear();
+        return true;
+    }
+
+public:
+    explicit Reader(std::istream& in)
+        : in(in), num_edges(0), encoding(BITSET), num_trees(0),
+          block_trees(0), pos(0), remaining(0), trees_read(0) {
+        unsigned char head[HEADER_BYTES];
+        if (!in.read(reinterpret_cast<char*>(head), HEADER_BYTES) ||
+            std::memcmp(head, MAGIC, 4) != 0) {
+            fail("not a tree export file");
+            return;
+        }
+        if (getLE(head + 4, 4) != VERSION) {
+            fail("unsupported version");
+            return;
+        }
+        num_edges = getLE(head + 8, 4);
+        encoding = Encoding(getLE(head + 12, 4));
+        num_trees = getLE(head + 16, 8);
+        block_trees = getLE(head + 24, 4);
+        if (encoding != BITSET && encoding != DELTA) fail("unknown encoding");
+    }
+
+    bool ok() const { return err.empty(); }
+    const std::string& error() const { return err; }
+    int numEdges() const { return num_edges; }
+    Encoding getEncoding() const { return encoding; }
+    uint64_t numTrees() const { return num_trees; }
+
+    // Next tree (ascending edge indices); false at the end or on error
+    // 次の木（辺インデックス昇順）。終端またはエラーで false
+    bool next(std::vector<int>& edges) {
+        if (!err.empty()) return false;
+        while (remaining == 0) {
+            if (!loadBlock()) {
+                // A file cut at a block boundary ends cleanly; check the count
+                // ブロック境界で切れたファイルも正常終了するので本数を確認する
+                if (err.empty() && trees_read != num_trees) {
+                    return fail(trees_read < num_trees ? "missing trees" : "extra trees");
+                }
+                return false;
+            }
+        }
+        --remaining;
+        ++trees_read;
+        edges.clear();
+
+        if (encoding == BITSET) {
+            size_t words = (num_edges + 63) / 64;
+            if (pos + 8 * words > block.size()) return fail("truncated tree");
+            for (size_t w = 0; w < words; ++w) {
+                uint64_t bits = getLE(&block[pos + 8 * w], 8);
+                while (bits) {
+                    edges.push_back(int(w * 64 + __builtin_ctzll(bits)));
+                    bits &= bits - 1;
+                }
+            }
+            pos += 8 * words;
+            return true;
+        }
+
+        uint64_t k, m, d;
+        if (!readVarint(k) || !readVarint(m)) return false;
+        if (k > prev.size() || k + m > (uint64_t)num_edges) return fail("corrupt tree");
+        edges.assign(prev.begin(), prev.begin() + k);
+        int64_t last = (k > 0) ? edges[k - 1] : -1;
+        for (uint64_t i = 0; i < m; ++i) {
+            if (!readVarint(d)) return false;
+            last += int64_t(d) + 1;
+            if (last >= num_edges) return fail("edge out of range");
+            edges.push_back(int(last));
+        }
+        prev = edges;
+        return true;
+    }
+};
+
+}  // namespace TreeExport
@@ -3,78 +3,70 @@
 // ============================================================================
 //
 // What this file does:
-//   Defines UnfoldingFilter<BitMask> template class for MOPE-based filtering.
-//   Generic version that works with any BitMask type (uint64_t, BigUInt<N>).
+//   Defines UnfoldingFilter class for MOPE-based filtering.
+//   The state is a runtime-width bitmask (uint64_t array) sized per MOPE.
 //
 // このファイルの役割:
-//   MOPE ベースのフィルタリングのための UnfoldingFilter<BitMask> テンプレートクラスを定義。
-//   任意の BitMask 型（uint64_t, BigUInt<N>）で動作する汎用版。
+//   MOPE ベースのフィルタリングのための UnfoldingFilter クラスを定義。
+//   状態は MOPE ごとにサイズを決める実行時幅のビットマスク（uint64_t 配列）。
 //
 // Responsibility:
 //   - Implement TdZdd DdSpec interface for ZDD subsetting
 //   - Filter out spanning trees that contain all edges of a MOPE
-//   - Support arbitrary bit widths through BitMask template parameter
+//   - Support arbitrary edge counts through a runtime-width state
+//   - Precompute the bit position of each level once per filter
 //
 // 責任範囲:
 //   - ZDD subsetting のための TdZdd DdSpec インターフェースを実装
 //   - MOPE の全辺を含む全域木を除外
-//   - BitMask テンプレートパラメータを通じて任意のビット幅をサポート
+//   - 実行時幅の状態により任意の辺数をサポート
+//   - 各レベルのビット位置をフィルタごとに 1 度だけ事前計算
 //
 // CRITICAL:
 //   The core algorithm (getRoot, getChild) is from Reserch2024 reference.
-//   DO NOT modify the logic, only adapt to generic BitMask operations.
+//   DO NOT modify the logic, only adapt to the bitmask representation.
 //
 // 重要:
 //   コアアルゴリズム（getRoot, getChild）は Reserch2024 参照実装由来。
-//   ロジックを変更せず、汎用的な BitMask 演算に適応させるのみ。
+//   ロジックを変更せず、ビットマスク表現に適応させるのみ。
 //
 // ============================================================================
 
 #pragma once
 #include <set>
-#include <type_traits>
+#include <utility>
+#include <vector>
 #include <tdzdd/DdSpec.hpp>
-#include "BigUInt.hpp"
+#include "BitState.hpp"
 
 // ============================================================================
-// UnfoldingFilter Template Class
-// UnfoldingFilter テンプレートクラス
+// UnfoldingFilter Class
+// UnfoldingFilter クラス
 // ============================================================================
 //
-// Template Parameters:
-//   BitMask: Type used for bitmask operations (uint64_t or BigUInt<N>)
+// State:
+//   uint64_t array with one bit per MOPE edge. Bit k corresponds to the
+//   k-th smallest edge ID of the MOPE, so the array size depends only on
+//   |MOPE| (see BitState::Layout), not on the polyhedron size.
+//   Edges outside the MOPE have an empty BitPos (mask 0), which makes
+//   test() false and clear() a no-op, exactly as bit(edge) & mate == 0
+//   in the original full-width formulation.
 //
-// テンプレートパラメータ:
-//   BitMask: ビットマスク演算に使用する型（uint64_t または BigUInt<N>）
-//
-// Requirements for BitMask:
-//   - Default constructor (zero initialization)
-//   - operator|= (bitwise OR assignment)
-//   - operator&= (bitwise AND assignment)
-//   - operator~ (bitwise NOT)
-//   - operator== (equality)
-//   - operator!= (inequality)
-//   - operator! (zero check)
-//   - operator& (binary AND)
-//   - static bit(int pos) (create bitmask with bit at pos set)
-//
-// BitMask の要件:
-//   - デフォルトコンストラクタ（ゼロ初期化）
-//   - operator|=（ビット論理和代入）
-//   - operator&=（ビット論理積代入）
-//   - operator~（ビット否定）
-//   - operator==（等価）
-//   - operator!=（非等価）
-//   - operator!（ゼロチェック）
-//   - operator&（二項 AND）
-//   - static bit(int pos)（pos のビットを設定したビットマスクを作成）
+// 状態:
+//   MOPE の辺ごとに 1 ビットを持つ uint64_t 配列。ビット k は MOPE の
+//   k 番目に小さい辺 ID に対応するため、配列サイズは多面体のサイズによらず
+//   |MOPE| のみで決まる（BitState::Layout 参照）。
+//   MOPE 外の辺は空の BitPos（mask 0）を持ち、test() は false、clear() は
+//   何もしない。これは元の全幅表現での bit(edge) & mate == 0 と同一。
 //
 // ============================================================================
-template<typename BitMask>
-class UnfoldingFilter : public tdzdd::DdSpec<UnfoldingFilter<BitMask>, BitMask, 2> {
+class UnfoldingFilter
+    : public tdzdd::PodArrayDdSpec<UnfoldingFilter, uint64_t, 2> {
 private:
     int const e;         // Number of edges in the graph / グラフの辺数
-    std::set<int> edges; // Set of edge IDs in this MOPE / この MOPE に含まれる辺 ID の集合
+    std::vector<int> edges; // Edge IDs of this MOPE, ascending / この MOPE に含まれる辺 ID（昇順）
+    BitState::Layout const layout;  // State layout (one bit per MOPE edge) / 状態レイアウト（MOPE 辺ごとに 1 ビット）
+    std::vector<BitState::BitPos> level_bit;  // level → bit of edge (e - level) / レベル → 辺 (e - level) のビット
 
 public:
     // ========================================================================
@@ -90,9 +82,36 @@ public:
     //   e: グラフの全辺数
     //   edges: この MOPE を構成する辺 ID の集合
     //
+    // Note:
+    //   level_bit[level] holds the position of edge (e - level) in the
+    //   state, so getChild() never has to build a full-width mask.
+    //
+    // 注記:
+    //   level_bit[level] は状態内での辺 (e - level) の位置を保持するため、
+    //   getChild() で全幅のマスクを構築する必要がない。
+    //
     // ========================================================================
     UnfoldingFilter(int e, const std::set<int>& edges)
-        : e(e), edges(edges) {}
+        : UnfoldingFilter(e, std::vector<int>(edges.begin(), edges.end())) {}
+
+    // Sorted, duplicate-free range (e.g. one set of InputLoader::EdgeSets)
+    // 昇順・重複なしの範囲（例: InputLoader::EdgeSets の 1 集合）
+    UnfoldingFilter(int e, const int* first, const int* last)
+        : UnfoldingFilter(e, std::vector<int>(first, last)) {}
+
+    UnfoldingFilter(int e, std::vector<int> sorted_edges)
+        : e(e), edges(std::move(sorted_edges)),
+          layout(static_cast<int>(edges.size())),
+          level_bit(e + 1) {
+        setArraySize(layout.stateWords());
+        int k = 0;
+        for (int edge_id : edges) {
+            if (edge_id >= 0 && edge_id < e) {
+                level_bit[e - edge_id] = BitState::BitPos(k);
+            }
+            ++k;
+        }
+    }
 
     // ========================================================================
     // getRoot
@@ -131,19 +150,50 @@ public:
     //   e を返す
     //
     // ========================================================================
-    int getRoot(BitMask& mate) const {
-        mate = BitMask();  // Zero initialization / ゼロ初期化
+    int getRoot(uint64_t* mate) const {
+        layout.clearAll(mate);  // Zero initialization / ゼロ初期化
         
         // Set bit for each edge in MOPE
         // MOPE の各辺に対してビットを設定
-        for (int edge_id : edges) {
-            mate |= BigUIntHelper::BitMaskTraits<BitMask>::bit(edge_id);
+        for (int k = 0; k < static_cast<int>(edges.size()); ++k) {
+            layout.set(mate, BitState::BitPos(k));
         }
         
         return e;  // Return root level / ルートレベルを返す
     }
 
 public:
+    // ========================================================================
+    // hashCode / equalTo
+    // ========================================================================
+    //
+    // What this does:
+    //   Node-table hooks used by TdZdd instead of its raw word hash.
+    //   Delegates to BitState::Layout (summary-guided, strong 64-bit mixer,
+    //   all-zero state short-circuited).
+    //
+    // この処理の内容:
+    //   TdZdd が生ワードハッシュの代わりに使用するノード表フック。
+    //   BitState::Layout（要約ワード参照、強い 64 ビットミキサー、
+    //   全ゼロ状態の即時判定）に委譲。
+    //
+    // ========================================================================
+    size_t hashCode(uint64_t const* a) const {
+        return layout.hash(a);
+    }
+
+    bool equalTo(uint64_t const* a, uint64_t const* b) const {
+        return layout.equal(a, b);
+    }
+
+    size_t hash_code(void const* p, int /*level*/) const {
+        return hashCode(static_cast<uint64_t const*>(p));
+    }
+
+    bool equal_to(void const* p, void const* q, int /*level*/) const {
+        return equalTo(static_cast<uint64_t const*>(p),
+                       static_cast<uint64_t const*>(q));
+    }
 
     // ========================================================================
     // getChild
@@ -212,37 +262,30 @@ public:
     //   このロジックを変更しないこと。
     //
     // ========================================================================
-    int getChild(BitMask& mate, int level, int value) const {
+    int getChild(uint64_t* mate, int level, int value) const {
         if (value == 0) {  // 0-branch: edge NOT selected / 0-枝: 辺を選ばない
             // Check if mate is non-zero
             // mate が非ゼロかチェック
-            if (mate != BitMask()) {
-                // Create mask for current level's bit
-                // 現在レベルのビット用マスクを作成
-                BitMask mask = BigUIntHelper::BitMaskTraits<BitMask>::bit(e - level);
-                
-                // Clear the bit for this edge
-                // この辺のビットをクリア
-                mate &= ~mask;
+            if (!layout.isZero(mate)) {
+                // Clear the bit for this edge (mate &= ~bit(e - level))
+                // この辺のビットをクリア（mate &= ~bit(e - level)）
+                layout.clear(mate, level_bit[level]);
                 
                 // If all bits are now 0, prune this branch
                 // 全ビットが 0 になったら、この枝を枝刈り
                 // (This means all MOPE edges are in the spanning tree = overlap)
                 // （これは全 MOPE 辺が全域木に含まれる = 重なり）
-                if (!mate) return 0;
+                if (layout.isZero(mate)) return 0;
             }
         } else {  // 1-branch: edge IS selected / 1-枝: 辺を選ぶ
-            // Check if this edge is in MOPE
+            // Check if this edge is in MOPE ((mate & bit(e - level)) != 0)
             // この辺が MOPE に含まれるかチェック
-            BitMask test_bit = BigUIntHelper::BitMaskTraits<BitMask>::bit(e - level);
-            BitMask result = mate & test_bit;
-            
             // If this edge is in MOPE, clear all bits
             // この辺が MOPE に含まれるなら、全ビットをクリア
             // (MOPE is cut by this edge, so no overlap is possible)
             // （MOPE がこの辺で切断されるため、重なりは不可能）
-            if (result != BitMask()) {
-                mate = BitMask();
+            if (layout.test(mate, level_bit[level])) {
+                layout.clearAll(mate);
             }
         }
         
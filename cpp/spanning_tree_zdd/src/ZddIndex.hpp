@@ -0,0 +1,443 @@
+// ============================================================================
+// ZddIndex.hpp
+// ============================================================================
+//
+// What this file does:
+//   Defines ZddIndex, which numbers the members (spanning trees) of a ZDD
+//   0, 1, ..., |ZDD| - 1 using exact per-node cardinalities, and provides
+//   rank (tree → index), unrank (index → tree), uniform sampling (a random
+//   index, unranked) and a cursor that starts at an arbitrary index and
+//   walks consecutive members.
+//
+// このファイルの役割:
+//   ノードごとの正確な要素数を用いて ZDD の要素（全域木）に
+//   0, 1, ..., |ZDD| - 1 の番号を付ける ZddIndex を定義。
+//   rank（木 → 番号）、unrank（番号 → 木）、一様抽出（乱数番号の unrank）、
+//   および任意の番号から開始して連続する要素を走査するカーソルを提供する。
+//
+// Responsibility:
+//   - Precompute exact per-node cardinalities as fixed-width multi-word
+//     integers (width from the root count; no overflow, no rounding)
+//   - rank / unrank / sample in O(edges × words), thread-safe after
+//     construction
+//   - Cursor: O(edges) to seek, amortized O(1) levels per next member,
+//     so a slice [a, b) costs time proportional to b - a, not to a
+//
+// 責任範囲:
+//   - ノードごとの正確な要素数を固定幅の多倍長整数として事前計算
+//     （幅は根の要素数から決定。オーバーフローも丸めもなし）
+//   - rank / unrank / sample を O(辺数 × ワード数) で実行（構築後は
+//     スレッドセーフ）
+//   - カーソル: シーク O(辺数)、次の要素へは償却 O(1) レベル。区間 [a, b) の
+//     コストは a ではなく b - a に比例する
+//
+// Order:
+//   The 1-branch is taken first at every node. Edges are processed from
+//   index 0 upward and all trees have the same size, so the index order is
+//   the lexicographic order of ascending edge lists (the same order as
+//   OrbitMinimalFilter).
+//
+// 順序:
+//   各ノードで 1-枝を先とする。辺はインデックス 0 から順に処理され、全ての木は
+//   同じ辺数なので、番号順は昇順辺リストの辞書式順序
+//   （OrbitMinimalFilter と同じ順序）。
+//
+// Design:
+//   Counts live in one flat uint64_t array (`words` little-endian words per
+//   node); node → slot lookup is a per-level vector indexed by NodeId::col(),
+//   so no hashing is needed after construction. Slots 0 and 1 are the 0- and
+//   1-terminals. A node's count never exceeds the root count, so counts are
+//   computed at the width of the 2^num_edges bound and then repacked to the
+//   root's width.
+//
+// 設計:
+//   要素数は 1 本の uint64_t 配列（ノードあたり words 個のリトルエンディアン
+//   ワード）に格納し、ノード → スロットの対応は NodeId::col() で引く
+//   レベルごとの vector のため、構築後はハッシュを使わない。スロット 0, 1 は
+//   0-終端と 1-終端。ノードの要素数は根の要素数を超えないため、上限
+//   2^num_edges の幅で計算した後に根の幅へ詰め直す。
+//
+// ============================================================================
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <tdzdd/DdStructure.hpp>
+#include "MemoryPlacement.hpp"
+
+class ZddIndex {
+public:
+    // Index value: little-endian words, countWords() long
+    // 番号の値: リトルエンディアンのワード列（長さ countWords()）
+    typedef std::vector<uint64_t> Number;
+
+private:
+    static constexpr size_t NONE = ~size_t(0);
+
+    const tdzdd::DdStructure<2>& dd;
+    int num_edges;
+    int words;                              // Words per count / 要素数あたりのワード数
+    std::vector<std::vector<size_t>> slot;  // [level][col] → slot
+    std::vector<uint64_t> counts;           // Per-slot counts / スロットごとの要素数
+
+    size_t build(tdzdd::NodeId f, int width) {
+        if (f.row() == 0) return f.col();
+        std::vector<size_t>& row = slot[f.row()];
+        if (row.size() <= f.col()) row.resize(f.col() + 1, NONE);
+        if (row[f.col()] != NONE) return row[f.col()];
+
+        size_t s0 = build(dd.child(f, 0), width);
+        size_t s1 = build(dd.child(f, 1), width);
+        size_t s = counts.size() / width;
+        counts.resize(counts.size() + width);
+        uint64_t carry = 0;
+        for (int i = 0; i < width; ++i) {
+            uint64_t a = counts[s0 * width + i];
+            uint64_t sum = a + counts[s1 * width + i];
+            uint64_t c1 = sum < a;
+            sum += carry;
+            carry = c1 | (sum < carry);
+            counts[s * width + i] = sum;
+        }
+        slot[f.row()][f.col()] = s;
+        return s;
+    }
+
+public:
+    // dd must outlive the index / dd はインデックスより長く生存する必要がある
+    ZddIndex(const tdzdd::DdStructure<2>& dd, int num_edges)
+        : dd(dd), num_edges(num_edges), words(1), slot(num_edges + 1) {
+        // Compute with a width that cannot overflow (count ≤ 2^num_edges)
+        // オーバーフローしない幅で計算（要素数 ≤ 2^num_edges）
+        int width = num_edges / 64 + 1;
+        counts.assign(2 * width, 0);
+        counts[width] = 1;  // 1-terminal / 1-終端
+        size_t root = build(dd.root(), width);
+
+        // Repack to the width of the root count
+        // 根の要素数の幅に詰め直す
+        words = 1;
+        for (int i = width - 1; i > 0; --i) {
+            if (counts[root * width + i] != 0) {
+                words = i + 1;
+                break;
+            }
+        }
+        if (words < width) {
+            size_t n = counts.size() / width;
+            for (size_t s = 0; s < n; ++s) {
+                std::copy_n(&counts[s * width], words, &counts[s * words]);
+            }
+            counts.resize(n * words);
+        }
+        counts.shrink_to_fit();
+
+        // The sampling and export threads read counts at random; with
+        // --huge-pages khugepaged may back it with huge pages
+        // サンプリングと出力のスレッドは counts をランダムに読む。
+        // --huge-pages では khugepaged がヒュージページに置き換えうる
+        MemoryPlacement::adviseHugePages(counts.data(), counts.size() * sizeof(uint64_t));
+    }
+
+    const tdzdd::DdStructure<2>& diagram() const {
+        return dd;
+    }
+
+    int numEdges() const {
+        return num_edges;
+    }
+
+    // Words per count / 要素数あたりのワード数
+    int countWords() const {
+        return words;
+    }
+
+    inline size_t slotOf(tdzdd::NodeId f) const {
+        if (f.row() == 0) return f.col();  // 0- / 1-terminal
+        return slot[f.row()][f.col()];
+    }
+
+    inline const uint64_t* countOf(tdzdd::NodeId f) const {
+        return &counts[slotOf(f) * words];
+    }
+
+    // ========================================================================
+    // Fixed-width arithmetic on countWords()-word numbers
+    // countWords() ワードの数の固定幅演算
+    // ========================================================================
+
+    // a < b
+    inline bool less(const uint64_t* a, const uint64_t* b) const {
+        for (int i = words - 1; i >= 0; --i) {
+            if (a[i] != b[i]) return a[i] < b[i];
+        }
+        return false;
+    }
+
+    inline bool isZero(const uint64_t* a) const {
+        return std::all_of(a, a + words, [](uint64_t w) { return w == 0; });
+    }
+
+    // a += b (carry out is dropped) / 桁あふれは捨てる
+    inline void add(uint64_t* a, const uint64_t* b) const {
+        uint64_t carry = 0;
+        for (int i = 0; i < words; ++i) {
+            uint64_t sum = a[i] + b[i];
+            uint64_t c1 = sum < a[i];
+            sum += carry;
+            carry = c1 | (sum < carry);
+            a[i] = sum;
+        }
+    }
+
+    // a -= b (a >= b)
+    inline void subtract(uint64_t* a, const uint64_t* b) const {
+        uint64_t borrow = 0;
+        for (int i = 0; i < words; ++i) {
+            uint64_t bi = b[i] + borrow;
+            uint64_t next = (bi < borrow || a[i] < bi) ? 1 : 0;
+            a[i] -= bi;
+            borrow = next;
+        }
+    }
+
+    // Number of members / 要素数
+    Number total() const {
+        const uint64_t* c = countOf(dd.root());
+        return Number(c, c + words);
+    }
+
+    bool empty() const {
+        return isZero(countOf(dd.root()));
+    }
+
+    // Decimal string of a number / 数の 10 進文字列
+    std::string toString(Number n) const {
+        std::string digits;
+        while (!isZero(n.data())) {
+            unsigned __int128 rem = 0;
+            for (int i = words - 1; i >= 0; --i) {
+                unsigned __int128 cur = (rem << 64) | n[i];
+                n[i] = (uint64_t)(cur / 10);
+                rem = cur % 10;
+            }
+            digits.push_back(char('0' + (int)rem));
+        }
+        if (digits.empty()) return "0";
+        return std::string(digits.rbegin(), digits.rend());
+    }
+
+    // Parse a decimal string; false if malformed or ≥ 2^(64·words)
+    // 10 進文字列を解析。不正または 2^(64·words) 以上なら false
+    bool parse(const std::string& s, Number& n) const {
+        n.assign(words, 0);
+        if (s.empty()) return false;
+        for (char ch : s) {
+            if (ch < '0' || ch > '9') return false;
+            unsigned __int128 carry = ch - '0';
+            for (int i = 0; i < words; ++i) {
+                unsigned __int128 cur = (unsigned __int128)n[i] * 10 + carry;
+                n[i] = (uint64_t)cur;
+                carry = cur >> 64;
+            }
+            if (carry != 0) return false;
+        }
+        return true;
+    }
+
+    std::string totalString() const {
+        return toString(total());
+    }
+
+    // ========================================================================
+    // rank
+    // ========================================================================
+    //
+    // Index of the tree `edges` (ascending edge indices) into `r`.
+    // Returns false if the tree is not a member of the ZDD.
+    //
+    // 木 edges（辺インデックス昇順）の番号を r に格納。
+    // ZDD の要素でなければ false を返す。
+    //
+    // ========================================================================
+    bool rank(const std::vector<int>& edges, Number& r) const {
+        r.assign(words, 0);
+        size_t k = 0;
+        tdzdd::NodeId f = dd.root();
+        while (f.row() != 0) {
+            int e = num_edges - f.row();
+            // An edge skipped by the ZDD (level jump) must not be in the tree
+            // ZDD が飛ばした辺（レベルの跳躍）は木に含まれてはならない
+            if (k < edges.size() && edges[k] < e) return false;
+            if (k < edges.size() && edges[k] == e) {
+                f = dd.child(f, 1);
+                ++k;
+            } else {
+                add(r.data(), countOf(dd.child(f, 1)));
+                f = dd.child(f, 0);
+            }
+        }
+        return f.col() == 1 && k == edges.size();
+    }
+
+    // ========================================================================
+    // unrank
+    // ========================================================================
+    //
+    // Write the member of index `r` (< total) into `edges` (ascending edge
+    // indices). `r` is consumed.
+    //
+    // 番号 r（< 要素数）の要素を edges に格納（辺インデックス昇順）。
+    // r は破壊される。
+    //
+    // ========================================================================
+    void unrank(uint64_t* r, std::vector<int>& edges) const {
+        edges.clear();
+        tdzdd::NodeId f = dd.root();
+        while (f.row() != 0) {
+            tdzdd::NodeId f1 = dd.child(f, 1);
+            const uint64_t* c1 = countOf(f1);
+            if (less(r, c1)) {
+                // Levels decrease along the walk, so edge indices increase
+                // 走査中レベルは減少するため辺インデックスは増加順
+                edges.push_back(num_edges - f.row());
+                f = f1;
+            } else {
+                subtract(r, c1);
+                f = dd.child(f, 0);
+            }
+        }
+    }
+
+    // ========================================================================
+    // sample
+    // ========================================================================
+    //
+    // Draw one member uniformly at random into `edges` (ascending edge
+    // indices). The index is drawn by rejection on the bit length of the
+    // total, so it is exactly uniform. Returns false if the ZDD is empty.
+    //
+    // 一様ランダムに 1 要素を抽出し edges に格納（辺インデックス昇順）。番号は
+    // 要素数のビット長での棄却法で引くため厳密に一様。ZDD が空なら false を返す。
+    //
+    // ========================================================================
+    template<typename RNG>
+    bool sample(RNG& rng, std::vector<int>& edges) const {
+        if (empty()) return false;
+        const uint64_t* n = countOf(dd.root());
+        uint64_t top_mask = ~0ULL >> __builtin_clzll(n[words - 1] | 1);
+
+        uint64_t small[16];
+        std::vector<uint64_t> heap;
+        uint64_t* r = small;
+        if (words > 16) {
+            heap.resize(words);
+            r = heap.data();
+        }
+        do {
+            for (int i = 0; i < words; ++i) r[i] = (uint64_t)rng();
+            r[words - 1] &= top_mask;
+        } while (!less(r, n));
+
+        unrank(r, edges);
+        return true;
+    }
+
+    // ========================================================================
+    // Cursor
+    // ========================================================================
+    //
+    // Walks members in index order starting at an arbitrary index. The path
+    // from the root is kept as an explicit stack; next() backtracks to the
+    // deepest 1-branch whose 0-sibling is non-empty and descends from there.
+    //
+    // 任意の番号から番号順に要素を走査する。根からの経路を明示的なスタックで
+    // 保持し、next() は 0-兄弟が空でない最も深い 1-枝まで戻ってから下降する。
+    //
+    // Usage / 使い方:
+    //   for (ZddIndex::Cursor c(index, a); c.valid() && n-- > 0; c.next()) {
+    //       use(c.edges());
+    //   }
+    //
+    // ========================================================================
+    class Cursor {
+        const ZddIndex& index;
+        std::vector<tdzdd::NodeId> path;  // Nodes from the root / 根からのノード
+        std::vector<bool> took_one;       // Branch taken at path[i] / path[i] で選んだ枝
+        std::vector<int> current;         // Edges of the current tree / 現在の木の辺
+        bool ok;
+
+        // Descend from f taking the 1-branch whenever it is non-empty
+        // f から下降し、空でなければ 1-枝を選ぶ
+        void descendFirst(tdzdd::NodeId f) {
+            const tdzdd::DdStructure<2>& dd = index.dd;
+            while (f.row() != 0) {
+                tdzdd::NodeId f1 = dd.child(f, 1);
+                bool one = !index.isZero(index.countOf(f1));
+                path.push_back(f);
+                took_one.push_back(one);
+                if (one) current.push_back(index.num_edges - f.row());
+                f = one ? f1 : dd.child(f, 0);
+            }
+        }
+
+    public:
+        // Position at index `start`; invalid if start ≥ total
+        // 番号 start に位置付ける。start ≥ 要素数なら無効
+        Cursor(const ZddIndex& index, Number start)
+            : index(index), ok(false) {
+            start.resize(index.words, 0);
+            if (!index.less(start.data(), index.countOf(index.dd.root()))) return;
+
+            const tdzdd::DdStructure<2>& dd = index.dd;
+            tdzdd::NodeId f = dd.root();
+            while (f.row() != 0) {
+                tdzdd::NodeId f1 = dd.child(f, 1);
+                const uint64_t* c1 = index.countOf(f1);
+                bool one = index.less(start.data(), c1);
+                path.push_back(f);
+                took_one.push_back(one);
+                if (one) {
+                    current.push_back(index.num_edges - f.row());
+                    f = f1;
+                } else {
+                    index.subtract(start.data(), c1);
+                    f = dd.child(f, 0);
+                }
+            }
+            ok = true;
+        }
+
+        bool valid() const {
+            return ok;
+        }
+
+        // Edges of the current tree, ascending / 現在の木の辺（昇順）
+        const std::vector<int>& edges() const {
+            return current;
+        }
+
+        void next() {
+            const tdzdd::DdStructure<2>& dd = index.dd;
+            while (!path.empty()) {
+                tdzdd::NodeId f = path.back();
+                bool one = took_one.back();
+                path.pop_back();
+                took_one.pop_back();
+                if (!one) continue;
+                current.pop_back();
+
+                tdzdd::NodeId f0 = dd.child(f, 0);
+                if (!index.isZero(index.countOf(f0))) {
+                    path.push_back(f);
+                    took_one.push_back(false);
+                    descendFirst(f0);
+                    return;
+                }
+            }
+            ok = false;
+        }
+    };
+};
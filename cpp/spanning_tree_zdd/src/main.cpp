@@ -24,15 +24,33 @@
 //   - Phase 4: Loads graph, constructs spanning tree ZDD
 //   - Phase 5: Loads MOPEs, applies subsetting filters iteratively
 //   - Phase 6: Loads automorphisms, applies Burnside's lemma on ZDD
+//   - Phase 6: Optionally keeps orbit representatives (cross-check, export)
+//   - Optionally draws uniform random trees from the final family
+//   - Optionally exports index slices [A, B) of the final family and ranks
+//     given trees (ZddIndex)
+//   - Optionally exports the whole final family as a block file (TreeExport)
 //   - Measures timing for each phase separately
 //   - Outputs structured results in JSON format
+//   - Optionally runs a manifest of many polyhedra in one process
+//   - Optionally keeps the diagrams in segment files (OutOfCoreDd)
+//   - Optionally sets NUMA placement, huge pages and pinning (MemoryPlacement)
+//   - Optionally estimates the diagram size without building it (SizeEstimator)
 //
 // プロジェクト内での責務:
 //   - Phase 4: グラフを読み込み、全域木 ZDD を構築
 //   - Phase 5: MOPE を読み込み、subsetting フィルタを反復適用
 //   - Phase 6: 自己同型を読み込み、ZDD 上で Burnside の補題を適用
+//   - Phase 6: オプションで軌道代表元を抽出（検証・エクスポート）
+//   - オプションで最終的な族から一様ランダムに全域木を抽出
+//   - オプションで最終的な族の番号区間 [A, B) を出力し、与えられた木の番号を
+//     計算（ZddIndex）
+//   - オプションで最終的な族全体をブロックファイルとして出力（TreeExport）
 //   - 各フェーズの時間を個別に計測
 //   - 構造化された結果を JSON 形式で出力
+//   - オプションで多数の多面体のマニフェストを 1 プロセスで実行
+//   - オプションで ZDD をセグメントファイルに置く（OutOfCoreDd）
+//   - オプションで NUMA 配置・ヒュージページ・固定を設定（MemoryPlacement）
+//   - オプションで ZDD を構築せずに大きさを推定（SizeEstimator）
 //
 // Phase 4+5+6 における位置づけ:
 //   Core binary for Phase 4, Phase 5, and Phase 6.
@@ -45,69 +63,64 @@
 //   Phase 4+5:        ./spanning_tree_zdd <polyhedron.grh> <edge_sets.jsonl>
 //   Phase 4+6:        ./spanning_tree_zdd <polyhedron.grh> --automorphisms <automorphisms.json>
 //   Phase 4+5+6:      ./spanning_tree_zdd <polyhedron.grh> <edge_sets.jsonl> --automorphisms <automorphisms.json>
+//   + representatives: ... --automorphisms <automorphisms.json> --export-representatives <out.jsonl>
+//   + sampling:        ... --sample N --sample-output <out> [--sample-format jsonl|binary]
+//                      [--sample-seed S] [--sample-threads T]
+//   + slicing:         ... --export-range A:B --range-output <out.jsonl>
+//                      ... --rank-edges <in.jsonl> --rank-output <out.jsonl>
+//   + full export:     ... --export-all <out.stze> [--export-encoding delta|bitset]
+//                      [--export-threads T]
+//   Memory budget:     ... --max-memory <SIZE>   (e.g. 8G; picks and raises --split-depth)
+//   Out-of-core:       ... --out-of-core <DIR>   (levels kept in segment files under DIR)
+//   Placement:         ... [--numa default|interleave|first-touch] [--huge-pages]
+//                      [--pin-threads]
+//   Estimate only:     ... --estimate [--estimate-states N] [--estimate-seed S]
+//   Batch:             ./spanning_tree_zdd --manifest <file|-> [--jobs N]
+//                      [--exclusive-edges E] [--simd K] [--numa MODE]
+//                      [--huge-pages] [--pin-threads]
+//                      (one "<result.json> <polyhedron.grh> [arguments...]" per line)
 //
 // ============================================================================
 
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <chrono>
 #include <string>
 #include <iomanip>
 #include <vector>
-#include <set>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <cstdio>
 #include <tdzdd/DdStructure.hpp>
 #include <tdzdd/DdSpecOp.hpp>
 #include <tdzdd/util/Graph.hpp>
 #include "SpanningTree.hpp"
-#include "BigUInt.hpp"
+#include "BitKernels.hpp"
 #include "UnfoldingFilter.hpp"
 #include "SymmetryFilter.hpp"
+#include "OrbitMinimalFilter.hpp"
+#include "EdgeRestrictor.hpp"
+#include "ZddIndex.hpp"
+#include "TreeExport.hpp"
+#include "InputLoader.hpp"
+#include "MemoryBudget.hpp"
+#include "MemoryPlacement.hpp"
+#include "BufferPool.hpp"
+#include "LevelStates.hpp"
+#include "OutOfCoreDd.hpp"
+#include "SizeEstimator.hpp"
 
 using tdzdd::Graph;
 using namespace std;
 using namespace std::chrono;
 
-// ============================================================================
-// EdgeRestrictor
-// ============================================================================
-//
-// What this does:
-//   ZDD filter that restricts the top `depth` edges to a specific bit pattern.
-//   Used to partition the ZDD into 2^depth disjoint subsets for memory-efficient
-//   subsetting with SymmetryFilter.
-//
-// この処理の内容:
-//   上位 depth 辺を特定のビットパターンに制約する ZDD フィルタ。
-//   SymmetryFilter との subsetting のメモリ効率化のため、ZDD を
-//   2^depth 個の排他的部分集合に分割するのに使用。
-//
-// ============================================================================
-class EdgeRestrictor : public tdzdd::DdSpec<EdgeRestrictor, int, 2> {
-    int num_edges;
-    int depth;
-    int partition;
-
-public:
-    EdgeRestrictor(int num_edges, int depth, int partition)
-        : num_edges(num_edges), depth(depth), partition(partition) {}
-
-    int getRoot(int& state) const {
-        state = 0;
-        return num_edges;
-    }
-
-    int getChild(int& state, int level, int value) const {
-        int edge_idx = num_edges - level;
-        if (edge_idx < depth) {
-            int required = (partition >> edge_idx) & 1;
-            if (value != required) return 0;
-        }
-        return (level <= 1) ? -1 : level - 1;
-    }
-};
-
 // ============================================================================
 // Big integer string arithmetic
 // 大整数文字列演算
@@ -168,232 +181,31 @@ string bigint_divide(const string& a, int b, int& remainder) {
 }
 
 // ============================================================================
-// extract_edges_from_json
-// ============================================================================
-//
-// What this does:
-//   Parse {"edges": [0, 1, 2, ...]} from a JSON line.
-//   Extract edge IDs as a set of integers.
-//
-// この処理の内容:
-//   JSON 行から {"edges": [0, 1, 2, ...]} をパース。
-//   辺 ID を整数の集合として抽出。
-//
-// ============================================================================
-set<int> extract_edges_from_json(const string& json_line) {
-    set<int> edges;
-
-    size_t start = json_line.find('[');
-    size_t end = json_line.find(']');
-
-    if (start == string::npos || end == string::npos) {
-        return edges;
-    }
-
-    string edge_list = json_line.substr(start + 1, end - start - 1);
-
-    stringstream ss(edge_list);
-    string token;
-    while (getline(ss, token, ',')) {
-        size_t first = token.find_first_not_of(" \t");
-        size_t last = token.find_last_not_of(" \t");
-
-        if (first != string::npos && last != string::npos) {
-            token = token.substr(first, last - first + 1);
-            if (!token.empty()) {
-                edges.insert(stoi(token));
-            }
-        }
-    }
-
-    return edges;
-}
-
-// ============================================================================
-// load_mopes_from_edge_sets
-// ============================================================================
-//
-// What this does:
-//   Read edge_sets.jsonl and extract all MOPE edge sets.
-//
-// この処理の内容:
-//   edge_sets.jsonl を読み込み、全ての MOPE 辺集合を抽出。
-//
-// ============================================================================
-vector<set<int>> load_mopes_from_edge_sets(const string& edge_sets_file) {
-    vector<set<int>> MOPEs;
-
-    ifstream file(edge_sets_file);
-    if (!file.is_open()) {
-        cerr << "Error: Could not open " << edge_sets_file << endl;
-        return MOPEs;
-    }
-
-    string line;
-    int line_num = 0;
-    while (getline(file, line)) {
-        line_num++;
-        if (line.empty()) continue;
-
-        set<int> edges = extract_edges_from_json(line);
-
-        if (!edges.empty()) {
-            MOPEs.push_back(edges);
-        } else {
-            cerr << "Warning: Empty edge set at line " << line_num << endl;
-        }
-    }
-
-    file.close();
-    return MOPEs;
-}
-
-// ============================================================================
-// load_automorphisms
+// isIdentity
 // ============================================================================
 //
-// What this does:
-//   Read automorphisms.json and extract edge permutations and group order.
-//   Format: {"group_order": N, "edge_permutations": [[...], [...], ...]}
-//
-// この処理の内容:
-//   automorphisms.json を読み込み、辺置換と群位数を抽出。
-//   形式: {"group_order": N, "edge_permutations": [[...], [...], ...]}
+// Whether an edge permutation fixes every edge.
+// 辺の置換が全ての辺を固定するか。
 //
 // ============================================================================
-bool load_automorphisms(
-    const string& automorphisms_file,
-    int& group_order,
-    vector<vector<int>>& edge_permutations,
-    vector<bool>& zero_flags
-) {
-    ifstream file(automorphisms_file);
-    if (!file.is_open()) {
-        cerr << "Error: Could not open " << automorphisms_file << endl;
-        return false;
+static bool isIdentity(const vector<int>& perm) {
+    for (int j = 0; j < (int)perm.size(); ++j) {
+        if (perm[j] != j) return false;
     }
-
-    // Read entire file into string
-    // ファイル全体を文字列に読み込み
-    string content((istreambuf_iterator<char>(file)),
-                    istreambuf_iterator<char>());
-    file.close();
-
-    // Extract group_order
-    // group_order を抽出
-    {
-        size_t pos = content.find("\"group_order\"");
-        if (pos == string::npos) {
-            cerr << "Error: group_order not found in " << automorphisms_file << endl;
-            return false;
-        }
-        pos = content.find(':', pos);
-        if (pos == string::npos) return false;
-        pos++;
-        // Skip whitespace
-        while (pos < content.size() && (content[pos] == ' ' || content[pos] == '\t')) pos++;
-        string num_str;
-        while (pos < content.size() && content[pos] >= '0' && content[pos] <= '9') {
-            num_str += content[pos++];
-        }
-        group_order = stoi(num_str);
-    }
-
-    // Extract edge_permutations
-    // edge_permutations を抽出
-    {
-        size_t pos = content.find("\"edge_permutations\"");
-        if (pos == string::npos) {
-            cerr << "Error: edge_permutations not found in " << automorphisms_file << endl;
-            return false;
-        }
-        pos = content.find('[', pos);
-        if (pos == string::npos) return false;
-        pos++; // Skip outer '['
-
-        // Parse each inner array
-        // 各内部配列をパース
-        while (pos < content.size()) {
-            // Find next '['
-            pos = content.find('[', pos);
-            if (pos == string::npos) break;
-
-            size_t end = content.find(']', pos);
-            if (end == string::npos) break;
-
-            // Extract numbers between '[' and ']'
-            string arr_str = content.substr(pos + 1, end - pos - 1);
-            vector<int> perm;
-            stringstream ss(arr_str);
-            string token;
-            while (getline(ss, token, ',')) {
-                size_t first = token.find_first_not_of(" \t\n\r");
-                size_t last = token.find_last_not_of(" \t\n\r");
-                if (first != string::npos && last != string::npos) {
-                    token = token.substr(first, last - first + 1);
-                    if (!token.empty()) {
-                        perm.push_back(stoi(token));
-                    }
-                }
-            }
-
-            if (!perm.empty()) {
-                edge_permutations.push_back(perm);
-            }
-
-            pos = end + 1;
-
-            // Check if we've reached the outer ']'
-            // 外側の ']' に到達したかチェック
-            size_t next_bracket = content.find_first_of("[]", pos);
-            if (next_bracket != string::npos && content[next_bracket] == ']') {
-                // Check if there's no '[' before this ']'
-                size_t next_open = content.find('[', pos);
-                if (next_open == string::npos || next_open > next_bracket) {
-                    break; // End of outer array
-                }
-            }
-        }
-    }
-
-    // Extract zero_flags (optional field, Theorem 2 pre-filtering)
-    // zero_flags を抽出（任意フィールド、Theorem 2 前処理フィルタ）
-    {
-        size_t pos = content.find("\"zero_flags\"");
-        if (pos != string::npos) {
-            pos = content.find('[', pos);
-            if (pos != string::npos) {
-                size_t end = content.find(']', pos);
-                if (end != string::npos) {
-                    string arr_str = content.substr(pos + 1, end - pos - 1);
-                    stringstream ss(arr_str);
-                    string token;
-                    while (getline(ss, token, ',')) {
-                        size_t first = token.find_first_not_of(" \t\n\r");
-                        size_t last = token.find_last_not_of(" \t\n\r");
-                        if (first != string::npos && last != string::npos) {
-                            string val = token.substr(first, last - first + 1);
-                            zero_flags.push_back(val == "true");
-                        }
-                    }
-                }
-            }
-        }
-    }
-
     return true;
 }
 
 // ============================================================================
-// run_filtering_with_bitmask
+// run_filtering
 // ============================================================================
 //
 // What this does:
-//   Template function to run Phase 5 filtering with specific BitMask type.
-//   Uses UnfoldingFilter<BitMask> for filtering.
+//   Run Phase 5 filtering with UnfoldingFilter (one subset per MOPE).
+//   The filter state width is chosen per MOPE at runtime.
 //
 // この処理の内容:
-//   特定の BitMask 型で Phase 5 フィルタリングを実行するテンプレート関数。
+//   UnfoldingFilter で Phase 5 フィルタリングを実行（MOPE ごとに subset）。
+//   フィルタ状態の幅は MOPE ごとに実行時に決まる。
 //
 // CRITICAL:
 //   The subsetting loop structure must NOT be changed.
@@ -404,50 +216,55 @@ bool load_automorphisms(
 //   これは Reserch2024 の検証済みアルゴリズム。
 //
 // ============================================================================
-template<typename BitMask>
-void run_filtering_with_bitmask(
+void run_filtering(
     tdzdd::DdStructure<2>& dd,
-    const vector<set<int>>& MOPEs,
-    int num_edges
+    const InputLoader::EdgeSets& MOPEs,
+    int num_edges,
+    ostream& log
 ) {
     int total_mopes = MOPEs.size();
 
     // CRITICAL: This loop structure must NOT be changed
     // 重要: このループ構造は変更してはいけない
     for (int i = 0; i < (int)MOPEs.size(); ++i) {
-        cerr << (i + 1) << "/" << total_mopes << endl;
+        log << (i + 1) << "/" << total_mopes << endl;
 
-        UnfoldingFilter<BitMask> filter(num_edges, MOPEs[i]);
+        UnfoldingFilter filter(num_edges, MOPEs.begin(i), MOPEs.end(i));
         dd.zddSubset(filter);
         dd.zddReduce();
     }
 }
 
 // ============================================================================
-// run_burnside_with_bitmask
+// run_burnside
 // ============================================================================
 //
 // What this does:
-//   Apply Burnside's lemma on the ZDD using SymmetryFilter<BitMask>.
+//   Apply Burnside's lemma on the ZDD using SymmetryFilter.
 //   For each automorphism g, count g-invariant spanning trees |T_g|.
 //   Sum all |T_g| and divide by |Aut(Γ)| to get nonisomorphic count.
+//   |T_g| is counted top-down on dd ∩ SymmetryFilter (countPaths) with
+//   buffers recycled from `pool` across the automorphisms.
 //
 // この処理の内容:
-//   SymmetryFilter<BitMask> を用いて ZDD 上で Burnside の補題を適用。
+//   SymmetryFilter を用いて ZDD 上で Burnside の補題を適用。
 //   各自己同型 g に対して g-不変全域木 |T_g| を数える。
 //   全 |T_g| を合計し |Aut(Γ)| で割って非同型個数を得る。
+//   |T_g| は dd ∩ SymmetryFilter 上でトップダウンに数え（countPaths）、
+//   バッファは自己同型をまたいで pool から使い回す。
 //
 // ============================================================================
-template<typename BitMask>
-void run_burnside_with_bitmask(
+void run_burnside(
     tdzdd::DdStructure<2>& dd,
     const vector<vector<int>>& edge_permutations,
     const vector<bool>& zero_flags,
     int group_order,
     int num_edges,
+    BufferPool& pool,
     vector<string>& invariant_counts,
     string& burnside_sum,
-    string& nonisomorphic_count
+    string& nonisomorphic_count,
+    ostream& log
 ) {
     burnside_sum = "0";
     int total = edge_permutations.size();
@@ -460,40 +277,33 @@ void run_burnside_with_bitmask(
         // Theorem 2 zero pre-filter: skip if |T_g| = 0 is guaranteed
         // Theorem 2 ゼロ前処理フィルタ: |T_g| = 0 が保証されている場合スキップ
         if (has_zero_flags && zero_flags[i]) {
-            cerr << "Phase 6: automorphism " << (i + 1) << "/" << total
+            log << "Phase 6: automorphism " << (i + 1) << "/" << total
                  << "  (skipped: Theorem 2) |T_g| = 0" << endl;
             invariant_counts.push_back("0");
             skipped++;
             continue;
         }
 
-        cerr << "Phase 6: automorphism " << (i + 1) << "/" << total << endl;
+        log << "Phase 6: automorphism " << (i + 1) << "/" << total << endl;
 
         // Check if this is the identity permutation
         // 恒等置換かチェック
-        bool is_identity = true;
-        for (int j = 0; j < num_edges; ++j) {
-            if (perm[j] != j) {
-                is_identity = false;
-                break;
-            }
-        }
+        bool is_identity = isIdentity(perm);
 
         string count;
         if (is_identity) {
             // Identity: all spanning trees are invariant
             // 恒等置換: 全ての全域木が不変
             count = dd.zddCardinality();
-            cerr << "  (identity) |T_g| = " << count << endl;
+            log << "  (identity) |T_g| = " << count << endl;
         } else {
-            // Non-identity: copy ZDD and apply SymmetryFilter
-            // 非恒等置換: ZDD をコピーして SymmetryFilter を適用
-            tdzdd::DdStructure<2> dd_copy(dd);
-            SymmetryFilter<BitMask> sym_filter(num_edges, perm);
-            dd_copy.zddSubset(sym_filter);
-            dd_copy.zddReduce();
-            count = dd_copy.zddCardinality();
-            cerr << "  |T_g| = " << count << endl;
+            // Non-identity: count dd ∩ SymmetryFilter directly; only |T_g| is
+            // needed, so no subset diagram is copied, built or reduced
+            // 非恒等置換: dd ∩ SymmetryFilter を直接数える。必要なのは |T_g|
+            // のみなので、部分集合の ZDD はコピーも構築も既約化もしない
+            SymmetryFilter sym_filter(num_edges, perm);
+            count = countPaths(tdzdd::zddIntersection(dd, sym_filter), pool);
+            log << "  |T_g| = " << count << endl;
         }
 
         invariant_counts.push_back(count);
@@ -501,7 +311,7 @@ void run_burnside_with_bitmask(
     }
 
     if (skipped > 0) {
-        cerr << "Phase 6: Skipped " << skipped << "/" << total
+        log << "Phase 6: Skipped " << skipped << "/" << total
              << " automorphisms by Theorem 2 pre-filter" << endl;
     }
 
@@ -511,11 +321,398 @@ void run_burnside_with_bitmask(
     nonisomorphic_count = bigint_divide(burnside_sum, group_order, remainder);
 
     if (remainder != 0) {
-        cerr << "WARNING: Burnside sum " << burnside_sum
+        log << "WARNING: Burnside sum " << burnside_sum
              << " is not divisible by group order " << group_order
              << " (remainder = " << remainder << ")" << endl;
-        cerr << "This indicates a bug in the computation!" << endl;
+        log << "This indicates a bug in the computation!" << endl;
+    }
+}
+
+// ============================================================================
+// run_orbit_representatives
+// ============================================================================
+//
+// What this does:
+//   Keep only the lexicographically smallest tree of each orbit by
+//   subsetting a copy of the ZDD with OrbitMinimalFilter for every
+//   non-identity automorphism. The cardinality is the nonisomorphic count
+//   (independent of Burnside). If `out` is given, each representative is
+//   written as one JSONL line {"edges": [...]} (edge indices, ascending).
+//
+// この処理の内容:
+//   ZDD のコピーを非恒等な各自己同型の OrbitMinimalFilter で subsetting し、
+//   各軌道の辞書式最小の全域木のみを残す。要素数が非同型数
+//   （Burnside とは独立）。out が与えられた場合、各代表元を JSONL の 1 行
+//   {"edges": [...]}（辺インデックス昇順）として書き出す。
+//
+// ============================================================================
+string run_orbit_representatives(
+    const tdzdd::DdStructure<2>& dd,
+    const vector<vector<int>>& edge_permutations,
+    int num_edges,
+    ostream* out,
+    ostream& log
+) {
+    tdzdd::DdStructure<2> reps(dd);
+    set<vector<int>> applied;
+    int total = edge_permutations.size();
+
+    for (int i = 0; i < total; ++i) {
+        const vector<int>& perm = edge_permutations[i];
+
+        if (isIdentity(perm) || !applied.insert(perm).second) continue;
+
+        log << "Representatives: automorphism " << (i + 1) << "/" << total << endl;
+        OrbitMinimalFilter filter(num_edges, perm);
+        reps.zddSubset(filter);
+        reps.zddReduce();
+    }
+
+    if (out) {
+        // ZDD iterator returns levels; level i is edge index (num_edges - i)
+        // ZDD イテレータはレベルを返す; レベル i は辺インデックス (num_edges - i)
+        vector<int> edges;
+        for (auto it = reps.begin(); it != reps.end(); ++it) {
+            edges.clear();
+            for (int level : *it) edges.push_back(num_edges - level);
+            sort(edges.begin(), edges.end());
+            *out << "{\"edges\": [";
+            for (size_t k = 0; k < edges.size(); ++k) {
+                if (k > 0) *out << ", ";
+                *out << edges[k];
+            }
+            *out << "]}\n";
+        }
+    }
+
+    return reps.zddCardinality();
+}
+
+// ============================================================================
+// run_ordered_batches
+// ============================================================================
+//
+// What this does:
+//   Produce batches 0 .. num_batches - 1 on `num_threads` threads with
+//   produce(b, buffer) and write the buffers to `out` in batch order, so the
+//   output does not depend on the number of threads. At most one finished
+//   batch per thread waits in memory.
+//
+// この処理の内容:
+//   num_threads スレッドで produce(b, buffer) によりバッチ 0 .. num_batches - 1
+//   を生成し、バッチ順に out へ書き出す（出力はスレッド数に依存しない）。
+//   メモリ上で待機する完成済みバッチはスレッドあたり高々 1 つ。
+//
+// ============================================================================
+void run_ordered_batches(
+    uint64_t num_batches,
+    int num_threads,
+    ostream& out,
+    const function<void(uint64_t, string&)>& produce
+) {
+    atomic<uint64_t> next_batch(0);
+    uint64_t next_write = 0;
+    mutex write_lock;
+    condition_variable write_turn;
+
+    auto worker = [&]() {
+        string buffer;
+        for (uint64_t b = next_batch++; b < num_batches; b = next_batch++) {
+            buffer.clear();
+            produce(b, buffer);
+
+            // Write batches in order / バッチ順に書き出す
+            unique_lock<mutex> lock(write_lock);
+            write_turn.wait(lock, [&]() { return next_write == b; });
+            out.write(buffer.data(), buffer.size());
+            ++next_write;
+            write_turn.notify_all();
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 1; t < num_threads; ++t) {
+        workers.emplace_back([&worker, t]() {
+            MemoryPlacement::pinWorker(t);
+            worker();
+        });
+    }
+    worker();
+    for (auto& w : workers) w.join();
+}
+
+// ============================================================================
+// run_sampling
+// ============================================================================
+//
+// What this does:
+//   Draw `num_samples` uniform random members of the ZDD with ZddIndex
+//   and write them to `out`. Samples are generated in batches of
+//   SAMPLE_BATCH trees; batch b always uses an mt19937_64 stream seeded
+//   with (seed, b), and batches are written in order, so the output
+//   depends only on the seed, not on the number of threads.
+//
+//   Formats:
+//   - "jsonl":  one line {"edges": [...]} per tree (edge indices, ascending)
+//   - "binary": header, then one bitmask per tree (bit e = edge e), as
+//               ceil(num_edges / 64) little-endian uint64 words
+//       header: magic "STZS" (4 bytes), uint32 version = 1,
+//               uint32 num_edges, uint32 words per tree, uint64 num_samples
+//
+// この処理の内容:
+//   ZddIndex で ZDD の要素を num_samples 個一様ランダムに抽出し out に
+//   書き出す。SAMPLE_BATCH 本ごとのバッチで生成し、バッチ b は常に
+//   (seed, b) で初期化した mt19937_64 を使い、バッチ順に書き出すため、
+//   出力はシードのみで決まりスレッド数に依存しない。
+//
+//   形式:
+//   - "jsonl":  1 本につき 1 行 {"edges": [...]}（辺インデックス昇順）
+//   - "binary": ヘッダに続き 1 本ごとのビットマスク（ビット e = 辺 e）、
+//               ceil(num_edges / 64) 個のリトルエンディアン uint64 ワード
+//       ヘッダ: マジック "STZS"（4 バイト）、uint32 バージョン = 1、
+//               uint32 辺数、uint32 1 本あたりのワード数、uint64 サンプル数
+//
+// ============================================================================
+static const uint64_t SAMPLE_BATCH = 4096;
+
+template<typename T>
+static void write_le(ostream& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.put(char((uint64_t(value) >> (8 * i)) & 0xFF));
+    }
+}
+
+bool run_sampling(
+    const ZddIndex& index,
+    uint64_t num_samples,
+    uint64_t seed,
+    int num_threads,
+    bool binary,
+    ostream& out,
+    ostream& log
+) {
+    const int num_edges = index.numEdges();
+    if (index.empty() && num_samples > 0) {
+        log << "Error: Cannot sample from an empty family" << endl;
+        return false;
+    }
+    log << "Sampling " << num_samples << " of " << index.totalString()
+         << " trees (" << index.countWords() << "-word counts, "
+         << num_threads << " threads)" << endl;
+
+    const uint32_t words_per_tree = (num_edges + 63) / 64;
+    if (binary) {
+        out.write("STZS", 4);
+        write_le<uint32_t>(out, 1);
+        write_le<uint32_t>(out, num_edges);
+        write_le<uint32_t>(out, words_per_tree);
+        write_le<uint64_t>(out, num_samples);
+    }
+
+    const uint64_t num_batches = (num_samples + SAMPLE_BATCH - 1) / SAMPLE_BATCH;
+    run_ordered_batches(num_batches, num_threads, out, [&](uint64_t b, string& buffer) {
+        seed_seq seq{uint32_t(seed), uint32_t(seed >> 32),
+                     uint32_t(b), uint32_t(b >> 32)};
+        mt19937_64 rng(seq);
+        uint64_t n = min(SAMPLE_BATCH, num_samples - b * SAMPLE_BATCH);
+
+        vector<int> edges;
+        vector<uint64_t> mask(words_per_tree);
+        for (uint64_t k = 0; k < n; ++k) {
+            index.sample(rng, edges);
+            if (binary) {
+                fill(mask.begin(), mask.end(), 0);
+                for (int e : edges) mask[e >> 6] |= 1ULL << (e & 63);
+                for (uint64_t w : mask) {
+                    for (int i = 0; i < 8; ++i) buffer.push_back(char(w >> (8 * i)));
+                }
+            } else {
+                buffer += "{\"edges\": [";
+                for (size_t i = 0; i < edges.size(); ++i) {
+                    if (i > 0) buffer += ", ";
+                    buffer += to_string(edges[i]);
+                }
+                buffer += "]}\n";
+            }
+        }
+    });
+
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+// ============================================================================
+// write_ranked_edges
+// ============================================================================
+//
+// Write one JSONL line {"rank": "<r>", "edges": [...]} ("rank": null if the
+// tree is not a member).
+// JSONL の 1 行 {"rank": "<r>", "edges": [...]} を書き出す
+// （要素でない木は "rank": null）。
+//
+// ============================================================================
+static void write_ranked_edges(ostream& out, const string* rank, const vector<int>& edges) {
+    out << "{\"rank\": ";
+    if (rank) out << "\"" << *rank << "\"";
+    else out << "null";
+    out << ", \"edges\": [";
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (i > 0) out << ", ";
+        out << edges[i];
+    }
+    out << "]}\n";
+}
+
+// ============================================================================
+// run_export_range
+// ============================================================================
+//
+// What this does:
+//   Write the members with index in [first, last) (ZddIndex order:
+//   lexicographic order of ascending edge lists) as JSONL. Seeking costs
+//   O(edges); each further tree costs amortized O(1) levels, so a slice
+//   costs time proportional to its length, not to its position.
+//
+// この処理の内容:
+//   番号が [first, last) の要素（ZddIndex の順序: 昇順辺リストの辞書式順序）を
+//   JSONL で書き出す。シークは O(辺数)、以降の木は償却 O(1) レベルのため、
+//   区間のコストは位置ではなく長さに比例する。
+//
+// ============================================================================
+bool run_export_range(
+    const ZddIndex& index,
+    const string& first_str,
+    const string& last_str,
+    ostream& out,
+    string& exported_count,
+    ostream& log
+) {
+    ZddIndex::Number first, last;
+    ZddIndex::Number total = index.total();
+    if (!index.parse(first_str, first) || !index.parse(last_str, last) ||
+        index.less(last.data(), first.data()) || index.less(total.data(), last.data())) {
+        log << "Error: Invalid range " << first_str << ":" << last_str
+             << " (family size " << index.toString(total) << ")" << endl;
+        return false;
+    }
+
+    ZddIndex::Number one(index.countWords(), 0);
+    one[0] = 1;
+    ZddIndex::Number r = first;
+    for (ZddIndex::Cursor c(index, first); c.valid() && r != last; c.next()) {
+        string rank = index.toString(r);
+        write_ranked_edges(out, &rank, c.edges());
+        index.add(r.data(), one.data());
+    }
+
+    ZddIndex::Number n = last;
+    index.subtract(n.data(), first.data());
+    exported_count = index.toString(n);
+    out.flush();
+    if (!out) {
+        log << "Error: Failed to write range output" << endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// run_rank_edges
+// ============================================================================
+//
+// What this does:
+//   For each {"edges": [...]} line of `in`, write its index in the family
+//   (ZddIndex order), or null if the tree is not a member.
+//
+// この処理の内容:
+//   in の各 {"edges": [...]} 行について、族の中での番号（ZddIndex の順序）を
+//   書き出す。要素でない木は null。
+//
+// ============================================================================
+bool run_rank_edges(
+    const ZddIndex& index,
+    istream& in,
+    ostream& out,
+    uint64_t& ranked,
+    uint64_t& not_members
+) {
+    ranked = 0;
+    not_members = 0;
+    ZddIndex::Number r;
+    string line;
+    vector<int> edges;
+    while (getline(in, line)) {
+        if (line.find('[') == string::npos) continue;
+        InputLoader::parseEdgeList(line.data(), line.data() + line.size(), edges);
+        if (index.rank(edges, r)) {
+            string rank = index.toString(r);
+            write_ranked_edges(out, &rank, edges);
+        } else {
+            write_ranked_edges(out, nullptr, edges);
+            ++not_members;
+        }
+        ++ranked;
+    }
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+// ============================================================================
+// run_export_all
+// ============================================================================
+//
+// What this does:
+//   Write every tree of the family in index order to a TreeExport block
+//   file. The family is cut into index ranges of EXPORT_BLOCK trees; each
+//   range is a sub-diagram walked depth-first by a ZddIndex::Cursor
+//   (explicit stack) and encoded as one block on a worker thread, and
+//   blocks are written in order.
+//
+// この処理の内容:
+//   族の全ての木を番号順に TreeExport のブロックファイルへ書き出す。族を
+//   EXPORT_BLOCK 本ずつの番号区間に分け、各区間（部分図）を
+//   ZddIndex::Cursor（明示的スタック）で深さ優先に走査してワーカースレッド上で
+//   1 ブロックに符号化し、ブロック順に書き出す。
+//
+// ============================================================================
+static const uint64_t EXPORT_BLOCK = 65536;
+
+bool run_export_all(
+    const ZddIndex& index,
+    TreeExport::Encoding encoding,
+    int num_threads,
+    ostream& out,
+    uint64_t& exported_count,
+    ostream& log
+) {
+    if (index.countWords() > 1) {
+        log << "Error: Family of " << index.totalString()
+             << " trees is too large to export" << endl;
+        return false;
     }
+    const uint64_t total = index.total()[0];
+    const int num_edges = index.numEdges();
+    log << "Exporting " << total << " trees ("
+         << (encoding == TreeExport::DELTA ? "delta" : "bitset") << ", "
+         << num_threads << " threads)" << endl;
+
+    string head = TreeExport::header(num_edges, encoding, total, EXPORT_BLOCK);
+    out.write(head.data(), head.size());
+
+    const uint64_t num_blocks = (total + EXPORT_BLOCK - 1) / EXPORT_BLOCK;
+    run_ordered_batches(num_blocks, num_threads, out, [&](uint64_t b, string& buffer) {
+        uint64_t n = min(EXPORT_BLOCK, total - b * EXPORT_BLOCK);
+        TreeExport::BlockEncoder encoder(num_edges, encoding);
+        ZddIndex::Cursor cursor(index, ZddIndex::Number(1, b * EXPORT_BLOCK));
+        for (uint64_t k = 0; k < n && cursor.valid(); ++k, cursor.next()) {
+            encoder.add(cursor.edges());
+        }
+        encoder.flush(buffer);
+    });
+
+    exported_count = total;
+    out.flush();
+    return static_cast<bool>(out);
 }
 
 // ============================================================================
@@ -529,6 +726,15 @@ void run_burnside_with_bitmask(
 //   and computes Burnside invariant counts. All ZDD memory is released
 //   after each partition, so peak memory ≈ 1/K of unpartitioned pipeline.
 //
+//   With node_budget > 0 (--max-memory), split_depth is only the starting
+//   depth. Partitions are visited depth-first over the binary tree of
+//   fixed edges, and a subtree shallower than the current depth is
+//   expanded instead of built. A partition whose Phase 4 diagram exceeds
+//   node_budget is dropped before Phase 5 / 6 copy it, and the current
+//   depth goes one edge deeper (up to min(30, num_edges - 1)). A partition
+//   below a quarter of the budget lets the following subtrees run one edge
+//   shallower again.
+//
 // この処理の内容:
 //   EdgeRestrictor でパーティション化した Phase 4 → 5 → 6 パイプライン。
 //   各パーティションで SpanningTree と EdgeRestrictor の zddIntersection
@@ -536,36 +742,63 @@ void run_burnside_with_bitmask(
 //   各パーティション処理後に ZDD メモリを完全解放するため、
 //   ピークメモリ ≈ 非分割時の 1/K。
 //
+//   node_budget > 0（--max-memory）の場合、split_depth は開始深さに過ぎない。
+//   固定辺の二分木を深さ優先でたどり、現在の深さより浅い部分木は構築せず
+//   展開する。Phase 4 の ZDD が node_budget を超えたパーティションは
+//   Phase 5 / 6 がコピーする前に破棄し、現在の深さを 1 辺深くする
+//   （上限は min(30, num_edges - 1)）。予算の 1/4 未満のパーティションの
+//   後は、続く部分木を再び 1 辺浅く実行する。
+//
 // ============================================================================
-template<typename BitMask>
+struct PartitionStats {
+    int partitions = 0;            // Partitions run to the end / 最後まで実行した数
+    int refined = 0;               // Dropped as over budget / 予算超過で破棄した数
+    int shallowest = 0;            // Depth range of the partitions run
+    int deepest = 0;               // 実行したパーティションの深さの範囲
+    uint64_t largest_nodes = 0;    // Largest Phase 4 diagram / 最大の Phase 4 ZDD
+};
+
 void run_partitioned_pipeline(
     const Graph& G,
     int num_edges,
     int split_depth,
     bool apply_filter,
-    const vector<set<int>>& MOPEs,
+    const InputLoader::EdgeSets& MOPEs,
     bool apply_burnside,
     const vector<vector<int>>& edge_permutations,
     const vector<bool>& zero_flags,
+    bool apply_representatives,
+    ostream* representatives_out,
+    uint64_t node_budget,
+    BufferPool& pool,
     // Outputs:
     string& spanning_tree_count,
     string& non_overlapping_count,
     vector<string>& invariant_counts,
     string& burnside_sum,
+    string& representative_count,
     double& build_time_ms,
     double& subset_time_ms,
-    double& burnside_time_ms
+    double& burnside_time_ms,
+    double& representatives_time_ms,
+    PartitionStats& stats,
+    ostream& log
 ) {
     const int num_partitions = 1 << split_depth;
+    const int max_depth = min(30, num_edges - 1);
     int total_automorphisms = edge_permutations.size();
     bool has_zero_flags = ((int)zero_flags.size() == total_automorphisms);
 
     spanning_tree_count = "0";
     non_overlapping_count = "0";
     burnside_sum = "0";
+    representative_count = "0";
     build_time_ms = 0.0;
     subset_time_ms = 0.0;
     burnside_time_ms = 0.0;
+    representatives_time_ms = 0.0;
+    stats = PartitionStats();
+    stats.shallowest = max_depth;
 
     // Initialize per-automorphism invariant counts to "0"
     // 各自己同型の不変量カウントを "0" に初期化
@@ -573,9 +806,40 @@ void run_partitioned_pipeline(
         invariant_counts.assign(total_automorphisms, "0");
     }
 
-    for (int p = 0; p < num_partitions; ++p) {
-        cerr << "=== Partition " << (p + 1) << "/" << num_partitions
-             << " ===" << endl;
+    // Subtrees still to run as (depth, index), next one at the back.
+    // Partition p at depth d is the union of p and p | 2^d at depth d + 1.
+    // Without a budget the leaves at split_depth are queued in order.
+    // 未処理の部分木 (深さ, 番号)。次に処理するものが末尾。深さ d の
+    // パーティション p は深さ d + 1 の p と p | 2^d の和。予算がなければ
+    // split_depth の葉を順に積む。
+    vector<pair<int, int>> pending;
+    if (node_budget == 0) {
+        for (int p = num_partitions - 1; p >= 0; --p) {
+            pending.push_back({split_depth, p});
+        }
+    } else {
+        pending.push_back({0, 0});
+    }
+    int current_depth = split_depth;
+
+    while (!pending.empty()) {
+        const int depth = pending.back().first;
+        const int p = pending.back().second;
+        pending.pop_back();
+
+        if (depth < current_depth) {
+            pending.push_back({depth + 1, p | (1 << depth)});
+            pending.push_back({depth + 1, p});
+            continue;
+        }
+
+        if (node_budget == 0) {
+            log << "=== Partition " << (p + 1) << "/" << num_partitions
+                 << " ===" << endl;
+        } else {
+            log << "=== Partition " << (stats.partitions + 1)
+                 << " (depth " << depth << ", index " << p << ") ===" << endl;
+        }
 
         // ================================================================
         // Phase 4: Build partitioned spanning tree ZDD
@@ -584,16 +848,40 @@ void run_partitioned_pipeline(
         auto start_build = high_resolution_clock::now();
 
         SpanningTree ST(G);
-        EdgeRestrictor restrictor(num_edges, split_depth, p);
+        EdgeRestrictor restrictor(num_edges, depth, p);
         auto partitioned_spec = tdzdd::zddIntersection(ST, restrictor);
         tdzdd::DdStructure<2> dd(partitioned_spec, true);
 
         auto end_build = high_resolution_clock::now();
         build_time_ms += duration<double, milli>(end_build - start_build).count();
 
+        // Over the memory budget: split before Phase 5 / 6 add their copies
+        // メモリ予算超過: Phase 5 / 6 がコピーを作る前に分割
+        uint64_t nodes = dd.size();
+        if (node_budget > 0 && nodes > node_budget) {
+            if (depth < max_depth) {
+                log << "  Partition has " << nodes << " nodes (budget "
+                     << node_budget << "), splitting at depth "
+                     << (depth + 1) << endl;
+                current_depth = depth + 1;
+                pending.push_back({depth, p});
+                stats.refined++;
+                continue;
+            }
+            log << "  Warning: partition has " << nodes << " nodes (budget "
+                 << node_budget << ") at the maximum depth " << depth << endl;
+        }
+        if (node_budget > 0 && nodes < node_budget / 4 && depth > 0) {
+            current_depth = min(current_depth, depth - 1);
+        }
+        stats.partitions++;
+        stats.shallowest = min(stats.shallowest, depth);
+        stats.deepest = max(stats.deepest, depth);
+        stats.largest_nodes = max<uint64_t>(stats.largest_nodes, nodes);
+
         string part_spanning = dd.zddCardinality();
         spanning_tree_count = bigint_add(spanning_tree_count, part_spanning);
-        cerr << "  Phase 4: spanning trees in partition = " << part_spanning << endl;
+        log << "  Phase 4: spanning trees in partition = " << part_spanning << endl;
 
         // ================================================================
         // Phase 5: Filtering (Optional)
@@ -606,9 +894,9 @@ void run_partitioned_pipeline(
             // CRITICAL: This loop structure must NOT be changed
             // 重要: このループ構造は変更してはいけない
             for (int i = 0; i < total_mopes; ++i) {
-                cerr << "  Phase 5: MOPE " << (i + 1) << "/" << total_mopes << endl;
+                log << "  Phase 5: MOPE " << (i + 1) << "/" << total_mopes << endl;
 
-                UnfoldingFilter<BitMask> filter(num_edges, MOPEs[i]);
+                UnfoldingFilter filter(num_edges, MOPEs.begin(i), MOPEs.end(i));
                 dd.zddSubset(filter);
                 dd.zddReduce();
             }
@@ -620,7 +908,7 @@ void run_partitioned_pipeline(
         string part_non_overlapping = dd.zddCardinality();
         non_overlapping_count = bigint_add(non_overlapping_count, part_non_overlapping);
         if (part_spanning != "0") {
-            cerr << "  Phase 5: non-overlapping in partition = " << part_non_overlapping << endl;
+            log << "  Phase 5: non-overlapping in partition = " << part_non_overlapping << endl;
         }
 
         // ================================================================
@@ -631,7 +919,7 @@ void run_partitioned_pipeline(
             // Skip Phase 6 if no trees in this partition
             // このパーティションに全域木がない場合は Phase 6 をスキップ
             if (part_non_overlapping == "0") {
-                cerr << "  Phase 6: skipped (no trees in partition)" << endl;
+                log << "  Phase 6: skipped (no trees in partition)" << endl;
             } else {
                 auto start_burnside = high_resolution_clock::now();
 
@@ -651,13 +939,7 @@ void run_partitioned_pipeline(
 
                     // Check if this is the identity permutation
                     // 恒等置換かチェック
-                    bool is_identity = true;
-                    for (int j = 0; j < num_edges; ++j) {
-                        if (perm[j] != j) {
-                            is_identity = false;
-                            break;
-                        }
-                    }
+                    bool is_identity = isIdentity(perm);
 
                     string count;
                     if (is_identity) {
@@ -665,13 +947,10 @@ void run_partitioned_pipeline(
                         // 恒等置換: 全ての全域木が不変
                         count = part_non_overlapping;
                     } else {
-                        // Non-identity: copy ZDD and apply SymmetryFilter
-                        // 非恒等置換: ZDD をコピーして SymmetryFilter を適用
-                        tdzdd::DdStructure<2> dd_copy(dd);
-                        SymmetryFilter<BitMask> sym_filter(num_edges, perm);
-                        dd_copy.zddSubset(sym_filter);
-                        dd_copy.zddReduce();
-                        count = dd_copy.zddCardinality();
+                        // Non-identity: count dd ∩ SymmetryFilter directly
+                        // 非恒等置換: dd ∩ SymmetryFilter を直接数える
+                        SymmetryFilter sym_filter(num_edges, perm);
+                        count = countPaths(tdzdd::zddIntersection(dd, sym_filter), pool);
                     }
 
                     invariant_counts[i] = bigint_add(invariant_counts[i], count);
@@ -682,11 +961,11 @@ void run_partitioned_pipeline(
                     if (count != "0") {
                         non_zero++;
                         if (is_identity) {
-                            cerr << "  Phase 6: automorphism " << (i + 1) << "/"
+                            log << "  Phase 6: automorphism " << (i + 1) << "/"
                                  << total_automorphisms
                                  << " (identity) |T_g| = " << count << endl;
                         } else {
-                            cerr << "  Phase 6: automorphism " << (i + 1) << "/"
+                            log << "  Phase 6: automorphism " << (i + 1) << "/"
                                  << total_automorphisms
                                  << " |T_g| = " << count << endl;
                         }
@@ -695,7 +974,7 @@ void run_partitioned_pipeline(
 
                 // Summary line for this partition
                 // このパーティションの要約行
-                cerr << "  Phase 6: " << computed << "/" << total_automorphisms
+                log << "  Phase 6: " << computed << "/" << total_automorphisms
                      << " computed, " << skipped_thm2 << " skipped (Theorem 2), "
                      << non_zero << " non-zero" << endl;
 
@@ -705,13 +984,33 @@ void run_partitioned_pipeline(
                 for (const auto& c : invariant_counts) {
                     cumulative_sum = bigint_add(cumulative_sum, c);
                 }
-                cerr << "  Phase 6: cumulative burnside_sum = " << cumulative_sum << endl;
+                log << "  Phase 6: cumulative burnside_sum = " << cumulative_sum << endl;
 
                 auto end_burnside = high_resolution_clock::now();
                 burnside_time_ms += duration<double, milli>(end_burnside - start_burnside).count();
             }
         }
 
+        // ================================================================
+        // Orbit representatives (Optional)
+        // 軌道代表元（オプション）
+        // ================================================================
+        // Orbit minimality is a property of each tree alone, so the
+        // per-partition results are disjoint and simply add up.
+        // 軌道最小性は各全域木単独の性質なので、パーティションごとの結果は
+        // 互いに素であり単純に足し合わせられる。
+        if (apply_representatives && part_non_overlapping != "0") {
+            auto start_reps = high_resolution_clock::now();
+
+            string part_reps = run_orbit_representatives(
+                dd, edge_permutations, num_edges, representatives_out, log);
+            representative_count = bigint_add(representative_count, part_reps);
+            log << "  Representatives in partition = " << part_reps << endl;
+
+            auto end_reps = high_resolution_clock::now();
+            representatives_time_ms += duration<double, milli>(end_reps - start_reps).count();
+        }
+
         // dd goes out of scope here — all ZDD memory for this partition is freed
         // dd はここでスコープを抜ける — このパーティションの全 ZDD メモリが解放される
     }
@@ -727,18 +1026,546 @@ void run_partitioned_pipeline(
 }
 
 // ============================================================================
-// main function
+// run_out_of_core_pipeline
 // ============================================================================
 //
-// Usage:
-//   Phase 4 only:     ./spanning_tree_zdd <polyhedron.grh>
-//   Phase 4+5:        ./spanning_tree_zdd <polyhedron.grh> <edge_sets.jsonl>
-//   Phase 4+6:        ./spanning_tree_zdd <polyhedron.grh> --automorphisms <file.json>
-//   Phase 4+5+6:      ./spanning_tree_zdd <polyhedron.grh> <edge_sets.jsonl> --automorphisms <file.json>
+// What this does:
+//   Phase 4 → 5 → 6 on one unpartitioned diagram kept in segment files
+//   under ws (--out-of-core). Phase 4 builds SpanningTree top-down and
+//   reduces it; each MOPE of Phase 5 builds the intersection of the stored
+//   diagram with its UnfoldingFilter and reduces that; Phase 6 counts the
+//   intersection with each SymmetryFilter (countPaths). Every pass walks
+//   the levels in order, so the node arrays are paged in from the files
+//   and out again by the kernel instead of being held on the heap.
+//   Returns false (with the error logged) if a segment file cannot be
+//   written.
+//
+// この処理の内容:
+//   ws のセグメントファイルに置いた分割なしの 1 つの ZDD 上で Phase 4 →
+//   5 → 6 を実行する（--out-of-core）。Phase 4 は SpanningTree をトップ
+//   ダウンに構築して既約化する。Phase 5 の各 MOPE は格納済み ZDD と
+//   UnfoldingFilter の共通部分を構築して既約化する。Phase 6 は各
+//   SymmetryFilter との共通部分を数える（countPaths）。全てのパスはレベル順に
+//   進むため、ノード配列はヒープに保持されず、カーネルがファイルから
+//   読み込み・追い出しを行う。セグメントファイルを書けなければ（エラーを
+//   ログに出して）false を返す。
 //
 // ============================================================================
-int main(int argc, char **argv) {
-    // ========================================================================
+bool run_out_of_core_pipeline(
+    const Graph& G,
+    int num_edges,
+    bool apply_filter,
+    const InputLoader::EdgeSets& MOPEs,
+    bool apply_burnside,
+    const vector<vector<int>>& edge_permutations,
+    const vector<bool>& zero_flags,
+    OutOfCore::Workspace& ws,
+    // Outputs:
+    string& spanning_tree_count,
+    string& non_overlapping_count,
+    vector<string>& invariant_counts,
+    string& burnside_sum,
+    uint64_t& phase4_nodes,
+    uint64_t& final_nodes,
+    double& build_time_ms,
+    double& subset_time_ms,
+    double& burnside_time_ms,
+    ostream& log
+) {
+    string error;
+    unique_ptr<OutOfCore::Diagram> dd(new OutOfCore::Diagram(ws, "phase4"));
+
+    // Phase 4: Spanning Tree Enumeration
+    // Phase 4: 全域木列挙
+    auto start_build = high_resolution_clock::now();
+    {
+        OutOfCore::Diagram raw(ws, "phase4-raw");
+        if (!OutOfCore::build(SpanningTree(G), raw, ws, error) ||
+            !OutOfCore::reduce(raw, *dd, ws, error)) {
+            log << "Error: " << error << endl;
+            return false;
+        }
+        log << "Phase 4: " << raw.size() << " nodes built, " << dd->size()
+             << " after reduction" << endl;
+    }
+    auto end_build = high_resolution_clock::now();
+    build_time_ms = duration<double, milli>(end_build - start_build).count();
+    phase4_nodes = dd->size();
+
+    if (!OutOfCore::count(*dd, ws, spanning_tree_count, error)) {
+        log << "Error: " << error << endl;
+        return false;
+    }
+    non_overlapping_count = spanning_tree_count;
+
+    // Phase 5: Filtering (Optional)
+    // Phase 5: フィルタリング（オプション）
+    if (apply_filter && MOPEs.size() > 0) {
+        auto start_subset = high_resolution_clock::now();
+        int total_mopes = MOPEs.size();
+        for (int i = 0; i < total_mopes; ++i) {
+            log << (i + 1) << "/" << total_mopes << endl;
+
+            UnfoldingFilter filter(num_edges, MOPEs.begin(i), MOPEs.end(i));
+            unique_ptr<OutOfCore::Diagram> next(new OutOfCore::Diagram(ws, "phase5"));
+            {
+                OutOfCore::Diagram raw(ws, "phase5-raw");
+                if (!OutOfCore::build(
+                        tdzdd::zddIntersection(OutOfCore::DiagramSpec(*dd), filter),
+                        raw, ws, error) ||
+                    !OutOfCore::reduce(raw, *next, ws, error)) {
+                    log << "Error: " << error << endl;
+                    return false;
+                }
+            }
+            dd = move(next);
+        }
+        auto end_subset = high_resolution_clock::now();
+        subset_time_ms = duration<double, milli>(end_subset - start_subset).count();
+
+        if (!OutOfCore::count(*dd, ws, non_overlapping_count, error)) {
+            log << "Error: " << error << endl;
+            return false;
+        }
+    }
+    final_nodes = dd->size();
+
+    // Phase 6: Nonisomorphic Counting (Optional)
+    // Phase 6: 非同型数え上げ（オプション）
+    if (apply_burnside) {
+        auto start_burnside = high_resolution_clock::now();
+        int total = edge_permutations.size();
+        bool has_zero_flags = ((int)zero_flags.size() == total);
+        burnside_sum = "0";
+
+        for (int i = 0; i < total; ++i) {
+            const vector<int>& perm = edge_permutations[i];
+
+            // Theorem 2 zero pre-filter / Theorem 2 ゼロ前処理フィルタ
+            if (has_zero_flags && zero_flags[i]) {
+                log << "Phase 6: automorphism " << (i + 1) << "/" << total
+                     << "  (skipped: Theorem 2) |T_g| = 0" << endl;
+                invariant_counts.push_back("0");
+                continue;
+            }
+
+            log << "Phase 6: automorphism " << (i + 1) << "/" << total << endl;
+
+            bool is_identity = isIdentity(perm);
+
+            // Only |T_g| is needed, so nothing is written for Phase 6
+            // 必要なのは |T_g| のみなので、Phase 6 では何も書き出さない
+            string count = non_overlapping_count;
+            if (!is_identity) {
+                SymmetryFilter sym_filter(num_edges, perm);
+                count = countPaths(
+                    tdzdd::zddIntersection(OutOfCore::DiagramSpec(*dd), sym_filter),
+                    ws.pool);
+            }
+            log << (is_identity ? "  (identity) |T_g| = " : "  |T_g| = ")
+                 << count << endl;
+
+            invariant_counts.push_back(count);
+            burnside_sum = bigint_add(burnside_sum, count);
+        }
+
+        auto end_burnside = high_resolution_clock::now();
+        burnside_time_ms = duration<double, milli>(end_burnside - start_burnside).count();
+    }
+
+    return true;
+}
+
+// ============================================================================
+// probe_split_depth
+// ============================================================================
+//
+// What this does:
+//   Pick the starting split depth for --max-memory. Builds the Phase 4
+//   diagram of PROBE_SAMPLES partitions at depth D = min(PROBE_DEPTH, max
+//   depth), then of their enclosing partitions one edge shallower at a
+//   time. After each level the geometric mean growth per edge since depth
+//   D is measured and the largest partition of the level is extrapolated
+//   to every depth (MemoryBudget::chooseSplitDepth). Climbing stops once
+//   the probe reaches the chosen depth, once the next level (at most twice
+//   as large) might exceed probe_limit, or once it would cost more than 1/8
+//   of the predicted run. probe_limit is the largest diagram the probe may
+//   build: the whole budget spent on one Phase 4 diagram.
+//
+// この処理の内容:
+//   --max-memory の開始分割深さを選ぶ。深さ D = min(PROBE_DEPTH, 最大深さ)
+//   の PROBE_SAMPLES 個のパーティションの Phase 4 ZDD を構築し、それを
+//   含むパーティションを 1 辺ずつ浅くしながら構築する。各段で深さ D から
+//   の辺 1 本あたりの増加率（幾何平均）を測り、その段の最大パーティション
+//   を各深さへ外挿する（MemoryBudget::chooseSplitDepth）。試行が選んだ
+//   深さに達したとき、次の段（高々 2 倍）が probe_limit を超えうるとき、
+//   または予測される本実行の 1/8 を超えるコストになるときに止める。
+//   probe_limit は試行が構築してよい最大の ZDD（予算全体を Phase 4 の
+//   ZDD 1 つに使う場合）。
+//
+// ============================================================================
+struct SplitProbe {
+    int probe_depth = 0;
+    uint64_t probe_nodes = 0;
+    double growth = 2.0;
+    uint64_t estimated_nodes = 0;
+    uint64_t probe_built_nodes = 0;
+    int split_depth = 0;
+    double probe_time_ms = 0.0;
+};
+
+SplitProbe probe_split_depth(const Graph& G, int num_edges,
+                             uint64_t node_budget, uint64_t probe_limit,
+                             ostream& log) {
+    SplitProbe probe;
+    const int max_depth = min(30, num_edges - 1);
+    if (max_depth < 1) return probe;
+
+    auto start_probe = high_resolution_clock::now();
+
+    // Samples spread over the partitions of the deepest probe level; the
+    // partition enclosing p at depth d is p with its bits >= d cleared
+    // 最深の試行段のパーティション全体に散らした標本。深さ d で p を含む
+    // パーティションは p の d ビット目以上を消したもの
+    int depth = min(MemoryBudget::PROBE_DEPTH, max_depth);
+    vector<int> samples;
+    for (int i = 0; i < MemoryBudget::PROBE_SAMPLES; ++i) {
+        samples.push_back(static_cast<int>(
+            ((i + 1) * 0x9E3779B97F4A7C15ULL) >> (64 - depth)));
+    }
+
+    auto largest_partition = [&](int d) -> uint64_t {
+        uint64_t largest = 0;
+        for (int p : samples) {
+            SpanningTree ST(G);
+            EdgeRestrictor restrictor(num_edges, d, p & ((1 << d) - 1));
+            tdzdd::DdStructure<2> dd(tdzdd::zddIntersection(ST, restrictor), true);
+            probe.probe_built_nodes += dd.size();
+            largest = max<uint64_t>(largest, dd.size());
+        }
+        return largest;
+    };
+
+    const int top = depth;
+    const uint64_t top_nodes = largest_partition(depth);
+    uint64_t nodes = top_nodes;
+    double growth = 2.0;
+    int chosen = MemoryBudget::chooseSplitDepth(
+        nodes, depth, growth, node_budget, max_depth, probe.estimated_nodes);
+    while (chosen < depth) {
+        if (nodes > 0) {
+            double next_cost = 2.0 * nodes * samples.size();
+            double run_cost = ldexp(double(probe.estimated_nodes), chosen);
+            if (2 * nodes > probe_limit
+                || probe.probe_built_nodes + next_cost > run_cost / 8) {
+                break;
+            }
+        }
+        --depth;
+        nodes = largest_partition(depth);
+        if (top_nodes > 0) {
+            growth = pow(double(nodes) / top_nodes, 1.0 / (top - depth));
+        }
+        chosen = MemoryBudget::chooseSplitDepth(
+            nodes, depth, growth, node_budget, max_depth, probe.estimated_nodes);
+    }
+
+    probe.probe_depth = depth;
+    probe.probe_nodes = nodes;
+    probe.growth = growth;
+    probe.split_depth = chosen;
+
+    auto end_probe = high_resolution_clock::now();
+    probe.probe_time_ms = duration<double, milli>(end_probe - start_probe).count();
+
+    log << "Memory probe: largest partition at depth " << depth << " has "
+         << nodes << " nodes, growth " << fixed << setprecision(2)
+         << growth << " per edge; split_depth " << chosen
+         << " (about " << probe.estimated_nodes << " nodes per partition, budget "
+         << node_budget << ")" << endl;
+    return probe;
+}
+
+// ============================================================================
+// run_estimate
+// ============================================================================
+//
+// What this does:
+//   --estimate: predict the diagrams with SizeEstimator instead of building
+//   them, and write the estimate as JSON. Phase 4 is SpanningTree itself.
+//   Each Phase 5 / Phase 6 pass intersects a diagram of that size with one
+//   filter. Up to PASS_SAMPLES MOPEs and automorphisms (neither identity
+//   nor zero by Theorem 2) are drawn at random, SpanningTree ∩ filter is
+//   estimated for each, and the mean is multiplied by the number of passes.
+//   The real passes run on the reduced, shrinking diagram, so these are
+//   upper estimates. Times are the estimated nodes times the expansion
+//   time per state measured while estimating; node tables and reduction
+//   make a real build several times slower, so they rank inputs rather
+//   than predict wall time. The memory needed follows the --max-memory
+//   model for the diagrams Phase 4 / Phase 5 build (Phase 6 only counts).
+//   With --max-memory, the smallest split depth that this model allows is
+//   reported too. Each fixed edge at most halves a partition, so the real
+//   depth is at least this.
+//
+// この処理の内容:
+//   --estimate: ZDD を構築せずに SizeEstimator で予測し、JSON で出力する。
+//   Phase 4 は SpanningTree そのもの。Phase 5 / Phase 6 の各パスはその大きさの
+//   ZDD と 1 つのフィルタの共通部分をとる。MOPE と（恒等でも Theorem 2 で
+//   ゼロでもない）自己同型を PASS_SAMPLES 個までランダムに選び、それぞれ
+//   SpanningTree ∩ フィルタを推定し、平均にパス数を掛ける。実際のパスは
+//   既約化され縮んでいく ZDD 上で行うため、これらは上からの推定。時間は推定
+//   ノード数に、推定中に測った状態あたりの展開時間を掛けたもの。ノード表と
+//   既約化のため実際の構築はその数倍遅く、壁時計時間の予測ではなく入力の
+//   比較に使う。必要メモリは Phase 4 / Phase 5 が構築する ZDD について
+//   --max-memory のモデルに従う（Phase 6 は数えるだけ）。
+//   --max-memory があれば、そのモデルが許す最小の分割深さも出力する。辺を
+//   1 本固定してもパーティションは高々半分になるため、実際の深さはこれ以上。
+//
+// ============================================================================
+struct PassEstimate {
+    uint64_t passes = 0;     // Passes in the run / 実行中のパス数
+    int sampled = 0;         // Passes estimated / 推定したパス数
+    double nodes = 0;        // Mean nodes per pass / パスあたりの平均ノード数
+    double ms = 0;           // Mean expansion time per pass / パスあたりの平均展開時間
+    double sets = 0;         // Mean sets per pass / パスあたりの平均集合数
+    double held = 0;         // Most states held by countPaths / countPaths が保持する最大状態数
+    size_t state_words = 0;  // Words per state / 状態あたりのワード数
+};
+
+static void write_pass_estimate(ostream& out, const char* name, const PassEstimate& pass,
+                                bool last) {
+    out << "    \"" << name << "\": {\"passes\": " << pass.passes
+         << ", \"sampled\": " << pass.sampled
+         << ", \"nodes_per_pass\": " << fixed << setprecision(0) << pass.nodes
+         << ", \"total_nodes\": " << pass.nodes * pass.passes
+         << ", \"expand_ms\": " << setprecision(2) << pass.ms * pass.passes
+         << ", \"sets_per_pass\": " << setprecision(0) << pass.sets
+         << ", \"peak_held_states\": " << pass.held << "}"
+         << (last ? "" : ",") << endl;
+}
+
+int run_estimate(
+    const Graph& G,
+    const string& grh_file,
+    int num_vertices,
+    int num_edges,
+    bool apply_filter,
+    const InputLoader::EdgeSets& MOPEs,
+    bool apply_burnside,
+    const vector<vector<int>>& edge_permutations,
+    const vector<bool>& zero_flags,
+    uint64_t max_memory,
+    uint64_t max_states,
+    uint64_t seed,
+    ostream& out,
+    ostream& log
+) {
+    log << "Estimating diagrams (at most " << max_states
+         << " states per level, seed " << seed << ")" << endl;
+    BufferPool pool;
+    SpanningTree ST(G);
+    SizeEstimator::Estimate phase4 = SizeEstimator::estimate(ST, pool, max_states, seed);
+    double phase4_ms = phase4.nodes * phase4.msPerState();
+
+    // Passes of Phase 5 / Phase 6, PASS_SAMPLES of each estimated
+    // Phase 5 / Phase 6 のパス。それぞれ PASS_SAMPLES 個を推定
+    vector<int> mopes, automorphisms;
+    if (apply_filter) {
+        for (int i = 0; i < (int)MOPEs.size(); ++i) mopes.push_back(i);
+    }
+    if (apply_burnside) {
+        bool has_zero_flags = zero_flags.size() == edge_permutations.size();
+        for (size_t i = 0; i < edge_permutations.size(); ++i) {
+            if (has_zero_flags && zero_flags[i]) continue;
+            const vector<int>& perm = edge_permutations[i];
+            if (!isIdentity(perm)) automorphisms.push_back((int)i);
+        }
+    }
+    mt19937_64 rng(seed);
+    auto estimatePasses = [&](vector<int> candidates, auto&& estimateOne) {
+        PassEstimate pass;
+        pass.passes = candidates.size();
+        shuffle(candidates.begin(), candidates.end(), rng);
+        for (int k = 0; k < (int)candidates.size() && k < SizeEstimator::PASS_SAMPLES; ++k) {
+            SizeEstimator::Estimate e = estimateOne(candidates[k]);
+            pass.nodes += e.nodes;
+            pass.ms += e.nodes * e.msPerState();
+            pass.sets += e.sets;
+            pass.held = max(pass.held, e.peak_held_nodes);
+            pass.state_words = e.state_words;
+            ++pass.sampled;
+        }
+        if (pass.sampled > 0) {
+            pass.nodes /= pass.sampled;
+            pass.ms /= pass.sampled;
+            pass.sets /= pass.sampled;
+        }
+        return pass;
+    };
+    PassEstimate phase5 = estimatePasses(mopes, [&](int i) {
+        UnfoldingFilter filter(num_edges, MOPEs.begin(i), MOPEs.end(i));
+        return SizeEstimator::estimate(tdzdd::zddIntersection(ST, filter), pool,
+                                       max_states, seed + 1 + i);
+    });
+    PassEstimate phase6 = estimatePasses(automorphisms, [&](int i) {
+        SymmetryFilter filter(num_edges, edge_permutations[i]);
+        return SizeEstimator::estimate(tdzdd::zddIntersection(ST, filter), pool,
+                                       max_states, seed + 1 + i);
+    });
+
+    int working_copies = MemoryBudget::workingCopies(apply_filter, apply_burnside, false);
+    double largest = max(phase4.nodes, phase5.nodes);
+    double memory_bytes = largest * MemoryBudget::BYTES_PER_NODE * working_copies;
+    // Phase 6 holds the diagram and the states of countPaths: state, path
+    // count and about two hash slots each
+    // Phase 6 は ZDD と countPaths の状態を保持する。各状態は状態、経路数、
+    // 約 2 個のハッシュスロット
+    double phase6_bytes = phase6.held * 8.0 * (phase6.state_words + num_edges / 64 + 1 + 2);
+    memory_bytes = max(memory_bytes, phase4.nodes * MemoryBudget::BYTES_PER_NODE + phase6_bytes);
+    double total_ms = phase4_ms + phase5.ms * phase5.passes + phase6.ms * phase6.passes;
+    uint64_t partition_nodes = 0;
+    int min_split_depth = 0;
+    if (max_memory > 0) {
+        min_split_depth = MemoryBudget::chooseSplitDepth(
+            (uint64_t)min(largest, 1.8e19), 0, 2.0,
+            MemoryBudget::nodeBudget(max_memory, working_copies),
+            max(0, min(30, num_edges - 1)), partition_nodes);
+    }
+
+    log << "Estimate: Phase 4 " << fixed << setprecision(0) << phase4.nodes << " nodes ("
+         << phase4.exact_levels << "/" << phase4.levels.size() << " levels exact); "
+         << phase5.passes << " Phase 5 passes of about " << phase5.nodes << " nodes; "
+         << phase6.passes << " Phase 6 passes of about " << phase6.nodes << " nodes" << endl;
+    log << "Estimate: about " << setprecision(2) << memory_bytes / (1024.0 * 1024 * 1024)
+         << " GiB, about " << setprecision(1) << total_ms / 1000
+         << " s of state expansion" << endl;
+
+    out << "{" << endl;
+    out << "  \"input_file\": \"" << grh_file << "\"," << endl;
+    out << "  \"vertices\": " << num_vertices << "," << endl;
+    out << "  \"edges\": " << num_edges << "," << endl;
+    out << "  \"estimate\": {" << endl;
+    out << "    \"max_states_per_level\": " << max_states << "," << endl;
+    out << "    \"seed\": " << seed << "," << endl;
+    out << "    \"phase4\": {" << endl;
+    out << "      \"exact\": " << (phase4.exact() ? "true" : "false") << "," << endl;
+    out << "      \"exact_levels\": " << phase4.exact_levels << "," << endl;
+    out << "      \"expanded_states\": " << phase4.expanded_states << "," << endl;
+    out << "      \"estimate_time_ms\": " << fixed << setprecision(2) << phase4.time_ms
+         << "," << endl;
+    out << "      \"nodes\": " << setprecision(0) << phase4.nodes << "," << endl;
+    out << "      \"peak_level_nodes\": " << phase4.peak_level_nodes << "," << endl;
+    out << "      \"spanning_tree_count\": " << phase4.sets << "," << endl;
+    out << "      \"expand_ms\": " << setprecision(2) << phase4_ms << "," << endl;
+    out << "      \"levels\": [" << endl;
+    for (size_t k = 0; k < phase4.levels.size(); ++k) {
+        const SizeEstimator::Level& level = phase4.levels[k];
+        out << "        {\"level\": " << level.level
+             << ", \"nodes\": " << setprecision(0) << level.nodes
+             << ", \"observed\": " << level.observed
+             << ", \"expanded\": " << level.expanded
+             << ", \"exponent\": " << setprecision(3) << level.exponent
+             << ", \"exact\": " << (level.exact ? "true" : "false") << "}"
+             << (k + 1 < phase4.levels.size() ? "," : "") << endl;
+    }
+    out << "      ]" << endl;
+    out << "    }," << endl;
+    write_pass_estimate(out, "phase5", phase5, false);
+    write_pass_estimate(out, "phase6", phase6, false);
+    if (apply_burnside && !apply_filter && !edge_permutations.empty()) {
+        // Burnside over all spanning trees: identity + sampled fixed counts
+        // 全域木に対する Burnside: 恒等写像 + 標本の固定集合数
+        out << "    \"nonisomorphic_count\": " << setprecision(0)
+             << (phase4.sets + phase6.sets * phase6.passes) / edge_permutations.size()
+             << "," << endl;
+    }
+    out << "    \"bytes_per_node\": " << MemoryBudget::BYTES_PER_NODE << "," << endl;
+    out << "    \"working_copies\": " << working_copies << "," << endl;
+    out << "    \"phase6_state_bytes\": " << setprecision(0) << phase6_bytes << "," << endl;
+    out << "    \"memory_bytes\": " << memory_bytes << "," << endl;
+    if (max_memory > 0) {
+        out << "    \"max_memory_bytes\": " << max_memory << "," << endl;
+        out << "    \"min_split_depth\": " << min_split_depth << "," << endl;
+    }
+    out << "    \"expand_ms\": " << setprecision(2) << total_ms << endl;
+    out << "  }" << endl;
+    out << "}" << endl;
+    return 0;
+}
+
+// ============================================================================
+// log_placement
+// ============================================================================
+//
+// One log line with the active memory placement (nothing when all defaults).
+// 有効なメモリ配置を 1 行でログに出す（全て既定値なら何もしない）。
+//
+// ============================================================================
+static void log_placement(ostream& log) {
+    const MemoryPlacement::Settings& placed = MemoryPlacement::active();
+    if (placed.numa == MemoryPlacement::Numa::Default && !placed.huge_pages
+        && !placed.pin_threads) {
+        return;
+    }
+    log << "Memory placement: numa " << MemoryPlacement::name(placed.numa)
+         << " (" << MemoryPlacement::nodeCount() << " node"
+         << (MemoryPlacement::nodeCount() == 1 ? "" : "s") << "), huge pages "
+         << (placed.huge_pages ? "on" : "off") << ", pinned threads "
+         << (placed.pin_threads ? "on" : "off") << endl;
+    if (placed.huge_pages && !MemoryPlacement::mallocHugePages()) {
+        log << "  (TdZdd node tables: start with GLIBC_TUNABLES=glibc.malloc.hugetlb=1"
+             << " to give them huge pages too)" << endl;
+    }
+}
+
+// ============================================================================
+// printUsage
+// ============================================================================
+//
+// The usage line of a single run (run_job).
+// 1 回の実行（run_job）の使い方の行。
+//
+// ============================================================================
+static void printUsage(ostream& log, const char* program) {
+    log << "Usage: " << program
+         << " <polyhedron.grh> [edge_sets.jsonl] [--automorphisms automorphisms.json]"
+         << " [--split-depth N] [--max-memory SIZE] [--out-of-core DIR]"
+         << " [--simd auto|scalar|sse2|avx2|avx512]"
+         << " [--numa default|interleave|first-touch] [--huge-pages] [--pin-threads]"
+         << " [--representatives] [--export-representatives out.jsonl]"
+         << " [--sample N --sample-output out] [--sample-format jsonl|binary]"
+         << " [--sample-seed S] [--sample-threads T]"
+         << " [--export-range A:B --range-output out.jsonl]"
+         << " [--rank-edges in.jsonl --rank-output out.jsonl]"
+         << " [--export-all out.stze] [--export-encoding delta|bitset]"
+         << " [--export-threads T]"
+         << " [--estimate [--estimate-states N] [--estimate-seed S]]"
+         << endl;
+}
+
+// ============================================================================
+// run_job
+// ============================================================================
+//
+// One run of the pipeline for the command line argv: the JSON result goes
+// to `out`, progress and errors to `log`. Holds no shared state apart from
+// the bitmask kernel table, which a batch (batch = true) selects once
+// before starting its jobs. Returns the exit status.
+//
+// コマンドライン argv に対するパイプラインの 1 回の実行: JSON の結果は
+// `out`、進捗とエラーは `log` へ。ビットマスクカーネル表以外に共有状態を
+// 持たず、バッチ（batch = true）ではジョブ開始前に 1 回だけ選択する。
+// 終了ステータスを返す。
+//
+// Usage:
+//   Phase 4 only:     ./spanning_tree_zdd <polyhedron.grh>
+//   Phase 4+5:        ./spanning_tree_zdd <polyhedron.grh> <edge_sets.jsonl>
+//   Phase 4+6:        ./spanning_tree_zdd <polyhedron.grh> --automorphisms <file.json>
+//   Phase 4+5+6:      ./spanning_tree_zdd <polyhedron.grh> <edge_sets.jsonl> --automorphisms <file.json>
+//
+// ============================================================================
+int run_job(int argc, char **argv, ostream& out, ostream& log, bool batch) {
+    // ========================================================================
     // Argument parsing
     // 引数解析
     // ========================================================================
@@ -746,6 +1573,28 @@ int main(int argc, char **argv) {
     string edge_sets_file;
     string automorphisms_file;
     int split_depth = 0;
+    bool split_depth_given = false;
+    uint64_t max_memory = 0;
+    string out_of_core_dir;
+    string simd = "auto";
+    MemoryPlacement::Settings placement;
+    bool apply_representatives = false;
+    string representatives_file;
+    uint64_t num_samples = 0;
+    string sample_file;
+    string sample_format = "jsonl";
+    uint64_t sample_seed = 0;
+    int sample_threads = 1;
+    string range_first, range_last;
+    string range_file;
+    string rank_input_file;
+    string rank_file;
+    string export_file;
+    string export_encoding = "delta";
+    int export_threads = 1;
+    bool apply_estimate = false;
+    uint64_t estimate_states = 100000;
+    uint64_t estimate_seed = 0;
 
     for (int i = 1; i < argc; i++) {
         string arg = argv[i];
@@ -754,56 +1603,231 @@ int main(int argc, char **argv) {
         } else if (arg == "--split-depth" && i + 1 < argc) {
             split_depth = stoi(argv[++i]);
             if (split_depth < 0 || split_depth > 30) {
-                cerr << "Error: split-depth must be between 0 and 30" << endl;
+                log << "Error: split-depth must be between 0 and 30" << endl;
                 return 1;
             }
+            split_depth_given = true;
+        } else if (arg == "--max-memory" && i + 1 < argc) {
+            if (!MemoryBudget::parseBytes(argv[++i], max_memory)) {
+                log << "Error: --max-memory expects a size such as 4096, 512M or 8G" << endl;
+                return 1;
+            }
+        } else if (arg == "--out-of-core" && i + 1 < argc) {
+            out_of_core_dir = argv[++i];
+        } else if (arg == "--simd" && i + 1 < argc) {
+            if (batch) {
+                log << "Error: --simd applies to the whole batch, not to one job" << endl;
+                return 1;
+            }
+            simd = argv[++i];
+        } else if ((arg == "--numa" && i + 1 < argc) || arg == "--huge-pages"
+                   || arg == "--pin-threads") {
+            if (batch) {
+                log << "Error: " << arg << " applies to the whole batch, not to one job" << endl;
+                return 1;
+            }
+            if (arg == "--huge-pages") {
+                placement.huge_pages = true;
+            } else if (arg == "--pin-threads") {
+                placement.pin_threads = true;
+            } else if (!MemoryPlacement::parseNuma(argv[++i], placement.numa)) {
+                log << "Error: --numa expects default, interleave or first-touch" << endl;
+                return 1;
+            }
+        } else if (arg == "--representatives") {
+            apply_representatives = true;
+        } else if (arg == "--export-representatives" && i + 1 < argc) {
+            apply_representatives = true;
+            representatives_file = argv[++i];
+        } else if (arg == "--sample" && i + 1 < argc) {
+            num_samples = stoull(argv[++i]);
+        } else if (arg == "--sample-output" && i + 1 < argc) {
+            sample_file = argv[++i];
+        } else if (arg == "--sample-format" && i + 1 < argc) {
+            sample_format = argv[++i];
+        } else if (arg == "--sample-seed" && i + 1 < argc) {
+            sample_seed = stoull(argv[++i]);
+        } else if (arg == "--sample-threads" && i + 1 < argc) {
+            sample_threads = stoi(argv[++i]);
+        } else if (arg == "--export-range" && i + 1 < argc) {
+            string range = argv[++i];
+            size_t colon = range.find(':');
+            if (colon == string::npos) {
+                log << "Error: --export-range expects A:B" << endl;
+                return 1;
+            }
+            range_first = range.substr(0, colon);
+            range_last = range.substr(colon + 1);
+        } else if (arg == "--range-output" && i + 1 < argc) {
+            range_file = argv[++i];
+        } else if (arg == "--rank-edges" && i + 1 < argc) {
+            rank_input_file = argv[++i];
+        } else if (arg == "--rank-output" && i + 1 < argc) {
+            rank_file = argv[++i];
+        } else if (arg == "--export-all" && i + 1 < argc) {
+            export_file = argv[++i];
+        } else if (arg == "--export-encoding" && i + 1 < argc) {
+            export_encoding = argv[++i];
+        } else if (arg == "--export-threads" && i + 1 < argc) {
+            export_threads = stoi(argv[++i]);
+        } else if (arg == "--estimate") {
+            apply_estimate = true;
+        } else if (arg == "--estimate-states" && i + 1 < argc) {
+            estimate_states = stoull(argv[++i]);
+        } else if (arg == "--estimate-seed" && i + 1 < argc) {
+            estimate_seed = stoull(argv[++i]);
         } else if (grh_file.empty()) {
             grh_file = arg;
         } else if (edge_sets_file.empty()) {
             edge_sets_file = arg;
         } else {
-            cerr << "Error: Unexpected argument: " << arg << endl;
-            cerr << "Usage: " << argv[0]
-                 << " <polyhedron.grh> [edge_sets.jsonl] [--automorphisms automorphisms.json]"
-                 << " [--split-depth N]"
-                 << endl;
+            log << "Error: Unexpected argument: " << arg << endl;
+            printUsage(log, argv[0]);
             return 1;
         }
     }
 
     if (grh_file.empty()) {
-        cerr << "Usage: " << argv[0]
-             << " <polyhedron.grh> [edge_sets.jsonl] [--automorphisms automorphisms.json]"
-             << " [--split-depth N]"
-             << endl;
+        printUsage(log, argv[0]);
         return 1;
     }
 
     bool apply_filter = !edge_sets_file.empty();
     bool apply_burnside = !automorphisms_file.empty();
 
+    if (apply_representatives && !apply_burnside) {
+        log << "Error: --representatives requires --automorphisms" << endl;
+        return 1;
+    }
+
+    bool apply_sampling = num_samples > 0;
+    if (apply_sampling) {
+        if (sample_file.empty()) {
+            log << "Error: --sample requires --sample-output" << endl;
+            return 1;
+        }
+        if (sample_format != "jsonl" && sample_format != "binary") {
+            log << "Error: --sample-format must be jsonl or binary" << endl;
+            return 1;
+        }
+        if (sample_threads < 1) {
+            log << "Error: --sample-threads must be at least 1" << endl;
+            return 1;
+        }
+    }
+
+    bool apply_range = !range_first.empty() || !range_last.empty();
+    bool apply_rank = !rank_input_file.empty();
+    if (apply_range && range_file.empty()) {
+        log << "Error: --export-range requires --range-output" << endl;
+        return 1;
+    }
+    if (apply_rank && rank_file.empty()) {
+        log << "Error: --rank-edges requires --rank-output" << endl;
+        return 1;
+    }
+
+    bool apply_export = !export_file.empty();
+    if (apply_export) {
+        if (export_encoding != "delta" && export_encoding != "bitset") {
+            log << "Error: --export-encoding must be delta or bitset" << endl;
+            return 1;
+        }
+        if (export_threads < 1) {
+            log << "Error: --export-threads must be at least 1" << endl;
+            return 1;
+        }
+    }
+
+    bool apply_index = apply_sampling || apply_range || apply_rank || apply_export;
+    if (apply_index && split_depth > 0) {
+        // Partitions are never held at once, so there is no single ZDD
+        // パーティションは同時に保持されないため単一の ZDD がない
+        log << "Error: --sample, --export-range, --rank-edges and --export-all"
+             << " are not supported with --split-depth" << endl;
+        return 1;
+    }
+    if (apply_index && max_memory > 0) {
+        // --max-memory may split the diagram at any point
+        // --max-memory はいつでも ZDD を分割しうる
+        log << "Error: --sample, --export-range, --rank-edges and --export-all"
+             << " are not supported with --max-memory" << endl;
+        return 1;
+    }
+    bool apply_out_of_core = !out_of_core_dir.empty();
+    if (apply_out_of_core && (split_depth > 0 || max_memory > 0)) {
+        // One unpartitioned diagram is the point of --out-of-core
+        // --out-of-core は分割しない 1 つの ZDD のためのもの
+        log << "Error: --split-depth and --max-memory are not supported with --out-of-core"
+             << endl;
+        return 1;
+    }
+    if (apply_out_of_core && (apply_index || apply_representatives)) {
+        log << "Error: --representatives, --sample, --export-range, --rank-edges"
+             << " and --export-all are not supported with --out-of-core" << endl;
+        return 1;
+    }
+    if (apply_estimate && (split_depth > 0 || apply_out_of_core || apply_index
+                           || apply_representatives)) {
+        // --estimate builds nothing; --max-memory only sizes the split depth
+        // --estimate は何も構築しない。--max-memory は分割深さの見積もりのみに使う
+        log << "Error: --split-depth, --out-of-core, --representatives, --sample,"
+             << " --export-range, --rank-edges and --export-all are not supported"
+             << " with --estimate" << endl;
+        return 1;
+    }
+    if (apply_estimate && estimate_states < 2) {
+        log << "Error: --estimate-states must be at least 2" << endl;
+        return 1;
+    }
+
+    // ========================================================================
+    // Select bitmask kernels (auto-detected unless --simd is given; a batch
+    // selects them once for all jobs)
+    // ビットマスクカーネルの選択（--simd 指定がなければ自動検出。バッチでは
+    // 全ジョブに対して 1 回だけ選択）
+    // ========================================================================
+    if (!batch && !BitKernels::select(simd)) {
+        log << "Error: SIMD kernel '" << simd
+             << "' is unknown or not supported by this CPU"
+             << " (choose auto, scalar, sse2, avx2, avx512)" << endl;
+        return 1;
+    }
+    log << "Bitmask kernels: " << BitKernels::active().name << endl;
+
+    // ========================================================================
+    // Memory placement (NUMA policy, huge pages, pinning), process-wide like
+    // the kernels and installed before any worker thread starts
+    // メモリ配置（NUMA ポリシー、ヒュージページ、固定）。カーネルと同様に
+    // プロセス全体に対し、ワーカスレッドの起動前に設定
+    // ========================================================================
+    if (!batch) {
+        string placement_error;
+        if (!MemoryPlacement::apply(placement, placement_error)) {
+            log << "Error: " << placement_error << endl;
+            return 1;
+        }
+    }
+    log_placement(log);
+
     // ========================================================================
     // Load graph
     // グラフの読み込み
     // ========================================================================
     Graph G;
-    G.readEdges(grh_file);
+    string load_error;
+    if (!InputLoader::loadGraph(grh_file, G, load_error)) {
+        log << "Error: " << load_error << endl;
+        return 1;
+    }
 
     int num_vertices = G.vertexSize();
     int num_edges = G.edgeSize();
 
-    // Check maximum supported edge count
-    // サポートする最大辺数をチェック
-    if (num_edges > 448) {
-        cerr << "Error: Edge count (" << num_edges
-             << ") exceeds maximum supported (448)." << endl;
-        return 1;
-    }
-
     // Validate split_depth against num_edges
     // split_depth が辺数に対して妥当かチェック
     if (split_depth > 0 && split_depth >= num_edges) {
-        cerr << "Error: split-depth (" << split_depth
+        log << "Error: split-depth (" << split_depth
              << ") must be less than num_edges (" << num_edges << ")" << endl;
         return 1;
     }
@@ -812,13 +1836,26 @@ int main(int argc, char **argv) {
     // Load MOPEs (if needed)
     // MOPEs の読み込み（必要な場合）
     // ========================================================================
-    vector<set<int>> MOPEs;
+    InputLoader::EdgeSets MOPEs;
     int num_mopes = 0;
     if (apply_filter) {
-        MOPEs = load_mopes_from_edge_sets(edge_sets_file);
+        if (!InputLoader::loadEdgeSets(edge_sets_file, MOPEs, load_error)) {
+            log << "Error: " << load_error << endl;
+            log << "Error: Failed to load MOPEs from "
+                 << edge_sets_file << endl;
+            return 1;
+        }
+        if (MOPEs.num_edges != 0 && MOPEs.num_edges != num_edges) {
+            log << "Error: Edge-set file is for " << MOPEs.num_edges
+                 << " edges, graph has " << num_edges << endl;
+            return 1;
+        }
+        for (size_t line_num : MOPEs.empty_lines) {
+            log << "Warning: Empty edge set at line " << line_num << endl;
+        }
         num_mopes = MOPEs.size();
         if (num_mopes == 0) {
-            cerr << "Warning: No MOPEs loaded from " << edge_sets_file << endl;
+            log << "Warning: No MOPEs loaded from " << edge_sets_file << endl;
         }
     }
 
@@ -826,40 +1863,109 @@ int main(int argc, char **argv) {
     // Load automorphisms (if needed)
     // 自己同型の読み込み（必要な場合）
     // ========================================================================
-    int group_order = 0;
-    vector<vector<int>> edge_permutations;
-    vector<bool> zero_flags;
+    InputLoader::Automorphisms automorphisms;
+    int& group_order = automorphisms.group_order;
+    vector<vector<int>>& edge_permutations = automorphisms.edge_permutations;
+    vector<bool>& zero_flags = automorphisms.zero_flags;
 
     if (apply_burnside) {
-        if (!load_automorphisms(automorphisms_file, group_order, edge_permutations, zero_flags)) {
-            cerr << "Error: Failed to load automorphisms from "
+        if (!InputLoader::loadAutomorphisms(automorphisms_file, automorphisms, load_error)) {
+            log << "Error: " << load_error << endl;
+            log << "Error: Failed to load automorphisms from "
                  << automorphisms_file << endl;
             return 1;
         }
 
-        cerr << "Loaded " << edge_permutations.size()
+        log << "Loaded " << edge_permutations.size()
              << " automorphisms (group order " << group_order << ")" << endl;
         if (!zero_flags.empty()) {
             int num_zero = 0;
             for (bool z : zero_flags) if (z) num_zero++;
-            cerr << "Theorem 2 pre-filter: " << num_zero << "/"
+            log << "Theorem 2 pre-filter: " << num_zero << "/"
                  << zero_flags.size() << " marked as zero" << endl;
         }
 
         if ((int)edge_permutations.size() != group_order) {
-            cerr << "Warning: Number of permutations (" << edge_permutations.size()
+            log << "Warning: Number of permutations (" << edge_permutations.size()
                  << ") != group_order (" << group_order << ")" << endl;
         }
 
         for (const auto& perm : edge_permutations) {
             if ((int)perm.size() != num_edges) {
-                cerr << "Error: Permutation size (" << perm.size()
+                log << "Error: Permutation size (" << perm.size()
                      << ") != num_edges (" << num_edges << ")" << endl;
                 return 1;
             }
         }
     }
 
+    // ========================================================================
+    // Estimate only: predict the diagram instead of building it
+    // 推定のみ: ZDD を構築せずに予測する
+    // ========================================================================
+    if (apply_estimate) {
+        return run_estimate(G, grh_file, num_vertices, num_edges, apply_filter, MOPEs,
+                            apply_burnside, edge_permutations, zero_flags, max_memory,
+                            estimate_states, estimate_seed, out, log);
+    }
+
+    // ========================================================================
+    // Open representatives output (if needed)
+    // 代表元の出力先を開く（必要な場合）
+    // ========================================================================
+    ofstream representatives_stream;
+    ostream* representatives_out = nullptr;
+    if (!representatives_file.empty()) {
+        representatives_stream.open(representatives_file);
+        if (!representatives_stream.is_open()) {
+            log << "Error: Could not open " << representatives_file << endl;
+            return 1;
+        }
+        representatives_out = &representatives_stream;
+    }
+
+    ofstream sample_stream;
+    if (apply_sampling) {
+        sample_stream.open(sample_file, ios::binary);
+        if (!sample_stream.is_open()) {
+            log << "Error: Could not open " << sample_file << endl;
+            return 1;
+        }
+    }
+
+    ofstream range_stream;
+    if (apply_range) {
+        range_stream.open(range_file);
+        if (!range_stream.is_open()) {
+            log << "Error: Could not open " << range_file << endl;
+            return 1;
+        }
+    }
+
+    ofstream export_stream;
+    if (apply_export) {
+        export_stream.open(export_file, ios::binary);
+        if (!export_stream.is_open()) {
+            log << "Error: Could not open " << export_file << endl;
+            return 1;
+        }
+    }
+
+    ifstream rank_input;
+    ofstream rank_stream;
+    if (apply_rank) {
+        rank_input.open(rank_input_file);
+        if (!rank_input.is_open()) {
+            log << "Error: Could not open " << rank_input_file << endl;
+            return 1;
+        }
+        rank_stream.open(rank_file);
+        if (!rank_stream.is_open()) {
+            log << "Error: Could not open " << rank_file << endl;
+            return 1;
+        }
+    }
+
     // ========================================================================
     // Pipeline execution
     // パイプライン実行
@@ -870,79 +1976,109 @@ int main(int argc, char **argv) {
     vector<string> invariant_counts;
     string burnside_sum;
     string nonisomorphic_count;
+    string representative_count;
     double build_time_ms = 0.0;
     double subset_time_ms = 0.0;
     double burnside_time_ms = 0.0;
+    double representatives_time_ms = 0.0;
+    double index_time_ms = 0.0;
+    double sample_time_ms = 0.0;
+    double range_time_ms = 0.0;
+    double rank_time_ms = 0.0;
+    int index_words = 0;
+    string range_count;
+    uint64_t ranked_count = 0;
+    uint64_t non_member_count = 0;
+    double export_time_ms = 0.0;
+    uint64_t export_count = 0;
+    uint64_t phase4_nodes = 0;
+    uint64_t final_nodes = 0;
+    BufferPool pool;
+    OutOfCore::Workspace out_of_core(pool);
+
+    // Memory budget: probe for the starting split depth unless one is given
+    // メモリ予算: 分割深さの指定がなければ試行で開始深さを決める
+    int working_copies = 0;
+    uint64_t node_budget = 0;
+    SplitProbe probe;
+    PartitionStats partition_stats;
+    if (max_memory > 0) {
+        working_copies = MemoryBudget::workingCopies(
+            apply_filter, apply_burnside, apply_representatives);
+        node_budget = MemoryBudget::nodeBudget(max_memory, working_copies);
+        if (!split_depth_given) {
+            probe = probe_split_depth(G, num_edges, node_budget,
+                                      node_budget * working_copies, log);
+            split_depth = probe.split_depth;
+        }
+    }
 
-    if (split_depth > 0) {
+    if (apply_out_of_core) {
         // ==================================================================
-        // Partitioned pipeline: Phase 4 → 5 → 6 per partition
-        // 分割パイプライン: パーティションごとに Phase 4 → 5 → 6
+        // Out-of-core pipeline: one diagram paged from segment files
+        // メモリ外パイプライン: セグメントファイルからページングする 1 つの ZDD
         // ==================================================================
-        cerr << "Running partitioned pipeline with split_depth=" << split_depth
-             << " (" << (1 << split_depth) << " partitions)" << endl;
+        if (!out_of_core.open(out_of_core_dir, load_error)) {
+            log << "Error: " << load_error << endl;
+            return 1;
+        }
+        log << "Running out-of-core pipeline in " << out_of_core_dir << endl;
 
-        if (num_edges <= 64) {
-            run_partitioned_pipeline<uint64_t>(
-                G, num_edges, split_depth,
-                apply_filter, MOPEs, apply_burnside, edge_permutations, zero_flags,
-                spanning_tree_count, non_overlapping_count,
-                invariant_counts, burnside_sum,
-                build_time_ms, subset_time_ms, burnside_time_ms);
-        } else if (num_edges <= 128) {
-            run_partitioned_pipeline<BigUInt<2>>(
-                G, num_edges, split_depth,
-                apply_filter, MOPEs, apply_burnside, edge_permutations, zero_flags,
-                spanning_tree_count, non_overlapping_count,
-                invariant_counts, burnside_sum,
-                build_time_ms, subset_time_ms, burnside_time_ms);
-        } else if (num_edges <= 192) {
-            run_partitioned_pipeline<BigUInt<3>>(
-                G, num_edges, split_depth,
+        if (!run_out_of_core_pipeline(
+                G, num_edges,
                 apply_filter, MOPEs, apply_burnside, edge_permutations, zero_flags,
+                out_of_core,
                 spanning_tree_count, non_overlapping_count,
-                invariant_counts, burnside_sum,
-                build_time_ms, subset_time_ms, burnside_time_ms);
-        } else if (num_edges <= 256) {
-            run_partitioned_pipeline<BigUInt<4>>(
-                G, num_edges, split_depth,
-                apply_filter, MOPEs, apply_burnside, edge_permutations, zero_flags,
-                spanning_tree_count, non_overlapping_count,
-                invariant_counts, burnside_sum,
-                build_time_ms, subset_time_ms, burnside_time_ms);
-        } else if (num_edges <= 320) {
-            run_partitioned_pipeline<BigUInt<5>>(
-                G, num_edges, split_depth,
-                apply_filter, MOPEs, apply_burnside, edge_permutations, zero_flags,
-                spanning_tree_count, non_overlapping_count,
-                invariant_counts, burnside_sum,
-                build_time_ms, subset_time_ms, burnside_time_ms);
-        } else if (num_edges <= 384) {
-            run_partitioned_pipeline<BigUInt<6>>(
-                G, num_edges, split_depth,
-                apply_filter, MOPEs, apply_burnside, edge_permutations, zero_flags,
-                spanning_tree_count, non_overlapping_count,
-                invariant_counts, burnside_sum,
-                build_time_ms, subset_time_ms, burnside_time_ms);
+                invariant_counts, burnside_sum, phase4_nodes, final_nodes,
+                build_time_ms, subset_time_ms, burnside_time_ms, log)) {
+            return 1;
+        }
+
+        // Finalize Burnside result
+        // Burnside 結果の最終計算
+        if (apply_burnside) {
+            int remainder = 0;
+            nonisomorphic_count = bigint_divide(burnside_sum, group_order, remainder);
+            if (remainder != 0) {
+                log << "WARNING: Burnside sum " << burnside_sum
+                     << " is not divisible by group order " << group_order
+                     << " (remainder = " << remainder << ")" << endl;
+                log << "This indicates a bug in the computation!" << endl;
+            }
+        }
+
+    } else if (split_depth > 0 || max_memory > 0) {
+        // ==================================================================
+        // Partitioned pipeline: Phase 4 → 5 → 6 per partition
+        // 分割パイプライン: パーティションごとに Phase 4 → 5 → 6
+        // ==================================================================
+        if (max_memory > 0) {
+            log << "Running partitioned pipeline from split_depth=" << split_depth
+                 << " (budget " << node_budget << " nodes per partition)" << endl;
         } else {
-            run_partitioned_pipeline<BigUInt<7>>(
-                G, num_edges, split_depth,
-                apply_filter, MOPEs, apply_burnside, edge_permutations, zero_flags,
-                spanning_tree_count, non_overlapping_count,
-                invariant_counts, burnside_sum,
-                build_time_ms, subset_time_ms, burnside_time_ms);
+            log << "Running partitioned pipeline with split_depth=" << split_depth
+                 << " (" << (1 << split_depth) << " partitions)" << endl;
         }
 
+        run_partitioned_pipeline(
+            G, num_edges, split_depth,
+            apply_filter, MOPEs, apply_burnside, edge_permutations, zero_flags,
+            apply_representatives, representatives_out, node_budget, pool,
+            spanning_tree_count, non_overlapping_count,
+            invariant_counts, burnside_sum, representative_count,
+            build_time_ms, subset_time_ms, burnside_time_ms,
+            representatives_time_ms, partition_stats, log);
+
         // Finalize Burnside result
         // Burnside 結果の最終計算
         if (apply_burnside) {
             int remainder = 0;
             nonisomorphic_count = bigint_divide(burnside_sum, group_order, remainder);
             if (remainder != 0) {
-                cerr << "WARNING: Burnside sum " << burnside_sum
+                log << "WARNING: Burnside sum " << burnside_sum
                      << " is not divisible by group order " << group_order
                      << " (remainder = " << remainder << ")" << endl;
-                cerr << "This indicates a bug in the computation!" << endl;
+                log << "This indicates a bug in the computation!" << endl;
             }
         }
 
@@ -963,6 +2099,7 @@ int main(int argc, char **argv) {
         tdzdd::DdStructure<2> dd(ST, true);
         auto end_build = high_resolution_clock::now();
         build_time_ms = duration<double, milli>(end_build - start_build).count();
+        phase4_nodes = dd.size();
 
         spanning_tree_count = dd.zddCardinality();
 
@@ -973,21 +2110,7 @@ int main(int argc, char **argv) {
         if (apply_filter && num_mopes > 0) {
             auto start_subset = high_resolution_clock::now();
 
-            if (num_edges <= 64) {
-                run_filtering_with_bitmask<uint64_t>(dd, MOPEs, num_edges);
-            } else if (num_edges <= 128) {
-                run_filtering_with_bitmask<BigUInt<2>>(dd, MOPEs, num_edges);
-            } else if (num_edges <= 192) {
-                run_filtering_with_bitmask<BigUInt<3>>(dd, MOPEs, num_edges);
-            } else if (num_edges <= 256) {
-                run_filtering_with_bitmask<BigUInt<4>>(dd, MOPEs, num_edges);
-            } else if (num_edges <= 320) {
-                run_filtering_with_bitmask<BigUInt<5>>(dd, MOPEs, num_edges);
-            } else if (num_edges <= 384) {
-                run_filtering_with_bitmask<BigUInt<6>>(dd, MOPEs, num_edges);
-            } else {
-                run_filtering_with_bitmask<BigUInt<7>>(dd, MOPEs, num_edges);
-            }
+            run_filtering(dd, MOPEs, num_edges, log);
 
             auto end_subset = high_resolution_clock::now();
             subset_time_ms = duration<double, milli>(end_subset - start_subset).count();
@@ -1000,39 +2123,100 @@ int main(int argc, char **argv) {
         if (apply_burnside) {
             auto start_burnside = high_resolution_clock::now();
 
-            if (num_edges <= 64) {
-                run_burnside_with_bitmask<uint64_t>(
-                    dd, edge_permutations, zero_flags, group_order, num_edges,
-                    invariant_counts, burnside_sum, nonisomorphic_count);
-            } else if (num_edges <= 128) {
-                run_burnside_with_bitmask<BigUInt<2>>(
-                    dd, edge_permutations, zero_flags, group_order, num_edges,
-                    invariant_counts, burnside_sum, nonisomorphic_count);
-            } else if (num_edges <= 192) {
-                run_burnside_with_bitmask<BigUInt<3>>(
-                    dd, edge_permutations, zero_flags, group_order, num_edges,
-                    invariant_counts, burnside_sum, nonisomorphic_count);
-            } else if (num_edges <= 256) {
-                run_burnside_with_bitmask<BigUInt<4>>(
-                    dd, edge_permutations, zero_flags, group_order, num_edges,
-                    invariant_counts, burnside_sum, nonisomorphic_count);
-            } else if (num_edges <= 320) {
-                run_burnside_with_bitmask<BigUInt<5>>(
-                    dd, edge_permutations, zero_flags, group_order, num_edges,
-                    invariant_counts, burnside_sum, nonisomorphic_count);
-            } else if (num_edges <= 384) {
-                run_burnside_with_bitmask<BigUInt<6>>(
-                    dd, edge_permutations, zero_flags, group_order, num_edges,
-                    invariant_counts, burnside_sum, nonisomorphic_count);
-            } else {
-                run_burnside_with_bitmask<BigUInt<7>>(
-                    dd, edge_permutations, zero_flags, group_order, num_edges,
-                    invariant_counts, burnside_sum, nonisomorphic_count);
-            }
+            run_burnside(
+                dd, edge_permutations, zero_flags, group_order, num_edges, pool,
+                invariant_counts, burnside_sum, nonisomorphic_count, log);
 
             auto end_burnside = high_resolution_clock::now();
             burnside_time_ms = duration<double, milli>(end_burnside - start_burnside).count();
         }
+
+        // Orbit representatives (Optional)
+        // 軌道代表元（オプション）
+        if (apply_representatives) {
+            auto start_reps = high_resolution_clock::now();
+
+            representative_count = run_orbit_representatives(
+                dd, edge_permutations, num_edges, representatives_out, log);
+
+            auto end_reps = high_resolution_clock::now();
+            representatives_time_ms = duration<double, milli>(end_reps - start_reps).count();
+        }
+
+        // Index of the final family: sampling, slices, ranks (Optional)
+        // 最終的な族の番号付け: サンプリング、区間、順位（オプション）
+        if (apply_index) {
+            auto start_index = high_resolution_clock::now();
+            ZddIndex index(dd, num_edges);
+            index_words = index.countWords();
+            auto end_index = high_resolution_clock::now();
+            index_time_ms = duration<double, milli>(end_index - start_index).count();
+
+            if (apply_sampling) {
+                auto start_sample = high_resolution_clock::now();
+
+                if (!run_sampling(index, num_samples, sample_seed,
+                                  sample_threads, sample_format == "binary",
+                                  sample_stream, log)) {
+                    log << "Error: Failed to write samples to " << sample_file << endl;
+                    return 1;
+                }
+
+                auto end_sample = high_resolution_clock::now();
+                sample_time_ms = duration<double, milli>(end_sample - start_sample).count();
+            }
+
+            if (apply_range) {
+                auto start_range = high_resolution_clock::now();
+
+                if (!run_export_range(index, range_first, range_last,
+                                      range_stream, range_count, log)) {
+                    return 1;
+                }
+
+                auto end_range = high_resolution_clock::now();
+                range_time_ms = duration<double, milli>(end_range - start_range).count();
+            }
+
+            if (apply_rank) {
+                auto start_rank = high_resolution_clock::now();
+
+                if (!run_rank_edges(index, rank_input, rank_stream,
+                                    ranked_count, non_member_count)) {
+                    log << "Error: Failed to write ranks to " << rank_file << endl;
+                    return 1;
+                }
+
+                auto end_rank = high_resolution_clock::now();
+                rank_time_ms = duration<double, milli>(end_rank - start_rank).count();
+            }
+
+            if (apply_export) {
+                auto start_export = high_resolution_clock::now();
+
+                TreeExport::Encoding encoding = (export_encoding == "bitset")
+                    ? TreeExport::BITSET : TreeExport::DELTA;
+                if (!run_export_all(index, encoding, export_threads,
+                                    export_stream, export_count, log)) {
+                    log << "Error: Failed to export trees to " << export_file << endl;
+                    return 1;
+                }
+
+                auto end_export = high_resolution_clock::now();
+                export_time_ms = duration<double, milli>(end_export - start_export).count();
+            }
+        }
+    }
+
+    // Cross-check the orbit representatives against Burnside
+    // 軌道代表元の個数を Burnside の結果と照合
+    if (apply_representatives) {
+        log << "Orbit representatives: " << representative_count << endl;
+        if (representative_count != nonisomorphic_count) {
+            log << "WARNING: representative count " << representative_count
+                 << " != Burnside nonisomorphic count " << nonisomorphic_count << endl;
+            log << "This indicates a bug in the computation!" << endl;
+        }
     }
 
     // ========================================================================
@@ -1040,65 +2224,479 @@ int main(int argc, char **argv) {
     // JSON 出力
     // ========================================================================
 
-    cout << "{" << endl;
-    cout << "  \"input_file\": \"" << grh_file << "\"," << endl;
-    cout << "  \"vertices\": " << num_vertices << "," << endl;
-    cout << "  \"edges\": " << num_edges << "," << endl;
+    out << "{" << endl;
+    out << "  \"input_file\": \"" << grh_file << "\"," << endl;
+    out << "  \"vertices\": " << num_vertices << "," << endl;
+    out << "  \"edges\": " << num_edges << "," << endl;
+    out << "  \"simd_kernels\": \"" << BitKernels::active().name << "\"," << endl;
+    // VmHWM covers the whole process, so a batch reports it once per
+    // manifest (run_manifest) instead of once per job
+    // VmHWM はプロセス全体の値のため、バッチではジョブごとではなく
+    // マニフェストごとに 1 回だけ報告する（run_manifest）
+    if (!batch) {
+        out << "  \"process_peak_rss_bytes\": " << MemoryBudget::peakResidentBytes()
+             << "," << endl;
+    }
+    const MemoryPlacement::Settings& placed = MemoryPlacement::active();
+    if (placed.numa != MemoryPlacement::Numa::Default || placed.huge_pages || placed.pin_threads) {
+        out << "  \"memory_placement\": {" << endl;
+        out << "    \"numa\": \"" << MemoryPlacement::name(placed.numa) << "\"," << endl;
+        out << "    \"numa_nodes\": " << MemoryPlacement::nodeCount() << "," << endl;
+        out << "    \"huge_pages\": " << (placed.huge_pages ? "true" : "false") << "," << endl;
+        out << "    \"malloc_huge_pages\": "
+             << (MemoryPlacement::mallocHugePages() ? "true" : "false") << "," << endl;
+        out << "    \"pinned_threads\": " << (placed.pin_threads ? "true" : "false") << endl;
+        out << "  }," << endl;
+    }
     if (split_depth > 0) {
-        cout << "  \"split_depth\": " << split_depth << "," << endl;
+        out << "  \"split_depth\": " << split_depth << "," << endl;
+    }
+
+    // Memory budget: the chosen parameters and what the run reached
+    // メモリ予算: 選んだパラメータと実行結果
+    if (max_memory > 0) {
+        out << "  \"memory_budget\": {" << endl;
+        out << "    \"max_memory_bytes\": " << max_memory << "," << endl;
+        out << "    \"bytes_per_node\": " << MemoryBudget::BYTES_PER_NODE << "," << endl;
+        out << "    \"working_copies\": " << working_copies << "," << endl;
+        out << "    \"node_budget\": " << node_budget << "," << endl;
+        if (!split_depth_given) {
+            out << "    \"probe_depth\": " << probe.probe_depth << "," << endl;
+            out << "    \"probe_nodes\": " << probe.probe_nodes << "," << endl;
+            out << "    \"growth_per_edge\": " << fixed << setprecision(3)
+                 << probe.growth << "," << endl;
+            out << "    \"estimated_partition_nodes\": " << probe.estimated_nodes
+                 << "," << endl;
+            out << "    \"probe_built_nodes\": " << probe.probe_built_nodes
+                 << "," << endl;
+            out << "    \"probe_time_ms\": " << fixed << setprecision(2)
+                 << probe.probe_time_ms << "," << endl;
+        }
+        out << "    \"split_depth\": " << split_depth << "," << endl;
+        out << "    \"split_depth_source\": \""
+             << (split_depth_given ? "argument" : "probe") << "\"," << endl;
+        out << "    \"partitions\": " << partition_stats.partitions << "," << endl;
+        out << "    \"refined_partitions\": " << partition_stats.refined << "," << endl;
+        out << "    \"shallowest_partition_depth\": " << partition_stats.shallowest
+             << "," << endl;
+        out << "    \"deepest_partition_depth\": " << partition_stats.deepest
+             << "," << endl;
+        out << "    \"largest_partition_nodes\": " << partition_stats.largest_nodes
+             << endl;
+        out << "  }," << endl;
+    }
+
+    // Out-of-core storage: disk traffic and node throughput of each pass
+    // (phase4.zdd_nodes / build_time_ms compares with the in-memory mode)
+    // メモリ外格納: ディスク量と各パスのノード処理速度
+    // （phase4.zdd_nodes / build_time_ms でメモリ内モードと比較できる）
+    if (apply_out_of_core) {
+        out << "  \"out_of_core\": {" << endl;
+        out << "    \"directory\": \"" << out_of_core.directory() << "\"," << endl;
+        out << "    \"bytes_written\": " << out_of_core.bytes_written << "," << endl;
+        out << "    \"peak_disk_bytes\": " << out_of_core.peak_bytes << "," << endl;
+        out << "    \"final_nodes\": " << final_nodes << "," << endl;
+        out << "    \"built_nodes\": " << out_of_core.built_nodes << "," << endl;
+        out << "    \"build_nodes_per_sec\": " << fixed << setprecision(0)
+             << OutOfCore::Workspace::perSecond(out_of_core.built_nodes,
+                                                out_of_core.build_ms) << "," << endl;
+        out << "    \"reduced_nodes\": " << out_of_core.reduced_nodes << "," << endl;
+        out << "    \"reduce_nodes_per_sec\": " << fixed << setprecision(0)
+             << OutOfCore::Workspace::perSecond(out_of_core.reduced_nodes,
+                                                out_of_core.reduce_ms) << "," << endl;
+        out << "    \"counted_nodes\": " << out_of_core.counted_nodes << "," << endl;
+        out << "    \"count_nodes_per_sec\": " << fixed << setprecision(0)
+             << OutOfCore::Workspace::perSecond(out_of_core.counted_nodes,
+                                                out_of_core.count_ms) << endl;
+        out << "  }," << endl;
+    }
+
+    // Buffer pool: bytes the repeated passes took from the allocator and
+    // bytes they recycled
+    // バッファプール: 繰り返しのパスがアロケータから得たバイト数と再利用した
+    // バイト数
+    if (pool.leases > 0) {
+        out << "  \"buffer_pool\": {" << endl;
+        out << "    \"allocated_bytes\": " << pool.allocated_bytes << "," << endl;
+        out << "    \"reused_bytes\": " << pool.reused_bytes << "," << endl;
+        out << "    \"leases\": " << pool.leases << "," << endl;
+        out << "    \"reuses\": " << pool.reuses << "," << endl;
+        out << "    \"peak_free_bytes\": " << pool.peak_free_bytes << endl;
+        out << "  }," << endl;
     }
 
     // Phase 4 results
     // Phase 4 の結果
-    cout << "  \"phase4\": {" << endl;
-    cout << "    \"build_time_ms\": " << fixed << setprecision(2)
+    out << "  \"phase4\": {" << endl;
+    out << "    \"build_time_ms\": " << fixed << setprecision(2)
          << build_time_ms << "," << endl;
-    cout << "    \"spanning_tree_count\": \"" << spanning_tree_count << "\""
+    if (phase4_nodes > 0) {
+        out << "    \"zdd_nodes\": " << phase4_nodes << "," << endl;
+    }
+    out << "    \"spanning_tree_count\": \"" << spanning_tree_count << "\""
          << endl;
-    cout << "  }," << endl;
+    out << "  }," << endl;
 
     // Phase 5 results
     // Phase 5 の結果
-    cout << "  \"phase5\": {" << endl;
-    cout << "    \"filter_applied\": " << (apply_filter ? "true" : "false");
+    out << "  \"phase5\": {" << endl;
+    out << "    \"filter_applied\": " << (apply_filter ? "true" : "false");
 
     if (apply_filter) {
-        cout << "," << endl;
-        cout << "    \"num_mopes\": " << num_mopes << "," << endl;
-        cout << "    \"subset_time_ms\": " << fixed << setprecision(2)
+        out << "," << endl;
+        out << "    \"num_mopes\": " << num_mopes << "," << endl;
+        out << "    \"subset_time_ms\": " << fixed << setprecision(2)
              << subset_time_ms << "," << endl;
-        cout << "    \"non_overlapping_count\": \"" << non_overlapping_count
+        out << "    \"non_overlapping_count\": \"" << non_overlapping_count
              << "\"" << endl;
     } else {
-        cout << endl;
+        out << endl;
     }
 
-    cout << "  }";
+    out << "  }";
 
     // Phase 6 results
     // Phase 6 の結果
     if (apply_burnside) {
-        cout << "," << endl;
-        cout << "  \"phase6\": {" << endl;
-        cout << "    \"burnside_applied\": true," << endl;
-        cout << "    \"group_order\": " << group_order << "," << endl;
-        cout << "    \"burnside_time_ms\": " << fixed << setprecision(2)
+        out << "," << endl;
+        out << "  \"phase6\": {" << endl;
+        out << "    \"burnside_applied\": true," << endl;
+        out << "    \"group_order\": " << group_order << "," << endl;
+        out << "    \"burnside_time_ms\": " << fixed << setprecision(2)
              << burnside_time_ms << "," << endl;
-        cout << "    \"burnside_sum\": \"" << burnside_sum << "\"," << endl;
-        cout << "    \"nonisomorphic_count\": \"" << nonisomorphic_count
+        out << "    \"burnside_sum\": \"" << burnside_sum << "\"," << endl;
+        out << "    \"nonisomorphic_count\": \"" << nonisomorphic_count
              << "\"," << endl;
-        cout << "    \"invariant_counts\": [" << endl;
+        if (apply_representatives) {
+            out << "    \"representatives_time_ms\": " << fixed << setprecision(2)
+                 << representatives_time_ms << "," << endl;
+            out << "    \"representative_count\": \"" << representative_count
+                 << "\"," << endl;
+            if (!representatives_file.empty()) {
+                out << "    \"representatives_file\": \"" << representatives_file
+                     << "\"," << endl;
+            }
+        }
+        out << "    \"invariant_counts\": [" << endl;
         for (size_t i = 0; i < invariant_counts.size(); ++i) {
-            cout << "      \"" << invariant_counts[i] << "\"";
-            if (i + 1 < invariant_counts.size()) cout << ",";
-            cout << endl;
+            out << "      \"" << invariant_counts[i] << "\"";
+            if (i + 1 < invariant_counts.size()) out << ",";
+            out << endl;
         }
-        cout << "    ]" << endl;
-        cout << "  }";
+        out << "    ]" << endl;
+        out << "  }";
     }
 
-    cout << endl;
-    cout << "}" << endl;
+    // Index results
+    // 番号付けの結果
+    if (apply_index) {
+        out << "," << endl;
+        out << "  \"index\": {" << endl;
+        out << "    \"index_time_ms\": " << fixed << setprecision(2)
+             << index_time_ms << "," << endl;
+        out << "    \"count_words\": " << index_words << endl;
+        out << "  }";
+    }
+
+    // Sampling results
+    // サンプリングの結果
+    if (apply_sampling) {
+        out << "," << endl;
+        out << "  \"sampling\": {" << endl;
+        out << "    \"num_samples\": " << num_samples << "," << endl;
+        out << "    \"seed\": " << sample_seed << "," << endl;
+        out << "    \"threads\": " << sample_threads << "," << endl;
+        out << "    \"format\": \"" << sample_format << "\"," << endl;
+        out << "    \"sample_time_ms\": " << fixed << setprecision(2)
+             << sample_time_ms << "," << endl;
+        out << "    \"output_file\": \"" << sample_file << "\"" << endl;
+        out << "  }";
+    }
+
+    // Range export results
+    // 区間出力の結果
+    if (apply_range) {
+        out << "," << endl;
+        out << "  \"range\": {" << endl;
+        out << "    \"first\": \"" << range_first << "\"," << endl;
+        out << "    \"last\": \"" << range_last << "\"," << endl;
+        out << "    \"exported_count\": \"" << range_count << "\"," << endl;
+        out << "    \"range_time_ms\": " << fixed << setprecision(2)
+             << range_time_ms << "," << endl;
+        out << "    \"output_file\": \"" << range_file << "\"" << endl;
+        out << "  }";
+    }
+
+    // Rank results
+    // 順位計算の結果
+    if (apply_rank) {
+        out << "," << endl;
+        out << "  \"rank\": {" << endl;
+        out << "    \"input_file\": \"" << rank_input_file << "\"," << endl;
+        out << "    \"ranked_count\": " << ranked_count << "," << endl;
+        out << "    \"non_member_count\": " << non_member_count << "," << endl;
+        out << "    \"rank_time_ms\": " << fixed << setprecision(2)
+             << rank_time_ms << "," << endl;
+        out << "    \"output_file\": \"" << rank_file << "\"" << endl;
+        out << "  }";
+    }
+
+    // Full export results
+    // 全件出力の結果
+    if (apply_export) {
+        out << "," << endl;
+        out << "  \"export\": {" << endl;
+        out << "    \"encoding\": \"" << export_encoding << "\"," << endl;
+        out << "    \"threads\": " << export_threads << "," << endl;
+        out << "    \"exported_count\": " << export_count << "," << endl;
+        out << "    \"export_time_ms\": " << fixed << setprecision(2)
+             << export_time_ms << "," << endl;
+        out << "    \"output_file\": \"" << export_file << "\"" << endl;
+        out << "  }";
+    }
+
+    out << endl;
+    out << "}" << endl;
 
     return 0;
 }
+
+// ============================================================================
+// run_manifest
+// ============================================================================
+//
+// Run every "<result.json> <polyhedron.grh> [arguments...]" line of the
+// manifest (blank lines and lines starting with # are skipped) in one
+// process; the arguments are those of a single run. Each job writes its
+// JSON result to result.json (removed again if the job fails).
+//
+// Small jobs are packed on `jobs` worker threads. Exclusive jobs, marked
+// with --exclusive on their line or with at least `exclusive_edges` edges,
+// run first and one at a time, with --sample-threads / --export-threads
+// defaulting to `jobs`. Each job's log is printed as one block, headed by
+//   job: output=OUT edges=E mode=exclusive|shared status=ok|error
+// in completion order, and a final
+//   manifest: jobs=N failed=F process_peak_rss_bytes=B
+// line reports the peak RSS of the whole batch. Returns 0 only if every
+// job succeeded.
+//
+// マニフェストの各 "<result.json> <polyhedron.grh> [引数...]" 行（空行と
+// # で始まる行は無視）を 1 プロセスで実行する。引数は単独実行と同じ。
+// 各ジョブは JSON の結果を result.json に書く（失敗したジョブでは削除）。
+//
+// 小さいジョブは jobs 個のワーカスレッドに詰めて並行実行する。排他ジョブ
+// （行に --exclusive があるか辺数が exclusive_edges 以上）は先に 1 つずつ
+// 実行し、--sample-threads / --export-threads の既定値を jobs とする。
+// 各ジョブのログは上記の job: 行を先頭とする 1 ブロックとして完了順に
+// 出力し、最後の manifest: 行でバッチ全体のピーク RSS を報告する。全ジョブが
+// 成功した場合のみ 0 を返す。
+//
+// ============================================================================
+struct BatchJob {
+    string output;
+    vector<string> args;
+    int edges = 0;
+    bool exclusive = false;
+};
+
+// Edge lines of a .grh file (0 if unreadable) / .grh ファイルの辺の行数（読めなければ 0）
+static int count_grh_edges(const string& path) {
+    InputLoader::MappedFile file(path);
+    int edges = 0;
+    for (const char* p = file.begin(); p < file.end();) {
+        const char* eol = InputLoader::findChar(p, file.end(), '\n');
+        const char* q = p;
+        int v;
+        if (InputLoader::scanInt(q, eol, v)) ++edges;
+        p = eol + 1;
+    }
+    return edges;
+}
+
+int run_manifest(istream& manifest, int jobs, int exclusive_edges) {
+    vector<BatchJob> tasks;
+    string line;
+    while (getline(manifest, line)) {
+        istringstream fields(line);
+        BatchJob job;
+        if (!(fields >> job.output) || job.output[0] == '#') continue;
+        for (string arg; fields >> arg;) {
+            if (arg == "--exclusive") job.exclusive = true;
+            else job.args.push_back(arg);
+        }
+        if (job.args.empty()) {
+            cerr << "Error: Manifest line must be \"<result.json> <polyhedron.grh> [arguments...]\": "
+                 << line << endl;
+            return 1;
+        }
+        job.edges = count_grh_edges(job.args[0]);
+        if (exclusive_edges > 0 && job.edges >= exclusive_edges) job.exclusive = true;
+        tasks.push_back(job);
+    }
+
+    if (jobs <= 0) jobs = max(1u, thread::hardware_concurrency());
+
+    atomic<int> failed(0);
+    mutex log_lock;
+    auto run = [&](const BatchJob& job, const vector<string>& defaults) {
+        ostringstream log;
+        int status = 1;
+        {
+            ofstream out(job.output);
+            if (!out) {
+                log << "Error: Cannot create " << job.output << endl;
+            } else {
+                // Later arguments win, so the job's own line overrides defaults
+                // 後の引数が優先されるため、ジョブ自身の行が既定値より優先
+                vector<string> args = {"spanning_tree_zdd"};
+                args.insert(args.end(), defaults.begin(), defaults.end());
+                args.insert(args.end(), job.args.begin(), job.args.end());
+                vector<char*> argv;
+                for (auto& a : args) argv.push_back(&a[0]);
+                try {
+                    status = run_job((int)argv.size(), argv.data(), out, log, true);
+                } catch (const exception& e) {
+                    log << "Error: " << e.what() << endl;
+                    status = 1;
+                }
+                if (status == 0 && !out.flush()) {
+                    log << "Error: Failed to write " << job.output << endl;
+                    status = 1;
+                }
+            }
+        }
+        if (status != 0) {
+            ++failed;
+            remove(job.output.c_str());
+        }
+
+        lock_guard<mutex> guard(log_lock);
+        cerr << "job: output=" << job.output << " edges=" << job.edges
+             << " mode=" << (job.exclusive ? "exclusive" : "shared")
+             << " status=" << (status == 0 ? "ok" : "error") << '\n'
+             << log.str() << flush;
+    };
+
+    // Exclusive jobs: one at a time with the whole machine
+    // 排他ジョブ: マシン全体を使って 1 つずつ
+    const vector<string> whole_machine = {
+        "--sample-threads", to_string(jobs), "--export-threads", to_string(jobs)};
+    vector<const BatchJob*> shared;
+    for (const auto& job : tasks) {
+        if (job.exclusive) run(job, whole_machine);
+        else shared.push_back(&job);
+    }
+
+    // Shared jobs: packed on the worker threads
+    // 共有ジョブ: ワーカスレッドに詰めて並行実行
+    atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t k; (k = next++) < shared.size(); ) run(*shared[k], {});
+    };
+    int workers = min<int>(jobs, max<size_t>(1, shared.size()));
+    vector<thread> threads;
+    for (int t = 1; t < workers; ++t) {
+        threads.emplace_back([&worker, t]() {
+            MemoryPlacement::pinWorker(t);
+            worker();
+        });
+    }
+    worker();
+    for (auto& t : threads) t.join();
+
+    cerr << "manifest: jobs=" << tasks.size() << " failed=" << failed.load()
+         << " process_peak_rss_bytes=" << MemoryBudget::peakResidentBytes() << endl;
+    return failed.load() == 0 ? 0 : 1;
+}
+
+// ============================================================================
+// main function
+// ============================================================================
+//
+// Without --manifest: one run (see run_job).
+// With --manifest F (- = stdin): a batch (see run_manifest), with options
+//   --jobs N              shared jobs run concurrently
+//                         (default 1, 0 = all hardware threads)
+//   --exclusive-edges E   jobs on graphs with at least E edges run alone
+//                         (default 60, 0 = only lines marked --exclusive)
+//   --simd K              bitmask kernels for every job
+//   --numa MODE, --huge-pages, --pin-threads
+//                         memory placement for every job (see MemoryPlacement)
+//
+// --manifest なし: 1 回の実行（run_job 参照）。
+// --manifest F（- = stdin）あり: バッチ（run_manifest 参照）。オプションは
+//   --jobs N              並行実行する共有ジョブの数
+//                         （デフォルト 1、0 = 全ハードウェアスレッド）
+//   --exclusive-edges E   辺数 E 以上のグラフのジョブは単独で実行
+//                         （デフォルト 60、0 = --exclusive 付きの行のみ）
+//   --simd K              全ジョブのビットマスクカーネル
+//   --numa MODE, --huge-pages, --pin-threads
+//                         全ジョブのメモリ配置（MemoryPlacement 参照）
+//
+// ============================================================================
+int main(int argc, char **argv) {
+    bool batch = false;
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--manifest") batch = true;
+    }
+    if (!batch) return run_job(argc, argv, cout, cerr, false);
+
+    string manifest_file;
+    int jobs = 1;
+    int exclusive_edges = 60;
+    string simd = "auto";
+    MemoryPlacement::Settings placement;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--manifest" && i + 1 < argc) {
+            manifest_file = argv[++i];
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            jobs = stoi(argv[++i]);
+        } else if (arg == "--exclusive-edges" && i + 1 < argc) {
+            exclusive_edges = stoi(argv[++i]);
+        } else if (arg == "--simd" && i + 1 < argc) {
+            simd = argv[++i];
+        } else if (arg == "--numa" && i + 1 < argc) {
+            if (!MemoryPlacement::parseNuma(argv[++i], placement.numa)) {
+                cerr << "Error: --numa expects default, interleave or first-touch" << endl;
+                return 1;
+            }
+        } else if (arg == "--huge-pages") {
+            placement.huge_pages = true;
+        } else if (arg == "--pin-threads") {
+            placement.pin_threads = true;
+        } else {
+            cerr << "Error: Unexpected argument with --manifest: " << arg
+                 << " (job arguments belong on the manifest lines)" << endl;
+            cerr << "Usage: " << argv[0]
+                 << " --manifest <file|-> [--jobs N] [--exclusive-edges E]"
+                 << " [--simd auto|scalar|sse2|avx2|avx512]"
+                 << " [--numa default|interleave|first-touch] [--huge-pages] [--pin-threads]"
+                 << endl;
+            return 1;
+        }
+    }
+
+    if (!BitKernels::select(simd)) {
+        cerr << "Error: SIMD kernel '" << simd
+             << "' is unknown or not supported by this CPU"
+             << " (choose auto, scalar, sse2, avx2, avx512)" << endl;
+        return 1;
+    }
+    cerr << "Bitmask kernels: " << BitKernels::active().name << endl;
+
+    string placement_error;
+    if (!MemoryPlacement::apply(placement, placement_error)) {
+        cerr << "Error: " << placement_error << endl;
+        return 1;
+    }
+    log_placement(cerr);
+
+    if (manifest_file == "-") return run_manifest(cin, jobs, exclusive_edges);
+    ifstream manifest(manifest_file);
+    if (!manifest) {
+        cerr << "Error: Cannot open manifest " << manifest_file << endl;
+        return 1;
+    }
+    return run_manifest(manifest, jobs, exclusive_edges);
+}
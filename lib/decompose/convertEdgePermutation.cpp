@@ -11,7 +11,6 @@
 
 std::vector<std::pair<int, int>> convertEdgePermutation(Graph &G, std::vector<int> &perm) {
     int n = G.numVertices();
-    int m = G.numEdges();
     /* [Bug]
     std::set<std::pair<int, int>> edge;
     for(int i = 0; i < m; i++) {
@@ -33,25 +32,22 @@ std::vector<std::pair<int, int>> convertEdgePermutation(Graph &G, std::vector<in
     }
     return res;
     */
-    std::map<std::pair<int, int>, int> edge;
-    for(int i = 0; i < m; i++) {
-        int u = G.getEdge(i).first.first;
-        int v = G.getEdge(i).first.second;
-        if(v < u) std::swap(u, v);
-        edge[std::make_pair(u, v)] += 1;
-    }
+    // Edges between perm[i] and the earlier perm[j], ordered by j, with
+    // parallel edges repeated: every edge is emitted once, from its later
+    // endpoint, by scanning that endpoint's CSR neighbours. O(m log deg)
+    // instead of the O(n^2 log m) pair scan.
+    std::vector<int> pos(n);
+    for(int i = 0; i < n; i++) pos[perm[i]] = i;
     std::vector<std::pair<int, int>> res;
+    std::vector<int> earlier;
     for(int i = 0; i < n; i++) {
-        for(int j = 0; j < i; j++) {
-            int u = perm[i];
-            int v = perm[j];
-            if(v < u) std::swap(u, v);
-            if(edge.count(std::make_pair(u, v))) {
-                for(int k = 0; k < edge[std::make_pair(u, v)]; k++) {
-                    res.push_back(std::make_pair(u, v));
-                }
-            }
+        int u = perm[i];
+        earlier.clear();
+        for(auto &[v, c]: G.getNeighbors(u)) {
+            if(pos[v] < i) earlier.push_back(v);
         }
+        std::stable_sort(earlier.begin(), earlier.end(), [&](int a, int b) { return pos[a] < pos[b]; });
+        for(int v: earlier) res.push_back(std::make_pair(std::min(u, v), std::max(u, v)));
     }
     return res;
 
@@ -64,27 +60,17 @@ std::vector<std::pair<int, int>> convertEdgePermutation(Graph &G, std::vector<in
 
 std::vector<int> convertEdgePermutation_weighted(Graph &G, std::vector<int> &perm) {
     int n = G.numVertices();
-    int m = G.numEdges();
-    std::map<std::pair<int, int>, std::vector<int>> edge;
-    for(int i = 0; i < m; i++) {
-        int u = G.getEdge(i).first.first;
-        int v = G.getEdge(i).first.second;
-        int c = G.getEdge(i).second;
-        if(v < u) std::swap(u, v);
-        edge[std::make_pair(u, v)].push_back(c);
-    }
+    std::vector<int> pos(n);
+    for(int i = 0; i < n; i++) pos[perm[i]] = i;
     std::vector<int> res;
+    std::vector<std::pair<int, int>> earlier;
     for(int i = 0; i < n; i++) {
-        for(int j = 0; j < i; j++) {
-            int u = perm[i];
-            int v = perm[j];
-            if(v < u) std::swap(u, v);
-            if(edge.count(std::make_pair(u, v))) {
-                for(auto c: edge[std::make_pair(u, v)]) {
-                    res.push_back(c);
-                }
-            }
+        earlier.clear();
+        for(auto &[v, c]: G.getNeighbors(perm[i])) {
+            if(pos[v] < i) earlier.push_back(std::make_pair(v, c));
         }
+        std::stable_sort(earlier.begin(), earlier.end(), [&](const std::pair<int, int> &a, const std::pair<int, int> &b) { return pos[a.first] < pos[b.first]; });
+        for(auto &[v, c]: earlier) res.push_back(c);
     }
     return res;
 
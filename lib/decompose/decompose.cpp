@@ -1,62 +1,270 @@
 #pragma once
-#include<bitset>
 #include<array>
+#include<cstdint>
 #include<vector>
 #include<unordered_set>
 #include<algorithm>
 #include<utility>
-#include <time.h>
+#include<atomic>
+#include<chrono>
+#include<deque>
+#include<mutex>
+#include<thread>
 
 #include "graph.cpp"
+#include "lowerBound.cpp"
+
+// Vertex set of at most 64 * W vertices. The branch and bound is instantiated
+// for W = 1, 2, 4, 8, 16 (64 ... 1024 vertices) and MAX_WORDS, and decompose()
+// picks the smallest one that fits, so every &, |, count() and hash touches
+// only the words the graph needs.
+template<int W>
+struct WordBitset {
+  uint64_t w[W] = {};
+
+  bool operator[](int i) const { return (w[i >> 6] >> (i & 63)) & 1; }
+  void set(int i){ w[i >> 6] |= 1ULL << (i & 63); }
+  void reset(int i){ w[i >> 6] &= ~(1ULL << (i & 63)); }
+
+  WordBitset operator&(const WordBitset &b) const {
+    WordBitset r;
+    for(int k = 0; k < W; ++k) r.w[k] = w[k] & b.w[k];
+    return r;
+  }
+  WordBitset operator|(const WordBitset &b) const {
+    WordBitset r;
+    for(int k = 0; k < W; ++k) r.w[k] = w[k] | b.w[k];
+    return r;
+  }
+  WordBitset operator~() const {
+    WordBitset r;
+    for(int k = 0; k < W; ++k) r.w[k] = ~w[k];
+    return r;
+  }
+  bool operator==(const WordBitset &b) const {
+    for(int k = 0; k < W; ++k) if(w[k] != b.w[k]) return false;
+    return true;
+  }
+  bool operator!=(const WordBitset &b) const { return !(*this == b); }
 
-const int MAX_VERTEX_SIZE = 960 * 3;
-const int MAX_BMPOOL_SIZE = 3*MAX_VERTEX_SIZE;
-using mybitset = std::bitset<MAX_VERTEX_SIZE>;
-using myarray = std::array<int, MAX_VERTEX_SIZE>;
-using myBMPool = std::array<mybitset, MAX_BMPOOL_SIZE>;
-using GMatrix = std::vector<mybitset>;
-
-struct Comp{
-  bool operator() (const mybitset &b1, const mybitset &b2) const {
-    return b1.to_string() < b2.to_string();
+  int count() const {
+    int c = 0;
+    for(int k = 0; k < W; ++k) c += __builtin_popcountll(w[k]);
+    return c;
+  }
+  // |this & ~b| without building the temporary
+  int countAndNot(const WordBitset &b) const {
+    int c = 0;
+    for(int k = 0; k < W; ++k) c += __builtin_popcountll(w[k] & ~b.w[k]);
+    return c;
+  }
+  // this ⊆ b
+  bool subsetOf(const WordBitset &b) const {
+    for(int k = 0; k < W; ++k) if(w[k] & ~b.w[k]) return false;
+    return true;
   }
+
+  struct Hash {
+    size_t operator()(const WordBitset &b) const {
+      uint64_t h = 0x9e3779b97f4a7c15ULL;
+      for(int k = 0; k < W; ++k){
+        h ^= b.w[k] + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+      }
+      return h;
+    }
+  };
 };
 
-using prefixStorage = std::unordered_set<mybitset>;
-//using prefixStorage = set<mybitset, Comp>;
+const int MAX_VERTEX_SIZE = 960 * 3;
+const int MAX_WORDS = (MAX_VERTEX_SIZE + 63) / 64;
+
+template<int W> using GMatrixW = std::vector<WordBitset<W>>;
+template<int W> using prefixStorageW = std::unordered_set<WordBitset<W>, typename WordBitset<W>::Hash>;
 
-inline int findFirstBit(const mybitset &b){
-  for(int i = 0, end = b.size(); i < end; ++i){
-    if(b[i]) return i;
+template<int W>
+inline int findFirstBit(const WordBitset<W> &b){
+  for(int k = 0; k < W; ++k){
+    if(b.w[k]) return k * 64 + __builtin_ctzll(b.w[k]);
   }
   return -1;
 }
 
-time_t starttime;
-double limittime;
-inline bool timecheck(){
-    return (double)(clock() - starttime) / CLOCKS_PER_SEC > limittime;
-}
+// Visited prefixes (sets of placed vertices), split into independently
+// locked shards so that parallel workers rarely contend.
+template<int W>
+class PrefixStore {
+  struct Shard {
+    std::mutex lock;
+    prefixStorageW<W> set;
+  };
+  std::vector<Shard> shards;
+
+  Shard &shardOf(const WordBitset<W> &b){
+    return shards[typename WordBitset<W>::Hash()(b) % shards.size()];
+  }
 
-int vertexSeparationBAB(const int n, const GMatrix &G, std::vector<int> &prefix, std::vector<int> &positions, myarray &bestSeq, int level, mybitset &bPrefix, mybitset &bPrefixAndNeighborhood, int &upperBound, int currentCost, std::vector<mybitset> &bmPool, prefixStorage& prefixStorage, const int limit){
-  if(level == n){
-    if(currentCost < upperBound){
-      for(int i = 0; i < n; ++i) bestSeq[i] = prefix[i];
+public:
+  explicit PrefixStore(int numShards) : shards(numShards) {}
+
+  bool count(const WordBitset<W> &b){
+    Shard &s = shardOf(b);
+    std::lock_guard<std::mutex> guard(s.lock);
+    return s.set.count(b) != 0;
+  }
+  void insert(const WordBitset<W> &b){
+    Shard &s = shardOf(b);
+    std::lock_guard<std::mutex> guard(s.lock);
+    s.set.insert(b);
+  }
+};
+
+// Subtree of the search handed to another worker.
+template<int W>
+struct SearchTask {
+  std::vector<int> prefix;
+  std::vector<int> positions;
+  int level;
+  WordBitset<W> bPrefix;
+  WordBitset<W> bPrefixAndNeighborhood;
+  int currentCost;
+  int depth;
+};
+
+// Work-stealing pool: every worker owns a deque, pushes and pops at the
+// back, and steals from the front of the others when its own is empty.
+template<typename Task>
+class WorkStealingPool {
+  struct Queue {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+  std::vector<Queue> queues;
+  std::atomic<long> pending{0};
+
+  bool pop(int self, Task &task){
+    for(int k = 0, nq = queues.size(); k < nq; ++k){
+      Queue &q = queues[(self + k) % nq];
+      std::lock_guard<std::mutex> guard(q.lock);
+      if(q.tasks.empty()) continue;
+      if(k == 0){
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+      }else{
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+      }
+      return true;
     }
+    return false;
+  }
+
+public:
+  explicit WorkStealingPool(int numWorkers) : queues(numWorkers) {}
+
+  int size() const { return queues.size(); }
+
+  void push(int self, Task &&task){
+    ++pending;
+    std::lock_guard<std::mutex> guard(queues[self].lock);
+    queues[self].tasks.push_back(std::move(task));
+  }
+
+  // Run body(worker, task) until no task is queued or running.
+  template<typename Body>
+  void run(Body body){
+    auto worker = [&](int self){
+      Task task;
+      while(pending.load() > 0){
+        if(pop(self, task)){
+          body(self, task);
+          --pending;
+        }else{
+          std::this_thread::yield();
+        }
+      }
+    };
+    std::vector<std::thread> threads;
+    for(int t = 1; t < size(); ++t) threads.emplace_back(worker, t);
+    worker(0);
+    for(auto &t: threads) t.join();
+  }
+};
+
+// State shared by all branches of one search: the best bound (atomic), the
+// best sequence, the visited-prefix store, the deadline and, when parallel,
+// the pool that shallow subtrees are pushed to. The search stops early once
+// the upper bound reaches target (lower bound + accepted gap); timedOut and
+// truncated record whether it gave up on part of the tree, i.e. whether the
+// result is not proven optimal.
+template<int W>
+struct VertexSeparationSearch {
+  const int n;
+  const GMatrixW<W> &G;
+  const int limit;
+  const int target;
+  const std::chrono::steady_clock::time_point start;
+  const std::chrono::steady_clock::time_point deadline;
+
+  std::atomic<int> upperBound;
+  std::atomic<bool> timedOut{false};
+  std::atomic<bool> truncated{false};
+  std::mutex bestLock;
+  std::vector<int> bestSeq;
+  double timeToBest = 0;
+  PrefixStore<W> prefixStorage;
+
+  WorkStealingPool<SearchTask<W>> *pool = nullptr;
+  int spawnDepth = 0;
+
+  VertexSeparationSearch(int n, const GMatrixW<W> &G, int limit, int target, double time, int numShards)
+    : n(n), G(G), limit(limit), target(target),
+      start(std::chrono::steady_clock::now()),
+      deadline(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(time))),
+      upperBound(n), bestSeq(n), prefixStorage(numShards) {
+    for(int i = 0; i < n; ++i) bestSeq[i] = i;
+  }
+
+  double elapsed() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  bool timecheck(){
+    if(std::chrono::steady_clock::now() <= deadline) return false;
+    timedOut.store(true);
+    return true;
+  }
+
+  bool done() const {
+    return upperBound.load() <= target;
+  }
+
+  void improve(int cost, const std::vector<int> &prefix){
+    std::lock_guard<std::mutex> guard(bestLock);
+    if(cost < upperBound.load()){
+      bestSeq = prefix;
+      timeToBest = elapsed();
+      upperBound.store(cost);
+    }
+  }
+
+  int bab(std::vector<int> &prefix, std::vector<int> &positions, int level, const WordBitset<W> &bPrefix, const WordBitset<W> &bPrefixAndNeighborhood, int currentCost, int worker, int depth);
+};
+
+template<int W>
+int VertexSeparationSearch<W>::bab(std::vector<int> &prefix, std::vector<int> &positions, int level, const WordBitset<W> &bPrefix, const WordBitset<W> &bPrefixAndNeighborhood, int currentCost, int worker, int depth){
+  if(level == n){
+    improve(currentCost, prefix);
     return currentCost;
   }
-  if(timecheck()) return n;
+  if(done() || timecheck()) return n;
 
   int delta_i, v;
   std::vector<std::pair<int,int>> delta;
   int locLevel = level;
 
-  mybitset locBPrefix = bmPool[3*level];
-  mybitset locBPrefixAndNeighborhood = bmPool[3*level+1];
-  mybitset bTmp = bmPool[3*level+2];
-
-  locBPrefix = bPrefix;
-  locBPrefixAndNeighborhood = bPrefixAndNeighborhood;
+  WordBitset<W> locBPrefix = bPrefix;
+  WordBitset<W> locBPrefixAndNeighborhood = bPrefixAndNeighborhood;
+  WordBitset<W> bTmp;
 
   // Greedy Step
   int select = 0;
@@ -64,12 +272,12 @@ int vertexSeparationBAB(const int n, const GMatrix &G, std::vector<int> &prefix,
   int j;
   while(i < n){
     j = prefix[i];
-    if(G[j] == (G[j] & locBPrefixAndNeighborhood)){
+    if(G[j].subsetOf(locBPrefixAndNeighborhood)){
       locBPrefixAndNeighborhood.set(j);
       select = 1;
     }else if(locBPrefixAndNeighborhood[j] && !locBPrefix[j]){
-      bTmp = (G[j] & ~locBPrefixAndNeighborhood);
-      if(bTmp.count() == 1){
+      if(G[j].countAndNot(locBPrefixAndNeighborhood) == 1){
+        bTmp = (G[j] & ~locBPrefixAndNeighborhood);
         //v = bmPool[3*level+2].find_first();
         v = findFirstBit(bTmp);
         locBPrefixAndNeighborhood.set(v);
@@ -92,44 +300,36 @@ int vertexSeparationBAB(const int n, const GMatrix &G, std::vector<int> &prefix,
   }
 
   if(locLevel == n){
-    if(currentCost < upperBound){
-      for(int i = 0; i < n; ++i) bestSeq[i] = prefix[i];
-    }
+    improve(currentCost, prefix);
     return currentCost;
   }
 
-  mybitset frozenPrefix;
+  WordBitset<W> frozenPrefix;
   for(int i = 0; i < locLevel; ++i) frozenPrefix.set(prefix[i]);
 
-  if(prefixStorage.count(frozenPrefix)) return upperBound;
+  if(prefixStorage.count(frozenPrefix)) return upperBound.load();
 
   for(int i = locLevel; i < n; ++i){
     j = prefix[i];
     bTmp = locBPrefixAndNeighborhood | G[j];
-    bTmp = (bTmp & ~locBPrefix);
     bTmp.reset(j);
-    delta_i = bTmp.count();
-    if(delta_i < upperBound) delta.emplace_back(delta_i, j);
+    delta_i = bTmp.countAndNot(locBPrefix);
+    if(delta_i < upperBound.load()) delta.emplace_back(delta_i, j);
   }
 
-  // cout << 0 << endl;
-  // for(auto &[a, b]: delta) cout << "(" << a << ", " << b << "), ";
-  // cout << endl;
   std::sort(delta.begin(), delta.end(), [&](const std::pair<int,int> &l, const std::pair<int,int> &r){
     if(l.first != r.first) return l.first < r.first;
     if(locBPrefixAndNeighborhood[l.second] != locBPrefixAndNeighborhood[r.second]) return locBPrefixAndNeighborhood[l.second] > locBPrefixAndNeighborhood[r.second];
     return l.second < r.second;
   });
 
-  // cout << 1 << endl;
-  // for(auto &[a, b]: delta) cout << "(" << a << ", " << b << "), ";
-  // cout << endl;
-  for(int i = 0; i < std::min(limit, (int)delta.size()); ++i){
-    delta_i = delta[i].first;
-    i = delta[i].second;
+  int k = 0;
+  for(; k < std::min(limit, (int)delta.size()); ++k){
+    delta_i = delta[k].first;
+    int i = delta[k].second;
 
     delta_i = std::max(currentCost, delta_i);
-    if(delta_i >= upperBound) break;
+    if(delta_i >= upperBound.load() || done()) break;
 
     bTmp = locBPrefixAndNeighborhood | G[i];
     bTmp.reset(i);
@@ -141,22 +341,39 @@ int vertexSeparationBAB(const int n, const GMatrix &G, std::vector<int> &prefix,
     }
     locBPrefix.set(i);
 
-    int costI = vertexSeparationBAB(n, G, prefix, positions, bestSeq, locLevel+1, locBPrefix, bTmp, upperBound, delta_i, bmPool, prefixStorage, limit);
+    if(pool && depth < spawnDepth){
+      // Shallow subtree: hand it to the pool instead of recursing
+      pool->push(worker, SearchTask<W>{prefix, positions, locLevel+1, locBPrefix, bTmp, delta_i, depth+1});
+    }else{
+      bab(prefix, positions, locLevel+1, locBPrefix, bTmp, delta_i, worker, depth+1);
+    }
 
     locBPrefix.reset(i);
-    if(costI < upperBound){
-      upperBound = costI;
-    }
   }
+  // Beam cut-off: candidates that could still improve were never tried
+  if(k == limit && k < (int)delta.size() && std::max(currentCost, delta[k].first) < upperBound.load()) truncated.store(true);
 
-  if(currentCost < upperBound) prefixStorage.insert(frozenPrefix);
-  return upperBound;
+  if(currentCost < upperBound.load()) prefixStorage.insert(frozenPrefix);
+  return upperBound.load();
 }
 
-std::pair<int, myarray> vertexSeparation(const int &n, const GMatrix& G, const int limit){
-  std::vector<mybitset> bmPool(3*n);
-  int pw = n;
+// Result of one search. width is the vertex separation of order; lowerBound
+// is the best proven bound (equal to width when optimal). Times in seconds.
+struct DecomposeResult {
+  std::vector<int> order;
+  int width;
+  int lowerBound;
+  bool optimal;
+  double timeToBest;
+  double elapsed;
+};
 
+// numThreads == 1 runs the original depth-first search; otherwise subtrees
+// up to depth spawnDepth become tasks of a work-stealing pool. The search
+// ends when the tree is exhausted, the time is up or the width reaches
+// lowerBound + gap.
+template<int W>
+DecomposeResult vertexSeparation(const int &n, const GMatrixW<W>& G, const int limit, const double time, const int numThreads, const int lowerBound, const int gap, const int spawnDepth = 2){
   std::vector<int> prefix(n);
   std::vector<int> positions(n);
   for(int i = 0; i < n; ++i) {
@@ -164,40 +381,72 @@ std::pair<int, myarray> vertexSeparation(const int &n, const GMatrix& G, const i
     positions[i] = i;
   }
 
-  mybitset bPrefix;
-  mybitset bPrefixAndNeighborhood;
-
-  prefixStorage prefixStorage;
-
-  int upperBound = n;
-  myarray bestSeq;
-
-  auto t = vertexSeparationBAB(n, G, prefix, positions, bestSeq, 0, bPrefix, bPrefixAndNeighborhood, upperBound, 0, bmPool, prefixStorage, limit);
-  //reverse(ALL(bestSeq));
-  // printVec(bestSeq);
+  WordBitset<W> bPrefix;
+  WordBitset<W> bPrefixAndNeighborhood;
+
+  VertexSeparationSearch<W> search(n, G, limit, lowerBound + gap, time, numThreads > 1 ? 64 * numThreads : 1);
+
+  if(numThreads <= 1){
+    search.bab(prefix, positions, 0, bPrefix, bPrefixAndNeighborhood, 0, 0, 0);
+  }else{
+    WorkStealingPool<SearchTask<W>> pool(numThreads);
+    search.pool = &pool;
+    search.spawnDepth = spawnDepth;
+    pool.push(0, SearchTask<W>{prefix, positions, 0, bPrefix, bPrefixAndNeighborhood, 0, 0});
+    pool.run([&](int worker, SearchTask<W> &task){
+      if(task.currentCost >= search.upperBound.load() || search.done()) return;
+      search.bab(task.prefix, task.positions, task.level, task.bPrefix, task.bPrefixAndNeighborhood, task.currentCost, worker, task.depth);
+    });
+  }
 
-  return make_pair(t, bestSeq);
+  DecomposeResult res;
+  res.order = search.bestSeq;
+  res.width = search.upperBound.load();
+  // An exhausted search proves its width; stopping at the target proves
+  // nothing beyond the given lower bound.
+  bool exhausted = !search.timedOut.load() && !search.truncated.load() && !search.done();
+  res.lowerBound = exhausted ? res.width : std::min(lowerBound, res.width);
+  res.optimal = res.lowerBound == res.width;
+  res.timeToBest = search.timeToBest;
+  res.elapsed = search.elapsed();
+  return res;
 }
 
-GMatrix getMatrix(const Graph& g){
-    GMatrix res(g.numVertices());
+template<int W>
+GMatrixW<W> getMatrix(const Graph& g){
+    GMatrixW<W> res(g.numVertices());
     for(int u = 0; u < g.numVertices(); ++u){
         for(auto &[v, cost]: g.getNeighbors(u)){
-            res[u][v] = 1;
+            res[u].set(v);
         }
     }
     return res;
 }
 
-std::vector<int> decompose(const Graph& graph, const double time, const int limit = 1e9){
-  starttime = clock();
-  limittime = time;
+template<int W>
+DecomposeResult decomposeW(const Graph& graph, const double time, const int limit, const int numThreads, const int lowerBound, const int gap){
+  GMatrixW<W> g = getMatrix<W>(graph);
 
-  GMatrix g = getMatrix(graph);
+  return vertexSeparation<W>(g.size(), g, limit, time, numThreads, lowerBound, gap);
+}
 
-  auto val = vertexSeparation(g.size(), g, limit);
+// Anytime search: returns the best order found together with a proven lower
+// bound. gap > 0 accepts any order within gap of the lower bound (faster,
+// not necessarily optimal).
+// numThreads: 1 = sequential (deterministic), 0 = all hardware threads
+DecomposeResult decomposeWithBounds(const Graph& graph, const double time, const int limit = 1e9, int numThreads = 1, const int gap = 0){
+  if(numThreads <= 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+  const int n = graph.numVertices();
+  const int lb = pathwidthLowerBound(graph);
+  if(n <= 64) return decomposeW<1>(graph, time, limit, numThreads, lb, gap);
+  if(n <= 128) return decomposeW<2>(graph, time, limit, numThreads, lb, gap);
+  if(n <= 256) return decomposeW<4>(graph, time, limit, numThreads, lb, gap);
+  if(n <= 512) return decomposeW<8>(graph, time, limit, numThreads, lb, gap);
+  if(n <= 1024) return decomposeW<16>(graph, time, limit, numThreads, lb, gap);
+  return decomposeW<MAX_WORDS>(graph, time, limit, numThreads, lb, gap);
+}
 
-  std::vector<int> res(g.size());
-  for(int i = 0; i < g.size(); ++i) res[i] = val.second[i];
-  return res;
-}
\ No newline at end of file
+std::vector<int> decompose(const Graph& graph, const double time, const int limit = 1e9, int numThreads = 1){
+  return decomposeWithBounds(graph, time, limit, numThreads).order;
+}
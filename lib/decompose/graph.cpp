@@ -12,6 +12,19 @@
 #include <stack>
 #include <queue>
 #include <algorithm>
+#include <functional>
+
+// Read-only view of a vertex's neighbours in the CSR arrays: (vertex, cost)
+// pairs, in edge input order.
+struct NeighborRange {
+    const std::pair<int, int>* first;
+    const std::pair<int, int>* last;
+
+    const std::pair<int, int>* begin() const { return first; }
+    const std::pair<int, int>* end() const { return last; }
+    size_t size() const { return last - first; }
+    const std::pair<int, int>& operator[](size_t i) const { return first[i]; }
+};
 
 class Graph {
 private:
@@ -23,7 +36,9 @@ private:
     int const s;
     int const t;
     std::vector<std::pair<std::pair<int, int>, int>> const edge;
-    std::vector<std::vector<std::pair<int, int>>> graph;
+    // CSR adjacency: neighbors of u are adjacency[offset[u] .. offset[u+1])
+    std::vector<int> offset;
+    std::vector<std::pair<int, int>> adjacency;
     std::vector<std::vector<int>> dist;
     int onepair;
     int construct;
@@ -31,33 +46,59 @@ private:
 public:
     Graph(int n, int m, int l, int s, int t, std::vector<std::pair<std::pair<int, int>, int>> edge) 
         : n(n), m(m), l(l), s(s), t(t), edge(edge) {
-        graph.resize(n);
+        offset.assign(n + 1, 0);
+        for(auto it = edge.begin(); it != edge.end(); ++it) {
+            offset[(*it).first.first + 1]++;
+            offset[(*it).first.second + 1]++;
+        }
+        for(int i = 0; i < n; i++) offset[i + 1] += offset[i];
+        adjacency.resize(offset[n]);
+        std::vector<int> pos(offset.begin(), offset.end() - 1);
         for(auto it = edge.begin(); it != edge.end(); ++it) {
             int u = (*it).first.first;
             int v = (*it).first.second;
             int c = (*it).second;
-            graph[u].push_back(std::make_pair(v, c));
-            graph[v].push_back(std::make_pair(u, c));
+            adjacency[pos[u]++] = std::make_pair(v, c);
+            adjacency[pos[v]++] = std::make_pair(u, c);
         }
         onepair = !(s == -1 && t == -1);
         construct = false;
     }
 
     void constructDist() {
-        // Floyd-Warshall Algorithm
+        // One search per source: BFS when every cost is 1 (graphs read by
+        // readGraph), Dijkstra otherwise (deletePaths merges costs).
+        // O(n m) instead of Floyd-Warshall's O(n^3).
         dist.assign(n, std::vector<int>(n, INF));
-        for(int i = 0; i < m; i++) {
-            int u = edge[i].first.first;
-            int v = edge[i].first.second;
-            int c = edge[i].second;
-            dist[u][v] = c;
-            dist[v][u] = c;
-        }
-        for(int i = 0; i < n; i++) dist[i][i] = 0;
-        for(int k = 0; k < n; k++) {
-            for(int i = 0; i < n; i++) {
-                for(int j = 0; j < n; j++) {
-                    dist[i][j] = std::min(dist[i][j], dist[i][k] + dist[k][j]);
+        bool unit = true;
+        for(int i = 0; i < m; i++) unit &= edge[i].second == 1;
+        std::vector<int> queue(n);
+        for(int src = 0; src < n; src++) {
+            std::vector<int> &d = dist[src];
+            d[src] = 0;
+            if(unit) {
+                int head = 0, tail = 0;
+                queue[tail++] = src;
+                while(head < tail) {
+                    int u = queue[head++];
+                    for(auto &[v, c]: getNeighbors(u)) {
+                        if(d[v] != INF) continue;
+                        d[v] = d[u] + 1;
+                        queue[tail++] = v;
+                    }
+                }
+            } else {
+                std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> pq;
+                pq.push(std::make_pair(0, src));
+                while(!pq.empty()) {
+                    auto [du, u] = pq.top(); pq.pop();
+                    if(du > d[u]) continue;
+                    for(auto &[v, c]: getNeighbors(u)) {
+                        if(du + c < d[v]) {
+                            d[v] = du + c;
+                            pq.push(std::make_pair(d[v], v));
+                        }
+                    }
                 }
             }
         }
@@ -100,8 +141,12 @@ public:
         return l;
     }
 
-    std::vector<std::pair<int, int>> getNeighbors(int e) const {
-        return graph[e];
+    NeighborRange getNeighbors(int e) const {
+        return NeighborRange{adjacency.data() + offset[e], adjacency.data() + offset[e + 1]};
+    }
+
+    int degree(int u) const {
+        return offset[u + 1] - offset[u];
     }
 
     void printEdges() const {
@@ -129,8 +174,8 @@ public:
         std::cout << "Edge List: " << std::endl;
         for(int i = 0; i < n; i++) {
             std::cout << i + 1 << ": ";
-            for(int j = 0; j < graph[i].size(); j++) {
-                std::cout << graph[i][j].first << " ";
+            for(auto &[v, c]: getNeighbors(i)) {
+                std::cout << v << " ";
             }
             std::cout << std::endl;
         }
@@ -372,13 +417,15 @@ public:
     }
 };
 
-Graph readGraph() {
+// Reads from any stream (stdin by default); holds no state between calls,
+// so several graphs can be read and decomposed concurrently.
+Graph readGraph(FILE *fp = stdin) {
     int n, m, l, s, t;
     s = -1;
     t = -1;
     std::vector<std::pair<std::pair<int, int>, int>> edge;
     char buf[1024];
-    while(fgets(buf, sizeof(buf), stdin)) {
+    while(fgets(buf, sizeof(buf), fp)) {
         if(buf[0] == 'p') {
             sscanf(buf, "p edge %d %d", &n, &m);
         }
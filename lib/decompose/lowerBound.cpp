@@ -0,0 +1,80 @@
+#pragma once
+#include<vector>
+#include<set>
+#include<algorithm>
+
+#include "graph.cpp"
+
+// Lower bounds on the vertex separation number (= pathwidth). Both are
+// treewidth lower bounds, and pathwidth >= treewidth.
+
+// Degeneracy: the largest minimum degree seen while repeatedly deleting a
+// vertex of minimum degree.
+int degeneracyLowerBound(const Graph& graph){
+  const int n = graph.numVertices();
+  std::vector<int> deg(n);
+  std::set<std::pair<int,int>> queue;
+  for(int u = 0; u < n; ++u){
+    deg[u] = graph.getNeighbors(u).size();
+    queue.emplace(deg[u], u);
+  }
+  std::vector<bool> removed(n, false);
+  int lb = 0;
+  while(!queue.empty()){
+    auto [d, u] = *queue.begin();
+    queue.erase(queue.begin());
+    removed[u] = true;
+    lb = std::max(lb, d);
+    for(auto &[v, cost]: graph.getNeighbors(u)){
+      if(removed[v]) continue;
+      queue.erase({deg[v], v});
+      queue.emplace(--deg[v], v);
+    }
+  }
+  return lb;
+}
+
+// Minor-min-width (MMD+ with the min-d rule): like the degeneracy bound, but
+// the minimum-degree vertex is contracted into its neighbour of smallest
+// degree instead of deleted, which keeps more edges in the remaining minor.
+int minorMinWidthLowerBound(const Graph& graph){
+  const int n = graph.numVertices();
+  std::vector<std::set<int>> adj(n);
+  for(int u = 0; u < n; ++u){
+    for(auto &[v, cost]: graph.getNeighbors(u)){
+      if(u != v) adj[u].insert(v);
+    }
+  }
+  std::set<std::pair<int,int>> queue;
+  for(int u = 0; u < n; ++u) queue.emplace(adj[u].size(), u);
+
+  int lb = 0;
+  while(queue.size() > 1){
+    auto [d, u] = *queue.begin();
+    queue.erase(queue.begin());
+    lb = std::max(lb, d);
+    if(d == 0) continue;
+
+    int w = -1;
+    for(int v: adj[u]){
+      if(w == -1 || adj[v].size() < adj[w].size()) w = v;
+    }
+    // Contract u into w; only u's neighbours change degree
+    std::vector<int> touched(adj[u].begin(), adj[u].end());
+    for(int v: touched) queue.erase({(int)adj[v].size(), v});
+    for(int v: touched){
+      adj[v].erase(u);
+      if(v != w){
+        adj[v].insert(w);
+        adj[w].insert(v);
+      }
+    }
+    adj[u].clear();
+    for(int v: touched) queue.emplace(adj[v].size(), v);
+  }
+  return lb;
+}
+
+int pathwidthLowerBound(const Graph& graph){
+  return std::max(degeneracyLowerBound(graph), minorMinWidthLowerBound(graph));
+}
@@ -0,0 +1,18 @@
+"""
+Artifact Cache Module
+
+Handles:
+- Canonical forms of .grh graphs (isomorphism-invariant keys)
+- Hashes of MOPE families modulo automorphisms
+- Content-addressed store of Phase 1 edge orders and Phase 4–6 counts
+
+成果物キャッシュモジュール:
+- .grh グラフの正準形（同型不変なキー）
+- 自己同型を法とした MOPE 族のハッシュ
+- Phase 1 の辺順序と Phase 4–6 の数え上げ結果の内容アドレス方式ストア
+"""
+
+from .canonical import canonical_form, family_key, graph_key
+from .store import ArtifactCache, CanonicalGraph, file_digest, read_grh
+
+__version__ = "1.0.0"
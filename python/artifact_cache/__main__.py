@@ -0,0 +1,38 @@
+"""
+Artifact Cache - Module Entry Point
+
+Prints the isomorphism-invariant key of each .grh file, so that
+isomorphic inputs can be spotted (equal keys) before running anything.
+
+各 .grh ファイルの同型不変なキーを表示する。実行前に同型な入力
+（キーが等しいもの）を見つけられる。
+
+Usage:
+    PYTHONPATH=python python -m artifact_cache data/polyhedra/*/*/polyhedron.grh
+"""
+
+import argparse
+from pathlib import Path
+
+from .store import CanonicalGraph
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Artifact Cache - .grh グラフの同型不変なキーを表示"
+    )
+    parser.add_argument(
+        "grh",
+        type=str,
+        nargs="+",
+        help=".grh ファイルのパス（TdZdd 形式または DIMACS 形式）"
+    )
+    args = parser.parse_args()
+
+    for path in args.grh:
+        graph = CanonicalGraph.from_grh(Path(path))
+        print(f"{graph.key}  {path}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,195 @@
+"""
+Canonical Graph Form
+
+Handles:
+- Canonical labeling of a simple graph by individualization-refinement
+  (color refinement + search over the first non-singleton cell, with
+  root-level pruning by the automorphisms found on the way)
+- The isomorphism from the input labels to the canonical labels
+- Canonical hashes of edge-set families modulo an automorphism group
+
+グラフの正準形:
+- 個別化・細分化による単純グラフの正準ラベル付け（色の細分化と最初の
+  非単元セルでの探索、途中で見つかった自己同型による根での枝刈り）
+- 入力ラベルから正準ラベルへの同型写像
+- 自己同型群を法とした辺集合族の正準ハッシュ
+
+Two graphs get the same canonical code if and only if they are
+isomorphic; the labeling maps each input onto that code, so results
+computed for one input can be carried to any isomorphic one.
+
+2 つのグラフが同じ正準コードを持つのは同型であるときに限る。ラベル付けは
+各入力をそのコードに写すため、ある入力で計算した結果を同型な任意の入力に
+持ち運べる。
+"""
+
+import hashlib
+from typing import Dict, Iterable, List, Optional, Sequence, Tuple
+
+Edge = Tuple[int, int]
+
+
+def _refine(adj: List[List[int]], colors: List[int]) -> List[int]:
+    """
+    Color refinement to the coarsest equitable partition. Colors are ranks
+    of (old color, sorted neighbor colors), so the result depends only on
+    the input coloring up to isomorphism.
+
+    最も粗い均等分割までの色の細分化。色は (旧色, 隣接色のソート列) の順位で、
+    結果は同型を除いて入力の色付けのみに依存する。
+    """
+    num_colors = len(set(colors))
+    while True:
+        signatures = [
+            (colors[v], tuple(sorted(colors[u] for u in adj[v])))
+            for v in range(len(adj))
+        ]
+        rank = {sig: i for i, sig in enumerate(sorted(set(signatures)))}
+        colors = [rank[sig] for sig in signatures]
+        if len(rank) == num_colors:
+            return colors
+        num_colors = len(rank)
+
+
+def _target_cell(colors: List[int]) -> Optional[List[int]]:
+    """First non-singleton cell in color order / 色順で最初の非単元セル"""
+    cells: Dict[int, List[int]] = {}
+    for v, c in enumerate(colors):
+        cells.setdefault(c, []).append(v)
+    for c in sorted(cells):
+        if len(cells[c]) > 1:
+            return cells[c]
+    return None
+
+
+def _individualize(colors: List[int], v: int) -> List[int]:
+    """Give v a color just below the rest of its cell / v にセルの他より小さい色を与える"""
+    doubled = [2 * c for c in colors]
+    doubled[v] -= 1
+    return doubled
+
+
+class _Union:
+    def __init__(self, n: int):
+        self.parent = list(range(n))
+
+    def find(self, x: int) -> int:
+        while self.parent[x] != x:
+            self.parent[x] = self.parent[self.parent[x]]
+            x = self.parent[x]
+        return x
+
+    def union(self, a: int, b: int) -> None:
+        self.parent[self.find(a)] = self.find(b)
+
+
+def canonical_form(num_vertices: int, edges: Sequence[Edge]) -> Tuple[Tuple[Edge, ...], List[int]]:
+    """
+    Canonical form of a simple undirected graph.
+
+    単純無向グラフの正準形。
+
+    Args:
+        num_vertices (int): Number of vertices (0-indexed)
+        edges (list): (u, v) pairs
+
+    Returns:
+        tuple: (code, labeling) where code is the sorted tuple of canonical
+            (min, max) edges and labeling[v] is the canonical label of v
+    """
+    adj: List[List[int]] = [[] for _ in range(num_vertices)]
+    for u, v in edges:
+        adj[u].append(v)
+        adj[v].append(u)
+
+    best: List = [None, None]        # [code, labeling]
+    orbits = _Union(num_vertices)     # Root-level orbits / 根での軌道
+
+    def leaf(colors: List[int]) -> None:
+        code = tuple(sorted((min(colors[u], colors[v]), max(colors[u], colors[v]))
+                            for u, v in edges))
+        if best[0] is None or code < best[0]:
+            best[0], best[1] = code, colors
+        elif code == best[0]:
+            # Automorphism: v ↦ best⁻¹(colors[v]) / 自己同型を記録
+            inverse = [0] * num_vertices
+            for w, c in enumerate(best[1]):
+                inverse[c] = w
+            for v in range(num_vertices):
+                orbits.union(v, inverse[colors[v]])
+
+    def search(colors: List[int], root: bool) -> None:
+        colors = _refine(adj, colors)
+        cell = _target_cell(colors)
+        if cell is None:
+            leaf(colors)
+            return
+        explored = set()
+        for v in cell:
+            if root:
+                rep = orbits.find(v)
+                if any(orbits.find(w) == rep for w in explored):
+                    continue
+                explored.add(v)
+            search(_individualize(colors, v), False)
+
+    search([0] * num_vertices, True)
+    return best[0], best[1]
+
+
+def graph_key(num_vertices: int, code: Sequence[Edge]) -> str:
+    """
+    Content hash of a canonical graph / 正準グラフの内容ハッシュ
+
+    Returns:
+        str: Hex SHA-256 of "n m" and the canonical edge list
+    """
+    h = hashlib.sha256(f"{num_vertices} {len(code)}\n".encode())
+    for u, v in code:
+        h.update(f"{u} {v}\n".encode())
+    return h.hexdigest()
+
+
+def edge_map(edges: Sequence[Edge], code: Sequence[Edge],
+             labeling: Sequence[int]) -> List[int]:
+    """
+    Input edge index → canonical edge index (position in code).
+
+    入力の辺番号 → 正準な辺番号（code 内の位置）。
+    """
+    position = {e: i for i, e in enumerate(code)}
+    return [position[(min(labeling[u], labeling[v]), max(labeling[u], labeling[v]))]
+            for u, v in edges]
+
+
+def family_key(family: Iterable[Iterable[int]], canon_edge: Sequence[int],
+               automorphisms: Optional[Sequence[Sequence[int]]] = None) -> str:
+    """
+    Hash of an edge-set family modulo automorphisms, in canonical labels.
+
+    自己同型を法とした辺集合族のハッシュ（正準ラベル）。
+
+    Args:
+        family: Edge sets in input edge labels (e.g. MOPEs)
+        canon_edge: Input → canonical edge index (edge_map)
+        automorphisms: Edge permutations of the input graph (input labels);
+            the hash is the minimum over their images. Missing or partial
+            groups can only cause cache misses, never false hits.
+
+    Returns:
+        str: Hex SHA-256 of the minimal image
+    """
+    sets = [sorted(canon_edge[e] for e in s) for s in family]
+    images = [sets]
+    if automorphisms:
+        inverse = [0] * len(canon_edge)
+        for i, c in enumerate(canon_edge):
+            inverse[c] = i
+        for perm in automorphisms:
+            # Canonical edge c ↦ canon_edge[perm[inverse[c]]]
+            images.append([sorted(canon_edge[perm[inverse[c]]] for c in s) for s in sets])
+    best = min(sorted(tuple(s) for s in image) for image in images)
+    h = hashlib.sha256()
+    for s in best:
+        h.update((" ".join(map(str, s)) + "\n").encode())
+    return h.hexdigest()
@@ -0,0 +1,237 @@
+"""
+Content-Addressed Artifact Store
+
+Handles:
+- Reading .grh graphs (TdZdd "u v" and DIMACS "p edge" / "e u v")
+- Isomorphism-invariant keys for a graph and its MOPE family
+- A directory store of JSON artifacts addressed by those keys
+- Phase 1 edge orders and Phase 4–6 counts kept in canonical labels
+
+内容アドレス方式の成果物ストア:
+- .grh グラフの読み込み（TdZdd 形式 "u v" と DIMACS 形式 "p edge" / "e u v"）
+- グラフとその MOPE 族に対する同型不変なキー
+- それらのキーで参照する JSON 成果物のディレクトリストア
+- Phase 1 の辺順序と Phase 4–6 の数え上げ結果を正準ラベルで保持
+
+Layout / 配置:
+    <cache_dir>/<kind>/<key[:2]>/<key>.json
+
+Responsibility:
+- Entries only hold data expressed in canonical labels, so an entry
+  written for one polyhedron serves every isomorphic one
+- Keys include every parameter that affects the stored result, the
+  entry format version and a digest of the binary that computed it
+- Writes are atomic (temporary file + rename); a damaged entry is a miss
+
+責務:
+- エントリは正準ラベルで表したデータのみを保持し、ある多面体で書いた
+  エントリは同型な全ての多面体に使える
+- キーには格納結果に影響する全てのパラメータ、エントリ形式の版、
+  結果を計算したバイナリのダイジェストを含める
+- 書き込みはアトミック（一時ファイル + rename）、壊れたエントリはミス扱い
+"""
+
+import hashlib
+import json
+import os
+from pathlib import Path
+from typing import Dict, List, Optional, Sequence, Tuple
+
+from .canonical import Edge, canonical_form, edge_map, family_key, graph_key
+
+
+def read_grh(path: Path) -> Tuple[int, List[Edge]]:
+    """
+    Read a .grh file in either format, 0-indexed.
+
+    どちらの形式の .grh ファイルも 0-indexed で読み込む。
+
+    Returns:
+        tuple: (num_vertices, edges) with edges in file order
+    """
+    edges: List[Edge] = []
+    num_vertices = 0
+    dimacs = False
+    with open(path, 'r') as f:
+        for line in f:
+            tokens = line.split()
+            if not tokens or tokens[0] == 'c':
+                continue
+            if tokens[0] == 'p':
+                dimacs = True
+                num_vertices = int(tokens[2])
+                continue
+            if tokens[0] == 'e':
+                tokens = tokens[1:]
+            u, v = int(tokens[0]), int(tokens[1])
+            if dimacs:
+                u, v = u - 1, v - 1
+            edges.append((u, v))
+            num_vertices = max(num_vertices, u + 1, v + 1)
+    return num_vertices, edges
+
+
+class CanonicalGraph:
+    """
+    A graph together with its canonical labeling.
+
+    グラフとその正準ラベル付け。
+
+    Attributes:
+        num_vertices (int): Number of vertices
+        edges (list): Input edges (u, v) in input order
+        key (str): Isomorphism-invariant graph key
+        labeling (list): Input vertex → canonical vertex
+        canon_edge (list): Input edge index → canonical edge index
+    """
+
+    def __init__(self, num_vertices: int, edges: Sequence[Edge]):
+        self.num_vertices = num_vertices
+        self.edges = list(edges)
+        code, self.labeling = canonical_form(num_vertices, self.edges)
+        self.key = graph_key(num_vertices, code)
+        self.canon_edge = edge_map(self.edges, code, self.labeling)
+
+    @classmethod
+    def from_grh(cls, path: Path) -> "CanonicalGraph":
+        return cls(*read_grh(path))
+
+    def to_canonical(self, pairs: Sequence[Edge]) -> List[Edge]:
+        """Input vertex pairs → canonical vertex pairs / 入力の頂点対 → 正準な頂点対"""
+        return [(self.labeling[u], self.labeling[v]) for u, v in pairs]
+
+    def from_canonical(self, pairs: Sequence[Edge]) -> List[Edge]:
+        """Canonical vertex pairs → input vertex pairs / 正準な頂点対 → 入力の頂点対"""
+        inverse = [0] * self.num_vertices
+        for v, c in enumerate(self.labeling):
+            inverse[c] = v
+        return [(inverse[u], inverse[v]) for u, v in pairs]
+
+
+# Bumped whenever the layout of an entry changes / エントリの形式を変えたら上げる
+FORMAT_VERSION = 2
+
+
+def params_key(*parts) -> str:
+    """
+    Key of a tuple of JSON-serializable parts, under the current entry
+    format / 現在のエントリ形式での、JSON 化可能な要素の組のキー
+    """
+    text = json.dumps((FORMAT_VERSION,) + parts, sort_keys=True, separators=(',', ':'))
+    return hashlib.sha256(text.encode()).hexdigest()
+
+
+def file_digest(path: Path) -> str:
+    """
+    Hex SHA-256 of a file, e.g. the binary that computes an artifact, so
+    that entries are not served after it is rebuilt / ファイルの SHA-256
+    （成果物を計算するバイナリなど。再ビルド後に古いエントリを返さない）
+    """
+    h = hashlib.sha256()
+    with open(path, 'rb') as f:
+        for block in iter(lambda: f.read(1 << 20), b''):
+            h.update(block)
+    return h.hexdigest()
+
+
+class ArtifactCache:
+    """
+    Directory store of JSON artifacts / JSON 成果物のディレクトリストア
+    """
+
+    def __init__(self, root: Path):
+        self.root = Path(root)
+
+    def _path(self, kind: str, key: str) -> Path:
+        return self.root / kind / key[:2] / f"{key}.json"
+
+    def get(self, kind: str, key: str) -> Optional[dict]:
+        path = self._path(kind, key)
+        try:
+            with open(path, 'r') as f:
+                return json.load(f)
+        except (OSError, json.JSONDecodeError):
+            return None
+
+    def put(self, kind: str, key: str, data: dict) -> Path:
+        path = self._path(kind, key)
+        path.parent.mkdir(parents=True, exist_ok=True)
+        tmp = path.with_suffix(f".tmp{os.getpid()}")
+        with open(tmp, 'w') as f:
+            json.dump(data, f)
+        os.replace(tmp, path)
+        return path
+
+    # ========================================================================
+    # Phase 1: edge orders / 辺順序
+    # ========================================================================
+
+    @staticmethod
+    def edge_order_key(graph: CanonicalGraph, params: Dict) -> str:
+        return params_key("edge_order", graph.key, params)
+
+    def get_edge_order(self, graph: CanonicalGraph, params: Dict) -> Optional[dict]:
+        """
+        Cached order of graph's edges, in graph's own labels.
+
+        キャッシュされた辺順序（graph 自身のラベル）。
+
+        Returns:
+            dict or None: {"order": [(u, v), ...], "summary": {...}}
+        """
+        entry = self.get("edge_order", self.edge_order_key(graph, params))
+        if entry is None or len(entry["order"]) != len(graph.edges):
+            return None
+        return {"order": graph.from_canonical(entry["order"]),
+                "summary": entry["summary"]}
+
+    def put_edge_order(self, graph: CanonicalGraph, params: Dict,
+                       order: Sequence[Edge], summary: Dict) -> Path:
+        return self.put("edge_order", self.edge_order_key(graph, params),
+                        {"order": graph.to_canonical(order), "summary": summary})
+
+    # ========================================================================
+    # Phase 4–6: counts / 数え上げ結果
+    # ========================================================================
+
+    # Fields of result.json that are invariant under isomorphism; the rest
+    # (timings, node counts, per-automorphism counts, split depth) depend on
+    # the edge labels or the run / 同型で不変な result.json のフィールド。
+    # 残り（時間、ノード数、自己同型ごとの数、分割深さ）は辺ラベルや実行に依存
+    COUNT_FIELDS = {
+        "phase4": ("spanning_tree_count",),
+        "phase5": ("filter_applied", "num_mopes", "non_overlapping_count"),
+        "phase6": ("burnside_applied", "group_order", "burnside_sum",
+                   "nonisomorphic_count"),
+    }
+
+    @staticmethod
+    def counts_key(graph: CanonicalGraph,
+                   mopes: Optional[Sequence[Sequence[int]]],
+                   automorphisms: Optional[Dict],
+                   apply_burnside: bool, code: str) -> str:
+        """
+        mopes is None without Phase 5; automorphisms is the parsed
+        automorphisms.json (its group canonicalizes the MOPE family, and
+        its order is part of the key with Phase 6); code identifies the
+        binary (file_digest).
+
+        Phase 5 なしでは mopes は None。automorphisms は読み込んだ
+        automorphisms.json（その群で MOPE 族を正準化し、Phase 6 では
+        群の位数をキーに含める）。code はバイナリの識別子（file_digest）。
+        """
+        group = automorphisms["edge_permutations"] if automorphisms else None
+        mope_key = (family_key(mopes, graph.canon_edge, group)
+                    if mopes is not None else None)
+        order = automorphisms["group_order"] if apply_burnside else None
+        return params_key("counts", graph.key, mope_key, order, code)
+
+    @classmethod
+    def invariant_counts(cls, result: Dict) -> Dict:
+        """
+        The isomorphism-invariant part of a result.json (COUNT_FIELDS).
+
+        result.json のうち同型で不変な部分（COUNT_FIELDS）。
+        """
+        return {phase: {k: result[phase][k] for k in fields if k in result[phase]}
+                for phase, fields in cls.COUNT_FIELDS.items() if phase in result}
@@ -36,14 +36,33 @@ Usage:
 
     # Phase 4→5→6 (+ both)
     PYTHONPATH=python python -m counting --poly <polyhedron_dir> --no-overlap --noniso
+
+    # Reuse counts of isomorphic polyhedra / 同型な多面体の数え上げ結果を再利用
+    PYTHONPATH=python python -m counting --poly <polyhedron_dir> --no-overlap --noniso --cache-dir <dir>
+
+    # Many polyhedra in one spanning_tree_zdd process / 多数の多面体を 1 プロセスで
+    PYTHONPATH=python python -m counting --poly <dir1> <dir2> ... --noniso --jobs 4
+
+    # Split depth chosen for a memory budget / メモリ予算から分割深さを選択
+    PYTHONPATH=python python -m counting --poly <polyhedron_dir> --no-overlap --noniso --max-memory 8G
+
+    # One diagram paged from segment files / セグメントファイルからページングする 1 つの ZDD
+    PYTHONPATH=python python -m counting --poly <polyhedron_dir> --no-overlap --noniso --out-of-core /scratch/stz
+
+    # NUMA and huge page placement on large machines / 大規模マシンでの NUMA・ヒュージページ配置
+    PYTHONPATH=python python -m counting --poly <polyhedron_dir> --no-overlap --noniso --numa interleave --huge-pages
 """
 
 import argparse
+import os
 import sys
 import json
 import subprocess
 from pathlib import Path
-from typing import Optional
+from typing import List, Optional
+
+from artifact_cache import ArtifactCache, CanonicalGraph, file_digest
+from graph_export.binary_format import AUTOMORPHISM_BINARY_NAME, MOPE_BINARY_NAME
 
 
 def get_polyhedron_info(polyhedron_dir: Path) -> tuple[str, str]:
@@ -76,31 +95,141 @@ def get_polyhedron_info(polyhedron_dir: Path) -> tuple[str, str]:
             return "unknown", "unknown"
 
 
-def run_pipeline(
+def _placement(numa: str = "default", huge_pages: bool = False,
+               pin_threads: bool = False) -> tuple[list, Optional[dict]]:
+    """
+    Memory placement arguments of spanning_tree_zdd and the environment to
+    run it in. With huge_pages, glibc is also asked to hint huge pages for
+    TdZdd's node tables (GLIBC_TUNABLES is read only at process start).
+
+    spanning_tree_zdd のメモリ配置の引数と実行環境。huge_pages では TdZdd の
+    ノード表にもヒュージページを使うよう glibc に指示する（GLIBC_TUNABLES は
+    プロセス起動時にのみ読まれる）。
+
+    Returns:
+        tuple: (arguments, environment or None for the inherited one)
+    """
+    args = []
+    env = None
+    if numa != "default":
+        args.extend(["--numa", numa])
+    if huge_pages:
+        args.append("--huge-pages")
+        env = dict(os.environ)
+        tunables = env.get("GLIBC_TUNABLES", "")
+        if "glibc.malloc.hugetlb" not in tunables:
+            env["GLIBC_TUNABLES"] = ":".join(
+                t for t in [tunables, "glibc.malloc.hugetlb=1"] if t)
+    if pin_threads:
+        args.append("--pin-threads")
+    return args, env
+
+
+def _run_binary(cmd: list, env: Optional[dict] = None) -> dict:
+    """
+    Run spanning_tree_zdd and parse its JSON output.
+
+    spanning_tree_zdd を実行し、JSON 出力を解析。
+    """
+    # stdout をフラッシュして、C++ の stderr と順序が混ざらないようにする
+    # Flush stdout so Python output appears before C++ stderr
+    sys.stdout.flush()
+
+    # C++ 実行（stderr はリアルタイム表示、stdout のみキャプチャ）
+    # Execute C++ (stderr streams in real-time, only stdout is captured)
+    try:
+        result = subprocess.run(
+            cmd,
+            stdout=subprocess.PIPE,
+            stderr=None,  # stderr → 端末にリアルタイム出力
+            text=True,
+            check=True,
+            env=env
+        )
+
+        # stdout は JSON
+        json_output = result.stdout
+
+    except subprocess.CalledProcessError as e:
+        print(f"Error: C++ binary failed (exit code {e.returncode})")
+        sys.exit(1)
+    except Exception as e:
+        print(f"Error: Failed to run C++ binary: {e}")
+        sys.exit(1)
+
+    # JSON をパース
+    try:
+        return json.loads(json_output)
+    except json.JSONDecodeError as e:
+        print(f"Error: Failed to parse JSON output: {e}")
+        print("Output was:", json_output)
+        sys.exit(1)
+
+
+def _binary_input(text_file: Path, binary_file: Path) -> Path:
+    """
+    The binary form of an input if it is at least as new as the text file,
+    otherwise the text file (spanning_tree_zdd reads either).
+
+    テキストファイル以上に新しければ入力のバイナリ形式、そうでなければ
+    テキストファイル（spanning_tree_zdd はどちらも読める）。
+    """
+    if binary_file.exists() and (not text_file.exists()
+                                 or binary_file.stat().st_mtime >= text_file.stat().st_mtime):
+        return binary_file
+    return text_file
+
+
+def _counts_key(graph: CanonicalGraph, edge_sets_file: Path, automorphisms_file: Path,
+                apply_filter: bool, apply_burnside: bool, cpp_binary: Path) -> str:
+    """
+    Cache key of the counts: graph, MOPE family and group, up to isomorphism,
+    and the binary that computes them.
+
+    数え上げ結果のキャッシュキー: 同型を除いたグラフ・MOPE 族・群と、
+    それらを計算するバイナリ。
+    """
+    mopes = None
+    if apply_filter:
+        with open(edge_sets_file, 'r') as f:
+            mopes = [json.loads(line)["edges"] for line in f if line.strip()]
+    automorphisms = None
+    if automorphisms_file.exists():
+        with open(automorphisms_file, 'r') as f:
+            automorphisms = json.load(f)
+    return ArtifactCache.counts_key(graph, mopes, automorphisms, apply_burnside,
+                                    file_digest(cpp_binary))
+
+
+def _prepare(
     polyhedron_dir: Path,
     apply_filter: bool = False,
     apply_burnside: bool = True,
     output_base: Optional[Path] = None,
-    split_depth: int = 0
-) -> None:
+    split_depth: int = 0,
+    max_memory: Optional[str] = None,
+    out_of_core: Optional[Path] = None,
+    export_representatives: bool = False,
+    num_samples: int = 0,
+    sample_format: str = "jsonl",
+    sample_seed: int = 0,
+    sample_threads: int = 1,
+    export_range: Optional[str] = None,
+    export_all: bool = False,
+    export_encoding: str = "delta",
+    cache_dir: Optional[Path] = None,
+    estimate: bool = False,
+    estimate_states: int = 100000
+) -> dict:
     """
-    Execute the spanning tree pipeline with configurable phases.
+    Validate the inputs of one polyhedron, build its spanning_tree_zdd
+    command and look up the cache (see run_pipeline for the arguments).
 
-    設定可能なフェーズで全域木パイプラインを実行。
+    1 つの多面体の入力を検証し、spanning_tree_zdd のコマンドを組み立て、
+    キャッシュを参照する（引数は run_pipeline を参照）。
 
-    Modes:
-        apply_filter=False, apply_burnside=True  → Phase 4→6
-        apply_filter=True,  apply_burnside=True  → Phase 4→5→6
-        apply_filter=True,  apply_burnside=False → Phase 4→5
-
-    Args:
-        polyhedron_dir (Path): Path to polyhedron directory
-        apply_filter (bool): Enable Phase 5 overlap filtering
-        apply_burnside (bool): Enable Phase 6 Burnside's lemma
-        output_base (Path, optional): Base directory for output/
-
-    Outputs:
-        - output/polyhedra/<class>/<name>/spanning_tree/result.json
+    Returns:
+        dict: Context for _finish; "result" holds a cached result or None
     """
     # デフォルト設定
     if output_base is None:
@@ -136,7 +265,12 @@ def run_pipeline(
     edge_sets_file = polyhedron_dir / "unfoldings_edge_sets.jsonl"
     automorphisms_file = polyhedron_dir / "automorphisms.json"
     output_dir = output_base / "output" / "polyhedra" / poly_class / poly_name / "spanning_tree"
-    result_file = output_dir / "result.json"
+    result_file = output_dir / ("estimate.json" if estimate else "result.json")
+    representatives_file = output_dir / "representatives.jsonl"
+    sample_file = output_dir / ("samples.bin" if sample_format == "binary" else "samples.jsonl")
+    range_file = (output_dir / f"range_{export_range.replace(':', '_')}.jsonl"
+                  if export_range else None)
+    export_file = output_dir / "trees.stze"
 
     # 入力ファイルの検証
     # Validate input files
@@ -204,48 +338,101 @@ def run_pipeline(
     cmd = [str(cpp_binary), str(grh_file)]
 
     if apply_filter:
-        cmd.append(str(edge_sets_file))
+        cmd.append(str(_binary_input(edge_sets_file,
+                                     polyhedron_dir / MOPE_BINARY_NAME)))
 
     if apply_burnside:
-        cmd.extend(["--automorphisms", str(automorphisms_file)])
+        cmd.extend(["--automorphisms",
+                    str(_binary_input(automorphisms_file,
+                                      polyhedron_dir / AUTOMORPHISM_BINARY_NAME))])
 
     if split_depth > 0:
         cmd.extend(["--split-depth", str(split_depth)])
 
-    # stdout をフラッシュして、C++ の stderr と順序が混ざらないようにする
-    # Flush stdout so Python output appears before C++ stderr
-    sys.stdout.flush()
-
-    # C++ 実行（stderr はリアルタイム表示、stdout のみキャプチャ）
-    # Execute C++ (stderr streams in real-time, only stdout is captured)
-    try:
-        result = subprocess.run(
-            cmd,
-            stdout=subprocess.PIPE,
-            stderr=None,  # stderr → 端末にリアルタイム出力
-            text=True,
-            check=True
-        )
-
-        # stdout は JSON
-        json_output = result.stdout
-
-    except subprocess.CalledProcessError as e:
-        print(f"Error: C++ binary failed (exit code {e.returncode})")
-        sys.exit(1)
-    except Exception as e:
-        print(f"Error: Failed to run C++ binary: {e}")
-        sys.exit(1)
-
-    # JSON をパース
-    try:
-        result_data = json.loads(json_output)
-    except json.JSONDecodeError as e:
-        print(f"Error: Failed to parse JSON output: {e}")
-        print("Output was:", json_output)
-        sys.exit(1)
+    if max_memory:
+        cmd.extend(["--max-memory", max_memory])
+
+    if out_of_core:
+        cmd.extend(["--out-of-core", str(out_of_core)])
+
+    if export_representatives:
+        cmd.extend(["--export-representatives", str(representatives_file)])
+
+    if num_samples > 0:
+        cmd.extend(["--sample", str(num_samples),
+                    "--sample-output", str(sample_file),
+                    "--sample-format", sample_format,
+                    "--sample-seed", str(sample_seed),
+                    "--sample-threads", str(sample_threads)])
+
+    if export_range:
+        cmd.extend(["--export-range", export_range,
+                    "--range-output", str(range_file)])
+
+    if export_all:
+        cmd.extend(["--export-all", str(export_file),
+                    "--export-encoding", export_encoding,
+                    "--export-threads", str(sample_threads)])
+
+    if estimate:
+        cmd.extend(["--estimate", "--estimate-states", str(estimate_states)])
+
+    # キャッシュ（木を出力しない場合のみ）
+    # Cache lookup (only when no trees are written)
+    cache = None
+    cache_key = None
+    result_data = None
+    if cache_dir and not (export_representatives or num_samples > 0
+                          or export_range or export_all or estimate):
+        cache = ArtifactCache(cache_dir)
+        graph = CanonicalGraph.from_grh(grh_file)
+        cache_key = _counts_key(graph, edge_sets_file, automorphisms_file,
+                                apply_filter, apply_burnside, cpp_binary)
+        counts = cache.get("counts", cache_key)
+        if counts is not None:
+            # Only the invariant counts are cached; the rest describes this
+            # graph / キャッシュは不変な数のみ。残りはこのグラフのもの
+            print(f"  Cache:  hit ({cache_key[:12]}), skipping spanning_tree_zdd")
+            result_data = {"input_file": str(grh_file),
+                           "vertices": graph.num_vertices,
+                           "edges": len(graph.edges),
+                           **ArtifactCache.invariant_counts(counts),
+                           "cache": {"hit": True, "key": cache_key}}
+        else:
+            print(f"  Cache:  miss ({cache_key[:12]})")
+
+    return {
+        "cmd": cmd,
+        "mode_str": mode_str,
+        "result_file": result_file,
+        "apply_filter": apply_filter,
+        "apply_burnside": apply_burnside,
+        "representatives_file": representatives_file if export_representatives else None,
+        "sample_file": sample_file if num_samples > 0 else None,
+        "range_file": range_file,
+        "export_file": export_file if export_all else None,
+        "cache": cache,
+        "cache_key": cache_key,
+        "estimate": estimate,
+        "result": result_data,
+    }
+
+
+def _finish(ctx: dict, result_data: dict) -> None:
+    """
+    Store, save and summarize the result of one polyhedron.
 
-    # result.json に保存
+    1 つの多面体の結果を格納・保存し、サマリーを表示。
+    """
+    mode_str = ctx["mode_str"]
+    result_file = ctx["result_file"]
+    apply_filter = ctx["apply_filter"]
+    apply_burnside = ctx["apply_burnside"]
+    if ctx["result"] is None and ctx["cache"] is not None:
+        ctx["cache"].put("counts", ctx["cache_key"],
+                         ArtifactCache.invariant_counts(result_data))
+
+    # result.json（--estimate では estimate.json）に保存
     with open(result_file, 'w') as f:
         json.dump(result_data, f, indent=2)
 
@@ -253,6 +440,10 @@ def run_pipeline(
     print(f"Saved: {result_file}")
     print()
 
+    if ctx["estimate"]:
+        _print_estimate(mode_str, result_file, result_data["estimate"])
+        return
+
     # ====================================================================
     # 結果サマリー
     # Results summary
@@ -262,6 +453,40 @@ def run_pipeline(
     print()
     print("Results:")
 
+    # Memory budget / メモリ予算
+    if 'memory_budget' in result_data:
+        mb = result_data['memory_budget']
+        print(f"  Split depth (--max-memory):  {mb['shallowest_partition_depth']}"
+              f"–{mb['deepest_partition_depth']} (start {mb['split_depth']}, "
+              f"{mb['partitions']} partitions, {mb['refined_partitions']} refined)")
+
+    # Out-of-core storage / メモリ外格納
+    if 'out_of_core' in result_data:
+        oc = result_data['out_of_core']
+        print(f"  Out-of-core (--out-of-core): {oc['bytes_written'] / 2**20:.1f} MiB written, "
+              f"peak {oc['peak_disk_bytes'] / 2**20:.1f} MiB on disk, "
+              f"build {oc['build_nodes_per_sec']:.0f} nodes/s")
+
+    # Memory placement / メモリ配置
+    if 'memory_placement' in result_data:
+        mp = result_data['memory_placement']
+        nodes = mp['numa_nodes']
+        print(f"  Memory placement:            numa {mp['numa']} ({nodes} node{'' if nodes == 1 else 's'}), "
+              f"huge pages {'on' if mp['huge_pages'] else 'off'}"
+              f"{' (+malloc)' if mp.get('malloc_huge_pages') else ''}, "
+              f"pinned threads {'on' if mp['pinned_threads'] else 'off'}")
+
+    # Buffer pool / バッファプール
+    if 'buffer_pool' in result_data:
+        bp = result_data['buffer_pool']
+        print(f"  Buffer pool:                 {bp['allocated_bytes'] / 2**20:.1f} MiB allocated, "
+              f"{bp['reused_bytes'] / 2**20:.1f} MiB reused ({bp['reuses']}/{bp['leases']} leases)")
+
+    # Peak RSS (single runs only; a batch logs it once per manifest)
+    # ピーク RSS（単独実行のみ。バッチはマニフェストごとに 1 回ログに出す）
+    if 'process_peak_rss_bytes' in result_data:
+        print(f"  Peak RSS (process):          {result_data['process_peak_rss_bytes'] / 2**20:.1f} MiB")
+
     # Phase 4
     print(f"  Spanning trees (labeled):    {result_data['phase4']['spanning_tree_count']}")
 
@@ -278,12 +503,228 @@ def run_pipeline(
         if p6.get('burnside_applied'):
             print(f"  Nonisomorphic:               {p6['nonisomorphic_count']}")
             print(f"  Group order |Aut(Γ)|:        {p6['group_order']}")
+            if 'representative_count' in p6:
+                print(f"  Orbit representatives:       {p6['representative_count']}")
 
     print()
     print(f"Output: {result_file}")
+    for key in ("representatives_file", "sample_file", "range_file", "export_file"):
+        if ctx[key]:
+            print(f"        {ctx[key]}")
     print("=" * 60)
 
 
+def _print_estimate(mode_str: str, estimate_file: Path, est: dict) -> None:
+    """
+    Summarize the output of spanning_tree_zdd --estimate.
+
+    spanning_tree_zdd --estimate の出力のサマリーを表示。
+    """
+    p4 = est['phase4']
+    exact = ("exact" if p4['exact']
+             else f"{p4['exact_levels']}/{len(p4['levels'])} levels exact")
+    print("=" * 60)
+    print(f"Estimate Complete! ({mode_str}, nothing built)")
+    print()
+    print("Estimates:")
+    print(f"  Phase 4 nodes:               {p4['nodes']:.4g} "
+          f"({exact}, "
+          f"widest level {p4['peak_level_nodes']:.4g})")
+    print(f"  Spanning trees (labeled):    {p4['spanning_tree_count']:.4g}")
+    for phase, label in (('phase5', 'Phase 5'), ('phase6', 'Phase 6')):
+        p = est[phase]
+        if p['passes'] > 0:
+            print(f"  {label} passes:              {p['passes']} × {p['nodes_per_pass']:.4g} nodes "
+                  f"(from {p['sampled']} sampled)")
+    if 'nonisomorphic_count' in est:
+        print(f"  Nonisomorphic:               {est['nonisomorphic_count']:.4g}")
+    print(f"  Memory:                      {est['memory_bytes'] / 2**30:.2f} GiB")
+    if 'min_split_depth' in est:
+        print(f"  Split depth (--max-memory):  at least {est['min_split_depth']}")
+    print(f"  State expansion:             {est['expand_ms'] / 1000:.1f} s")
+    print()
+    print(f"Output: {estimate_file}")
+    print("=" * 60)
+
+
+def run_pipeline(
+    polyhedron_dir: Path,
+    apply_filter: bool = False,
+    apply_burnside: bool = True,
+    output_base: Optional[Path] = None,
+    split_depth: int = 0,
+    max_memory: Optional[str] = None,
+    out_of_core: Optional[Path] = None,
+    export_representatives: bool = False,
+    num_samples: int = 0,
+    sample_format: str = "jsonl",
+    sample_seed: int = 0,
+    sample_threads: int = 1,
+    export_range: Optional[str] = None,
+    export_all: bool = False,
+    export_encoding: str = "delta",
+    cache_dir: Optional[Path] = None,
+    numa: str = "default",
+    huge_pages: bool = False,
+    pin_threads: bool = False,
+    estimate: bool = False,
+    estimate_states: int = 100000
+) -> None:
+    """
+    Execute the spanning tree pipeline with configurable phases.
+
+    設定可能なフェーズで全域木パイプラインを実行。
+
+    Modes:
+        apply_filter=False, apply_burnside=True  → Phase 4→6
+        apply_filter=True,  apply_burnside=True  → Phase 4→5→6
+        apply_filter=True,  apply_burnside=False → Phase 4→5
+
+    Args:
+        polyhedron_dir (Path): Path to polyhedron directory
+        apply_filter (bool): Enable Phase 5 overlap filtering
+        apply_burnside (bool): Enable Phase 6 Burnside's lemma
+        output_base (Path, optional): Base directory for output/
+        split_depth (int): Partition the ZDD into 2^split_depth parts
+        max_memory (str, optional): Memory budget such as "8G"; the binary
+            probes for the split depth (starting from split_depth if given)
+            and splits partitions that outgrow the budget
+        out_of_core (Path, optional): Scratch directory; the diagrams are
+            kept level by level in segment files there and paged in by the
+            passes instead of being held in RAM
+        export_representatives (bool): Export one tree per isomorphism class
+            (requires apply_burnside)
+        num_samples (int): Draw this many uniform random trees from the
+            final family (0 = no sampling)
+        sample_format (str): "jsonl" or "binary"
+        sample_seed (int): Seed of the sampling RNG streams
+        sample_threads (int): Threads used for sampling
+        export_range (str, optional): "A:B" — export the trees with index
+            in [A, B) of the final family (lexicographic order)
+        export_all (bool): Export every tree of the final family as a block
+            file (read back with counting.tree_export)
+        export_encoding (str): "delta" or "bitset"
+        cache_dir (Path, optional): Artifact cache; counts of an isomorphic
+            polyhedron (same graph, MOPE family and group up to isomorphism)
+            are reused instead of running spanning_tree_zdd. Ignored when
+            trees are exported or sampled (default: no cache)
+        numa (str): "default", "interleave" (pages spread over all NUMA
+            nodes) or "first-touch" (pages on the node of the pinned worker
+            that first writes them)
+        huge_pages (bool): Transparent huge page hints for the diagram
+            arrays, TdZdd's node tables included
+        pin_threads (bool): Pin worker threads to CPUs, node by node
+        estimate (bool): Predict the diagram sizes, the memory needed and
+            the passes by sampling the spec transitions level by level,
+            without building anything (writes estimate.json instead of
+            result.json)
+        estimate_states (int): States expanded per level by the estimate;
+            levels up to this width are exact
+
+    Outputs:
+        - output/polyhedra/<class>/<name>/spanning_tree/result.json
+        - output/polyhedra/<class>/<name>/spanning_tree/representatives.jsonl
+          (only with export_representatives)
+        - output/polyhedra/<class>/<name>/spanning_tree/samples.jsonl or samples.bin
+          (only with num_samples > 0)
+        - output/polyhedra/<class>/<name>/spanning_tree/range_<A>_<B>.jsonl
+          (only with export_range)
+        - output/polyhedra/<class>/<name>/spanning_tree/trees.stze
+          (only with export_all)
+        - output/polyhedra/<class>/<name>/spanning_tree/estimate.json
+          (only with estimate, instead of result.json)
+    """
+    ctx = _prepare(polyhedron_dir, apply_filter, apply_burnside, output_base,
+                   split_depth=split_depth,
+                   max_memory=max_memory,
+                   out_of_core=out_of_core,
+                   export_representatives=export_representatives,
+                   num_samples=num_samples,
+                   sample_format=sample_format,
+                   sample_seed=sample_seed,
+                   sample_threads=sample_threads,
+                   export_range=export_range,
+                   export_all=export_all,
+                   export_encoding=export_encoding,
+                   cache_dir=cache_dir,
+                   estimate=estimate,
+                   estimate_states=estimate_states)
+    result_data = ctx["result"]
+    if result_data is None:
+        args, env = _placement(numa, huge_pages, pin_threads)
+        result_data = _run_binary(ctx["cmd"] + args, env)
+    _finish(ctx, result_data)
+
+
+def run_pipeline_batch(polyhedron_dirs: List[Path], jobs: int = 1,
+                       exclusive_edges: int = 60, numa: str = "default",
+                       huge_pages: bool = False, pin_threads: bool = False,
+                       **options) -> None:
+    """
+    Run the pipeline for many polyhedra in one spanning_tree_zdd process
+    (--manifest). Every polyhedron gets its own result.json as with
+    run_pipeline; cache hits are not sent to the binary.
+
+    多数の多面体のパイプラインを 1 つの spanning_tree_zdd プロセスで実行
+    （--manifest）。各多面体には run_pipeline と同様に個別の result.json が
+    書かれる。キャッシュヒットはバイナリに渡さない。
+
+    Args:
+        polyhedron_dirs (list): Polyhedron directories
+        jobs (int): Polyhedra processed concurrently (0 = all hardware threads)
+        exclusive_edges (int): Polyhedra with at least this many edges run
+            alone with every thread (0 = never)
+        numa, huge_pages, pin_threads: Memory placement of the whole
+            process (see run_pipeline)
+        **options: Keyword arguments of run_pipeline, applied to every polyhedron
+    """
+    contexts = [_prepare(d, **options) for d in polyhedron_dirs]
+    pending = [ctx for ctx in contexts if ctx["result"] is None]
+
+    if pending:
+        manifest = []
+        for ctx in pending:
+            fields = [str(ctx["result_file"])] + ctx["cmd"][1:]
+            if any(not f or any(c.isspace() for c in f) for f in fields):
+                raise ValueError(f"マニフェストのパスに空白は使えません: {ctx['result_file']}")
+            ctx["result_file"].unlink(missing_ok=True)
+            manifest.append(" ".join(fields) + "\n")
+
+        print("=" * 60)
+        print(f"Running C++ spanning_tree_zdd on {len(pending)} polyhedra "
+              f"(--jobs {jobs}, --exclusive-edges {exclusive_edges})")
+        print("=" * 60)
+        sys.stdout.flush()
+        args, env = _placement(numa, huge_pages, pin_threads)
+        subprocess.run(
+            [pending[0]["cmd"][0], "--manifest", "-", "--jobs", str(jobs),
+             "--exclusive-edges", str(exclusive_edges)] + args,
+            input="".join(manifest),
+            text=True,
+            env=env
+        )
+
+    # 失敗したジョブは result.json を残さない
+    # Failed jobs leave no result.json behind
+    failed = []
+    for ctx in contexts:
+        result_data = ctx["result"]
+        if result_data is None:
+            try:
+                with open(ctx["result_file"], 'r') as f:
+                    result_data = json.load(f)
+            except (OSError, json.JSONDecodeError):
+                failed.append(ctx["result_file"])
+                continue
+        _finish(ctx, result_data)
+
+    if failed:
+        print(f"Error: {len(failed)}/{len(contexts)} polyhedra failed:")
+        for result_file in failed:
+            print(f"  {result_file}")
+        sys.exit(1)
+
+
 def main():
     parser = argparse.ArgumentParser(
         description=(
@@ -296,8 +737,9 @@ def main():
     parser.add_argument(
         "--poly",
         type=str,
+        nargs="+",
         required=True,
-        help="多面体ディレクトリへのパス（例: data/polyhedra/johnson/n20）"
+        help="多面体ディレクトリへのパス（例: data/polyhedra/johnson/n20）。複数指定で 1 プロセスのバッチ実行"
     )
 
     parser.add_argument(
@@ -319,6 +761,109 @@ def main():
         help="ZDD を 2^N パーティションに分割しピークメモリ削減（デフォルト: 0 = 分割なし）"
     )
 
+    parser.add_argument(
+        "--max-memory",
+        type=str,
+        default=None,
+        metavar="SIZE",
+        help="メモリ予算（例: 8G, 512M）。試行構築から分割深さを選び、超過したパーティションは実行中に分割（--split-depth 指定時はそれを開始深さとする）"
+    )
+
+    parser.add_argument(
+        "--out-of-core",
+        type=str,
+        default=None,
+        metavar="DIR",
+        help="ZDD をレベルごとに DIR のセグメントファイルに置き、メモリマップで読み戻す（分割せずに物理メモリを超える構築用）"
+    )
+
+    parser.add_argument(
+        "--numa",
+        choices=["default", "interleave", "first-touch"],
+        default="default",
+        help="ZDD メモリの NUMA 配置: interleave は全ノードにページを分散、first-touch は固定したワーカが最初に書いたノードに置く（デフォルト: default）"
+    )
+
+    parser.add_argument(
+        "--huge-pages",
+        action="store_true",
+        help="ZDD の大きな配列（TdZdd のノード表を含む）に透過的ヒュージページを要求"
+    )
+
+    parser.add_argument(
+        "--pin-threads",
+        action="store_true",
+        help="ワーカスレッドを CPU に固定（NUMA ノードを順番に巡る）"
+    )
+
+    parser.add_argument(
+        "--representatives",
+        action="store_true",
+        help="各同型類の代表元（軌道の辞書式最小）を representatives.jsonl に出力（--noniso が必要）"
+    )
+
+    parser.add_argument(
+        "--sample",
+        type=int,
+        default=0,
+        help="最終的な族から一様ランダムに N 本の全域木を抽出（デフォルト: 0 = 抽出なし）"
+    )
+
+    parser.add_argument(
+        "--sample-format",
+        choices=["jsonl", "binary"],
+        default="jsonl",
+        help="サンプルの出力形式（デフォルト: jsonl）"
+    )
+
+    parser.add_argument(
+        "--sample-seed",
+        type=int,
+        default=0,
+        help="サンプリングの乱数シード（デフォルト: 0）"
+    )
+
+    parser.add_argument(
+        "--sample-threads",
+        type=int,
+        default=1,
+        help="サンプリングと --export-all のスレッド数（出力はスレッド数に依存しない、デフォルト: 1）"
+    )
+
+    parser.add_argument(
+        "--export-range",
+        type=str,
+        default=None,
+        metavar="A:B",
+        help="最終的な族の番号 [A, B)（昇順辺リストの辞書式順序）の全域木を出力"
+    )
+
+    parser.add_argument(
+        "--export-all",
+        action="store_true",
+        help="最終的な族の全ての全域木を trees.stze（ブロック形式）に出力"
+    )
+
+    parser.add_argument(
+        "--export-encoding",
+        choices=["delta", "bitset"],
+        default="delta",
+        help="--export-all の符号化（デフォルト: delta）"
+    )
+
+    parser.add_argument(
+        "--estimate",
+        action="store_true",
+        help="構築せずに ZDD のノード数・必要メモリ・パス数を予測し estimate.json に出力（spec の遷移をレベルごとに標本化）"
+    )
+
+    parser.add_argument(
+        "--estimate-states",
+        type=int,
+        default=100000,
+        help="--estimate でレベルごとに展開する状態数。この幅までのレベルは正確（デフォルト: 100000）"
+    )
+
     parser.add_argument(
         "--output-base",
         type=str,
@@ -326,21 +871,93 @@ def main():
         help="出力ベースディレクトリ（デフォルト: カレントディレクトリ）"
     )
 
+    parser.add_argument(
+        "--cache-dir",
+        type=str,
+        default=None,
+        help="成果物キャッシュのディレクトリ。同型な多面体の数え上げ結果を再利用（木の出力・抽出時は無効、デフォルト: 無効）"
+    )
+
+    parser.add_argument(
+        "--jobs",
+        type=int,
+        default=1,
+        help="バッチ実行で並行に処理する多面体の数（0 = 全ハードウェアスレッド、デフォルト: 1）"
+    )
+
+    parser.add_argument(
+        "--exclusive-edges",
+        type=int,
+        default=60,
+        help="バッチ実行で辺数がこの値以上の多面体は全スレッドを使い単独で実行（0 = 無効、デフォルト: 60）"
+    )
+
     args = parser.parse_args()
 
-    polyhedron_dir = Path(args.poly)
+    polyhedron_dirs = [Path(p) for p in args.poly]
 
-    if not polyhedron_dir.exists():
-        print(f"Error: Directory not found: {polyhedron_dir}")
-        sys.exit(1)
+    for polyhedron_dir in polyhedron_dirs:
+        if not polyhedron_dir.exists():
+            print(f"Error: Directory not found: {polyhedron_dir}")
+            sys.exit(1)
 
     apply_filter = args.no_overlap
     apply_burnside = args.noniso
     output_base = Path(args.output_base) if args.output_base else None
 
+    if args.representatives and not apply_burnside:
+        print("Error: --representatives requires --noniso")
+        sys.exit(1)
+
+    if (args.sample > 0 or args.export_range or args.export_all) and (args.split_depth > 0 or args.max_memory):
+        print("Error: --sample / --export-range / --export-all cannot be combined with --split-depth / --max-memory")
+        sys.exit(1)
+
+    if args.out_of_core and (args.split_depth > 0 or args.max_memory or args.representatives
+                             or args.sample > 0 or args.export_range or args.export_all):
+        print("Error: --out-of-core cannot be combined with --split-depth / --max-memory / "
+              "--representatives / --sample / --export-range / --export-all")
+        sys.exit(1)
+
+    if args.estimate and (args.split_depth > 0 or args.out_of_core or args.representatives
+                          or args.sample > 0 or args.export_range or args.export_all):
+        print("Error: --estimate cannot be combined with --split-depth / --out-of-core / "
+              "--representatives / --sample / --export-range / --export-all")
+        sys.exit(1)
+
+    if args.estimate_states < 2:
+        print("Error: --estimate-states must be at least 2")
+        sys.exit(1)
+
+    options = dict(
+        apply_filter=apply_filter,
+        apply_burnside=apply_burnside,
+        output_base=output_base,
+        split_depth=args.split_depth,
+        max_memory=args.max_memory,
+        out_of_core=Path(args.out_of_core) if args.out_of_core else None,
+        export_representatives=args.representatives,
+        num_samples=args.sample,
+        sample_format=args.sample_format,
+        sample_seed=args.sample_seed,
+        sample_threads=args.sample_threads,
+        export_range=args.export_range,
+        export_all=args.export_all,
+        export_encoding=args.export_encoding,
+        cache_dir=Path(args.cache_dir) if args.cache_dir else None,
+        numa=args.numa,
+        huge_pages=args.huge_pages,
+        pin_threads=args.pin_threads,
+        estimate=args.estimate,
+        estimate_states=args.estimate_states
+    )
+
     try:
-        run_pipeline(polyhedron_dir, apply_filter, apply_burnside, output_base,
-                     split_depth=args.split_depth)
+        if len(polyhedron_dirs) == 1:
+            run_pipeline(polyhedron_dirs[0], **options)
+        else:
+            run_pipeline_batch(polyhedron_dirs, jobs=args.jobs,
+                               exclusive_edges=args.exclusive_edges, **options)
     except Exception as e:
         print(f"\nError: {e}")
         import traceback
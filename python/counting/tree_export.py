@@ -0,0 +1,187 @@
+"""
+Tree Export Reader
+
+Handles:
+- Streaming the block files written by spanning_tree_zdd --export-all
+  (TreeExport.hpp format, bitset or delta encoding)
+- Conversion to JSONL ({"edges": [...]} per tree) for other tools
+
+全件出力リーダー:
+- spanning_tree_zdd --export-all が書き出すブロックファイル
+  （TreeExport.hpp 形式、bitset または delta 符号化）のストリーム読み込み
+- 他のツール向けの JSONL（1 本につき {"edges": [...]}）への変換
+
+Usage:
+    # Print the header / ヘッダを表示
+    PYTHONPATH=python python -m counting.tree_export trees.stze
+
+    # Convert to JSONL / JSONL に変換
+    PYTHONPATH=python python -m counting.tree_export trees.stze --jsonl out.jsonl
+"""
+
+import argparse
+import json
+import struct
+import sys
+from pathlib import Path
+from typing import BinaryIO, Iterator, List
+
+MAGIC = b"STZE"
+VERSION = 1
+HEADER = struct.Struct("<4sIIIQI")
+BLOCK_HEADER = struct.Struct("<II")
+ENCODINGS = {0: "bitset", 1: "delta"}
+
+
+def read_header(f: BinaryIO) -> dict:
+    """
+    Read the file header.
+
+    ファイルヘッダを読み込む。
+
+    Returns:
+        dict: num_edges, encoding ("bitset" / "delta"), num_trees, block_trees
+    """
+    raw = f.read(HEADER.size)
+    if len(raw) != HEADER.size:
+        raise ValueError("not a tree export file (truncated header)")
+    magic, version, num_edges, encoding, num_trees, block_trees = HEADER.unpack(raw)
+    if magic != MAGIC:
+        raise ValueError("not a tree export file (bad magic)")
+    if version != VERSION:
+        raise ValueError(f"unsupported version {version}")
+    if encoding not in ENCODINGS:
+        raise ValueError(f"unknown encoding {encoding}")
+    return {
+        "num_edges": num_edges,
+        "encoding": ENCODINGS[encoding],
+        "num_trees": num_trees,
+        "block_trees": block_trees,
+    }
+
+
+def _read_varint(payload: bytes, pos: int) -> tuple[int, int]:
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(payload):
+            raise ValueError("truncated varint")
+        b = payload[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return value, pos
+        shift += 7
+
+
+def _decode_block(payload: bytes, trees: int, num_edges: int,
+                  encoding: str) -> Iterator[List[int]]:
+    if encoding == "bitset":
+        width = (num_edges + 63) // 64 * 8
+        if len(payload) < trees * width:
+            raise ValueError("truncated block")
+        for t in range(trees):
+            bits = int.from_bytes(payload[t * width:(t + 1) * width], "little")
+            edges = []
+            while bits:
+                low = bits & -bits
+                edges.append(low.bit_length() - 1)
+                bits ^= low
+            yield edges
+        return
+
+    pos = 0
+    prev: List[int] = []
+    for _ in range(trees):
+        k, pos = _read_varint(payload, pos)
+        m, pos = _read_varint(payload, pos)
+        if k > len(prev):
+            raise ValueError("corrupt tree")
+        edges = prev[:k]
+        last = edges[-1] if edges else -1
+        for _ in range(m):
+            d, pos = _read_varint(payload, pos)
+            last += d + 1
+            edges.append(last)
+        prev = edges
+        yield list(edges)
+
+
+def iter_trees(path: Path) -> Iterator[List[int]]:
+    """
+    Stream the trees of an export file, one block in memory at a time.
+
+    出力ファイルの木をストリームで返す（メモリ上には 1 ブロックのみ）。
+
+    Args:
+        path (Path): File written by spanning_tree_zdd --export-all
+
+    Yields:
+        list[int]: Cut edge indices of one tree, ascending
+    """
+    with open(path, "rb") as f:
+        header = read_header(f)
+        while True:
+            raw = f.read(BLOCK_HEADER.size)
+            if not raw:
+                return
+            if len(raw) != BLOCK_HEADER.size:
+                raise ValueError("truncated block header")
+            trees, size = BLOCK_HEADER.unpack(raw)
+            payload = f.read(size)
+            if len(payload) != size:
+                raise ValueError("truncated block")
+            yield from _decode_block(payload, trees, header["num_edges"],
+                                     header["encoding"])
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=(
+            "Read a spanning tree block export (spanning_tree_zdd --export-all).\n"
+            "全域木のブロック出力（spanning_tree_zdd --export-all）を読み込む"
+        )
+    )
+    parser.add_argument("file", type=str, help="--export-all の出力ファイル")
+    parser.add_argument(
+        "--jsonl",
+        type=str,
+        default=None,
+        help="JSONL（1 本につき {\"edges\": [...]}）に変換して書き出す（- で標準出力）"
+    )
+    args = parser.parse_args()
+
+    path = Path(args.file)
+    if not path.exists():
+        print(f"Error: File not found: {path}")
+        sys.exit(1)
+
+    try:
+        with open(path, "rb") as f:
+            header = read_header(f)
+        print(json.dumps(header), file=sys.stderr)
+
+        if args.jsonl is None:
+            return
+
+        out = sys.stdout if args.jsonl == "-" else open(args.jsonl, "w")
+        count = 0
+        try:
+            for edges in iter_trees(path):
+                out.write(json.dumps({"edges": edges}) + "\n")
+                count += 1
+        finally:
+            if out is not sys.stdout:
+                out.close()
+    except ValueError as e:
+        print(f"Error: {path}: {e}")
+        sys.exit(1)
+
+    if count != header["num_trees"]:
+        print(f"Error: expected {header['num_trees']} trees, read {count}")
+        sys.exit(1)
+    print(f"Wrote {count} trees", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -25,17 +25,24 @@ Phase 1 における責務:
 
 Usage:
     PYTHONPATH=python python -m edge_relabeling --poly <polyhedron_path>
+    
+    # Several polyhedra in one decompose process / 複数の多面体を 1 プロセスで
+    PYTHONPATH=python python -m edge_relabeling --poly <dir>/*/polyhedron.json --jobs 0
+    
+    # Reuse edge orders of isomorphic graphs / 同型なグラフの辺順序を再利用
+    PYTHONPATH=python python -m edge_relabeling --poly <polyhedron_path> --cache-dir <dir>
 """
 
 import argparse
 import sys
 import json
 from pathlib import Path
-from typing import Optional
+from typing import List, Optional
 
+from artifact_cache import ArtifactCache, CanonicalGraph, read_grh
 from .graph_builder import build_vertex_edge_graph
 from .grh_generator import generate_grh
-from .decompose_runner import run_decompose_with_stats
+from .decompose_runner import binary_digest, count_edges, run_decompose_batch, run_decompose_with_stats
 from .edge_mapper import create_edge_mapping, verify_mapping, save_edge_mapping
 from .relabeler import load_polyhedron, relabel_polyhedron, verify_relabeling, save_polyhedron
 
@@ -61,39 +68,15 @@ def get_polyhedron_info(polyhedron_path: Path) -> tuple[str, str]:
     return poly_class, poly_name
 
 
-def run_phase1(
-    polyhedron_path: Path,
-    output_base: Optional[Path] = None,
-    data_base: Optional[Path] = None
-) -> None:
+def _prepare(polyhedron_path: Path, output_base: Path, data_base: Path) -> dict:
     """
-    Execute all Phase 1 steps in sequence.
-    
-    Phase 1 の全ステップを順次実行。
+    Print the header and run Step 1 (.grh generation) for one polyhedron.
     
-    Args:
-        polyhedron_path (Path): Path to input polyhedron.json
-        output_base (Path, optional): Base directory for output/ (default: current directory)
-        data_base (Path, optional): Base directory for data/ (default: current directory)
-    
-    Outputs:
-        - output/polyhedra/<class>/<name>/edge_relabeling/input.grh
-        - output/polyhedra/<class>/<name>/edge_relabeling/output.grh
-        - data/polyhedra/<class>/<name>/edge_mapping.json
-        - data/polyhedra/<class>/<name>/polyhedron_relabeled.json
+    1 つの多面体についてヘッダーを表示し、Step 1（.grh 生成）を実行。
     
-    Steps:
-        1. Generate .grh file (graph_builder + grh_generator)
-        2. Run decompose for pathwidth optimization
-        3. Extract edge mapping (edge_mapper)
-        4. Relabel polyhedron edges (relabeler)
+    Returns:
+        dict: Polyhedron data and the paths used by the later steps
     """
-    # デフォルト設定
-    if output_base is None:
-        output_base = Path.cwd()
-    if data_base is None:
-        data_base = Path.cwd()
-    
     # 多面体情報を取得
     poly_class, poly_name = get_polyhedron_info(polyhedron_path)
     
@@ -112,43 +95,123 @@ def run_phase1(
     data_dir.mkdir(parents=True, exist_ok=True)
     
     # ファイルパスの設定
-    input_grh = output_dir / "input.grh"
-    output_grh = output_dir / "output.grh"
-    edge_mapping_json = data_dir / "edge_mapping.json"
-    polyhedron_relabeled_json = data_dir / "polyhedron_relabeled.json"
+    ctx = {
+        "name": f"{poly_class}/{poly_name}",
+        "input_grh": output_dir / "input.grh",
+        "output_grh": output_dir / "output.grh",
+        "order_stats_json": output_dir / "order_stats.json",
+        "edge_mapping_json": data_dir / "edge_mapping.json",
+        "polyhedron_relabeled_json": data_dir / "polyhedron_relabeled.json",
+    }
     
     # Step 1: .grh ファイル生成
     print("[Step 1/4] Generating .grh file...")
     
     with open(polyhedron_path, 'r') as f:
-        polyhedron = json.load(f)
+        ctx["polyhedron"] = json.load(f)
     
-    edge_to_vertices = build_vertex_edge_graph(polyhedron)
-    generate_grh(edge_to_vertices, input_grh)
+    edge_to_vertices = build_vertex_edge_graph(ctx["polyhedron"])
+    generate_grh(edge_to_vertices, ctx["input_grh"])
     
     num_vertices = max(max(v) for v in edge_to_vertices.values()) + 1
     num_edges = len(edge_to_vertices)
     
-    print(f"  Generated: {input_grh}")
+    print(f"  Generated: {ctx['input_grh']}")
     print(f"    Edges:    {num_edges}")
     print(f"    Vertices: {num_vertices}")
     print()
+    return ctx
+
+
+def _report_decompose(ctx: dict, input_edges: int, output_edges: int,
+                      summary: dict) -> None:
+    """
+    Print the Step 2 results and write order_stats.json.
     
-    # Step 2: decompose 実行
-    print("[Step 2/4] Running decompose (pathwidth optimization)...")
-    
-    input_edges, output_edges = run_decompose_with_stats(input_grh, output_grh)
-    
-    print(f"  Input:  {input_grh}")
-    print(f"  Output: {output_grh}")
+    Step 2 の結果を表示し、order_stats.json を書き出す。
+    """
+    print(f"  Input:  {ctx['input_grh']}")
+    print(f"  Output: {ctx['output_grh']}")
     print(f"    Input edges:  {input_edges}")
     print(f"    Output edges: {output_edges}")
+    if "decompose" in summary:
+        d = summary["decompose"]
+        status = "optimal" if d["optimal"] else f"gap {d['gap']}"
+        print(f"    Width:        {d['width']} "
+              f"(lower bound {d['lower_bound']}, {status})")
+        print(f"    Time to best: {d['time_to_best']:.3f}s "
+              f"(total {d['elapsed']:.3f}s)")
+    if "edge_order" in summary:
+        o = summary["edge_order"]
+        print(f"    Frontier:     {o['frontier_width']} "
+              f"(before local search {o['initial_frontier_width']})")
+        if "predicted_nodes" in o:
+            print(f"    Predicted ZDD nodes: {o['predicted_nodes']} "
+                  f"(before {o['initial_predicted_nodes']}, -1 = over the probe limit)")
+    stats = {key: summary[key] for key in ("decompose", "edge_order") if key in summary}
+    with open(ctx["order_stats_json"], 'w') as f:
+        json.dump(stats, f, indent=2)
+    print(f"  Stats:  {ctx['order_stats_json']}")
     
     if input_edges != output_edges:
         print(f"  ERROR: Edge count mismatch!")
         sys.exit(1)
     
     print()
+
+
+def _order_params(time_limit: float, gap: int, order_iterations: int,
+                  probe_states: int) -> dict:
+    """
+    Parameters that determine the edge order (threads only change the speed),
+    and the binary that computes it.
+    
+    辺順序を決めるパラメータ（threads は速度のみに影響）と、それを計算する
+    バイナリ。
+    """
+    return {"time": time_limit, "gap": gap,
+            "order_iterations": order_iterations, "probe_states": probe_states,
+            "code": binary_digest()}
+
+
+def _load_cached_order(ctx: dict, cache: ArtifactCache, params: dict) -> Optional[dict]:
+    """
+    Write output.grh from a cached order of an isomorphic graph.
+    
+    同型なグラフのキャッシュ済み順序から output.grh を書き出す。
+    
+    Returns:
+        dict or None: Cached summary on a hit, None on a miss
+    """
+    ctx["graph"] = CanonicalGraph.from_grh(ctx["input_grh"])
+    entry = cache.get_edge_order(ctx["graph"], params)
+    if entry is None:
+        return None
+    generate_grh(dict(enumerate(entry["order"])), ctx["output_grh"])
+    print(f"  Cache:  hit (graph {ctx['graph'].key[:12]})")
+    return entry["summary"]
+
+
+def _store_order(ctx: dict, cache: ArtifactCache, params: dict, summary: dict) -> None:
+    """Store the order in output.grh / output.grh の順序を格納"""
+    _, order = read_grh(ctx["output_grh"])
+    stats = {key: summary[key] for key in ("decompose", "edge_order") if key in summary}
+    cache.put_edge_order(ctx["graph"], params, order, stats)
+    print(f"  Cache:  stored (graph {ctx['graph'].key[:12]})")
+
+
+def _finish(ctx: dict) -> None:
+    """
+    Run Steps 3 and 4 (edge mapping, relabeling) for one polyhedron.
+    
+    1 つの多面体について Step 3・4（辺ラベル対応表、貼り替え）を実行。
+    """
+    input_grh = ctx["input_grh"]
+    output_grh = ctx["output_grh"]
+    order_stats_json = ctx["order_stats_json"]
+    edge_mapping_json = ctx["edge_mapping_json"]
+    polyhedron_relabeled_json = ctx["polyhedron_relabeled_json"]
+    polyhedron = ctx["polyhedron"]
     
     # Step 3: 辺ラベル対応表の抽出
     print("[Step 3/4] Extracting edge mapping...")
@@ -183,11 +246,164 @@ def run_phase1(
     print("Output files:")
     print(f"  - {input_grh}")
     print(f"  - {output_grh}")
+    print(f"  - {order_stats_json}")
     print(f"  - {edge_mapping_json}")
     print(f"  - {polyhedron_relabeled_json}")
     print("=" * 60)
 
 
+def run_phase1(
+    polyhedron_path: Path,
+    output_base: Optional[Path] = None,
+    data_base: Optional[Path] = None,
+    threads: int = 1,
+    time_limit: float = 30.0,
+    gap: int = 0,
+    order_iterations: int = 0,
+    probe_states: int = 0,
+    cache_dir: Optional[Path] = None
+) -> None:
+    """
+    Execute all Phase 1 steps in sequence.
+    
+    Phase 1 の全ステップを順次実行。
+    
+    Args:
+        polyhedron_path (Path): Path to input polyhedron.json
+        output_base (Path, optional): Base directory for output/ (default: current directory)
+        data_base (Path, optional): Base directory for data/ (default: current directory)
+        threads (int): decompose branch-and-bound threads
+            (1 = sequential and deterministic, 0 = all hardware threads)
+        time_limit (float): decompose time limit in seconds
+        gap (int): Accept an order within gap of the pathwidth lower bound
+            (0 = stop early only on a proven optimum)
+        order_iterations (int): Edge-order local search steps (0 = off)
+        probe_states (int): Per-level state cap of the ZDD node-count
+            probe (0 = rank candidate orders by frontier width only)
+        cache_dir (Path, optional): Artifact cache; the edge order of an
+            isomorphic graph computed with the same parameters is reused
+            instead of running decompose (default: no cache)
+    
+    Outputs:
+        - output/polyhedra/<class>/<name>/edge_relabeling/input.grh
+        - output/polyhedra/<class>/<name>/edge_relabeling/output.grh
+        - output/polyhedra/<class>/<name>/edge_relabeling/order_stats.json
+        - data/polyhedra/<class>/<name>/edge_mapping.json
+        - data/polyhedra/<class>/<name>/polyhedron_relabeled.json
+    
+    Steps:
+        1. Generate .grh file (graph_builder + grh_generator)
+        2. Run decompose for pathwidth optimization
+        3. Extract edge mapping (edge_mapper)
+        4. Relabel polyhedron edges (relabeler)
+    """
+    # デフォルト設定
+    if output_base is None:
+        output_base = Path.cwd()
+    if data_base is None:
+        data_base = Path.cwd()
+    
+    ctx = _prepare(polyhedron_path, output_base, data_base)
+    
+    # Step 2: decompose 実行
+    print("[Step 2/4] Running decompose (pathwidth optimization)...")
+    
+    cache = ArtifactCache(cache_dir) if cache_dir else None
+    params = _order_params(time_limit, gap, order_iterations, probe_states) if cache else None
+    summary = _load_cached_order(ctx, cache, params) if cache else None
+    if summary is None:
+        input_edges, output_edges, summary = run_decompose_with_stats(
+            ctx["input_grh"], ctx["output_grh"], threads, time_limit, gap,
+            order_iterations, probe_states)
+        if cache:
+            _store_order(ctx, cache, params, summary)
+    else:
+        input_edges, output_edges = count_edges(ctx["input_grh"]), count_edges(ctx["output_grh"])
+    _report_decompose(ctx, input_edges, output_edges, summary)
+    
+    _finish(ctx)
+
+
+def run_phase1_batch(
+    polyhedron_paths: List[Path],
+    output_base: Optional[Path] = None,
+    data_base: Optional[Path] = None,
+    jobs: int = 1,
+    threads: int = 1,
+    time_limit: float = 30.0,
+    gap: int = 0,
+    order_iterations: int = 0,
+    probe_states: int = 0,
+    cache_dir: Optional[Path] = None
+) -> None:
+    """
+    Execute Phase 1 for many polyhedra with a single decompose process.
+    
+    1 つの decompose プロセスで多数の多面体の Phase 1 を実行。
+    
+    Args:
+        polyhedron_paths (list[Path]): Paths to input polyhedron.json files
+        output_base, data_base: See run_phase1
+        jobs (int): Polyhedra decomposed concurrently (0 = all cores)
+        threads, time_limit, gap, order_iterations, probe_states, cache_dir:
+            See run_phase1 (applied to every polyhedron; cache hits are
+            left out of the manifest)
+    
+    Steps:
+        1. Generate every .grh file
+        2. Decompose all of them in one edge_relabeling --manifest run
+        3-4. Edge mapping and relabeling per polyhedron
+    
+    Outputs are the same files as run_phase1, for each polyhedron.
+    """
+    # デフォルト設定
+    if output_base is None:
+        output_base = Path.cwd()
+    if data_base is None:
+        data_base = Path.cwd()
+    
+    contexts = [_prepare(path, output_base, data_base) for path in polyhedron_paths]
+    
+    # Step 2: 全多面体の decompose を一括実行
+    print("=" * 60)
+    print(f"[Step 2/4] Running decompose on {len(contexts)} polyhedra "
+          f"(jobs: {jobs}, threads per job: {threads})...")
+    print("=" * 60)
+    print()
+    
+    cache = ArtifactCache(cache_dir) if cache_dir else None
+    params = _order_params(time_limit, gap, order_iterations, probe_states) if cache else None
+    summaries = {}
+    if cache:
+        for ctx in contexts:
+            print(f"[Step 2/4] {ctx['name']}")
+            summary = _load_cached_order(ctx, cache, params)
+            if summary is None:
+                print("  Cache:  miss")
+            else:
+                summaries[str(ctx["output_grh"])] = summary
+        print()
+    
+    for ctx in contexts:
+        ctx["cached"] = str(ctx["output_grh"]) in summaries
+    pending = [ctx for ctx in contexts if not ctx["cached"]]
+    if pending:
+        computed = run_decompose_batch(
+            [(ctx["input_grh"], ctx["output_grh"]) for ctx in pending],
+            jobs, threads, time_limit, gap, order_iterations, probe_states)
+        summaries.update(computed)
+    
+    for ctx in contexts:
+        print(f"[Step 2/4] {ctx['name']}")
+        summary = summaries[str(ctx["output_grh"])]
+        if cache and not ctx["cached"]:
+            _store_order(ctx, cache, params, summary)
+        _report_decompose(ctx, count_edges(ctx["input_grh"]),
+                          count_edges(ctx["output_grh"]), summary)
+        _finish(ctx)
+        print()
+
+
 def main():
     parser = argparse.ArgumentParser(
         description="Phase 1: Edge Relabeling - 多面体の辺ラベルをパス幅最適化された順序に貼り直す"
@@ -196,8 +412,16 @@ def main():
     parser.add_argument(
         "--poly",
         type=str,
+        nargs="+",
         required=True,
-        help="入力 polyhedron.json のパス"
+        help="入力 polyhedron.json のパス（複数指定で 1 つの decompose プロセスで一括処理）"
+    )
+    
+    parser.add_argument(
+        "--jobs",
+        type=int,
+        default=1,
+        help="複数の --poly を並行に分解する数（デフォルト: 1、0 = 全コア）"
     )
     
     parser.add_argument(
@@ -214,19 +438,76 @@ def main():
         help="データベースディレクトリ（デフォルト: カレントディレクトリ）"
     )
     
+    parser.add_argument(
+        "--threads",
+        type=int,
+        default=1,
+        help="decompose の分枝限定法のスレッド数（デフォルト: 1 = 逐次・決定的、0 = 全コア）"
+    )
+    
+    parser.add_argument(
+        "--time",
+        type=float,
+        default=30.0,
+        help="decompose の時間制限（秒、デフォルト: 30）。最適性が証明されればそれより早く終了"
+    )
+    
+    parser.add_argument(
+        "--gap",
+        type=int,
+        default=0,
+        help="パス幅の下界から gap 以内の順序で探索を打ち切る（デフォルト: 0 = 最適性の証明時のみ）"
+    )
+    
+    parser.add_argument(
+        "--order-iterations",
+        type=int,
+        default=0,
+        help="辺順序の局所探索のステップ数（デフォルト: 0 = 無効、20000 程度で有効）"
+    )
+    
+    parser.add_argument(
+        "--probe-states",
+        type=int,
+        default=0,
+        help="ZDD ノード数予測の 1 レベルあたりの状態数上限（デフォルト: 0 = 無効、フロンティア幅のみで評価）"
+    )
+    
+    parser.add_argument(
+        "--cache-dir",
+        type=str,
+        default=None,
+        help="成果物キャッシュのディレクトリ。同じパラメータで計算済みの同型なグラフの辺順序を再利用（デフォルト: 無効）"
+    )
+    
     args = parser.parse_args()
     
-    polyhedron_path = Path(args.poly)
+    polyhedron_paths = [Path(p) for p in args.poly]
+    
+    for polyhedron_path in polyhedron_paths:
+        if not polyhedron_path.exists():
+            print(f"Error: File not found: {polyhedron_path}")
+            sys.exit(1)
     
-    if not polyhedron_path.exists():
-        print(f"Error: File not found: {polyhedron_path}")
+    if args.jobs < 0:
+        print("Error: --jobs must be non-negative")
         sys.exit(1)
     
     output_base = Path(args.output_base) if args.output_base else None
     data_base = Path(args.data_base) if args.data_base else None
+    cache_dir = Path(args.cache_dir) if args.cache_dir else None
     
     try:
-        run_phase1(polyhedron_path, output_base, data_base)
+        if len(polyhedron_paths) == 1:
+            run_phase1(polyhedron_paths[0], output_base, data_base, threads=args.threads,
+                       time_limit=args.time, gap=args.gap,
+                       order_iterations=args.order_iterations,
+                       probe_states=args.probe_states, cache_dir=cache_dir)
+        else:
+            run_phase1_batch(polyhedron_paths, output_base, data_base, jobs=args.jobs,
+                             threads=args.threads, time_limit=args.time, gap=args.gap,
+                             order_iterations=args.order_iterations,
+                             probe_states=args.probe_states, cache_dir=cache_dir)
     except Exception as e:
         print(f"\nError: {e}")
         import traceback
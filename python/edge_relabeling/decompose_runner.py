@@ -5,13 +5,13 @@ Handles:
 - Subprocess invocation of cpp/edge_relabeling/build/edge_relabeling
 - Pathwidth optimization via lib/decompose
 - Standard input/output stream management
-- Does NOT modify the decompose algorithm itself
+- Batch mode: many .grh files decomposed concurrently in one process
 
 decompose 実行モジュール:
 - cpp/edge_relabeling/build/edge_relabeling のサブプロセス呼び出し
 - lib/decompose によるパス幅最適化
 - 標準入出力ストリームの管理
-- decompose アルゴリズム自体は変更しない
+- バッチモード: 1 プロセスで多数の .grh ファイルを並行して分解
 
 Responsibility in Phase 1:
 - Invokes the C++ binary that wraps lib/decompose
@@ -26,10 +26,103 @@ Phase 1 における責務:
 
 import subprocess
 from pathlib import Path
-from typing import Tuple
+from typing import Dict, List, Tuple
 
+from artifact_cache import file_digest
 
-def run_decompose(input_grh_path: Path, output_grh_path: Path) -> None:
+
+def _parse_value(text: str):
+    if text in ("yes", "no"):
+        return text == "yes"
+    for convert in (int, float):
+        try:
+            return convert(text)
+        except ValueError:
+            pass
+    return text
+
+
+def parse_summary(stderr: str) -> dict:
+    """
+    Parse the "<name>: key=value ..." summary lines printed by the binary.
+
+    バイナリが出力する "<name>: key=value ..." 形式の要約行を解析。
+
+    Returns:
+        dict: {"decompose": {width, lower_bound, gap, optimal, time_to_best,
+            elapsed}, "edge_order": {frontier_width, initial_frontier_width,
+            weight, initial_weight[, predicted_nodes,
+            initial_predicted_nodes]}}; sections absent from stderr are omitted
+    """
+    summary = {}
+    for line in stderr.splitlines():
+        name, sep, rest = line.partition(": ")
+        if not sep or name not in ("decompose", "edge_order"):
+            continue
+        summary[name] = {
+            key: _parse_value(value)
+            for key, value in (item.split("=", 1) for item in rest.split())
+        }
+    return summary
+
+
+def parse_batch_summary(stderr: str) -> Dict[str, dict]:
+    """
+    Split the stderr of a --manifest run into per-job summaries.
+
+    --manifest 実行時の stderr をジョブごとの要約に分割。
+
+    Returns:
+        dict: output path → {"input", "status" ("ok" / "error"),
+            "errors" (list of lines), plus the sections of parse_summary}
+    """
+    jobs = {}
+    blocks = stderr.split("job: ")[1:]
+    for block in blocks:
+        header, _, body = block.partition("\n")
+        fields = dict(item.split("=", 1) for item in header.split())
+        job = parse_summary(body)
+        job["input"] = fields["input"]
+        job["status"] = fields["status"]
+        job["errors"] = [line for line in body.splitlines() if line.startswith("Error:")]
+        jobs[fields["output"]] = job
+    return jobs
+
+
+def _binary_path() -> Path:
+    # C++ バイナリのパスを解決
+    binary_path = Path(__file__).parent.parent.parent / "cpp" / "edge_relabeling" / "build" / "edge_relabeling"
+    
+    if not binary_path.exists():
+        raise FileNotFoundError(
+            f"C++ バイナリが見つかりません: {binary_path}\n"
+            f"以下のコマンドでビルドしてください:\n"
+            f"cd cpp/edge_relabeling && mkdir -p build && cd build && cmake .. && make"
+        )
+    return binary_path
+
+
+def binary_digest() -> str:
+    """
+    Digest of the C++ binary; part of the edge-order cache key, so orders
+    computed by an older build are not reused.
+
+    C++ バイナリのダイジェスト。辺順序のキャッシュキーに含め、古いビルドで
+    計算した順序を再利用しない。
+    """
+    return file_digest(_binary_path())
+
+
+def _search_args(threads: int, time_limit: float, gap: int,
+                 order_iterations: int, probe_states: int) -> List[str]:
+    return ["--threads", str(threads), "--time", str(time_limit), "--gap", str(gap),
+            "--order-iterations", str(order_iterations),
+            "--probe-states", str(probe_states)]
+
+
+def run_decompose(input_grh_path: Path, output_grh_path: Path, threads: int = 1,
+                  time_limit: float = 30.0, gap: int = 0,
+                  order_iterations: int = 0, probe_states: int = 0) -> dict:
     """
     Run decompose to obtain pathwidth-optimized edge ordering.
     
@@ -38,6 +131,18 @@ def run_decompose(input_grh_path: Path, output_grh_path: Path) -> None:
     Args:
         input_grh_path (Path): Input .grh file path (decompose input format)
         output_grh_path (Path): Output .grh file path (decompose output format)
+        threads (int): Branch-and-bound threads (1 = sequential and
+            deterministic, 0 = all hardware threads)
+        time_limit (float): Time limit in seconds
+        gap (int): Stop once the width is within gap of the lower bound
+            (0 = stop early only on a proven optimum)
+        order_iterations (int): Local search steps on the edge order
+            (0 = keep the vertex-order-derived edge order)
+        probe_states (int): Per-level state cap of the ZDD node-count probe
+            (0 = rank candidate orders by frontier width only)
+    
+    Returns:
+        dict: Search and edge-order summary (see parse_summary)
     
     Raises:
         FileNotFoundError: If C++ binary not found
@@ -47,15 +152,7 @@ def run_decompose(input_grh_path: Path, output_grh_path: Path) -> None:
         The C++ binary must be built first:
         cd cpp/edge_relabeling && mkdir -p build && cd build && cmake .. && make
     """
-    # C++ バイナリのパスを解決
-    binary_path = Path(__file__).parent.parent.parent / "cpp" / "edge_relabeling" / "build" / "edge_relabeling"
-    
-    if not binary_path.exists():
-        raise FileNotFoundError(
-            f"C++ バイナリが見つかりません: {binary_path}\n"
-            f"以下のコマンドでビルドしてください:\n"
-            f"cd cpp/edge_relabeling && mkdir -p build && cd build && cmake .. && make"
-        )
+    binary_path = _binary_path()
     
     # 入力ファイルの存在確認
     if not input_grh_path.exists():
@@ -70,7 +167,8 @@ def run_decompose(input_grh_path: Path, output_grh_path: Path) -> None:
              open(output_grh_path, 'w') as outfile:
             
             result = subprocess.run(
-                [str(binary_path)],
+                [str(binary_path)] + _search_args(threads, time_limit, gap,
+                                                  order_iterations, probe_states),
                 stdin=infile,
                 stdout=outfile,
                 stderr=subprocess.PIPE,
@@ -85,9 +183,78 @@ def run_decompose(input_grh_path: Path, output_grh_path: Path) -> None:
         )
     except Exception as e:
         raise RuntimeError(f"decompose の実行中に予期しないエラーが発生しました: {e}")
+    
+    return parse_summary(result.stderr)
 
 
-def run_decompose_with_stats(input_grh_path: Path, output_grh_path: Path) -> Tuple[int, int]:
+def run_decompose_batch(jobs: List[Tuple[Path, Path]], parallel_jobs: int = 1,
+                        threads: int = 1, time_limit: float = 30.0, gap: int = 0,
+                        order_iterations: int = 0,
+                        probe_states: int = 0) -> Dict[str, dict]:
+    """
+    Decompose many .grh files in one edge_relabeling process (--manifest).
+
+    1 つの edge_relabeling プロセスで多数の .grh ファイルを分解（--manifest）。
+
+    Args:
+        jobs (list): (input .grh, output .grh) pairs
+        parallel_jobs (int): Graphs decomposed concurrently
+            (0 = all hardware threads)
+        threads, time_limit, gap, order_iterations, probe_states:
+            See run_decompose (applied to every graph)
+
+    Returns:
+        dict: str(output path) → job summary (see parse_batch_summary)
+
+    Raises:
+        FileNotFoundError: If C++ binary or an input file is not found
+        RuntimeError: If any graph fails (all other outputs are still written)
+    """
+    binary_path = _binary_path()
+    
+    manifest = []
+    for input_grh_path, output_grh_path in jobs:
+        if not input_grh_path.exists():
+            raise FileNotFoundError(f"入力ファイルが見つかりません: {input_grh_path}")
+        if any(c.isspace() for c in f"{input_grh_path}{output_grh_path}"):
+            raise ValueError(f"マニフェストのパスに空白は使えません: {input_grh_path}")
+        output_grh_path.parent.mkdir(parents=True, exist_ok=True)
+        manifest.append(f"{input_grh_path} {output_grh_path}\n")
+    
+    result = subprocess.run(
+        [str(binary_path), "--manifest", "-", "--jobs", str(parallel_jobs)]
+        + _search_args(threads, time_limit, gap, order_iterations, probe_states),
+        input="".join(manifest),
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        text=True
+    )
+    summaries = parse_batch_summary(result.stderr)
+    
+    failed = [f"{out}: {' '.join(job['errors'])}"
+              for out, job in summaries.items() if job["status"] != "ok"]
+    if result.returncode != 0 or len(summaries) != len(jobs):
+        raise RuntimeError(
+            f"decompose の実行に失敗しました (exit code: {result.returncode})\n"
+            + ("\n".join(failed) if failed else f"stderr: {result.stderr}")
+        )
+    return summaries
+
+
+def count_edges(grh_path: Path) -> int:
+    """
+    Count the e lines of a .grh file.
+
+    .grh ファイルの e 行を数える。
+    """
+    with open(grh_path, 'r') as f:
+        return sum(1 for line in f if line.startswith('e'))
+
+
+def run_decompose_with_stats(input_grh_path: Path, output_grh_path: Path,
+                             threads: int = 1, time_limit: float = 30.0,
+                             gap: int = 0, order_iterations: int = 0,
+                             probe_states: int = 0) -> Tuple[int, int, dict]:
     """
     Run decompose and return statistics.
     
@@ -96,28 +263,22 @@ def run_decompose_with_stats(input_grh_path: Path, output_grh_path: Path) -> Tup
     Args:
         input_grh_path (Path): Input .grh file path
         output_grh_path (Path): Output .grh file path
+        threads, time_limit, gap, order_iterations, probe_states:
+            See run_decompose
     
     Returns:
-        tuple: (input_edge_count, output_edge_count)
+        tuple: (input_edge_count, output_edge_count, search_summary)
     
     Note:
         Edge counts should match. If they don't, it indicates an error.
         辺数は一致すべき。不一致の場合はエラーを示す。
     """
     # decompose を実行
-    run_decompose(input_grh_path, output_grh_path)
-    
-    # 入力辺数をカウント
-    with open(input_grh_path, 'r') as f:
-        input_lines = [line.strip() for line in f if line.strip() and not line.startswith('p')]
-        input_edge_count = len([line for line in input_lines if line.startswith('e')])
-    
-    # 出力辺数をカウント（ヘッダー行を除く）
-    with open(output_grh_path, 'r') as f:
-        output_lines = [line.strip() for line in f if line.strip()]
-        output_edge_count = len([line for line in output_lines if line.startswith('e')])
+    summary = run_decompose(input_grh_path, output_grh_path, threads, time_limit, gap,
+                            order_iterations, probe_states)
     
-    return input_edge_count, output_edge_count
+    # 入力・出力の辺数をカウント（ヘッダー行を除く）
+    return count_edges(input_grh_path), count_edges(output_grh_path), summary
 
 
 if __name__ == "__main__":
@@ -136,10 +297,17 @@ if __name__ == "__main__":
     print(f"  Output: {output_path}")
     
     try:
-        input_edges, output_edges = run_decompose_with_stats(input_path, output_path)
+        input_edges, output_edges, summary = run_decompose_with_stats(input_path, output_path)
         print(f"\n✓ Success!")
         print(f"  Input edges:  {input_edges}")
         print(f"  Output edges: {output_edges}")
+        if "decompose" in summary:
+            d = summary["decompose"]
+            print(f"  Width: {d['width']} (lower bound {d['lower_bound']})")
+        if "edge_order" in summary:
+            o = summary["edge_order"]
+            print(f"  Frontier width: {o['frontier_width']} "
+                  f"(initial {o['initial_frontier_width']})")
         
         if input_edges != output_edges:
             print(f"\n⚠ Warning: 辺数が一致しません")
@@ -0,0 +1,308 @@
+"""
+Binary Input Formats - Compact MOPE and Automorphism Files
+
+Handles:
+- Writing unfoldings_edge_sets.jsonl as a CSR edge-set file (.bin, "STZM")
+- Writing automorphisms.json as a dense uint16 permutation matrix with
+  zero flags and a generating set ("STZA")
+- Reading both formats back
+- Converting the text files of a polyhedron directory
+
+バイナリ入力形式 — MOPE と自己同型のコンパクトなファイル:
+- unfoldings_edge_sets.jsonl を CSR 形式の辺集合ファイル（"STZM"）として書き込み
+- automorphisms.json を uint16 の密な置換行列・ゼロフラグ・生成系
+  （"STZA"）として書き込み
+- 両形式の読み戻し
+- 多面体ディレクトリのテキストファイルの変換
+
+Format (all integers little-endian; InputLoader.hpp reads the same layout):
+    unfoldings_edge_sets.bin
+        header: magic "STZM", uint32 version = 1, uint32 num_edges,
+                uint32 reserved = 0, uint64 num_sets, uint64 num_entries
+        uint64 offset[num_sets + 1]      set i = edges[offset[i], offset[i+1])
+        int32  edges[num_entries]        each set sorted ascending
+    automorphisms.bin
+        header: magic "STZA", uint32 version = 1, uint32 num_edges,
+                uint32 group_order, uint32 num_perms, uint32 num_generators,
+                uint32 flags (bit 0 = zero flags present), uint32 reserved = 0
+        uint16 perms[num_perms][num_edges], padded to 4 bytes
+        uint8  zero_flags[num_perms] (if flag bit 0), padded to 4 bytes
+        uint32 generators[num_generators] (indices into perms)
+
+    Both headers are 32 bytes and every array starts aligned to its element
+    size, so spanning_tree_zdd uses the mapped file directly.
+
+形式（整数は全てリトルエンディアン。InputLoader.hpp が同じ配置を読む）:
+    両ヘッダは 32 バイトで、各配列は要素サイズに整列して始まるため、
+    spanning_tree_zdd はマップしたファイルをそのまま使う。
+
+Usage:
+    # Convert a polyhedron directory / 多面体ディレクトリを変換
+    PYTHONPATH=python python -m graph_export.binary_format data/polyhedra/johnson/n20
+"""
+
+import argparse
+import json
+import struct
+import sys
+from pathlib import Path
+from typing import Dict, List, Sequence, Tuple
+
+MOPE_MAGIC = b"STZM"
+AUTOMORPHISM_MAGIC = b"STZA"
+VERSION = 1
+MOPE_HEADER = struct.Struct("<4sIIIQQ")
+AUTOMORPHISM_HEADER = struct.Struct("<4sIIIIIII")
+FLAG_ZERO_FLAGS = 1
+
+MOPE_BINARY_NAME = "unfoldings_edge_sets.bin"
+AUTOMORPHISM_BINARY_NAME = "automorphisms.bin"
+
+
+def _pad4(data: bytearray) -> None:
+    data.extend(b"\0" * (-len(data) % 4))
+
+
+def _check_header(raw: bytes, header: struct.Struct, magic: bytes) -> tuple:
+    if len(raw) < header.size:
+        raise ValueError("truncated header")
+    fields = header.unpack_from(raw)
+    if fields[0] != magic:
+        raise ValueError("bad magic")
+    if fields[1] != VERSION:
+        raise ValueError(f"unsupported version {fields[1]}")
+    return fields
+
+
+# ============================================================================
+# MOPE families / MOPE 族
+# ============================================================================
+
+def encode_edge_sets(edge_sets: Sequence[Sequence[int]], num_edges: int) -> bytes:
+    """
+    CSR file contents for a family of edge sets. Sets are sorted and
+    deduplicated; empty sets are dropped, as the JSONL loader does.
+
+    辺集合族の CSR ファイル内容。各集合はソート・重複除去し、空集合は
+    JSONL ローダーと同様に除く。
+    """
+    offsets = [0]
+    entries: List[int] = []
+    for s in edge_sets:
+        edges = sorted(set(s))
+        if not edges:
+            continue
+        if edges[-1] >= num_edges:
+            raise ValueError(f"edge {edges[-1]} out of range (num_edges = {num_edges})")
+        entries.extend(edges)
+        offsets.append(len(entries))
+    data = bytearray(MOPE_HEADER.pack(MOPE_MAGIC, VERSION, num_edges, 0,
+                                      len(offsets) - 1, len(entries)))
+    data += struct.pack(f"<{len(offsets)}Q", *offsets)
+    data += struct.pack(f"<{len(entries)}i", *entries)
+    return bytes(data)
+
+
+def decode_edge_sets(raw: bytes) -> Tuple[int, List[List[int]]]:
+    """
+    Returns:
+        tuple: (num_edges, edge sets)
+    """
+    _, _, num_edges, _, num_sets, num_entries = _check_header(raw, MOPE_HEADER, MOPE_MAGIC)
+    pos = MOPE_HEADER.size
+    if len(raw) < pos + 8 * (num_sets + 1) + 4 * num_entries:
+        raise ValueError("truncated edge-set file")
+    offsets = struct.unpack_from(f"<{num_sets + 1}Q", raw, pos)
+    pos += 8 * (num_sets + 1)
+    entries = struct.unpack_from(f"<{num_entries}i", raw, pos)
+    return num_edges, [list(entries[offsets[i]:offsets[i + 1]]) for i in range(num_sets)]
+
+
+# ============================================================================
+# Automorphism groups / 自己同型群
+# ============================================================================
+
+def generating_set(perms: Sequence[Sequence[int]]) -> List[int]:
+    """
+    Indices of a generating set of the group listed by perms, chosen
+    greedily in list order (each one is outside the group generated by
+    the previous ones).
+
+    perms が列挙する群の生成系の番号。リスト順に貪欲に選ぶ（各生成元は
+    それまでの生成元が生成する群に含まれない）。
+    """
+    if not perms:
+        return []
+    identity = tuple(range(len(perms[0])))
+    closure = {identity}
+    chosen: List[Tuple[int, ...]] = []
+    indices: List[int] = []
+    for i, p in enumerate(perms):
+        p = tuple(p)
+        if p in closure:
+            continue
+        chosen.append(p)
+        indices.append(i)
+        closure = {identity}
+        queue = [identity]
+        while queue:
+            g = queue.pop()
+            for h in chosen:
+                gh = tuple(g[e] for e in h)
+                if gh not in closure:
+                    closure.add(gh)
+                    queue.append(gh)
+    return indices
+
+
+def encode_automorphisms(automorphisms: Dict) -> bytes:
+    """
+    Binary file contents for a parsed automorphisms.json.
+
+    読み込んだ automorphisms.json のバイナリファイル内容。
+    """
+    perms = automorphisms["edge_permutations"]
+    num_edges = automorphisms.get("num_edges", len(perms[0]) if perms else 0)
+    if num_edges > 0xFFFF:
+        raise ValueError(f"num_edges = {num_edges} does not fit in uint16")
+    zero_flags = automorphisms.get("zero_flags")
+    generators = generating_set(perms)
+
+    flags = FLAG_ZERO_FLAGS if zero_flags is not None else 0
+    data = bytearray(AUTOMORPHISM_HEADER.pack(
+        AUTOMORPHISM_MAGIC, VERSION, num_edges, automorphisms["group_order"],
+        len(perms), len(generators), flags, 0))
+    for p in perms:
+        if len(p) != num_edges:
+            raise ValueError("permutation length differs from num_edges")
+        data += struct.pack(f"<{num_edges}H", *p)
+    _pad4(data)
+    if zero_flags is not None:
+        data += bytes(1 if z else 0 for z in zero_flags)
+        _pad4(data)
+    data += struct.pack(f"<{len(generators)}I", *generators)
+    return bytes(data)
+
+
+def decode_automorphisms(raw: bytes) -> Dict:
+    """
+    Returns:
+        dict: automorphisms.json keys (num_edges, group_order,
+            edge_permutations, zero_flags if present) plus generators
+    """
+    (_, _, num_edges, group_order, num_perms, num_generators,
+     flags, _) = _check_header(raw, AUTOMORPHISM_HEADER, AUTOMORPHISM_MAGIC)
+    pos = AUTOMORPHISM_HEADER.size
+    perms = []
+    for _ in range(num_perms):
+        perms.append(list(struct.unpack_from(f"<{num_edges}H", raw, pos)))
+        pos += 2 * num_edges
+    pos += -pos % 4
+    result = {
+        "num_edges": num_edges,
+        "group_order": group_order,
+        "edge_permutations": perms,
+    }
+    if flags & FLAG_ZERO_FLAGS:
+        result["zero_flags"] = [b != 0 for b in raw[pos:pos + num_perms]]
+        pos += num_perms
+        pos += -pos % 4
+    result["generators"] = list(struct.unpack_from(f"<{num_generators}I", raw, pos))
+    return result
+
+
+# ============================================================================
+# Conversion / 変換
+# ============================================================================
+
+def _num_edges_of_grh(grh_path: Path) -> int:
+    with open(grh_path, 'r') as f:
+        return sum(1 for line in f if line.split())
+
+
+def convert_edge_sets(jsonl_path: Path, output_path: Path, num_edges: int) -> int:
+    """
+    unfoldings_edge_sets.jsonl → binary file. Returns the number of sets.
+
+    unfoldings_edge_sets.jsonl → バイナリファイル。集合の数を返す。
+    """
+    edge_sets = []
+    with open(jsonl_path, 'r') as f:
+        for line in f:
+            if line.strip():
+                edge_sets.append(json.loads(line)["edges"])
+    raw = encode_edge_sets(edge_sets, num_edges)
+    output_path.write_bytes(raw)
+    return MOPE_HEADER.unpack_from(raw)[4]
+
+
+def convert_automorphisms(json_path: Path, output_path: Path) -> Dict:
+    """
+    automorphisms.json → binary file. Returns the decoded header fields.
+
+    automorphisms.json → バイナリファイル。復号したヘッダ項目を返す。
+    """
+    with open(json_path, 'r') as f:
+        automorphisms = json.load(f)
+    raw = encode_automorphisms(automorphisms)
+    output_path.write_bytes(raw)
+    fields = AUTOMORPHISM_HEADER.unpack_from(raw)
+    return {"group_order": fields[3], "num_perms": fields[4], "num_generators": fields[5]}
+
+
+def convert_directory(polyhedron_dir: Path) -> List[Path]:
+    """
+    Write the binary form of every text input present in polyhedron_dir.
+
+    polyhedron_dir にある各テキスト入力のバイナリ形式を書き出す。
+
+    Returns:
+        list[Path]: Files written
+    """
+    written = []
+    edge_sets = polyhedron_dir / "unfoldings_edge_sets.jsonl"
+    grh = polyhedron_dir / "polyhedron.grh"
+    if edge_sets.exists() and grh.exists():
+        output = polyhedron_dir / MOPE_BINARY_NAME
+        count = convert_edge_sets(edge_sets, output, _num_edges_of_grh(grh))
+        print(f"Generated binary edge sets: {output} ({count} sets)")
+        written.append(output)
+    automorphisms = polyhedron_dir / "automorphisms.json"
+    if automorphisms.exists():
+        output = polyhedron_dir / AUTOMORPHISM_BINARY_NAME
+        info = convert_automorphisms(automorphisms, output)
+        print(f"Generated binary automorphisms: {output} "
+              f"(order {info['group_order']}, {info['num_generators']} generators)")
+        written.append(output)
+    return written
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=(
+            "Convert Phase 3 MOPE / automorphism files to the binary formats.\n"
+            "Phase 3 の MOPE・自己同型ファイルをバイナリ形式に変換する"
+        )
+    )
+    parser.add_argument(
+        "poly",
+        nargs="+",
+        help="多面体ディレクトリ（polyhedron.grh と unfoldings_edge_sets.jsonl / automorphisms.json を含む）"
+    )
+    args = parser.parse_args()
+
+    for name in args.poly:
+        polyhedron_dir = Path(name)
+        if not polyhedron_dir.is_dir():
+            print(f"Error: Directory not found: {polyhedron_dir}")
+            sys.exit(1)
+        try:
+            if not convert_directory(polyhedron_dir):
+                print(f"Warning: No input files in {polyhedron_dir}")
+        except (ValueError, KeyError, json.JSONDecodeError) as e:
+            print(f"Error: {polyhedron_dir}: {e}")
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -24,12 +24,14 @@ Responsibility in Phase 3:
 - Validates input files before processing
 - Reports progress and statistics for each block
 - Outputs polyhedron.grh, unfoldings_edge_sets.jsonl, and automorphisms.json
+  (plus their binary forms with --binary)
 
 Phase 3 における責務:
 - Block A + Block B + Block C 実行のための統一 CLI インターフェースを提供
 - 処理前に入力ファイルを検証
 - 各ブロックの進捗と統計を報告
 - polyhedron.grh、unfoldings_edge_sets.jsonl、automorphisms.json を出力
+  （--binary でそれらのバイナリ形式も出力）
 """
 
 import argparse
@@ -42,6 +44,7 @@ from .graph_builder import build_vertex_edge_graph_for_tdzdd
 from .grh_generator import generate_grh_file
 from .edge_set_extractor import extract_edge_sets_from_jsonl, write_edge_sets_jsonl
 from .automorphism_builder import build_automorphisms_json
+from .binary_format import convert_directory
 
 
 def resolve_paths(polyhedron_json_path: str) -> Dict[str, Path]:
@@ -281,6 +284,11 @@ def main():
         required=True,
         help="Path to polyhedron_relabeled.json (e.g., data/polyhedra/johnson/n20/polyhedron_relabeled.json)"
     )
+    parser.add_argument(
+        "--binary",
+        action="store_true",
+        help="unfoldings_edge_sets.bin と automorphisms.bin（バイナリ形式）も書き出す"
+    )
     
     args = parser.parse_args()
     
@@ -322,6 +330,17 @@ def main():
         print(f"Error in Block C: {e}", file=sys.stderr)
         sys.exit(1)
 
+    # Binary copies of the Block B / C outputs
+    # Block B / C 出力のバイナリ版
+    binary_outputs = []
+    if args.binary:
+        try:
+            binary_outputs = convert_directory(paths['output_grh'].parent)
+        except Exception as e:
+            print(f"Error writing binary formats: {e}", file=sys.stderr)
+            sys.exit(1)
+        print()
+
     # Summary
     # サマリー
     print("=" * 60)
@@ -331,6 +350,8 @@ def main():
     print(f"    - {paths['output_grh']}")
     print(f"    - {paths['output_edge_sets']}")
     print(f"    - {paths['output_automorphisms']}")
+    for output in binary_outputs:
+        print(f"    - {output}")
     print("=" * 60)
     
     sys.exit(0)
@@ -0,0 +1,785 @@
+// ============================================================================
+// overlap_check.cpp — Independent geometric check of Phase 5 (MOPE filter)
+// ============================================================================
+//
+// Lays out the unfolding of a spanning tree (cut edges) in the plane from
+// polyhedron_relabeled.json and tests the faces for overlap, without using
+// the MOPE list. Samples are drawn uniformly from the non-overlapping ZDD
+// (Phase 5 result; expected: no overlap) and from the removed set
+// (spanning trees minus Phase 5 result; expected: every tree overlaps).
+//
+// Geometry:
+//   - Regular polygons with unit edges; neighbor lists are clockwise
+//   - Orientations are exact integers in units of 360 / L degrees
+//     (L = lcm of 2 * gon), positions use precomputed cos/sin tables
+//   - Face pairs are found with a uniform grid on face centers and
+//     tested with the separating axis theorem (SAT)
+//
+// Tolerance policy (eps, default 1e-9):
+//   - SAT gap > eps:    separated
+//   - SAT gap < -eps:   face-face overlap
+//   - otherwise:        boundary contact (vertex-vertex, edge-vertex,
+//                       edge-edge), which counts as overlap like the
+//                       exact_overlap kinds in Phase 2, except corners
+//                       joined around a polyhedron vertex by glued sides
+//   - --ignore-touch:   only face-face counts as overlap
+//
+// Usage:
+//   ./overlap_check <polyhedron_data_dir> [--samples N] [--threads N]
+//                   [--seed S] [--eps E] [--ignore-touch]
+//                   [--mismatches out.jsonl]
+//   ./overlap_check <polyhedron_data_dir> --check edges.jsonl|trees.stze
+//
+// Example:
+//   ./overlap_check data/polyhedra/johnson/n54 --samples 1000000
+//   ./overlap_check data/polyhedra/johnson/n54 --check representatives.jsonl
+//
+// ============================================================================
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+
+#include <tdzdd/DdStructure.hpp>
+#include <tdzdd/DdSpecOp.hpp>
+#include <tdzdd/util/Graph.hpp>
+#include "SpanningTree.hpp"
+#include "UnfoldingFilter.hpp"
+#include "ZddIndex.hpp"
+#include "TreeExport.hpp"
+#include "InputLoader.hpp"
+
+using namespace std;
+
+// ============================================================================
+// Load faces from polyhedron_relabeled.json
+// ============================================================================
+struct Face {
+    int gon = 0;
+    vector<int> edge;      // edge_id of side k (clockwise)
+    vector<int> neighbor;  // face_id across side k
+};
+
+// Index of the bracket closing the one at `open`
+size_t match_bracket(const string& s, size_t open) {
+    int depth = 0;
+    for (size_t i = open; i < s.size(); ++i) {
+        if (s[i] == '[' || s[i] == '{') depth++;
+        else if (s[i] == ']' || s[i] == '}') {
+            if (--depth == 0) return i;
+        }
+    }
+    return string::npos;
+}
+
+int int_field(const string& obj, const string& key) {
+    size_t pos = obj.find("\"" + key + "\"");
+    if (pos == string::npos) return -1;
+    pos = obj.find(':', pos);
+    if (pos == string::npos) return -1;
+    return stoi(obj.substr(pos + 1));
+}
+
+bool load_polyhedron(const string& path, vector<Face>& faces) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        cerr << "Error: Cannot open " << path << endl;
+        return false;
+    }
+    string content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    size_t pos = content.find("\"faces\"");
+    if (pos == string::npos) {
+        cerr << "Error: faces not found in " << path << endl;
+        return false;
+    }
+    size_t open = content.find('[', pos);
+    size_t close = match_bracket(content, open);
+
+    for (size_t p = open + 1; ; ) {
+        size_t obj_open = content.find('{', p);
+        if (obj_open == string::npos || obj_open > close) break;
+        size_t obj_close = match_bracket(content, obj_open);
+        string obj = content.substr(obj_open, obj_close - obj_open + 1);
+        p = obj_close + 1;
+
+        // Split off the neighbors array so its face_id keys are not confused
+        size_t nb_key = obj.find("\"neighbors\"");
+        if (nb_key == string::npos) continue;
+        size_t nb_open = obj.find('[', nb_key);
+        size_t nb_close = match_bracket(obj, nb_open);
+        string head = obj.substr(0, nb_key) + obj.substr(nb_close + 1);
+
+        int face_id = int_field(head, "face_id");
+        if (face_id < 0) continue;
+        if (face_id >= (int)faces.size()) faces.resize(face_id + 1);
+        Face& face = faces[face_id];
+        face.gon = int_field(head, "gon");
+
+        for (size_t q = nb_open + 1; ; ) {
+            size_t n_open = obj.find('{', q);
+            if (n_open == string::npos || n_open > nb_close) break;
+            size_t n_close = match_bracket(obj, n_open);
+            string nb = obj.substr(n_open, n_close - n_open + 1);
+            face.edge.push_back(int_field(nb, "edge_id"));
+            face.neighbor.push_back(int_field(nb, "face_id"));
+            q = n_close + 1;
+        }
+    }
+
+    for (size_t f = 0; f < faces.size(); ++f) {
+        if (faces[f].gon < 3 || faces[f].gon != (int)faces[f].edge.size()) {
+            cerr << "Error: Face " << f << " is missing or has inconsistent gon" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Overlap kinds (named like exact_overlap.kind in Phase 2)
+// ============================================================================
+enum OverlapKind { NONE, VERTEX_VERTEX, EDGE_VERTEX, EDGE_EDGE, FACE_FACE, INVALID, NUM_KINDS };
+
+const char* kind_name(int kind) {
+    static const char* names[] = {
+        "none", "vertex-vertex", "edge-vertex", "edge-edge", "face-face", "invalid"
+    };
+    return names[kind];
+}
+
+// ============================================================================
+// Unfolding layout and overlap test
+// ============================================================================
+// Side k of face f (with reference side r at angle A) has its outward
+// normal at A - (k - r) * L / gon; corner k lies between sides k and k+1
+// at A - (k - r) * L / gon - L / (2 gon). A child glued across side k gets
+// that side as its reference, with the normal turned by L / 2.
+class UnfoldingChecker {
+public:
+    // Per-thread scratch space
+    struct Workspace {
+        vector<char> cut;
+        vector<int> queue;
+        vector<int> ref_side;
+        vector<int> ref_angle;
+        vector<double> cx, cy;
+        vector<double> px, py;  // corners, face f at corner_offset[f]
+        vector<int> cell_head, cell_next;
+    };
+
+private:
+    vector<Face> faces;
+    int num_edges;
+    double eps;
+    bool touch_is_overlap;
+
+    int L;                        // angle units per turn
+    vector<double> cos_table, sin_table;
+    vector<double> inradius, circumradius;
+    vector<int> corner_offset;    // prefix sums of gon
+    vector<int> corner_vertex;    // polyhedron vertex of each corner
+    vector<vector<int>> side_in_neighbor;  // [f][k] = side index of the same edge in neighbor
+    int vertex_count;
+    double max_circumradius;
+
+    int find_root(vector<int>& parent, int x) const {
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    }
+
+    int normal_angle(int f, int k, const Workspace& ws) const {
+        int step = L / faces[f].gon;
+        int a = ws.ref_angle[f] - (k - ws.ref_side[f]) * step;
+        return ((a % L) + L) % L;
+    }
+
+    bool glued_neighbors(int f, int g, const Workspace& ws) const {
+        const Face& face = faces[f];
+        for (int k = 0; k < face.gon; ++k) {
+            if (face.neighbor[k] == g && !ws.cut[face.edge[k]]) return true;
+        }
+        return false;
+    }
+
+    bool same_vertex_group(int f, int i, int g, int j, const Workspace& ws) const;
+    int test_pair(int f, int g, const Workspace& ws) const;
+
+public:
+    UnfoldingChecker(const vector<Face>& faces, int num_edges, double eps, bool touch_is_overlap)
+        : faces(faces), num_edges(num_edges), eps(eps), touch_is_overlap(touch_is_overlap) {
+        int F = faces.size();
+
+        L = 1;
+        for (const Face& face : faces) L = lcm(L, 2 * face.gon);
+        cos_table.resize(L);
+        sin_table.resize(L);
+        for (int a = 0; a < L; ++a) {
+            long double t = 2.0L * 3.14159265358979323846264338327950288L * a / L;
+            cos_table[a] = (double)cosl(t);
+            sin_table[a] = (double)sinl(t);
+        }
+
+        corner_offset.assign(F + 1, 0);
+        max_circumradius = 0.0;
+        for (int f = 0; f < F; ++f) {
+            int n = faces[f].gon;
+            inradius.push_back(0.5 / tan(M_PI / n));
+            circumradius.push_back(0.5 / sin(M_PI / n));
+            max_circumradius = max(max_circumradius, circumradius.back());
+            corner_offset[f + 1] = corner_offset[f] + n;
+        }
+
+        // Side index of each edge within the neighboring face
+        side_in_neighbor.resize(F);
+        for (int f = 0; f < F; ++f) {
+            for (int k = 0; k < faces[f].gon; ++k) {
+                const Face& nb = faces[faces[f].neighbor[k]];
+                int m = find(nb.edge.begin(), nb.edge.end(), faces[f].edge[k]) - nb.edge.begin();
+                side_in_neighbor[f].push_back(m < nb.gon ? m : -1);
+            }
+        }
+
+        // Polyhedron vertices: side k runs from corner k-1 to corner k, and
+        // the neighbor traverses the same edge in the opposite direction
+        vector<int> parent(corner_offset[F]);
+        iota(parent.begin(), parent.end(), 0);
+        for (int f = 0; f < F; ++f) {
+            int n = faces[f].gon;
+            for (int k = 0; k < n; ++k) {
+                int g = faces[f].neighbor[k];
+                int m = side_in_neighbor[f][k];
+                if (m < 0) continue;
+                int gn = faces[g].gon;
+                int a = corner_offset[f] + (k + n - 1) % n;
+                int b = corner_offset[f] + k;
+                int c = corner_offset[g] + m;
+                int d = corner_offset[g] + (m + gn - 1) % gn;
+                parent[find_root(parent, a)] = find_root(parent, c);
+                parent[find_root(parent, b)] = find_root(parent, d);
+            }
+        }
+        corner_vertex.resize(corner_offset[F]);
+        vector<int> id(corner_offset[F], -1);
+        vertex_count = 0;
+        for (int i = 0; i < corner_offset[F]; ++i) {
+            int r = find_root(parent, i);
+            if (id[r] < 0) id[r] = vertex_count++;
+            corner_vertex[i] = id[r];
+        }
+    }
+
+    int num_vertices() const { return vertex_count; }
+
+    bool consistent() const {
+        for (const auto& sides : side_in_neighbor) {
+            for (int m : sides) if (m < 0) return false;
+        }
+        return true;
+    }
+
+    void init(Workspace& ws) const {
+        int F = faces.size();
+        ws.cut.assign(num_edges, 0);
+        ws.queue.resize(F);
+        ws.ref_side.resize(F);
+        ws.ref_angle.resize(F);
+        ws.cx.resize(F);
+        ws.cy.resize(F);
+        ws.px.resize(corner_offset[F]);
+        ws.py.resize(corner_offset[F]);
+        ws.cell_next.resize(F);
+    }
+
+    int check(const vector<int>& tree, Workspace& ws) const;
+};
+
+// ============================================================================
+// Are corner i of f and corner j of g one point of the unfolding?
+// ============================================================================
+// True iff both are the same polyhedron vertex and the faces are joined
+// around it by glued sides. Corner k touches sides k (as its end) and k+1
+// (as its start); walk around the vertex in both directions until a cut
+// side is reached.
+bool UnfoldingChecker::same_vertex_group(int f, int i, int g, int j,
+                                         const Workspace& ws) const {
+    if (corner_vertex[corner_offset[f] + i] != corner_vertex[corner_offset[g] + j]) return false;
+    for (int dir = 0; dir < 2; ++dir) {
+        int cf = f, ci = i;
+        for (;;) {
+            int n = faces[cf].gon;
+            int side = (dir == 0) ? ci : (ci + 1) % n;
+            if (ws.cut[faces[cf].edge[side]]) break;
+            int nb = faces[cf].neighbor[side];
+            int m = side_in_neighbor[cf][side];
+            ci = (dir == 0) ? (m + faces[nb].gon - 1) % faces[nb].gon : m;
+            cf = nb;
+            if (cf == g && ci == j) return true;
+            if (cf == f && ci == i) break;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// Test one face pair (not glued to each other)
+// ============================================================================
+int UnfoldingChecker::test_pair(int f, int g, const Workspace& ws) const {
+    double dx = ws.cx[g] - ws.cx[f];
+    double dy = ws.cy[g] - ws.cy[f];
+    double reach = circumradius[f] + circumradius[g] + eps;
+    if (dx * dx + dy * dy > reach * reach) return NONE;
+
+    const double* fx = &ws.px[corner_offset[f]];
+    const double* fy = &ws.py[corner_offset[f]];
+    const double* gx = &ws.px[corner_offset[g]];
+    const double* gy = &ws.py[corner_offset[g]];
+    int fn = faces[f].gon;
+    int gn = faces[g].gon;
+
+    // SAT over the side normals of both faces: largest gap between projections
+    double gap = -1e300;
+    for (int pass = 0; pass < 2 && gap <= eps; ++pass) {
+        int h = pass == 0 ? f : g;
+        for (int k = 0; k < faces[h].gon; ++k) {
+            int a = normal_angle(h, k, ws);
+            double nx = cos_table[a], ny = sin_table[a];
+            double fmin = 1e300, fmax = -1e300, gmin = 1e300, gmax = -1e300;
+            for (int i = 0; i < fn; ++i) {
+                double t = fx[i] * nx + fy[i] * ny;
+                fmin = min(fmin, t);
+                fmax = max(fmax, t);
+            }
+            for (int i = 0; i < gn; ++i) {
+                double t = gx[i] * nx + gy[i] * ny;
+                gmin = min(gmin, t);
+                gmax = max(gmax, t);
+            }
+            gap = max(gap, max(gmin - fmax, fmin - gmax));
+            if (gap > eps) return NONE;
+        }
+    }
+    if (gap < -eps) return FACE_FACE;
+    if (!touch_is_overlap) return NONE;
+
+    // Boundary contact: touching corner pairs that are not the same point
+    // of the unfolding (see same_vertex_group), and corners on sides
+    int vv = 0, ev = 0;
+    double eps2 = eps * eps;
+    for (int i = 0; i < fn; ++i) {
+        for (int j = 0; j < gn; ++j) {
+            double ddx = fx[i] - gx[j], ddy = fy[i] - gy[j];
+            if (ddx * ddx + ddy * ddy <= eps2 && !same_vertex_group(f, i, g, j, ws)) vv++;
+        }
+    }
+    auto on_side = [&](double x, double y, const double* sx, const double* sy, int n) {
+        int hits = 0;
+        for (int k = 0; k < n; ++k) {
+            double ax = sx[k], ay = sy[k];
+            double bx = sx[(k + 1) % n], by = sy[(k + 1) % n];
+            double ux = bx - ax, uy = by - ay;
+            double len2 = ux * ux + uy * uy;
+            double t = ((x - ax) * ux + (y - ay) * uy) / len2;
+            if (t * t * len2 <= eps2 || (1 - t) * (1 - t) * len2 <= eps2) continue;  // near a corner
+            if (t < 0 || t > 1) continue;
+            double cross = (x - ax) * uy - (y - ay) * ux;
+            if (cross * cross <= eps2 * len2) hits++;
+        }
+        return hits;
+    };
+    for (int i = 0; i < fn; ++i) ev += on_side(fx[i], fy[i], gx, gy, gn);
+    for (int j = 0; j < gn; ++j) ev += on_side(gx[j], gy[j], fx, fy, fn);
+
+    if (ev > 0) return (vv + ev >= 2) ? EDGE_EDGE : EDGE_VERTEX;
+    if (vv >= 2) return EDGE_EDGE;
+    if (vv == 1) return VERTEX_VERTEX;
+    return NONE;
+}
+
+// ============================================================================
+// Lay out the unfolding of `tree` (cut edges) and find an overlap
+// ============================================================================
+int UnfoldingChecker::check(const vector<int>& tree, Workspace& ws) const {
+    int F = faces.size();
+    fill(ws.cut.begin(), ws.cut.end(), 0);
+    for (int e : tree) {
+        if (e < 0 || e >= num_edges) return INVALID;
+        ws.cut[e] = 1;
+    }
+    if (num_edges - (int)tree.size() != F - 1) return INVALID;
+
+    // Place faces by BFS over glued edges
+    fill(ws.ref_side.begin(), ws.ref_side.end(), -1);
+    ws.ref_side[0] = 0;
+    ws.ref_angle[0] = 0;
+    ws.cx[0] = ws.cy[0] = 0.0;
+    int head = 0, tail = 0;
+    ws.queue[tail++] = 0;
+    while (head < tail) {
+        int f = ws.queue[head++];
+        const Face& face = faces[f];
+        for (int k = 0; k < face.gon; ++k) {
+            int g = face.neighbor[k];
+            if (ws.cut[face.edge[k]] || ws.ref_side[g] >= 0) continue;
+            int a = normal_angle(f, k, ws);
+            double dist = inradius[f] + inradius[g];
+            ws.cx[g] = ws.cx[f] + dist * cos_table[a];
+            ws.cy[g] = ws.cy[f] + dist * sin_table[a];
+            ws.ref_side[g] = side_in_neighbor[f][k];
+            ws.ref_angle[g] = (a + L / 2) % L;
+            ws.queue[tail++] = g;
+        }
+    }
+    if (tail != F) return INVALID;
+
+    // Corners
+    for (int f = 0; f < F; ++f) {
+        int half = L / (2 * faces[f].gon);
+        for (int k = 0; k < faces[f].gon; ++k) {
+            int a = (normal_angle(f, k, ws) - half + L) % L;
+            ws.px[corner_offset[f] + k] = ws.cx[f] + circumradius[f] * cos_table[a];
+            ws.py[corner_offset[f] + k] = ws.cy[f] + circumradius[f] * sin_table[a];
+        }
+    }
+
+    // Uniform grid on face centers: faces more than one cell apart cannot touch
+    double min_x = *min_element(ws.cx.begin(), ws.cx.end());
+    double min_y = *min_element(ws.cy.begin(), ws.cy.end());
+    double max_x = *max_element(ws.cx.begin(), ws.cx.end());
+    double max_y = *max_element(ws.cy.begin(), ws.cy.end());
+    double cell = 2.0 * max_circumradius + 2.0 * eps;
+    int nx = (int)((max_x - min_x) / cell) + 1;
+    int ny = (int)((max_y - min_y) / cell) + 1;
+    ws.cell_head.assign((size_t)nx * ny, -1);
+    auto cell_of = [&](int f, int& ix, int& iy) {
+        ix = min(nx - 1, (int)((ws.cx[f] - min_x) / cell));
+        iy = min(ny - 1, (int)((ws.cy[f] - min_y) / cell));
+    };
+    for (int f = 0; f < F; ++f) {
+        int ix, iy;
+        cell_of(f, ix, iy);
+        ws.cell_next[f] = ws.cell_head[iy * nx + ix];
+        ws.cell_head[iy * nx + ix] = f;
+    }
+
+    for (int f = 0; f < F; ++f) {
+        int ix, iy;
+        cell_of(f, ix, iy);
+        for (int yy = max(0, iy - 1); yy <= min(ny - 1, iy + 1); ++yy) {
+            for (int xx = max(0, ix - 1); xx <= min(nx - 1, ix + 1); ++xx) {
+                for (int g = ws.cell_head[yy * nx + xx]; g >= 0; g = ws.cell_next[g]) {
+                    if (g <= f || glued_neighbors(f, g, ws)) continue;
+                    int kind = test_pair(f, g, ws);
+                    if (kind != NONE) return kind;
+                }
+            }
+        }
+    }
+    return NONE;
+}
+
+// ============================================================================
+// Spec for members of 2^E not in a given ZDD (used to build the removed set)
+// ============================================================================
+// State is the node reached in `dd` so far; NodeId(0, 0) once the path has
+// left `dd`. Accepts at the end unless the path ends at the 1-terminal.
+class NotInZdd : public tdzdd::DdSpec<NotInZdd, tdzdd::NodeId, 2> {
+    const tdzdd::DdStructure<2>& dd;
+    int num_edges;
+
+public:
+    NotInZdd(const tdzdd::DdStructure<2>& dd, int num_edges)
+        : dd(dd), num_edges(num_edges) {}
+
+    int getRoot(tdzdd::NodeId& f) const {
+        f = dd.root();
+        return num_edges;
+    }
+
+    int getChild(tdzdd::NodeId& f, int level, int value) const {
+        if ((int)f.row() == level) {
+            f = dd.child(f, value);
+        } else if (value == 1) {
+            f = tdzdd::NodeId(0, 0);  // Skipped level taken: not in dd
+        }
+        if (level == 1) return f == tdzdd::NodeId(0, 1) ? 0 : -1;
+        return level - 1;
+    }
+
+    size_t hashCode(tdzdd::NodeId const& f) const {
+        return f.hash();
+    }
+
+    bool equalTo(tdzdd::NodeId const& f, tdzdd::NodeId const& g) const {
+        return f == g;
+    }
+};
+
+// ============================================================================
+// Sample one set in parallel and check every tree
+// ============================================================================
+struct SampleStats {
+    size_t sampled = 0;
+    size_t mismatches = 0;
+    size_t by_kind[NUM_KINDS] = {};
+};
+
+SampleStats run_samples(const ZddIndex& index, const UnfoldingChecker& checker,
+                        const string& set_name, bool expect_overlap, size_t num_samples,
+                        int num_threads, uint64_t seed, ostream* mismatch_out) {
+    SampleStats total;
+    mutex lock;
+
+    auto worker = [&](int t) {
+        // Independent stream per (seed, set, thread)
+        seed_seq seq{(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)expect_overlap, (uint32_t)t};
+        mt19937_64 rng(seq);
+        UnfoldingChecker::Workspace ws;
+        checker.init(ws);
+
+        SampleStats local;
+        size_t count = num_samples / num_threads + ((size_t)t < num_samples % num_threads ? 1 : 0);
+        vector<int> tree;
+        for (size_t i = 0; i < count; ++i) {
+            if (!index.sample(rng, tree)) break;
+            int kind = checker.check(tree, ws);
+            local.sampled++;
+            local.by_kind[kind]++;
+            bool overlapping = (kind != NONE && kind != INVALID);
+            if (kind == INVALID || overlapping != expect_overlap) {
+                local.mismatches++;
+                if (mismatch_out) {
+                    lock_guard<mutex> guard(lock);
+                    *mismatch_out << "{\"set\": \"" << set_name << "\", \"kind\": \""
+                                  << kind_name(kind) << "\", \"edges\": [";
+                    for (size_t k = 0; k < tree.size(); ++k) {
+                        if (k > 0) *mismatch_out << ", ";
+                        *mismatch_out << tree[k];
+                    }
+                    *mismatch_out << "]}\n";
+                }
+            }
+        }
+
+        lock_guard<mutex> guard(lock);
+        total.sampled += local.sampled;
+        total.mismatches += local.mismatches;
+        for (int k = 0; k < NUM_KINDS; ++k) total.by_kind[k] += local.by_kind[k];
+    };
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int t = 1; t < num_threads; ++t) threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : threads) th.join();
+    double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cerr << "  " << set_name << ": " << total.sampled << " sampled, "
+         << total.mismatches << " mismatches ("
+         << (long long)(total.sampled / max(sec, 1e-9) * 3600.0) << " trees/hour)" << endl;
+    return total;
+}
+
+void print_stats(const string& name, const SampleStats& s, bool last) {
+    cout << "  \"" << name << "\": {\"sampled\": " << s.sampled
+         << ", \"mismatches\": " << s.mismatches << ", \"kinds\": {";
+    for (int k = 0; k < NUM_KINDS; ++k) {
+        cout << "\"" << kind_name(k) << "\": " << s.by_kind[k];
+        if (k + 1 < NUM_KINDS) cout << ", ";
+    }
+    cout << "}}" << (last ? "" : ",") << endl;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+int main(int argc, char** argv) {
+    string data_dir;
+    string check_file;
+    string mismatch_file;
+    size_t num_samples = 100000;
+    int num_threads = max(1u, thread::hardware_concurrency());
+    uint64_t seed = 1;
+    double eps = 1e-9;
+    bool touch_is_overlap = true;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--samples" && i + 1 < argc) {
+            num_samples = stoull(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            num_threads = max(1, stoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = stoull(argv[++i]);
+        } else if (arg == "--eps" && i + 1 < argc) {
+            eps = stod(argv[++i]);
+        } else if (arg == "--ignore-touch") {
+            touch_is_overlap = false;
+        } else if (arg == "--mismatches" && i + 1 < argc) {
+            mismatch_file = argv[++i];
+        } else if (arg == "--check" && i + 1 < argc) {
+            check_file = argv[++i];
+        } else if (data_dir.empty()) {
+            data_dir = arg;
+        } else {
+            cerr << "Error: Unexpected argument: " << arg << endl;
+            return 1;
+        }
+    }
+    if (data_dir.empty()) {
+        cerr << "Usage: " << argv[0] << " <polyhedron_data_dir> [--samples N] [--threads N]"
+             << " [--seed S] [--eps E] [--ignore-touch] [--mismatches out.jsonl]"
+             << " [--check edges.jsonl|trees.stze]" << endl;
+        cerr << "Example: " << argv[0] << " data/polyhedra/johnson/n54" << endl;
+        return 1;
+    }
+
+    if (data_dir.back() != '/') data_dir += '/';
+
+    const string grh_file = data_dir + "polyhedron.grh";
+    const string poly_file = data_dir + "polyhedron_relabeled.json";
+    const string edge_sets_file = data_dir + "unfoldings_edge_sets.jsonl";
+
+    // --- Polyhedron graph (edge order of the ZDD) ---
+    tdzdd::Graph G;
+    string load_error;
+    if (!InputLoader::loadGraph(grh_file, G, load_error)) {
+        cerr << "Error: " << load_error << endl;
+        return 1;
+    }
+    int num_edges = G.edgeSize();
+
+    // --- Face geometry ---
+    vector<Face> faces;
+    if (!load_polyhedron(poly_file, faces)) return 1;
+    UnfoldingChecker checker(faces, num_edges, eps, touch_is_overlap);
+    cerr << "Faces: " << faces.size() << ", edges: " << num_edges
+         << ", vertices: " << checker.num_vertices() << endl;
+    if (!checker.consistent() || checker.num_vertices() != G.vertexSize()) {
+        cerr << "Error: Face adjacency in " << poly_file
+             << " does not match " << grh_file << endl;
+        return 1;
+    }
+
+    // --- Check mode: trees given as JSONL or a TreeExport block file ---
+    if (!check_file.empty()) {
+        ifstream file(check_file, ios::binary);
+        if (!file.is_open()) {
+            cerr << "Error: Cannot open " << check_file << endl;
+            return 1;
+        }
+        char magic[4] = {0, 0, 0, 0};
+        file.read(magic, 4);
+        bool block_file = file.gcount() == 4 && equal(magic, magic + 4, TreeExport::MAGIC);
+        file.clear();
+        file.seekg(0);
+
+        unique_ptr<TreeExport::Reader> reader;
+        if (block_file) {
+            reader.reset(new TreeExport::Reader(file));
+            if (!reader->ok() || reader->numEdges() != num_edges) {
+                cerr << "Error: " << check_file << ": "
+                     << (reader->ok() ? "edge count mismatch" : reader->error()) << endl;
+                return 1;
+            }
+        }
+
+        UnfoldingChecker::Workspace ws;
+        checker.init(ws);
+        size_t total = 0, overlapping = 0;
+        string line;
+        vector<int> tree;
+        auto next_tree = [&]() {
+            if (reader) return reader->next(tree);
+            while (getline(file, line)) {
+                if (line.empty()) continue;
+                InputLoader::parseEdgeList(line.data(), line.data() + line.size(), tree);
+                return true;
+            }
+            return false;
+        };
+        while (next_tree()) {
+            int kind = checker.check(tree, ws);
+            total++;
+            if (kind != NONE) overlapping++;
+            cout << "{\"edges\": [";
+            for (size_t k = 0; k < tree.size(); ++k) {
+                if (k > 0) cout << ", ";
+                cout << tree[k];
+            }
+            cout << "], \"overlap\": \"" << kind_name(kind) << "\"}" << endl;
+        }
+        if (reader && !reader->ok()) {
+            cerr << "Error: " << check_file << ": " << reader->error() << endl;
+            return 1;
+        }
+        cerr << "Checked: " << total << ", overlapping or invalid: " << overlapping << endl;
+        return 0;
+    }
+
+    // --- Phase 4 / Phase 5 diagrams ---
+    cerr << "Phase 4: Building spanning tree ZDD..." << endl;
+    SpanningTree ST(G);
+    tdzdd::DdStructure<2> all_trees(ST, true);
+    cerr << "Phase 4: spanning trees = " << all_trees.zddCardinality() << endl;
+
+    cerr << "Phase 5: Applying MOPE filters..." << endl;
+    InputLoader::EdgeSets mopes;
+    if (!InputLoader::loadEdgeSets(edge_sets_file, mopes, load_error)) {
+        cerr << "Error: " << load_error << endl;
+        return 1;
+    }
+    tdzdd::DdStructure<2> kept(all_trees);
+    for (size_t i = 0; i < mopes.size(); ++i) {
+        UnfoldingFilter filter(num_edges, mopes.begin(i), mopes.end(i));
+        kept.zddSubset(filter);
+        kept.zddReduce();
+    }
+    tdzdd::DdStructure<2> removed(tdzdd::zddIntersection(all_trees, NotInZdd(kept, num_edges)));
+    removed.zddReduce();
+    cerr << "Phase 5: non-overlapping = " << kept.zddCardinality()
+         << ", removed = " << removed.zddCardinality() << endl;
+
+    ofstream mismatch_stream;
+    ostream* mismatch_out = nullptr;
+    if (!mismatch_file.empty()) {
+        mismatch_stream.open(mismatch_file);
+        if (!mismatch_stream.is_open()) {
+            cerr << "Error: Cannot open " << mismatch_file << endl;
+            return 1;
+        }
+        mismatch_out = &mismatch_stream;
+    }
+
+    // --- Sample and check both sets ---
+    cerr << "Sampling " << num_samples << " trees per set (" << num_threads
+         << " threads, seed " << seed << ")..." << endl;
+    ZddIndex kept_index(kept, num_edges);
+    ZddIndex removed_index(removed, num_edges);
+    SampleStats kept_stats = run_samples(kept_index, checker, "non_overlapping", false,
+                                         num_samples, num_threads, seed, mismatch_out);
+    SampleStats removed_stats = run_samples(removed_index, checker, "removed", true,
+                                            num_samples, num_threads, seed, mismatch_out);
+
+    cout << "{" << endl;
+    cout << "  \"eps\": " << eps << "," << endl;
+    cout << "  \"touch_is_overlap\": " << (touch_is_overlap ? "true" : "false") << "," << endl;
+    print_stats("non_overlapping", kept_stats, false);
+    print_stats("removed", removed_stats, true);
+    cout << "}" << endl;
+
+    bool pass = (kept_stats.mismatches == 0 && removed_stats.mismatches == 0);
+    if (!pass) {
+        cerr << "  FAIL: geometric check disagrees with the MOPE filter" << endl;
+    }
+    return pass ? 0 : 1;
+}
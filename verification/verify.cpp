@@ -5,171 +5,292 @@
 // Enumerates all non-overlapping spanning trees from ZDD, then applies
 // automorphism-based canonical form to count nonisomorphic unfoldings.
 //
+// Trees are packed bitsets (BigUInt<W>, W = ceil(edges / 64), dispatched
+// by width up to 8 words = 512 edges). Each permutation is applied through
+// a lookup table on 8-bit chunks. Trees are canonicalized while the ZDD is
+// iterated, so memory holds only the canonical set; the ZDD is split into
+// 2^D disjoint sub-diagrams that are iterated on several threads, and the
+// per-thread sets are merged by hash bucket.
+//
 // Usage:
-//   ./verify <polyhedron_data_dir>
+//   ./verify <polyhedron_data_dir> [--threads N] [--split-depth D]
 //
 // Example:
 //   ./verify data/polyhedra/johnson/n54
+//   ./verify data/polyhedra/archimedean/s07 --threads 8
 //
 // ============================================================================
 
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
-#include <set>
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 
 #include <tdzdd/DdStructure.hpp>
+#include <tdzdd/DdSpecOp.hpp>
 #include <tdzdd/util/Graph.hpp>
 #include "SpanningTree.hpp"
 #include "UnfoldingFilter.hpp"
+#include "EdgeRestrictor.hpp"
+#include "BigUInt.hpp"
+#include "BitState.hpp"
+#include "InputLoader.hpp"
 
 using namespace std;
 
 // ============================================================================
-// Parse {"edges": [0, 1, 2, ...]} from a JSON line
+// Lexicographic order on packed trees
 // ============================================================================
-set<int> extract_edges(const string& line) {
-    set<int> edges;
-    size_t start = line.find('[');
-    size_t end = line.find(']');
-    if (start == string::npos || end == string::npos) return edges;
-
-    string nums = line.substr(start + 1, end - start - 1);
-    stringstream ss(nums);
-    string token;
-    while (getline(ss, token, ',')) {
-        size_t f = token.find_first_not_of(" \t");
-        size_t l = token.find_last_not_of(" \t");
-        if (f != string::npos && l != string::npos) {
-            edges.insert(stoi(token.substr(f, l - f + 1)));
-        }
+// All spanning trees have the same number of edges, so comparing sorted
+// edge vectors reduces to: the smallest edge in the symmetric difference
+// belongs to the smaller tree. This matches `vector<int>` comparison of
+// the sorted edge lists.
+template<size_t W>
+bool lex_less(const BigUInt<W>& a, const BigUInt<W>& b) {
+    for (size_t i = 0; i < W; ++i) {
+        uint64_t diff = a.word(i) ^ b.word(i);
+        if (diff != 0) return (a.word(i) & diff & (~diff + 1)) != 0;
     }
-    return edges;
+    return false;
 }
 
-// ============================================================================
-// Load MOPEs from edge_sets.jsonl
-// ============================================================================
-vector<set<int>> load_mopes(const string& path) {
-    vector<set<int>> mopes;
-    ifstream file(path);
-    if (!file.is_open()) {
-        cerr << "Error: Cannot open " << path << endl;
-        return mopes;
-    }
-    string line;
-    while (getline(file, line)) {
-        if (line.empty()) continue;
-        set<int> e = extract_edges(line);
-        if (!e.empty()) mopes.push_back(e);
+template<size_t W>
+struct PackedTreeHash {
+    size_t operator()(const BigUInt<W>& t) const {
+        uint64_t h = 0;
+        for (size_t i = 0; i < W; ++i) {
+            h = BitState::mix64(h ^ t.word(i));
+        }
+        return h;
     }
-    return mopes;
-}
+};
 
 // ============================================================================
-// Load automorphisms (edge permutations) from automorphisms.json
+// Permutation lookup table on 8-bit chunks
 // ============================================================================
-vector<vector<int>> load_automorphisms(const string& path, int& group_order) {
-    vector<vector<int>> perms;
-    ifstream file(path);
-    if (!file.is_open()) {
-        cerr << "Error: Cannot open " << path << endl;
-        return perms;
-    }
+// table[c * 256 + b] is the image of byte value b at chunk c (edges
+// 8c .. 8c+7), so applying a permutation costs one OR per nonzero byte
+// instead of one lookup per edge plus a sort.
+template<size_t W>
+class PermutationTable {
+private:
+    int num_chunks;
+    vector<BigUInt<W>> table;
 
-    string content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
-    file.close();
-
-    // Extract group_order
-    {
-        size_t pos = content.find("\"group_order\"");
-        pos = content.find(':', pos);
-        pos++;
-        while (pos < content.size() && (content[pos] == ' ' || content[pos] == '\t')) pos++;
-        size_t end = pos;
-        while (end < content.size() && isdigit(content[end])) end++;
-        group_order = stoi(content.substr(pos, end - pos));
+public:
+    PermutationTable(const vector<int>& perm, int num_edges)
+        : num_chunks((num_edges + 7) / 8), table(num_chunks * 256) {
+        for (int c = 0; c < num_chunks; ++c) {
+            for (int b = 0; b < 256; ++b) {
+                BigUInt<W>& image = table[c * 256 + b];
+                for (int k = 0; k < 8; ++k) {
+                    int e = c * 8 + k;
+                    if ((b >> k & 1) && e < num_edges) {
+                        image.setBit(BigUIntHelper::BitPos(perm[e]));
+                    }
+                }
+            }
+        }
     }
 
-    // Extract edge_permutations
-    size_t pos = content.find("\"edge_permutations\"");
-    pos = content.find('[', pos);
-    pos++; // skip outer '['
-
-    // Find matching outer ']' by counting brackets
-    int depth = 1;
-    size_t outer_end = pos;
-    while (outer_end < content.size() && depth > 0) {
-        if (content[outer_end] == '[') depth++;
-        else if (content[outer_end] == ']') depth--;
-        outer_end++;
+    BigUInt<W> apply(const BigUInt<W>& tree) const {
+        BigUInt<W> result;
+        for (int c = 0; c < num_chunks; ++c) {
+            unsigned byte = (tree.word(c / 8) >> (8 * (c % 8))) & 0xFF;
+            if (byte != 0) result |= table[c * 256 + byte];
+        }
+        return result;
     }
+};
 
-    while (pos < outer_end) {
-        size_t arr_start = content.find('[', pos);
-        if (arr_start == string::npos || arr_start >= outer_end) break;
-        size_t arr_end = content.find(']', arr_start);
-        if (arr_end == string::npos || arr_end >= outer_end) break;
-
-        string arr = content.substr(arr_start + 1, arr_end - arr_start - 1);
-        vector<int> perm;
-        stringstream ss(arr);
-        string token;
-        while (getline(ss, token, ',')) {
-            size_t f = token.find_first_not_of(" \t\n");
-            size_t l = token.find_last_not_of(" \t\n");
-            if (f != string::npos && l != string::npos) {
-                perm.push_back(stoi(token.substr(f, l - f + 1)));
-            }
+// ============================================================================
+// Compute canonical form: lexicographically smallest under all automorphisms
+// ============================================================================
+template<size_t W>
+BigUInt<W> canonical_form(const BigUInt<W>& tree,
+                          const vector<PermutationTable<W>>& tables) {
+    BigUInt<W> canonical = tree;
+    for (const auto& table : tables) {
+        BigUInt<W> mapped = table.apply(tree);
+        if (lex_less(mapped, canonical)) {
+            canonical = mapped;
         }
-        if (!perm.empty()) perms.push_back(perm);
-        pos = arr_end + 1;
     }
-
-    return perms;
+    return canonical;
 }
 
 // ============================================================================
-// Apply edge permutation to a spanning tree (edge set)
+// Per-thread canonical set, split into hash buckets
 // ============================================================================
-vector<int> apply_permutation(const set<int>& tree, const vector<int>& perm) {
-    vector<int> result;
-    result.reserve(tree.size());
-    for (int e : tree) {
-        result.push_back(perm[e]);
+// Each worker owns one BucketedSet, so inserts take no lock. After the
+// workers finish, bucket b of every worker is merged independently (and
+// in parallel), so only one bucket's duplicates are alive at a time per
+// merging thread.
+template<size_t W>
+using TreeSet = unordered_set<BigUInt<W>, PackedTreeHash<W>>;
+
+template<size_t W>
+struct BucketedSet {
+    vector<TreeSet<W>> buckets;
+
+    explicit BucketedSet(int num_buckets) : buckets(num_buckets) {}
+
+    void insert(const BigUInt<W>& key) {
+        // High hash bits pick the bucket; unordered_set uses the low bits
+        size_t h = PackedTreeHash<W>()(key);
+        buckets[(h >> 40) % buckets.size()].insert(key);
     }
-    sort(result.begin(), result.end());
-    return result;
+};
+
+template<size_t W>
+size_t merge_buckets(vector<BucketedSet<W>>& locals, int num_buckets, int num_threads) {
+    atomic<int> next(0);
+    atomic<size_t> total(0);
+
+    auto worker = [&]() {
+        for (;;) {
+            int b = next.fetch_add(1);
+            if (b >= num_buckets) break;
+            size_t largest = 0;
+            for (size_t t = 1; t < locals.size(); ++t) {
+                if (locals[t].buckets[b].size() > locals[largest].buckets[b].size()) {
+                    largest = t;
+                }
+            }
+            TreeSet<W> merged = move(locals[largest].buckets[b]);
+            for (size_t t = 0; t < locals.size(); ++t) {
+                if (t == largest) continue;
+                merged.insert(locals[t].buckets[b].begin(), locals[t].buckets[b].end());
+                TreeSet<W>().swap(locals[t].buckets[b]);
+            }
+            total += merged.size();
+        }
+    };
+
+    vector<thread> threads;
+    for (int t = 1; t < num_threads; ++t) threads.emplace_back(worker);
+    worker();
+    for (auto& th : threads) th.join();
+    return total;
 }
 
 // ============================================================================
-// Compute canonical form: lexicographically smallest under all automorphisms
+// Stream, canonicalize and count for a fixed packed width W
 // ============================================================================
-vector<int> canonical_form(const set<int>& tree, const vector<vector<int>>& perms) {
-    vector<int> canonical(tree.begin(), tree.end());
+// Trees are never materialized: each tree is canonicalized as soon as the
+// ZDD iterator yields it, and only canonical forms are kept. With
+// split_depth D > 0 the ZDD is split into 2^D disjoint sub-diagrams by
+// fixing the first D edges (EdgeRestrictor), and workers iterate them in
+// parallel. Building a sub-diagram copies `dd` as a spec, which is not
+// thread-safe in TdZdd, so that step is serialized.
+template<size_t W>
+size_t count_nonisomorphic(const tdzdd::DdStructure<2>& dd, int num_edges,
+                           const vector<vector<int>>& perms, int num_threads,
+                           int split_depth, size_t& enumerated) {
+    vector<PermutationTable<W>> tables;
+    tables.reserve(perms.size());
     for (const auto& perm : perms) {
-        vector<int> mapped = apply_permutation(tree, perm);
-        if (mapped < canonical) {
-            canonical = mapped;
-        }
+        tables.emplace_back(perm, num_edges);
     }
-    return canonical;
+
+    const int num_parts = 1 << split_depth;
+    const int num_buckets = 4 * num_threads;
+    cerr << "Phase 6 verification: streaming canonical forms ("
+         << num_threads << " threads, " << num_parts << " partitions)..." << endl;
+
+    const size_t FLUSH = 4096;
+    const size_t REPORT_INTERVAL = 100000;
+    vector<BucketedSet<W>> locals(num_threads, BucketedSet<W>(num_buckets));
+    atomic<int> next(0);
+    atomic<size_t> processed(0);
+    mutex dd_lock;
+    mutex log_lock;
+
+    auto worker = [&](int id) {
+        BucketedSet<W>& local = locals[id];
+        size_t pending = 0;
+        auto flush = [&]() {
+            size_t done = processed.fetch_add(pending) + pending;
+            if ((done - pending) / REPORT_INTERVAL != done / REPORT_INTERVAL) {
+                lock_guard<mutex> guard(log_lock);
+                cerr << "  Processed: " << done << endl;
+            }
+            pending = 0;
+        };
+        // ZDD iterator returns level numbers (1-indexed), not edge indices.
+        // Level i corresponds to edge index (num_edges - i).
+        auto consume = [&](const tdzdd::DdStructure<2>& part) {
+            for (auto it = part.begin(); it != part.end(); ++it) {
+                BigUInt<W> tree;
+                for (int level : *it) {
+                    tree.setBit(BigUIntHelper::BitPos(num_edges - level));
+                }
+                local.insert(canonical_form(tree, tables));
+                if (++pending == FLUSH) flush();
+            }
+        };
+
+        for (;;) {
+            int p = next.fetch_add(1);
+            if (p >= num_parts) break;
+            if (split_depth == 0) {
+                consume(dd);
+                continue;
+            }
+            unique_ptr<tdzdd::DdStructure<2>> part;
+            {
+                lock_guard<mutex> guard(dd_lock);
+                part.reset(new tdzdd::DdStructure<2>(
+                    tdzdd::zddIntersection(dd, EdgeRestrictor(num_edges, split_depth, p))));
+            }
+            consume(*part);
+        }
+        flush();
+    };
+
+    vector<thread> threads;
+    for (int t = 1; t < num_threads; ++t) threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : threads) th.join();
+
+    enumerated = processed;
+    cerr << "Enumerated: " << enumerated << endl;
+    cerr << "Merging " << num_buckets << " hash buckets..." << endl;
+    return merge_buckets(locals, num_buckets, num_threads);
 }
 
 // ============================================================================
 // Main
 // ============================================================================
 int main(int argc, char** argv) {
-    if (argc < 2) {
-        cerr << "Usage: " << argv[0] << " <polyhedron_data_dir>" << endl;
+    string data_dir;
+    int num_threads = max(1u, thread::hardware_concurrency());
+    int split_depth = -1;  // -1 = choose from thread count
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            num_threads = max(1, stoi(argv[++i]));
+        } else if (arg == "--split-depth" && i + 1 < argc) {
+            split_depth = max(0, stoi(argv[++i]));
+        } else if (data_dir.empty()) {
+            data_dir = arg;
+        } else {
+            cerr << "Error: Unexpected argument: " << arg << endl;
+            return 1;
+        }
+    }
+    if (data_dir.empty()) {
+        cerr << "Usage: " << argv[0] << " <polyhedron_data_dir> [--threads N] [--split-depth D]" << endl;
         cerr << "Example: " << argv[0] << " data/polyhedra/johnson/n54" << endl;
         return 1;
     }
 
-    string data_dir = argv[1];
     if (data_dir.back() != '/') data_dir += '/';
 
     const string grh_file = data_dir + "polyhedron.grh";
@@ -179,23 +300,11 @@ int main(int argc, char** argv) {
     // --- Phase 4: Build spanning tree ZDD ---
     cerr << "Phase 4: Building spanning tree ZDD..." << endl;
     tdzdd::Graph G;
-    {
-        ifstream file(grh_file);
-        if (!file.is_open()) {
-            cerr << "Error: Cannot open " << grh_file << endl;
-            return 1;
-        }
-        string line;
-        while (getline(file, line)) {
-            if (line.empty()) continue;
-            stringstream ss(line);
-            int u, v;
-            if (ss >> u >> v) {
-                G.addEdge(to_string(u), to_string(v));
-            }
-        }
+    string load_error;
+    if (!InputLoader::loadGraph(grh_file, G, load_error)) {
+        cerr << "Error: " << load_error << endl;
+        return 1;
     }
-    G.update();
 
     SpanningTree ST(G);
     tdzdd::DdStructure<2> dd(ST, true);
@@ -204,61 +313,79 @@ int main(int argc, char** argv) {
 
     // --- Phase 5: Apply MOPE filters ---
     cerr << "Phase 5: Applying MOPE filters..." << endl;
-    vector<set<int>> mopes = load_mopes(edge_sets_file);
+    InputLoader::EdgeSets mopes;
+    if (!InputLoader::loadEdgeSets(edge_sets_file, mopes, load_error)) {
+        cerr << "Error: " << load_error << endl;
+        return 1;
+    }
     cerr << "  MOPEs loaded: " << mopes.size() << endl;
 
     int num_edges = G.edgeSize();
     for (int i = 0; i < (int)mopes.size(); ++i) {
-        UnfoldingFilter<uint64_t> filter(num_edges, mopes[i]);
+        UnfoldingFilter filter(num_edges, mopes.begin(i), mopes.end(i));
         dd.zddSubset(filter);
         dd.zddReduce();
     }
     string nonoverlap_count = dd.zddCardinality();
     cerr << "Phase 5: non-overlapping = " << nonoverlap_count << endl;
 
-    // --- Enumerate all non-overlapping spanning trees from ZDD ---
-    // ZDD iterator returns level numbers (1-indexed), not edge indices.
-    // Level i corresponds to edge index (num_edges - i).
-    cerr << "Enumerating all non-overlapping spanning trees..." << endl;
-    vector<set<int>> trees;
-    for (auto it = dd.begin(); it != dd.end(); ++it) {
-        const set<int>& levels = *it;
-        set<int> edge_set;
-        for (int level : levels) {
-            edge_set.insert(num_edges - level);
-        }
-        trees.push_back(edge_set);
+    // --- Phase 6 verification: load automorphisms ---
+    InputLoader::Automorphisms automorphisms;
+    if (!InputLoader::loadAutomorphisms(auto_file, automorphisms, load_error)) {
+        cerr << "Error: " << load_error << endl;
+        return 1;
     }
-    cerr << "Enumerated: " << trees.size() << endl;
-
-    // --- Phase 6 verification: canonical form ---
-    cerr << "Phase 6 verification: computing canonical forms..." << endl;
-    int group_order = 0;
-    vector<vector<int>> perms = load_automorphisms(auto_file, group_order);
+    int group_order = automorphisms.group_order;
+    const vector<vector<int>>& perms = automorphisms.edge_permutations;
     cerr << "  Group order: " << group_order << endl;
     cerr << "  Permutations loaded: " << perms.size() << endl;
+    for (const auto& perm : perms) {
+        if ((int)perm.size() != num_edges) {
+            cerr << "Error: Permutation size (" << perm.size()
+                 << ") != num_edges (" << num_edges << ")" << endl;
+            return 1;
+        }
+    }
 
-    set<vector<int>> canonical_set;
-    int count = 0;
-    for (const auto& tree : trees) {
-        canonical_set.insert(canonical_form(tree, perms));
-        count++;
-        if (count % 10000 == 0) {
-            cerr << "  Processed: " << count << "/" << trees.size() << endl;
+    // Split depth: a few partitions per thread for load balancing
+    if (split_depth < 0) {
+        split_depth = 0;
+        if (num_threads > 1) {
+            while ((1 << split_depth) < num_threads) split_depth++;
+            split_depth += 2;
         }
     }
+    split_depth = min(split_depth, min(num_edges - 1, 24));
+
+    // Dispatch by packed tree width (64-bit words)
+    size_t enumerated = 0;
+    size_t nonisomorphic = 0;
+    switch (BitState::wordsFor(num_edges)) {
+        case 1: nonisomorphic = count_nonisomorphic<1>(dd, num_edges, perms, num_threads, split_depth, enumerated); break;
+        case 2: nonisomorphic = count_nonisomorphic<2>(dd, num_edges, perms, num_threads, split_depth, enumerated); break;
+        case 3: nonisomorphic = count_nonisomorphic<3>(dd, num_edges, perms, num_threads, split_depth, enumerated); break;
+        case 4: nonisomorphic = count_nonisomorphic<4>(dd, num_edges, perms, num_threads, split_depth, enumerated); break;
+        case 5: nonisomorphic = count_nonisomorphic<5>(dd, num_edges, perms, num_threads, split_depth, enumerated); break;
+        case 6: nonisomorphic = count_nonisomorphic<6>(dd, num_edges, perms, num_threads, split_depth, enumerated); break;
+        case 7: nonisomorphic = count_nonisomorphic<7>(dd, num_edges, perms, num_threads, split_depth, enumerated); break;
+        case 8: nonisomorphic = count_nonisomorphic<8>(dd, num_edges, perms, num_threads, split_depth, enumerated); break;
+        default:
+            cerr << "Error: Edge count (" << num_edges
+                 << ") exceeds maximum supported by verify (512)." << endl;
+            return 1;
+    }
 
     cerr << endl;
     cerr << "=== Verification Results ===" << endl;
     cerr << "  Spanning trees:        " << spanning_count << endl;
     cerr << "  Non-overlapping:       " << nonoverlap_count << endl;
-    cerr << "  Enumerated:            " << trees.size() << endl;
-    cerr << "  Nonisomorphic:         " << canonical_set.size() << endl;
+    cerr << "  Enumerated:            " << enumerated << endl;
+    cerr << "  Nonisomorphic:         " << nonisomorphic << endl;
 
     // Output nonisomorphic count to stdout for scripting
-    cout << canonical_set.size() << endl;
+    cout << nonisomorphic << endl;
 
-    bool pass = (to_string(trees.size()) == nonoverlap_count);
+    bool pass = (to_string(enumerated) == nonoverlap_count);
     if (!pass) {
         cerr << "  FAIL: enumerated count != non-overlapping count" << endl;
     }